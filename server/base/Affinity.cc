@@ -0,0 +1,203 @@
+/**
+* @description: Affinity.cc
+* @author: YQ Huang
+* @brief: CPU亲和性和NUMA内存策略 用于把IO线程固定在指定的CPU和节点上
+* @date: 2026/10/18 21:20:51
+*/
+
+#include "server/base/Affinity.h"
+#include "server/base/FileUtil.h"
+
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace myserver {
+
+namespace {
+
+// applyToCurrentThread()固定到的唯一CPU
+__thread int t_pinnedCpu = -1;
+
+}   // namespace
+
+CpuSet::CpuSet() {
+    CPU_ZERO(&set_);
+}
+
+bool CpuSet::parse(const string& spec, CpuSet* out) {
+    CpuSet result;
+    const char* p = spec.c_str();
+    while(*p && *p != '\n') {
+        char* end = NULL;
+        long first = ::strtol(p, &end, 10);
+        if(end == p || first < 0 || first >= CPU_SETSIZE) {
+            return false;
+        }
+        long last = first;
+        p = end;
+        if(*p == '-') {
+            ++p;
+            last = ::strtol(p, &end, 10);
+            if(end == p || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            p = end;
+        }
+        for(long cpu = first; cpu <= last; ++cpu) {
+            result.add(static_cast<int>(cpu));
+        }
+        if(*p == ',') {
+            ++p;
+        }
+        else if(*p && *p != '\n') {
+            return false;
+        }
+    }
+    *out = result;
+    return true;
+}
+
+CpuSet CpuSet::single(int cpu) {
+    CpuSet set;
+    set.add(cpu);
+    return set;
+}
+
+CpuSet CpuSet::ofCurrentThread() {
+    CpuSet set;
+    ::pthread_getaffinity_np(::pthread_self(), sizeof set.set_, &set.set_);
+    return set;
+}
+
+CpuSet CpuSet::ofNumaNode(int node) {
+    CpuSet set;
+    char path[64];
+    snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+    string content;
+    if(node >= 0 && FileUtil::readFile(path, 4096, &content) == 0) {
+        parse(content, &set);
+    }
+    return set;
+}
+
+void CpuSet::add(int cpu) {
+    if(cpu >= 0 && cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &set_);
+    }
+}
+
+bool CpuSet::contains(int cpu) const {
+    return cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &set_);
+}
+
+int CpuSet::count() const {
+    return CPU_COUNT(&set_);
+}
+
+int CpuSet::first() const {
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if(CPU_ISSET(cpu, &set_)) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+std::vector<int> CpuSet::cpus() const {
+    std::vector<int> result;
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if(CPU_ISSET(cpu, &set_)) {
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+// 连续的编号合并成区间
+string CpuSet::toString() const {
+    string result;
+    char buf[32];
+    int cpu = 0;
+    while(cpu < CPU_SETSIZE) {
+        if(!CPU_ISSET(cpu, &set_)) {
+            ++cpu;
+            continue;
+        }
+        int last = cpu;
+        while(last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set_)) {
+            ++last;
+        }
+        if(last == cpu) {
+            snprintf(buf, sizeof buf, "%s%d", result.empty() ? "" : ",", cpu);
+        }
+        else {
+            snprintf(buf, sizeof buf, "%s%d-%d", result.empty() ? "" : ",", cpu, last);
+        }
+        result += buf;
+        cpu = last + 1;
+    }
+    return result;
+}
+
+int CpuSet::applyToCurrentThread() const {
+    int err = ::pthread_setaffinity_np(::pthread_self(), sizeof set_, &set_);
+    if(err == 0) {
+        t_pinnedCpu = count() == 1 ? first() : -1;
+    }
+    return err;
+}
+
+int CpuSet::pinnedCpuOfCurrentThread() {
+    return t_pinnedCpu;
+}
+
+namespace Numa {
+
+int numNodes() {
+    string content;
+    CpuSet nodes;   // 节点编号的格式和CPU列表相同
+    if(FileUtil::readFile("/sys/devices/system/node/online", 4096, &content) == 0
+       && CpuSet::parse(content, &nodes) && !nodes.empty())
+    {
+        return nodes.cpus().back() + 1;
+    }
+    return 1;
+}
+
+int nodeOfCpu(int cpu) {
+    int nodes = numNodes();
+    for(int node = 0; node < nodes; ++node) {
+        if(CpuSet::ofNumaNode(node).contains(cpu)) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+int setMemoryNode(int node, bool strict) {
+    const int kMaxNodes = 1024;
+    unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = { 0 };
+    int mode = MPOL_DEFAULT;
+    unsigned long maxNode = 0;
+    if(node >= 0) {
+        if(node >= kMaxNodes) {
+            return EINVAL;
+        }
+        mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+        mode = strict ? MPOL_BIND : MPOL_PREFERRED;
+        maxNode = kMaxNodes;
+    }
+    if(::syscall(SYS_set_mempolicy, mode, node >= 0 ? mask : NULL, maxNode) < 0) {
+        return errno;
+    }
+    return 0;
+}
+
+}   // namespace Numa
+
+}   // namespace myserver
@@ -0,0 +1,82 @@
+/**
+* @description: Affinity.h
+* @author: YQ Huang
+* @brief: CPU亲和性和NUMA内存策略 用于把IO线程固定在指定的CPU和节点上
+* @date: 2026/10/18 21:20:44
+*/
+
+#pragma once
+
+#include "server/base/copyable.h"
+#include "server/base/Types.h"
+
+#include <vector>
+#include <sched.h>
+
+namespace myserver {
+
+/**
+ * CPU集合 cpu_set_t的值类型封装
+ * 字符串形式与/sys/devices/system/cpu/online和taskset -c相同 例如 "0-3,8,10-11"
+ */
+class CpuSet : public copyable {
+public:
+    CpuSet();
+
+    // 解析字符串 格式错误或CPU编号超出CPU_SETSIZE时返回false
+    static bool parse(const string& spec, CpuSet* out);
+    // 只包含一个CPU
+    static CpuSet single(int cpu);
+    // 调用线程当前允许运行的CPU
+    static CpuSet ofCurrentThread();
+    // 某个NUMA节点上的CPU 读取失败时为空
+    static CpuSet ofNumaNode(int node);
+
+    void add(int cpu);
+    bool contains(int cpu) const;
+    int count() const;
+    bool empty() const { return count() == 0; }
+    // 编号最小的CPU 空集合返回-1
+    int first() const;
+    std::vector<int> cpus() const;
+    string toString() const;
+
+    // 把调用线程固定在这些CPU上 失败返回errno
+    int applyToCurrentThread() const;
+    /**
+     * 调用线程通过applyToCurrentThread()固定在唯一一个CPU上时返回它 否则返回-1
+     * 单CPU的机器或受cpuset限制的容器里 ofCurrentThread()也可能只有一个CPU 但不算固定
+     */
+    static int pinnedCpuOfCurrentThread();
+
+    const cpu_set_t& native() const { return set_; }
+
+    bool operator==(const CpuSet& rhs) const { return CPU_EQUAL(&set_, &rhs.set_); }
+
+private:
+    cpu_set_t set_;
+};
+
+/**
+ * NUMA 不依赖libnuma 直接读sysfs和调用set_mempolicy
+ * 线程的内存策略决定它第一次访问(缺页)的内存页从哪个节点分配 glibc的malloc按线程
+ * 使用不同的arena 所以IO线程自己分配和写入的缓冲区 连接对象都会落在设定的节点上
+ */
+namespace Numa {
+
+// 节点个数 没有NUMA时为1
+int numNodes();
+// CPU所在的节点 找不到时返回-1
+int nodeOfCpu(int cpu);
+
+/**
+ * 设置调用线程的内存策略
+ * strict为false时用MPOL_PREFERRED 节点内存不足时可以从其他节点分配
+ * strict为true时用MPOL_BIND 只从这个节点分配
+ * node为-1时恢复默认策略 失败返回errno
+ */
+int setMemoryNode(int node, bool strict = false);
+
+}   // namespace Numa
+
+}   // namespace myserver
@@ -0,0 +1,166 @@
+/**
+* @description: AsyncLogging.cc
+* @author: YQ Huang
+* @brief: 异步日志 双缓冲技术
+* @date: 2026/10/18 11:02:41
+*/
+
+#include "server/base/AsyncLogging.h"
+#include "server/base/LogFile.h"
+#include "server/base/Timestamp.h"
+
+#include <stdio.h>
+
+namespace myserver {
+
+// 构造函数 只初始化参数和缓冲区 后端线程在start()中启动
+AsyncLogging::AsyncLogging(const string& basename,
+                           off_t rollSize,
+                           int flushInterval,
+                           int maxBacklog)
+    : flushInterval_(flushInterval),
+      maxBacklog_(maxBacklog),
+      running_(false),
+      basename_(basename),
+      rollSize_(rollSize),
+      archiver_(NULL),
+      directIO_(false),
+      thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"),
+      latch_(1),
+      mutex_(),
+      cond_(mutex_),
+      currentBuffer_(new Buffer),
+      nextBuffer_(new Buffer),
+      buffers_()
+{
+    currentBuffer_->bzero();
+    nextBuffer_->bzero();
+    buffers_.reserve(16);
+}
+
+/**
+ * 前端 把一条日志消息追加到当前缓冲区
+ * 1) 当前缓冲区剩余空间足够 直接拷贝 这是最常见的情况
+ * 2) 当前缓冲区写满了 把它放入buffers_ 换上预备缓冲区 并通知后端写文件
+ * 3) 预备缓冲区也用完了(前端写得太快) 积压不多时新分配一块 积压过多时丢弃
+ */
+void AsyncLogging::append(const char* logline, int len) {
+    MutexLockGuard lock(mutex_);
+    if(currentBuffer_->avail() > len) {
+        currentBuffer_->append(logline, len);
+        return;
+    }
+
+    if(buffers_.size() >= maxBacklog_) {
+        droppedMessages_.increment();
+        droppedBytes_.add(len);
+        return;
+    }
+
+    buffers_.push_back(std::move(currentBuffer_));
+    if(nextBuffer_) {
+        currentBuffer_ = std::move(nextBuffer_);
+    }
+    else {
+        currentBuffer_.reset(new Buffer);   // 很少发生
+    }
+    currentBuffer_->append(logline, len);
+    cond_.notify();
+}
+
+// 前端因为积压丢弃了日志 在写出这一批缓冲区之前留下记录
+void AsyncLogging::reportDrops(LogFile* output, int64_t* reportedDrops) {
+    int64_t dropped = droppedMessages_.get();
+    if(dropped != *reportedDrops) {
+        char buf[256];
+        snprintf(buf, sizeof buf, "Dropped %lld log messages at %s, %lld dropped in total\n",
+                 static_cast<long long>(dropped - *reportedDrops),
+                 Timestamp::now().toFormattedString().c_str(),
+                 static_cast<long long>(dropped));
+        fputs(buf, stderr);
+        output->append(buf, static_cast<int>(strlen(buf)));
+        *reportedDrops = dropped;
+    }
+}
+
+/**
+ * 后端线程 准备好两块空缓冲区newBuffer1和newBuffer2
+ * 每次在临界区内交换出前端写满的缓冲区 然后在临界区外写文件
+ */
+void AsyncLogging::threadFunc() {
+    assert(running_ == true);
+    latch_.countDown();
+    LogFile output(basename_, rollSize_, false, 3, 1024, directIO_);
+    output.setArchiver(archiver_);
+    BufferPtr newBuffer1(new Buffer);
+    BufferPtr newBuffer2(new Buffer);
+    newBuffer1->bzero();
+    newBuffer2->bzero();
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(16);
+    int64_t reportedDrops = 0;
+
+    while(running_) {
+        assert(newBuffer1 && newBuffer1->length() == 0);
+        assert(newBuffer2 && newBuffer2->length() == 0);
+        assert(buffersToWrite.empty());
+
+        {
+            MutexLockGuard lock(mutex_);
+            // 这里用if而不是while 超时后即使没有写满的缓冲区也要把currentBuffer_写出去
+            if(buffers_.empty()) {
+                cond_.waitForSeconds(flushInterval_);
+            }
+            buffers_.push_back(std::move(currentBuffer_));
+            currentBuffer_ = std::move(newBuffer1);
+            buffersToWrite.swap(buffers_);
+            if(!nextBuffer_) {
+                nextBuffer_ = std::move(newBuffer2);
+            }
+        }
+
+        assert(!buffersToWrite.empty());
+
+        reportDrops(&output, &reportedDrops);
+        for(const auto& buffer : buffersToWrite) {
+            output.append(buffer->data(), buffer->length());
+        }
+
+        // 只留下两块缓冲区用于newBuffer1和newBuffer2 其余的释放掉
+        if(buffersToWrite.size() > 2) {
+            buffersToWrite.resize(2);
+        }
+
+        if(!newBuffer1) {
+            assert(!buffersToWrite.empty());
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+
+        if(!newBuffer2) {
+            assert(!buffersToWrite.empty());
+            newBuffer2 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer2->reset();
+        }
+
+        buffersToWrite.clear();
+        output.flush();
+    }
+
+    // 退出前把最后一次交换之后前端写入的日志也写出去
+    {
+        MutexLockGuard lock(mutex_);
+        buffers_.push_back(std::move(currentBuffer_));
+        currentBuffer_ = std::move(newBuffer1);
+        buffersToWrite.swap(buffers_);
+    }
+    reportDrops(&output, &reportedDrops);
+    for(const auto& buffer : buffersToWrite) {
+        output.append(buffer->data(), buffer->length());
+    }
+    output.flush();
+}
+
+}   // namespace myserver
@@ -0,0 +1,105 @@
+/**
+* @description: AsyncLogging.h
+* @author: YQ Huang
+* @brief: 异步日志 双缓冲技术
+* @date: 2026/10/18 11:02:36
+*/
+
+#pragma once
+
+#include "server/base/Atomic.h"
+#include "server/base/CountDownLatch.h"
+#include "server/base/LogStream.h"
+#include "server/base/Mutex.h"
+#include "server/base/Thread.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace myserver {
+
+class LogArchiver;
+class LogFile;
+
+/**
+ * 异步日志后端 前端线程只负责把日志消息拷贝到缓冲区 由专门的后端线程写入LogFile
+ *
+ * 双缓冲: 前端有currentBuffer_和nextBuffer_两块4MB的缓冲区 写满的缓冲区放入buffers_
+ * 后端线程被唤醒(或每flushInterval秒)后 在临界区内把buffers_与自己的空vector交换
+ * 同时给前端换上两块空缓冲区 临界区内只有几次指针交换 不做任何IO
+ *
+ * 当后端写文件跟不上前端时 积压的缓冲区会越来越多 超过maxBacklog块后
+ * 前端直接丢弃日志消息并计数 避免内存无限增长
+ *
+ * 用法:
+ *   AsyncLogging log("server", 500*1000*1000);
+ *   log.start();
+ *   Logger::setOutput(...)   // 回调里调用log.append()
+ */
+class AsyncLogging : noncopyable {
+public:
+    AsyncLogging(const string& basename,
+                 off_t rollSize,
+                 int flushInterval = 3,
+                 int maxBacklog = 25);
+
+    ~AsyncLogging() {
+        if(running_) {
+            stop();
+        }
+    }
+
+    // 前端接口 供Logger的输出函数调用 线程安全
+    void append(const char* logline, int len);
+
+    // 启动后端线程 等待后端线程真正运行起来再返回
+    void start() {
+        running_ = true;
+        thread_.start();
+        latch_.wait();
+    }
+
+    // 停止后端线程 会把已经写入缓冲区的日志全部写到文件
+    void stop() {
+        running_ = false;
+        cond_.notify();
+        thread_.join();
+    }
+
+    // 滚动下来的文件交给archiver压缩和清理 必须在start()之前调用
+    void setArchiver(LogArchiver* archiver) { archiver_ = archiver; }
+    // 用O_DIRECT写日志文件 不占用页缓存 必须在start()之前调用
+    void setDirectIO(bool on) { directIO_ = on; }
+
+    // 因为积压过多而被丢弃的日志条数和字节数
+    int64_t droppedMessages() { return droppedMessages_.get(); }
+    int64_t droppedBytes() { return droppedBytes_.get(); }
+
+private:
+    void threadFunc();  // 后端线程函数
+    void reportDrops(LogFile* output, int64_t* reportedDrops);
+
+    typedef detail::FixedBuffer<detail::kLargeBuffer> Buffer;
+    typedef std::vector<std::unique_ptr<Buffer> > BufferVector;
+    typedef BufferVector::value_type BufferPtr;
+
+    const int flushInterval_;   // 超时时间 即使缓冲区没写满也要写文件
+    const size_t maxBacklog_;   // 允许积压的已写满缓冲区数目
+    std::atomic<bool> running_; // 后端线程是否在运行
+    const string basename_;     // 日志文件名
+    const off_t rollSize_;      // 日志文件滚动的大小
+    LogArchiver* archiver_;     // 可以为NULL
+    bool directIO_;             // LogFile使用DirectAppendFile
+    Thread thread_;             // 后端线程
+    CountDownLatch latch_;      // 保证后端线程启动
+    MutexLock mutex_;           // 保护下面的缓冲区
+    Condition cond_;            // 唤醒后端线程
+    BufferPtr currentBuffer_;   // 当前缓冲区
+    BufferPtr nextBuffer_;      // 预备缓冲区
+    BufferVector buffers_;      // 待写入文件的已写满的缓冲区
+    AtomicInt64 droppedMessages_;   // 丢弃的日志条数
+    AtomicInt64 droppedBytes_;      // 丢弃的日志字节数
+};
+
+}   // namespace myserver
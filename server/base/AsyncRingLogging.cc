@@ -0,0 +1,296 @@
+/**
+* @description: AsyncRingLogging.cc
+* @author: YQ Huang
+* @brief: 异步日志 每个线程一个无锁环形缓冲区
+* @date: 2026/10/18 13:52:33
+*/
+
+#include "server/base/AsyncRingLogging.h"
+#include "server/base/CurrentThread.h"
+#include "server/base/DeferredLogging.h"
+#include "server/base/LogFile.h"
+#include "server/base/Timestamp.h"
+
+#include <limits>
+#include <stdio.h>
+
+namespace myserver {
+
+namespace detail {
+
+// 用于生成AsyncRingLogging的instanceId_
+AtomicInt64 g_ringLoggingInstances;
+
+__thread int64_t t_ringOwner = 0;
+__thread SpscRingBuffer* t_ring = NULL;
+
+}   // namespace detail
+
+AsyncRingLogging::AsyncRingLogging(const string& basename,
+                                   off_t rollSize,
+                                   size_t ringSize,
+                                   int mergeWindowMs,
+                                   int flushInterval)
+    : basename_(basename),
+      rollSize_(rollSize),
+      ringSize_(ringSize),
+      mergeWindowMs_(mergeWindowMs),
+      flushInterval_(flushInterval),
+      instanceId_(detail::g_ringLoggingInstances.incrementAndGet()),
+      binary_(false),
+      archiver_(NULL),
+      directIO_(false),
+      running_(false),
+      thread_(std::bind(&AsyncRingLogging::threadFunc, this), "RingLogging"),
+      latch_(1),
+      mutex_(),
+      generation_(0),
+      retired_(0),
+      fileGeneration_(0)
+{
+    ::pthread_key_create(&ringKey_, &AsyncRingLogging::retireRing);
+}
+
+// 删除key之后 还存活的线程退出时不再调用retireRing()
+AsyncRingLogging::~AsyncRingLogging() {
+    if(running_) {
+        stop();
+    }
+    ::pthread_key_delete(ringKey_);
+}
+
+void AsyncRingLogging::start() {
+    running_ = true;
+    thread_.start();
+    latch_.wait();
+}
+
+void AsyncRingLogging::stop() {
+    running_ = false;
+    thread_.join();
+}
+
+size_t AsyncRingLogging::numRings() const {
+    MutexLockGuard lock(mutex_);
+    return rings_.size();
+}
+
+/**
+ * 慢路径 每个线程只走一次 同一个线程交替使用多个AsyncRingLogging对象时
+ * 从pthread_key里找回原来的缓冲区
+ * 优先复用空闲列表里的缓冲区 它们已经被后端读空 也不再有别的生产者
+ * 所以每个缓冲区始终只有一个生产者
+ */
+SpscRingBuffer* AsyncRingLogging::ringOfThisThread() {
+    Ring* ring = static_cast<Ring*>(::pthread_getspecific(ringKey_));
+    if(ring == NULL) {
+        MutexLockGuard lock(mutex_);
+        if(!freeRings_.empty()) {
+            ring = freeRings_.back();
+            freeRings_.pop_back();
+        }
+        else {
+            rings_.emplace_back(new Ring);
+            ring = rings_.back().get();
+            ring->owner = this;
+            ring->buffer.reset(new SpscRingBuffer(ringSize_));
+        }
+        ring->tid = CurrentThread::tid();
+        ring->state = kActive;
+        generation_.fetch_add(1, std::memory_order_release);
+        ::pthread_setspecific(ringKey_, ring);
+    }
+    detail::t_ring = ring->buffer.get();
+    detail::t_ringOwner = instanceId_;
+    return detail::t_ring;
+}
+
+/**
+ * 线程退出时调用 缓冲区里可能还有日志 交给后端读空后再回收
+ * 清掉线程局部的缓存 之后其他析构函数再写日志时会重新注册
+ */
+void AsyncRingLogging::retireRing(void* arg) {
+    Ring* ring = static_cast<Ring*>(arg);
+    AsyncRingLogging* owner = ring->owner;
+    if(detail::t_ringOwner == owner->instanceId_) {
+        detail::t_ringOwner = 0;
+        detail::t_ring = NULL;
+    }
+    MutexLockGuard lock(owner->mutex_);
+    ring->state = kRetired;
+    owner->retired_.fetch_add(1, std::memory_order_release);
+}
+
+// 后端线程调用 只有后端读缓冲区 所以peek()不到记录就说明已经读空
+void AsyncRingLogging::recycleRings() {
+    MutexLockGuard lock(mutex_);
+    int recycled = 0;
+    for(const auto& ring : rings_) {
+        SpscRingBuffer::Record record;
+        if(ring->state == kRetired && !ring->buffer->peek(&record)) {
+            ring->state = kFree;
+            freeRings_.push_back(ring.get());
+            ++recycled;
+        }
+    }
+    if(recycled > 0) {
+        retired_.fetch_sub(recycled, std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+/**
+ * 多路归并 每次从所有缓冲区的第一条记录中选出时间戳最小的输出
+ * 只输出时间戳不晚于until的记录 返回输出的条数
+ */
+size_t AsyncRingLogging::drain(const RingList& rings, int64_t until, LogFile* output) {
+    std::vector<SpscRingBuffer::Record> heads(rings.size());
+    std::vector<bool> valid(rings.size(), false);
+    size_t count = 0;
+    for(;;) {
+        int best = -1;
+        for(size_t i = 0; i < rings.size(); ++i) {
+            if(!valid[i]) {
+                valid[i] = rings[i]->buffer->peek(&heads[i]);
+            }
+            if(valid[i] && heads[i].timestamp <= until
+               && (best < 0 || heads[i].timestamp < heads[best].timestamp))
+            {
+                best = static_cast<int>(i);
+            }
+        }
+        if(best < 0) {
+            break;
+        }
+        write(rings[best]->tid, heads[best], output);
+        rings[best]->buffer->consume(heads[best]);
+        valid[best] = false;
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * 输出一条记录 文本记录原样输出 延迟格式化的记录在这里格式化
+ */
+void AsyncRingLogging::write(pid_t tid, const SpscRingBuffer::Record& record, LogFile* output) {
+    if(binary_) {
+        writeBinary(tid, record, output);
+    }
+    else if(record.tag == 0) {
+        output->append(record.data, static_cast<int>(record.length));
+    }
+    else {
+        const detail::DeferredLogSite* site = detail::findLogSite(record.tag);
+        if(site) {
+            char buf[detail::kSmallBuffer];
+            int n = detail::formatDeferred(*site, tid, record.timestamp,
+                                           record.data, record.length, buf, sizeof buf);
+            output->append(buf, n);
+        }
+    }
+}
+
+/**
+ * 二进制模式 每个新文件先写kBinaryLogMagic 调用点第一次出现时先写它的描述
+ * 一条记录用到的所有内容拼好后一次append 保证LogFile滚动时不会把它们拆到两个文件里
+ */
+void AsyncRingLogging::writeBinary(pid_t tid, const SpscRingBuffer::Record& record, LogFile* output) {
+    scratch_.clear();
+    if(output->rollCount() != fileGeneration_) {
+        fileGeneration_ = output->rollCount();
+        sitesWritten_.clear();
+        scratch_.append(kBinaryLogMagic, sizeof kBinaryLogMagic);
+    }
+
+    BinaryLogHeader header;
+    header.type = kBinaryText;
+    header.length = record.length;
+    header.timestamp = record.timestamp;
+    header.tid = tid;
+    header.siteId = record.tag;
+    if(record.tag != 0) {
+        const detail::DeferredLogSite* site = detail::findLogSite(record.tag);
+        if(site == NULL) {
+            return;
+        }
+        header.type = kBinaryMessage;
+        if(sitesWritten_.size() <= record.tag) {
+            sitesWritten_.resize(record.tag + 1, false);
+        }
+        if(!sitesWritten_[record.tag]) {
+            sitesWritten_[record.tag] = true;
+            detail::encodeLogSite(*site, record.tag, &scratch_);
+        }
+    }
+    scratch_.append(reinterpret_cast<const char*>(&header), sizeof header);
+    scratch_.append(record.data, record.length);
+    output->append(scratch_.data(), static_cast<int>(scratch_.size()));
+}
+
+void AsyncRingLogging::refreshRings(RingList* rings) {
+    MutexLockGuard lock(mutex_);
+    rings->clear();
+    for(const auto& ring : rings_) {
+        if(ring->state != kFree) {
+            rings->push_back(ring.get());
+        }
+    }
+}
+
+/**
+ * 后端线程 没有日志可写时睡眠半个归并窗口
+ */
+void AsyncRingLogging::threadFunc() {
+    latch_.countDown();
+    LogFile output(basename_, rollSize_, false, 3, 1024, directIO_);
+    output.setArchiver(archiver_);
+    RingList rings;
+    int generation = -1;
+    const int64_t window = static_cast<int64_t>(mergeWindowMs_) * 1000;
+    Timestamp lastFlush(Timestamp::now());
+    int64_t reportedDrops = 0;
+
+    while(running_) {
+        int g = generation_.load(std::memory_order_acquire);
+        if(g != generation) {
+            refreshRings(&rings);
+            generation = g;
+        }
+
+        // 前端因为缓冲区满丢弃了日志 在文件里留下记录
+        int64_t dropped = droppedMessages_.get();
+        if(dropped != reportedDrops) {
+            char buf[256];
+            Timestamp now(Timestamp::now());
+            int len = snprintf(buf, sizeof buf, "Dropped %lld log messages at %s, %lld dropped in total\n",
+                               static_cast<long long>(dropped - reportedDrops),
+                               now.toFormattedString().c_str(),
+                               static_cast<long long>(dropped));
+            fputs(buf, stderr);
+            SpscRingBuffer::Record note = { now.microSecondsSinceEpoch(), buf, static_cast<uint32_t>(len), 0 };
+            write(0, note, &output);
+            reportedDrops = dropped;
+        }
+
+        Timestamp now(Timestamp::now());
+        size_t n = drain(rings, now.microSecondsSinceEpoch() - window, &output);
+        if(retired_.load(std::memory_order_acquire) > 0) {
+            recycleRings();
+        }
+        if(timeDifference(now, lastFlush) > flushInterval_) {
+            output.flush();
+            lastFlush = now;
+        }
+        if(n == 0) {
+            CurrentThread::sleepUsec(window / 2 + 1);
+        }
+    }
+
+    // 退出前输出所有缓冲区中剩余的日志
+    refreshRings(&rings);
+    drain(rings, std::numeric_limits<int64_t>::max(), &output);
+    output.flush();
+}
+
+}   // namespace myserver
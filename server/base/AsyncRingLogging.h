@@ -0,0 +1,155 @@
+/**
+* @description: AsyncRingLogging.h
+* @author: YQ Huang
+* @brief: 异步日志 每个线程一个无锁环形缓冲区
+* @date: 2026/10/18 13:52:27
+*/
+
+#pragma once
+
+#include "server/base/Atomic.h"
+#include "server/base/CountDownLatch.h"
+#include "server/base/Mutex.h"
+#include "server/base/SpscRingBuffer.h"
+#include "server/base/Thread.h"
+#include "server/base/Timestamp.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <pthread.h>
+
+namespace myserver {
+
+class LogArchiver;
+class LogFile;
+
+namespace detail {
+
+// 线程局部的缓存 记录当前线程在哪个AsyncRingLogging对象里注册了哪个缓冲区
+extern __thread int64_t t_ringOwner;
+extern __thread SpscRingBuffer* t_ring;
+
+}   // namespace detail
+
+/**
+ * AsyncLogging的前端线程共用一把锁 线程多的时候这把锁就成了瓶颈
+ * AsyncRingLogging给每个前端线程分配一个SPSC环形缓冲区(记在pthread_key里)
+ * 前端写日志只是往自己的缓冲区里memcpy 不加锁
+ * 只有线程第一次写日志时 才需要加锁注册自己的缓冲区
+ * 线程退出时缓冲区被标记为退役 后端读完其中剩下的日志后放回空闲列表 供新线程复用
+ * 所以分配的缓冲区个数不超过同时写日志的线程数 不随线程的创建和退出增长
+ *
+ * 唯一的后端线程轮询所有缓冲区 把日志写入LogFile
+ * 不同线程的日志按时间戳归并排序后输出 为了保证顺序 后端只输出
+ * 早于(当前时间 - mergeWindow)的日志 在这个窗口内的日志会按时间戳排好序
+ *
+ * 缓冲区满时 前端丢弃这条日志并计数 不会阻塞
+ *
+ * 每条记录带一个tag 0表示已经格式化好的文本 非0表示LOGF_XXX写入的
+ * 延迟格式化的记录(tag是调用点的编号 见DeferredLogging.h) 由后端格式化
+ * setBinary(true)之后后端不再格式化 直接写二进制文件 由decodeBinaryLog()还原
+ */
+class AsyncRingLogging : noncopyable {
+public:
+    AsyncRingLogging(const string& basename,
+                     off_t rollSize,
+                     size_t ringSize = 4 * 1024 * 1024,
+                     int mergeWindowMs = 10,
+                     int flushInterval = 3);
+    ~AsyncRingLogging();
+
+    // 前端接口 供Logger的输出函数调用 不加锁
+    void append(const char* logline, int len) {
+        char* buf = beginAppend(len);
+        if(buf) {
+            memcpy(buf, logline, len);
+            commitAppend(0, len);
+        }
+    }
+
+    // 在当前线程的缓冲区里预留len字节 缓冲区满时返回NULL并计数
+    char* beginAppend(size_t len) {
+        SpscRingBuffer* ring = detail::t_ring;
+        if(__builtin_expect(detail::t_ringOwner != instanceId_, 0)) {
+            ring = ringOfThisThread();
+        }
+        char* buf = ring->beginWrite(len);
+        if(buf == NULL) {
+            droppedMessages_.increment();
+        }
+        return buf;
+    }
+
+    // 发布beginAppend()预留的记录
+    void commitAppend(uint32_t tag, size_t len) {
+        detail::t_ring->commitWrite(Timestamp::nowFast().microSecondsSinceEpoch(), tag, len);
+    }
+
+    // 必须在start()之前调用
+    void setBinary(bool on) { binary_ = on; }
+    // 滚动下来的文件交给archiver压缩和清理 必须在start()之前调用
+    void setArchiver(LogArchiver* archiver) { archiver_ = archiver; }
+    // 用O_DIRECT写日志文件 不占用页缓存 必须在start()之前调用
+    void setDirectIO(bool on) { directIO_ = on; }
+
+    void start();
+    void stop();
+
+    // 因为缓冲区满而被丢弃的日志条数
+    int64_t droppedMessages() { return droppedMessages_.get(); }
+    // 已分配的缓冲区个数 包括空闲列表里的
+    size_t numRings() const;
+
+private:
+    enum RingState {
+        kActive,    // 属于一个存活的线程
+        kRetired,   // 线程已经退出 里面可能还有没输出的日志
+        kFree,      // 已经读空 在空闲列表里
+    };
+
+    struct Ring {
+        AsyncRingLogging* owner;
+        pid_t tid;              // 当前使用者 复用时改写 后端在peek()之后读取
+        RingState state;        // 由mutex_保护
+        std::unique_ptr<SpscRingBuffer> buffer;
+    };
+    typedef std::vector<Ring*> RingList;
+
+    SpscRingBuffer* ringOfThisThread();     // 慢路径 注册当前线程的缓冲区
+    static void retireRing(void* ring);     // pthread_key的析构函数 线程退出时调用
+    void recycleRings();                    // 把读空的退役缓冲区放回空闲列表
+    void threadFunc();                      // 后端线程函数
+    void refreshRings(RingList* rings);
+    size_t drain(const RingList& rings, int64_t until, LogFile* output);
+    void write(pid_t tid, const SpscRingBuffer::Record& record, LogFile* output);
+    void writeBinary(pid_t tid, const SpscRingBuffer::Record& record, LogFile* output);
+
+    const string basename_;     // 日志文件名
+    const off_t rollSize_;      // 日志文件滚动的大小
+    const size_t ringSize_;     // 每个线程的缓冲区大小
+    const int mergeWindowMs_;   // 归并排序的时间窗口
+    const int flushInterval_;   // flush的时间间隔
+    const int64_t instanceId_;  // 区分不同的AsyncRingLogging对象 用于线程局部的缓存
+    bool binary_;               // 是否写二进制文件
+    LogArchiver* archiver_;     // 可以为NULL
+    bool directIO_;             // LogFile使用DirectAppendFile
+    std::atomic<bool> running_;
+    Thread thread_;             // 后端线程
+    CountDownLatch latch_;
+
+    pthread_key_t ringKey_;     // 当前线程在这个对象里的Ring
+    mutable MutexLock mutex_;   // 只保护注册和回收 不在热路径上
+    std::vector<std::unique_ptr<Ring> > rings_;     // 分配过的所有缓冲区
+    std::vector<Ring*> freeRings_;                  // 读空的退役缓冲区
+    std::atomic<int> generation_;   // 正在使用的缓冲区有变化时加一 后端据此刷新自己的列表
+    std::atomic<int> retired_;      // 等待后端回收的缓冲区个数
+    AtomicInt64 droppedMessages_;   // 丢弃的日志条数
+
+    // 下面的成员只由后端线程使用
+    int fileGeneration_;                // LogFile::rollCount() 变化说明换了新文件
+    std::vector<bool> sitesWritten_;    // 二进制模式下 当前文件已经写过哪些调用点
+    string scratch_;                    // 二进制模式下拼接一条记录
+};
+
+}   // namespace myserver
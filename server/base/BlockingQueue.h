@@ -0,0 +1,100 @@
+/**
+* @description: BlockingQueue.h
+* @author: YQ Huang
+* @brief: 无界阻塞队列
+* @date: 2026/10/18 09:12:40
+*/
+
+#pragma once
+
+#include "server/base/Condition.h"
+#include "server/base/Mutex.h"
+
+#include <deque>
+#include <assert.h>
+
+namespace myserver {
+
+/**
+ * 无界阻塞队列 生产者消费者模型
+ * 用MutexLock保护std::deque 用Condition通知消费者队列非空
+ * put()永远不会阻塞 take()在队列为空时阻塞
+ * put()/take()/tryTake()/size()/empty()与两个有界队列相同 无界队列不需要tryPut()
+ * T只需要能移动构造 tryTake(T*)另外要求能移动赋值
+ */
+template<typename T>
+class BlockingQueue : noncopyable {
+public:
+    using queue_type = std::deque<T>;
+
+    BlockingQueue()
+        : mutex_(),
+          notEmpty_(mutex_),
+          queue_()
+    { }
+
+    // 放入一个元素 并唤醒一个等待的消费者
+    void put(const T& x) {
+        MutexLockGuard lock(mutex_);
+        queue_.push_back(x);
+        notEmpty_.notify();
+    }
+
+    void put(T&& x) {
+        MutexLockGuard lock(mutex_);
+        queue_.push_back(std::move(x));
+        notEmpty_.notify();
+    }
+
+    // 取出一个元素 队列为空时阻塞等待
+    T take() {
+        MutexLockGuard lock(mutex_);
+        // 必须用while循环等待 防止虚假唤醒
+        while(queue_.empty()) {
+            notEmpty_.wait();
+        }
+        assert(!queue_.empty());
+        T front(std::move(queue_.front()));
+        queue_.pop_front();
+        return front;
+    }
+
+    // 非阻塞的取出 队列为空时返回false
+    bool tryTake(T* out) {
+        MutexLockGuard lock(mutex_);
+        if(queue_.empty()) {
+            return false;
+        }
+        *out = std::move(queue_.front());
+        queue_.pop_front();
+        return true;
+    }
+
+    // 一次性取走队列中的全部元素
+    queue_type drain() {
+        std::deque<T> queue;
+        {
+            MutexLockGuard lock(mutex_);
+            queue = std::move(queue_);
+            assert(queue_.empty());
+        }
+        return queue;
+    }
+
+    size_t size() const {
+        MutexLockGuard lock(mutex_);
+        return queue_.size();
+    }
+
+    bool empty() const {
+        MutexLockGuard lock(mutex_);
+        return queue_.empty();
+    }
+
+private:
+    mutable MutexLock mutex_;   // 保护queue_
+    Condition notEmpty_;        // 条件变量 队列非空
+    queue_type queue_;          // 队列
+};
+
+}   // namespace myserver
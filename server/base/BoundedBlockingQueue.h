@@ -0,0 +1,127 @@
+/**
+* @description: BoundedBlockingQueue.h
+* @author: YQ Huang
+* @brief: 有界阻塞队列
+* @date: 2026/10/18 09:20:11
+*/
+
+#pragma once
+
+#include "server/base/Condition.h"
+#include "server/base/Mutex.h"
+
+#include <deque>
+#include <assert.h>
+
+namespace myserver {
+
+/**
+ * 有界阻塞队列 容量固定
+ * 队列满时put()阻塞 队列空时take()阻塞
+ * 接口与LockFreeBoundedQueue保持一致 两者可以互相替换
+ * T只需要能移动构造 tryTake(T*)另外要求能移动赋值
+ */
+template<typename T>
+class BoundedBlockingQueue : noncopyable {
+public:
+    explicit BoundedBlockingQueue(size_t maxSize)
+        : mutex_(),
+          notEmpty_(mutex_),
+          notFull_(mutex_),
+          maxSize_(maxSize)
+    {
+        assert(maxSize_ > 0);
+    }
+
+    // 放入一个元素 队列满时阻塞等待
+    void put(const T& x) {
+        MutexLockGuard lock(mutex_);
+        while(queue_.size() >= maxSize_) {
+            notFull_.wait();
+        }
+        queue_.push_back(x);
+        notEmpty_.notify();
+    }
+
+    void put(T&& x) {
+        MutexLockGuard lock(mutex_);
+        while(queue_.size() >= maxSize_) {
+            notFull_.wait();
+        }
+        queue_.push_back(std::move(x));
+        notEmpty_.notify();
+    }
+
+    // 取出一个元素 队列空时阻塞等待
+    T take() {
+        MutexLockGuard lock(mutex_);
+        while(queue_.empty()) {
+            notEmpty_.wait();
+        }
+        assert(!queue_.empty());
+        T front(std::move(queue_.front()));
+        queue_.pop_front();
+        notFull_.notify();
+        return front;
+    }
+
+    // 非阻塞的放入 队列满时返回false
+    bool tryPut(const T& x) {
+        MutexLockGuard lock(mutex_);
+        if(queue_.size() >= maxSize_) {
+            return false;
+        }
+        queue_.push_back(x);
+        notEmpty_.notify();
+        return true;
+    }
+
+    // 队列满时返回false 此时x保持不变
+    bool tryPut(T&& x) {
+        MutexLockGuard lock(mutex_);
+        if(queue_.size() >= maxSize_) {
+            return false;
+        }
+        queue_.push_back(std::move(x));
+        notEmpty_.notify();
+        return true;
+    }
+
+    // 非阻塞的取出 队列空时返回false
+    bool tryTake(T* out) {
+        MutexLockGuard lock(mutex_);
+        if(queue_.empty()) {
+            return false;
+        }
+        *out = std::move(queue_.front());
+        queue_.pop_front();
+        notFull_.notify();
+        return true;
+    }
+
+    bool empty() const {
+        MutexLockGuard lock(mutex_);
+        return queue_.empty();
+    }
+
+    bool full() const {
+        MutexLockGuard lock(mutex_);
+        return queue_.size() >= maxSize_;
+    }
+
+    size_t size() const {
+        MutexLockGuard lock(mutex_);
+        return queue_.size();
+    }
+
+    size_t capacity() const { return maxSize_; }
+
+private:
+    mutable MutexLock mutex_;   // 保护queue_
+    Condition notEmpty_;        // 条件变量 队列非空
+    Condition notFull_;         // 条件变量 队列未满
+    const size_t maxSize_;      // 队列容量
+    std::deque<T> queue_;       // 队列
+};
+
+}   // namespace myserver
@@ -0,0 +1,127 @@
+/**
+* @description: Context.h
+* @author: YQ Huang
+* @brief: 带内联存储的类型化上下文 代替boost::any保存连接和EventLoop上的协议状态
+* @date: 2026/10/19 01:02:14
+*/
+
+#pragma once
+
+#include "server/base/noncopyable.h"
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <stddef.h>
+
+namespace myserver {
+
+/**
+ * 保存任意一个类型的对象 不超过kInlineSize的对象直接构造在内部的缓冲区里
+ * 更大的对象才在堆上分配 所以常见的解析器状态跟着TcpConnection一起从Slab分配
+ *
+ * 类型检查只比较一个指针 每种类型对应一个静态的操作表 不使用RTTI
+ * 对象始终留在原地 不复制也不移动 get()返回的指针在下一次emplace()或reset()之前有效
+ */
+class Context : noncopyable {
+public:
+    static const size_t kInlineSize = 128;
+
+    Context() : ops_(NULL) { }
+    ~Context() { reset(); }
+
+    // 判断类型T的对象是否放在内部的缓冲区里
+    template<typename T>
+    static constexpr bool isInline() {
+        return sizeof(T) <= kInlineSize && alignof(T) <= alignof(max_align_t);
+    }
+
+    // 销毁原有的对象 用args构造一个T
+    template<typename T, typename... Args>
+    T& emplace(Args&&... args) {
+        reset();
+        T* object = construct<T>(InlineTag<T>(), std::forward<Args>(args)...);
+        // 构造成功之后才设置 构造抛出异常时仍然是空的
+        ops_ = opsOf<T>();
+        return *object;
+    }
+
+    // 类型不是T或为空时返回NULL
+    template<typename T>
+    T* get() {
+        return ops_ == opsOf<T>() ? static_cast<T*>(address()) : NULL;
+    }
+
+    template<typename T>
+    const T* get() const {
+        return ops_ == opsOf<T>() ? static_cast<const T*>(address()) : NULL;
+    }
+
+    template<typename T>
+    bool is() const { return ops_ == opsOf<T>(); }
+
+    bool empty() const { return ops_ == NULL; }
+
+    void reset() {
+        if(ops_) {
+            const Ops* ops = ops_;
+            ops_ = NULL;
+            ops->destroy(&storage_);
+        }
+    }
+
+private:
+    struct Ops {
+        bool heap;
+        void (*destroy)(void* storage);
+    };
+
+    // C++11没有if constexpr 按是否内联分派 避免对大对象生成placement new
+    template<typename T>
+    struct InlineTag : std::integral_constant<bool, isInline<T>()> { };
+
+    template<typename T, typename... Args>
+    T* construct(std::true_type, Args&&... args) {
+        return new (&storage_) T(std::forward<Args>(args)...);
+    }
+
+    template<typename T, typename... Args>
+    T* construct(std::false_type, Args&&... args) {
+        T* object = new T(std::forward<Args>(args)...);
+        *static_cast<T**>(static_cast<void*>(&storage_)) = object;
+        return object;
+    }
+
+    template<typename T>
+    static void destroy(std::true_type, void* storage) {
+        static_cast<T*>(storage)->~T();
+    }
+
+    template<typename T>
+    static void destroy(std::false_type, void* storage) {
+        delete *static_cast<T**>(storage);
+    }
+
+    template<typename T>
+    static void destroy(void* storage) {
+        destroy<T>(InlineTag<T>(), storage);
+    }
+
+    // 操作表的地址就是类型的标识 const和引用在这里去掉
+    template<typename T>
+    static const Ops* opsOf() {
+        typedef typename std::remove_cv<typename std::remove_reference<T>::type>::type Type;
+        static const Ops ops = { !isInline<Type>(), &Context::destroy<Type> };
+        return &ops;
+    }
+
+    void* address() const {
+        void* storage = const_cast<void*>(static_cast<const void*>(&storage_));
+        return ops_->heap ? *static_cast<void**>(storage) : storage;
+    }
+
+    typename std::aligned_storage<kInlineSize, alignof(max_align_t)>::type storage_;
+    const Ops* ops_;
+};
+
+}   // namespace myserver
@@ -21,11 +21,67 @@ __thread int t_tidStringLength = 6;
 __thread const char* t_threadName = "unknown";
 static_assert(std::is_same<int, pid_t>::value, "pid_t should be int");
 
+/**
+ * backtrace_symbols的每一行形如 bin/server(_ZN8myserver7TcpConn...+0x79) [0x401909]
+ * 把括号和加号之间的符号名还原成C++的名字 还原失败的行原样保留
+ */
 string stackTrace(bool demangle) {
     string stack;
+    const int kMaxFrames = 200;
+    void* frame[kMaxFrames];
+    int nptrs = ::backtrace(frame, kMaxFrames);
+    char** strings = ::backtrace_symbols(frame, nptrs);
+    if(strings) {
+        size_t len = 256;
+        char* demangled = demangle ? static_cast<char*>(::malloc(len)) : NULL;
+        // 跳过第0帧 也就是stackTrace自己
+        for(int i = 1; i < nptrs; ++i) {
+            if(demangle) {
+                char* leftPar = NULL;
+                char* plus = NULL;
+                for(char* p = strings[i]; *p; ++p) {
+                    if(*p == '(') {
+                        leftPar = p;
+                    }
+                    else if(*p == '+') {
+                        plus = p;
+                    }
+                }
+                if(leftPar && plus && plus > leftPar + 1) {
+                    *plus = '\0';
+                    int status = 0;
+                    char* ret = abi::__cxa_demangle(leftPar + 1, demangled, &len, &status);
+                    *plus = '+';
+                    if(status == 0) {
+                        demangled = ret;
+                        stack.append(strings[i], leftPar + 1);
+                        stack.append(demangled);
+                        stack.append(plus);
+                        stack.push_back('\n');
+                        continue;
+                    }
+                }
+            }
+            stack.append(strings[i]);
+            stack.push_back('\n');
+        }
+        ::free(demangled);
+        ::free(strings);
+    }
     return stack;
 }
 
+string demangle(const char* symbol) {
+    int status = 0;
+    char* ret = abi::__cxa_demangle(symbol, NULL, NULL, &status);
+    if(status != 0) {
+        return symbol;
+    }
+    string result(ret);
+    ::free(ret);
+    return result;
+}
+
 }   // namespace CurrentThread
 
 }   // namespace myserver
\ No newline at end of file
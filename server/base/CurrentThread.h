@@ -52,6 +52,8 @@ void sleepUsec(int64_t usec);   // for testing
 
 // 用在错误后定位错误信息 与 exception 结合使用
 string stackTrace(bool demangle);
+// 还原C++的符号名或typeid().name() 失败时原样返回
+string demangle(const char* symbol);
 
 }   // namespace CurrentThread
 
@@ -0,0 +1,493 @@
+/**
+* @description: DeferredLogging.cc
+* @author: YQ Huang
+* @brief: 延迟格式化的日志 前端只记录格式串的编号和原始参数 由后端或离线工具格式化
+* @date: 2026/10/18 15:06:20
+*/
+
+#include "server/base/DeferredLogging.h"
+#include "server/base/CurrentThread.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <ctype.h>
+#include <stdlib.h>
+#include <time.h>
+
+namespace myserver {
+
+// 定义在Logging.cc中
+extern const char* LogLevelName[Logger::NUM_LOG_LEVELS];
+extern Logger::OutputFunc g_output;
+
+const char kBinaryLogMagic[8] = { 'M', 'Y', 'S', 'L', 'O', 'G', '0', '1' };
+
+namespace detail {
+
+AsyncRingLogging* g_deferredLogging = NULL;
+
+// 调用点注册表 编号从1开始 编号直接作为数组下标 后端查找时不加锁
+const uint32_t kMaxLogSites = 16384;
+DeferredLogSite* g_logSites[kMaxLogSites];
+uint32_t g_numLogSites = 0;
+MutexLock g_logSitesMutex;
+
+// 后端格式化时间用的缓存 与Logging.cc中的t_time相同
+__thread char t_deferredTime[64];
+__thread time_t t_deferredLastSecond;
+
+uint32_t registerLogSite(DeferredLogSite* site) {
+    MutexLockGuard lock(g_logSitesMutex);
+    if(site->id == 0) {
+        if(g_numLogSites + 1 >= kMaxLogSites) {
+            fprintf(stderr, "too many LOGF call sites (%u)\n", kMaxLogSites);
+            abort();
+        }
+        uint32_t id = g_numLogSites + 1;
+        __atomic_store_n(&g_logSites[id], site, __ATOMIC_RELEASE);
+        __atomic_store_n(&g_numLogSites, id, __ATOMIC_RELEASE);
+        __atomic_store_n(&site->id, id, __ATOMIC_RELEASE);
+    }
+    return site->id;
+}
+
+uint32_t numLogSites() {
+    return __atomic_load_n(&g_numLogSites, __ATOMIC_ACQUIRE);
+}
+
+const DeferredLogSite* findLogSite(uint32_t id) {
+    if(id == 0 || id >= kMaxLogSites) {
+        return NULL;
+    }
+    return __atomic_load_n(&g_logSites[id], __ATOMIC_ACQUIRE);
+}
+
+void checkLogFormat(const char*, ...) {
+}
+
+/**
+ * 把文本写入固定大小的缓冲区 写满后截断 最后一个字节留给'\n'
+ */
+class LineWriter {
+public:
+    LineWriter(char* buf, int size)
+        : buf_(buf),
+          size_(size - 1),
+          len_(0)
+    {
+    }
+
+    void append(const char* str, size_t len) {
+        size_t n = std::min(len, static_cast<size_t>(size_ - len_));
+        memcpy(buf_ + len_, str, n);
+        len_ += static_cast<int>(n);
+    }
+
+    void append(const char* str) {
+        append(str, strlen(str));
+    }
+
+    // spec是运行时拼出来的格式串 只含一个转换说明
+    template<typename T>
+    void appendf(const char* spec, T v) {
+        int avail = size_ - len_;
+        if(avail <= 0) {
+            return;
+        }
+        // snprintf会在末尾写'\0' 所以多给它一个字节 那个字节是留给'\n'的
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+        int n = snprintf(buf_ + len_, avail + 1, spec, v);
+#pragma GCC diagnostic pop
+        if(n > 0) {
+            len_ += std::min(n, avail);
+        }
+    }
+
+    int finish() {
+        buf_[len_++] = '\n';
+        return len_;
+    }
+
+private:
+    char* buf_;
+    int size_;
+    int len_;
+};
+
+/**
+ * 依次读出编码后的参数 长度不对时返回false 不会越界
+ */
+class ArgReader {
+public:
+    struct Arg {
+        int type;
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char* s;
+        const void* p;
+    };
+
+    ArgReader(const char* data, size_t len)
+        : cur_(data),
+          end_(data + len)
+    {
+    }
+
+    bool next(Arg* arg) {
+        if(cur_ >= end_) {
+            return false;
+        }
+        arg->type = *cur_++;
+        switch(arg->type) {
+        case kArgInt64:
+            if(!read(&arg->i)) {
+                return false;
+            }
+            arg->u = static_cast<uint64_t>(arg->i);
+            return true;
+        case kArgUInt64:
+            if(!read(&arg->u)) {
+                return false;
+            }
+            arg->i = static_cast<int64_t>(arg->u);
+            return true;
+        case kArgDouble:
+            return read(&arg->d);
+        case kArgChar:
+            if(cur_ >= end_) {
+                return false;
+            }
+            arg->i = *cur_++;
+            return true;
+        case kArgString: {
+            uint32_t n = 0;
+            if(!read(&n) || n == 0 || static_cast<size_t>(end_ - cur_) < n || cur_[n - 1] != '\0') {
+                return false;
+            }
+            arg->s = cur_;
+            cur_ += n;
+            return true;
+        }
+        case kArgPointer:
+            return read(&arg->p);
+        default:
+            cur_ = end_;
+            return false;
+        }
+    }
+
+private:
+    template<typename T>
+    bool read(T* v) {
+        if(static_cast<size_t>(end_ - cur_) < sizeof(T)) {
+            cur_ = end_;
+            return false;
+        }
+        memcpy(v, cur_, sizeof(T));
+        cur_ += sizeof(T);
+        return true;
+    }
+
+    const char* cur_;
+    const char* end_;
+};
+
+/**
+ * 按格式串输出正文 每个转换说明保留标志 宽度和精度
+ * 长度修饰符丢掉 按参数实际编码的类型重新加上 所以%d配int64_t也不会出错
+ */
+void formatMessage(const char* format, ArgReader* reader, LineWriter* out) {
+    const char* p = format;
+    while(*p) {
+        const char* percent = strchr(p, '%');
+        if(percent == NULL) {
+            out->append(p);
+            break;
+        }
+        out->append(p, percent - p);
+        if(percent[1] == '%') {
+            out->append("%", 1);
+            p = percent + 2;
+            continue;
+        }
+
+        char spec[48];
+        size_t n = 0;
+        spec[n++] = '%';
+        const char* s = percent + 1;
+        bool ok = true;
+        ArgReader::Arg arg;
+        while(*s && strchr("-+ #0", *s) && n < 8) {
+            spec[n++] = *s++;
+        }
+        // 宽度和精度 '*'从参数中读出
+        for(int part = 0; part < 2; ++part) {
+            if(part == 1) {
+                if(*s != '.') {
+                    break;
+                }
+                spec[n++] = *s++;
+            }
+            if(*s == '*') {
+                ++s;
+                ok = reader->next(&arg) && (arg.type == kArgInt64 || arg.type == kArgUInt64);
+                if(ok) {
+                    n += static_cast<size_t>(snprintf(spec + n, 12, "%d", static_cast<int>(arg.i)));
+                }
+            }
+            else {
+                while(isdigit(*s) && n < 30) {
+                    spec[n++] = *s++;
+                }
+            }
+        }
+        // 长度修饰符只用来决定%u %x等无符号转换截取多少位 负数按printf的规则输出
+        int shorts = 0;
+        bool wide = false;
+        while(*s && strchr("hlLqjzt", *s)) {
+            if(*s == 'h') {
+                ++shorts;
+            }
+            else {
+                wide = true;
+            }
+            ++s;
+        }
+        const char conv = *s;
+        if(conv) {
+            ++s;
+        }
+        p = s;
+
+        if(!ok || !reader->next(&arg)) {
+            // 参数不够 原样输出这个转换说明
+            out->append(percent, s - percent);
+            continue;
+        }
+        switch(arg.type) {
+        case kArgInt64:
+        case kArgUInt64: {
+            const bool isUnsigned = conv && strchr("ouxX", conv);
+            if(conv == 'c') {
+                memcpy(spec + n, "c", 2);
+                out->appendf(spec, static_cast<int>(arg.i));
+            }
+            else if(isUnsigned || arg.type == kArgUInt64) {
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = isUnsigned ? conv : 'u';
+                spec[n] = '\0';
+                uint64_t u = arg.u;
+                if(isUnsigned && arg.type == kArgInt64 && !wide) {
+                    u &= shorts == 0 ? 0xFFFFFFFFu : (shorts == 1 ? 0xFFFFu : 0xFFu);
+                }
+                out->appendf(spec, static_cast<unsigned long long>(u));
+            }
+            else {
+                memcpy(spec + n, "lld", 4);
+                out->appendf(spec, static_cast<long long>(arg.i));
+            }
+            break;
+        }
+        case kArgDouble:
+            spec[n++] = conv && strchr("fFeEgGaA", conv) ? conv : 'g';
+            spec[n] = '\0';
+            out->appendf(spec, arg.d);
+            break;
+        case kArgChar:
+            spec[n++] = conv == 'c' ? 'c' : 'd';
+            spec[n] = '\0';
+            out->appendf(spec, static_cast<int>(arg.i));
+            break;
+        case kArgString:
+            memcpy(spec + n, "s", 2);
+            out->appendf(spec, arg.s);
+            break;
+        case kArgPointer:
+            memcpy(spec + n, "p", 2);
+            out->appendf(spec, arg.p);
+            break;
+        }
+    }
+}
+
+int formatDeferred(const DeferredLogSite& site, int tid, int64_t microSecondsSinceEpoch,
+                   const char* args, size_t len, char* buf, int size)
+{
+    LineWriter out(buf, size);
+
+    // 时间 同一秒内只格式化微秒部分
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
+    int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
+    if(seconds != t_deferredLastSecond) {
+        t_deferredLastSecond = seconds;
+        struct tm tm_time;
+        localtime_r(&seconds, &tm_time);
+        snprintf(t_deferredTime, sizeof t_deferredTime, "%4d%02d%02d %02d:%02d:%02d",
+                 tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+                 tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+    }
+    out.append(t_deferredTime, 17);
+    out.appendf(".%06dZ ", microseconds);
+    out.appendf("%5d ", tid);
+    if(site.level >= 0 && site.level < Logger::NUM_LOG_LEVELS) {
+        out.append(LogLevelName[site.level], 6);
+    }
+    if(site.level <= Logger::DEBUG) {
+        out.append(site.func);
+        out.append(" ", 1);
+    }
+
+    ArgReader reader(args, len);
+    formatMessage(site.format, &reader, &out);
+
+    const char* slash = strrchr(site.file, '/');
+    out.append(" - ", 3);
+    out.append(slash ? slash + 1 : site.file);
+    out.appendf(":%d", site.line);
+    return out.finish();
+}
+
+void appendDeferredSlow(const DeferredLogSite& site, const char* args, size_t len) {
+    char buf[kSmallBuffer];
+    int n = formatDeferred(site, CurrentThread::tid(), Timestamp::nowFast().microSecondsSinceEpoch(),
+                           args, len, buf, sizeof buf);
+    g_output(buf, n);
+}
+
+void encodeLogSite(const DeferredLogSite& site, uint32_t id, string* out) {
+    const size_t fileLen = strlen(site.file) + 1;
+    const size_t funcLen = strlen(site.func) + 1;
+    const size_t formatLen = strlen(site.format) + 1;
+    BinaryLogHeader header;
+    header.type = kBinarySite;
+    header.length = static_cast<uint32_t>(2 * sizeof(int32_t) + fileLen + funcLen + formatLen);
+    header.timestamp = 0;
+    header.tid = 0;
+    header.siteId = id;
+    int32_t level = site.level;
+    int32_t line = site.line;
+    out->append(reinterpret_cast<const char*>(&header), sizeof header);
+    out->append(reinterpret_cast<const char*>(&level), sizeof level);
+    out->append(reinterpret_cast<const char*>(&line), sizeof line);
+    out->append(site.file, fileLen);
+    out->append(site.func, funcLen);
+    out->append(site.format, formatLen);
+}
+
+}   // namespace detail
+
+void setDeferredLogging(AsyncRingLogging* log) {
+    __atomic_store_n(&detail::g_deferredLogging, log, __ATOMIC_RELEASE);
+}
+
+namespace {
+
+// 从二进制文件中读出的调用点 字符串归自己所有
+struct DecodedSite {
+    string file;
+    string func;
+    string format;
+    detail::DeferredLogSite site;
+};
+
+bool parseSite(const char* data, size_t len, uint32_t id, DecodedSite* decoded) {
+    int32_t level = 0;
+    int32_t line = 0;
+    if(len < 2 * sizeof(int32_t) + 3 || data[len - 1] != '\0') {
+        return false;
+    }
+    memcpy(&level, data, sizeof level);
+    memcpy(&line, data + sizeof level, sizeof line);
+    const char* p = data + 2 * sizeof(int32_t);
+    const char* end = data + len;
+    const char* fields[3];
+    for(int i = 0; i < 3; ++i) {
+        if(p >= end) {
+            return false;
+        }
+        fields[i] = p;
+        p += strlen(p) + 1;
+    }
+    if(level < 0 || level >= Logger::NUM_LOG_LEVELS) {
+        return false;
+    }
+    decoded->file = fields[0];
+    decoded->func = fields[1];
+    decoded->format = fields[2];
+    detail::DeferredLogSite site = { decoded->format.c_str(), decoded->file.c_str(),
+                                     decoded->func.c_str(), line,
+                                     static_cast<Logger::LogLevel>(level), id };
+    decoded->site = site;
+    return true;
+}
+
+}   // namespace
+
+/**
+ * 离线还原二进制日志 多个文件首尾相接(cat a.log b.log)也可以解析
+ */
+int64_t decodeBinaryLog(const char* data, size_t len, DecodeOutputFunc output, void* arg) {
+    std::map<uint32_t, std::unique_ptr<DecodedSite> > sites;
+    const char* p = data;
+    const char* end = data + len;
+    int64_t count = 0;
+    char buf[detail::kSmallBuffer];
+
+    while(p < end) {
+        if(static_cast<size_t>(end - p) >= sizeof kBinaryLogMagic
+           && memcmp(p, kBinaryLogMagic, sizeof kBinaryLogMagic) == 0)
+        {
+            // 新文件 调用点的编号只在一个文件内有效
+            sites.clear();
+            p += sizeof kBinaryLogMagic;
+            continue;
+        }
+        if(count == 0 && p == data) {
+            return -1;  // 不是以kBinaryLogMagic开头
+        }
+
+        BinaryLogHeader header;
+        if(static_cast<size_t>(end - p) < sizeof header) {
+            return -1;
+        }
+        memcpy(&header, p, sizeof header);
+        p += sizeof header;
+        if(static_cast<size_t>(end - p) < header.length) {
+            return -1;
+        }
+        const char* body = p;
+        p += header.length;
+
+        if(header.type == kBinarySite) {
+            std::unique_ptr<DecodedSite> site(new DecodedSite);
+            if(!parseSite(body, header.length, header.siteId, site.get())) {
+                return -1;
+            }
+            sites[header.siteId] = std::move(site);
+        }
+        else if(header.type == kBinaryMessage) {
+            auto it = sites.find(header.siteId);
+            if(it == sites.end()) {
+                return -1;
+            }
+            int n = detail::formatDeferred(it->second->site, header.tid, header.timestamp,
+                                           body, header.length, buf, sizeof buf);
+            output(buf, n, arg);
+            ++count;
+        }
+        else if(header.type == kBinaryText) {
+            output(body, static_cast<int>(header.length), arg);
+            ++count;
+        }
+        else {
+            return -1;
+        }
+    }
+    return count;
+}
+
+}   // namespace myserver
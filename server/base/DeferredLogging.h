@@ -0,0 +1,287 @@
+/**
+* @description: DeferredLogging.h
+* @author: YQ Huang
+* @brief: 延迟格式化的日志 前端只记录格式串的编号和原始参数 由后端或离线工具格式化
+* @date: 2026/10/18 15:06:12
+*/
+
+#pragma once
+
+#include "server/base/AsyncRingLogging.h"
+#include "server/base/FlightRecorder.h"
+#include "server/base/Logging.h"
+
+#include <type_traits>
+#include <stdio.h>
+#include <string.h>
+
+namespace myserver {
+
+/**
+ * Logger在调用线程上格式化时间 转换整数 拷贝文件名 每条日志要花几百纳秒
+ * LOGF_XXX宏把这些工作推迟到后端线程:
+ *   每个调用点有一个静态的DeferredLogSite 记录格式串 文件名 行号 级别
+ *   第一次执行时向全局的注册表登记 得到一个编号
+ *   之后每次调用只把 编号 + 参数的原始字节 写入AsyncRingLogging的环形缓冲区
+ * 后端线程取出记录后 按照printf格式串把参数格式化成和Logger一样的文本行
+ * 或者在二进制模式下原样写入文件 由decodeBinaryLog()离线还原
+ *
+ * 用法:
+ *   AsyncRingLogging log("server", 500*1000*1000);
+ *   log.start();
+ *   setDeferredLogging(&log);
+ *   LOGF_INFO("accept %s fd=%d", peer.c_str(), fd);
+ *
+ * 格式串和参数的规则与printf相同 由编译器检查 std::string要传c_str()
+ * 字符串的内容在调用时拷贝 其余参数按值拷贝
+ * 没有调用setDeferredLogging()时 在调用线程上格式化并交给Logger的输出函数
+ */
+void setDeferredLogging(AsyncRingLogging* log);
+
+namespace detail {
+
+// 调用点的静态描述 由LOGF_XXX宏生成 必须是常量初始化的聚合体
+struct DeferredLogSite {
+    const char* format;
+    const char* file;
+    const char* func;
+    int line;
+    Logger::LogLevel level;
+    uint32_t id;    // 0表示还没有登记
+};
+
+// 参数的类型标签 写在每个参数的前面
+enum DeferredArgType {
+    kArgInt64 = 1,
+    kArgUInt64,
+    kArgDouble,
+    kArgChar,
+    kArgString,     // uint32长度(含结尾的'\0') + 字符串
+    kArgPointer,
+};
+
+uint32_t registerLogSite(DeferredLogSite* site);
+const DeferredLogSite* findLogSite(uint32_t id);
+uint32_t numLogSites();     // 已登记的调用点个数 编号是1~numLogSites()
+
+/**
+ * 把一条延迟格式化的记录格式化成文本行 写到buf 返回写入的字节数
+ * 格式与Logger相同: 日期 时间.微秒Z 线程id 级别 正文 - 文件名:行号
+ */
+int formatDeferred(const DeferredLogSite& site, int tid, int64_t microSecondsSinceEpoch,
+                   const char* args, size_t len, char* buf, int size);
+
+// 二进制模式下把调用点的描述编码成一条kBinarySite记录 追加到out
+void encodeLogSite(const DeferredLogSite& site, uint32_t id, string* out);
+
+extern AsyncRingLogging* g_deferredLogging;
+void appendDeferredSlow(const DeferredLogSite& site, const char* args, size_t len);
+
+/**
+ * 参数的编码 ArgCodec<T>::size()返回编码后的长度 encode()写入并移动指针
+ * 不支持的类型没有定义ArgCodec 编译报错
+ */
+template<typename T, typename Enable = void>
+struct ArgCodec;
+
+template<typename T>
+inline char* encodeRaw(char* p, char type, const T& v) {
+    *p++ = type;
+    memcpy(p, &v, sizeof v);
+    return p + sizeof v;
+}
+
+inline char* encodeString(char* p, const char* str, uint32_t len) {
+    *p++ = static_cast<char>(kArgString);
+    uint32_t n = len + 1;
+    memcpy(p, &n, sizeof n);
+    p += sizeof n;
+    memcpy(p, str, len);
+    p[len] = '\0';
+    return p + n;
+}
+
+template<typename T>
+struct ArgCodec<T, typename std::enable_if<(std::is_integral<T>::value && std::is_signed<T>::value)
+                                           || std::is_enum<T>::value>::type> {
+    static size_t size(T) { return 1 + sizeof(int64_t); }
+    static char* encode(char* p, T v) { return encodeRaw(p, kArgInt64, static_cast<int64_t>(v)); }
+};
+
+template<typename T>
+struct ArgCodec<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type> {
+    static size_t size(T) { return 1 + sizeof(uint64_t); }
+    static char* encode(char* p, T v) { return encodeRaw(p, kArgUInt64, static_cast<uint64_t>(v)); }
+};
+
+template<typename T>
+struct ArgCodec<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static size_t size(T) { return 1 + sizeof(double); }
+    static char* encode(char* p, T v) { return encodeRaw(p, kArgDouble, static_cast<double>(v)); }
+};
+
+template<>
+struct ArgCodec<char> {
+    static size_t size(char) { return 2; }
+    static char* encode(char* p, char v) { *p++ = static_cast<char>(kArgChar); *p++ = v; return p; }
+};
+
+// 格式化后的一行最长kSmallBuffer 更长的字符串拷贝了也会被截断
+template<>
+struct ArgCodec<const char*> {
+    static const char* str(const char* v) { return v ? v : "(null)"; }
+    static size_t length(const char* v) { return strnlen(str(v), kSmallBuffer); }
+    static size_t size(const char* v) { return 1 + sizeof(uint32_t) + length(v) + 1; }
+    static char* encode(char* p, const char* v) {
+        return encodeString(p, str(v), static_cast<uint32_t>(length(v)));
+    }
+};
+
+template<>
+struct ArgCodec<char*> : ArgCodec<const char*> {
+};
+
+template<size_t N>
+struct ArgCodec<char[N]> : ArgCodec<const char*> {
+};
+
+template<typename T>
+struct ArgCodec<T*> {
+    static size_t size(const T*) { return 1 + sizeof(const void*); }
+    static char* encode(char* p, const T* v) {
+        return encodeRaw(p, kArgPointer, static_cast<const void*>(v));
+    }
+};
+
+inline size_t encodedSize() {
+    return 0;
+}
+
+template<typename T, typename... Args>
+inline size_t encodedSize(const T& first, const Args&... rest) {
+    return ArgCodec<T>::size(first) + encodedSize(rest...);
+}
+
+inline char* encodeArgs(char* p) {
+    return p;
+}
+
+template<typename T, typename... Args>
+inline char* encodeArgs(char* p, const T& first, const Args&... rest) {
+    return encodeArgs(ArgCodec<T>::encode(p, first), rest...);
+}
+
+inline uint32_t logSiteId(DeferredLogSite* site) {
+    uint32_t id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+    if(__builtin_expect(id == 0, 0)) {
+        id = registerLogSite(site);
+    }
+    return id;
+}
+
+// 把参数拷贝进当前线程的飞行记录仪
+template<typename... Args>
+inline void recordFlight(uint32_t id, size_t len, const Args&... args) {
+    char* buf = beginFlightRecord(len);
+    if(buf) {
+        encodeArgs(buf, args...);
+        commitFlightRecord(id, len);
+    }
+}
+
+// 级别没有打开的调用点 只写飞行记录仪
+template<typename... Args>
+inline void recordDeferred(DeferredLogSite* site, const Args&... args) {
+    recordFlight(logSiteId(site), encodedSize(args...), args...);
+}
+
+/**
+ * 前端 热路径只有一次原子读 一次时间戳 和参数的拷贝
+ */
+template<typename... Args>
+inline void appendDeferred(DeferredLogSite* site, const Args&... args) {
+    uint32_t id = logSiteId(site);
+    const size_t len = encodedSize(args...);
+    if(flightRecorderEnabled()) {
+        recordFlight(id, len, args...);
+    }
+    AsyncRingLogging* log = __atomic_load_n(&g_deferredLogging, __ATOMIC_ACQUIRE);
+    if(log) {
+        char* buf = log->beginAppend(len);
+        if(buf) {   // 缓冲区满时丢弃 已经计数
+            encodeArgs(buf, args...);
+            log->commitAppend(id, len);
+        }
+    }
+    else if(len <= kSmallBuffer) {
+        char buf[kSmallBuffer];
+        encodeArgs(buf, args...);
+        appendDeferredSlow(*site, buf, len);
+    }
+    else {
+        string buf(len, '\0');
+        encodeArgs(&*buf.begin(), args...);
+        appendDeferredSlow(*site, buf.data(), len);
+    }
+}
+
+// 只用于让编译器按printf的规则检查格式串和参数 从不调用
+void checkLogFormat(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+}   // namespace detail
+
+// 级别没有打开时 如果飞行记录仪打开了 仍然把参数记录下来
+#define LOGF_IMPL(lvl, fmt, ...) \
+    do { \
+        static myserver::detail::DeferredLogSite myserver_deferredSite = \
+            { fmt, __FILE__, __func__, __LINE__, lvl, 0 }; \
+        if(false) { \
+            myserver::detail::checkLogFormat(fmt, ##__VA_ARGS__); \
+        } \
+        if(MYSERVER_LOG_ENABLED(lvl)) { \
+            myserver::detail::appendDeferred(&myserver_deferredSite, ##__VA_ARGS__); \
+        } \
+        else if(lvl >= MYSERVER_LOG_MIN_LEVEL && myserver::detail::flightRecorderEnabled()) { \
+            myserver::detail::recordDeferred(&myserver_deferredSite, ##__VA_ARGS__); \
+        } \
+    } while(0)
+
+#define LOGF_TRACE(fmt, ...) LOGF_IMPL(myserver::Logger::TRACE, fmt, ##__VA_ARGS__)
+#define LOGF_DEBUG(fmt, ...) LOGF_IMPL(myserver::Logger::DEBUG, fmt, ##__VA_ARGS__)
+#define LOGF_INFO(fmt, ...) LOGF_IMPL(myserver::Logger::INFO, fmt, ##__VA_ARGS__)
+#define LOGF_WARN(fmt, ...) LOGF_IMPL(myserver::Logger::WARN, fmt, ##__VA_ARGS__)
+#define LOGF_ERROR(fmt, ...) LOGF_IMPL(myserver::Logger::ERROR, fmt, ##__VA_ARGS__)
+
+/**
+ * 二进制日志文件的格式 每个文件以kBinaryLogMagic开头 后面是一条条记录
+ * 每条记录 = BinaryLogHeader + length字节的内容
+ *   kBinarySite:    一个调用点第一次出现在这个文件时写入
+ *                   内容 = int32级别 + int32行号 + 文件名\0 + 函数名\0 + 格式串\0
+ *   kBinaryMessage: 一条延迟格式化的日志 内容是编码后的参数
+ *   kBinaryText:    一条已经格式化好的文本日志(LOG_XXX) 内容是文本
+ */
+struct BinaryLogHeader {
+    uint32_t type;
+    uint32_t length;
+    int64_t timestamp;
+    int32_t tid;
+    uint32_t siteId;
+};
+
+enum BinaryLogType {
+    kBinarySite = 1,
+    kBinaryMessage,
+    kBinaryText,
+};
+
+extern const char kBinaryLogMagic[8];
+
+/**
+ * 把一个二进制日志文件的内容还原成文本 每一行调用一次output
+ * 返回解析的记录数 文件格式错误时返回-1
+ */
+typedef void (*DecodeOutputFunc)(const char* line, int len, void* arg);
+int64_t decodeBinaryLog(const char* data, size_t len, DecodeOutputFunc output, void* arg);
+
+}   // namespace myserver
+
@@ -8,8 +8,13 @@
 #include "server/base/FileUtil.h"
 #include "server/base/Logging.h"
 
+#include <limits>
+#include <linux/io_uring.h>
 #include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 namespace myserver {
@@ -124,10 +129,85 @@ template int ReadSmallFile::readToString(
     int64_t* , int64_t*, int64_t*);   
 
 
+// 打开后立即映射
+MappedFile::MappedFile(StringArg filename, int flags)
+    : fd_(::open(filename.c_str(), O_RDONLY | O_CLOEXEC)),
+      data_(NULL),
+      size_(0),
+      err_(0)
+{
+    if(fd_ < 0) {
+        err_ = errno;
+        return;
+    }
+    struct stat statbuf;
+    if(::fstat(fd_, &statbuf) < 0) {
+        err_ = errno;
+    }
+    else if(S_ISDIR(statbuf.st_mode)) {
+        err_ = EISDIR;
+    }
+    else if(!S_ISREG(statbuf.st_mode)) {
+        err_ = EINVAL;
+    }
+    else if(statbuf.st_size > 0) {
+        size_ = static_cast<size_t>(statbuf.st_size);
+        int mapFlags = MAP_PRIVATE;
+        if(flags & kPopulate) {
+            mapFlags |= MAP_POPULATE;
+        }
+        void* p = ::mmap(NULL, size_, PROT_READ, mapFlags, fd_, 0);
+        if(p == MAP_FAILED) {
+            err_ = errno;
+            size_ = 0;
+        }
+        else {
+            data_ = static_cast<const char*>(p);
+            if(flags & kSequential) {
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+            }
+            else if(flags & kRandom) {
+                ::madvise(p, size_, MADV_RANDOM);
+            }
+            if((flags & kWillNeed) && !(flags & kPopulate)) {
+                ::madvise(p, size_, MADV_WILLNEED);
+            }
+        }
+    }
+}
+
+MappedFile::~MappedFile() {
+    if(data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+    if(fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+StringPiece MappedFile::data() const {
+    assert(size_ <= static_cast<size_t>(std::numeric_limits<int>::max()));
+    return StringPiece(data_, static_cast<int>(size_));
+}
+
+// madvise要求地址按页对齐 向内收缩到整页
+void MappedFile::dontNeed(size_t offset, size_t len) {
+    if(data_ == NULL || offset >= size_) {
+        return;
+    }
+    len = std::min(len, size_ - offset);
+    const size_t kPageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t start = (offset + kPageSize - 1) & ~(kPageSize - 1);
+    size_t end = offset + len == size_ ? offset + len : (offset + len) & ~(kPageSize - 1);
+    if(end > start) {
+        ::madvise(const_cast<char*>(data_) + start, end - start, MADV_DONTNEED);
+        ::posix_fadvise(fd_, static_cast<off_t>(start), static_cast<off_t>(end - start), POSIX_FADV_DONTNEED);
+    }
+}
+
 // AppendFile构造函数     
 AppendFile::AppendFile(StringArg filename)
-    : fp_(fopen(filename.c_str(), "ae")), //a：追加 e：O_CLOEXEC 多线程
-      writtenBytes_(0)
+    : fp_(fopen(filename.c_str(), "ae")) //a：追加 e：O_CLOEXEC 多线程
 {
     assert(fp_);
     // 设置文件流的缓冲区
@@ -169,6 +249,348 @@ size_t AppendFile::write(const char* logline, size_t len) {
     return fwrite_unlocked(logline, 1, len, fp_);
 }
 
+/**
+ * 最小的io_uring封装 只支持写 直接使用系统调用 不依赖liburing
+ * 提交队列和完成队列只由一个线程使用 与内核之间用acquire/release同步
+ */
+class IoUring : noncopyable {
+public:
+    explicit IoUring(unsigned entries)
+        : fd_(-1), sqRing_(NULL), cqRing_(NULL), sqes_(NULL),
+          sqRingSize_(0), cqRingSize_(0), sqesSize_(0)
+    {
+        struct io_uring_params params;
+        memZero(&params, sizeof params);
+        fd_ = static_cast<int>(::syscall(SYS_io_uring_setup, entries, &params));
+        if(fd_ < 0) {
+            return;
+        }
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if(params.features & IORING_FEAT_SINGLE_MMAP) {
+            sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        }
+        sqRing_ = mapRing(sqRingSize_, IORING_OFF_SQ_RING);
+        cqRing_ = (params.features & IORING_FEAT_SINGLE_MMAP) ? sqRing_ : mapRing(cqRingSize_, IORING_OFF_CQ_RING);
+        sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes_ = static_cast<struct io_uring_sqe*>(mapRing(sqesSize_, IORING_OFF_SQES));
+        if(sqRing_ == NULL || cqRing_ == NULL || sqes_ == NULL) {
+            release();
+            return;
+        }
+        sqHead_ = ringField(sqRing_, params.sq_off.head);
+        sqTail_ = ringField(sqRing_, params.sq_off.tail);
+        sqMask_ = *ringField(sqRing_, params.sq_off.ring_mask);
+        sqArray_ = ringField(sqRing_, params.sq_off.array);
+        cqHead_ = ringField(cqRing_, params.cq_off.head);
+        cqTail_ = ringField(cqRing_, params.cq_off.tail);
+        cqMask_ = *ringField(cqRing_, params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<struct io_uring_cqe*>(static_cast<char*>(cqRing_) + params.cq_off.cqes);
+    }
+
+    ~IoUring() {
+        release();
+    }
+
+    bool valid() const { return fd_ >= 0; }
+
+    /**
+     * 提交一个写请求 不等待完成 调用者保证未完成的请求数不超过entries
+     * io_uring_enter失败且内核没有取走这个请求时撤回队尾 返回false
+     * 否则它会留在提交队列里 随下一次enter提交 完成事件会被当成之后的请求的
+     */
+    bool submitWrite(int fd, const void* buf, unsigned len, off_t offset, uint64_t userData) {
+        unsigned tail = *sqTail_;
+        unsigned index = tail & sqMask_;
+        struct io_uring_sqe* sqe = &sqes_[index];
+        memZero(sqe, sizeof *sqe);
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = len;
+        sqe->off = static_cast<uint64_t>(offset);
+        sqe->user_data = userData;
+        sqArray_[index] = index;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+        int ret = enter(1, 0, 0);
+        while(ret < 0 && errno == EINTR) {
+            ret = enter(1, 0, 0);
+        }
+        if(ret == 1 || __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) != tail) {
+            return true;
+        }
+        __atomic_store_n(sqTail_, tail, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    // 等待一个完成事件
+    void waitCompletion(uint64_t* userData, int* result) {
+        for(;;) {
+            unsigned head = *cqHead_;
+            if(head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+                const struct io_uring_cqe& cqe = cqes_[head & cqMask_];
+                *userData = cqe.user_data;
+                *result = cqe.res;
+                __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+                return;
+            }
+            if(enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                *userData = 0;
+                *result = -errno;
+                return;
+            }
+        }
+    }
+
+private:
+    void* mapRing(size_t size, off_t offset) {
+        void* p = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? NULL : p;
+    }
+
+    static unsigned* ringField(void* ring, unsigned offset) {
+        return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(::syscall(SYS_io_uring_enter, fd_, toSubmit, minComplete, flags, NULL, 0));
+    }
+
+    void release() {
+        if(sqes_) {
+            ::munmap(sqes_, sqesSize_);
+        }
+        if(cqRing_ && cqRing_ != sqRing_) {
+            ::munmap(cqRing_, cqRingSize_);
+        }
+        if(sqRing_) {
+            ::munmap(sqRing_, sqRingSize_);
+        }
+        if(fd_ >= 0) {
+            ::close(fd_);
+        }
+        sqes_ = NULL;
+        cqRing_ = sqRing_ = NULL;
+        fd_ = -1;
+    }
+
+    int fd_;
+    void* sqRing_;
+    void* cqRing_;
+    struct io_uring_sqe* sqes_;
+    size_t sqRingSize_;
+    size_t cqRingSize_;
+    size_t sqesSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned* sqArray_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    struct io_uring_cqe* cqes_;
+};
+
+/**
+ * 先尝试O_DIRECT 文件系统不支持时(EINVAL)退回普通的打开方式
+ * 文件已经存在时从末尾接着写 把最后不足一块的数据读回当前缓冲区
+ */
+DirectAppendFile::DirectAppendFile(StringArg filename)
+    : fd_(::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | O_DIRECT, 0644)),
+      direct_(fd_ >= 0),
+      current_(0),
+      used_(0),
+      flushedUsed_(0),
+      fileOffset_(0),
+      allocated_(0),
+      fallocateOk_(true),
+      lastRangeOffset_(0),
+      lastRangeLength_(0)
+{
+    if(fd_ < 0) {
+        fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    }
+    if(fd_ < 0) {
+        fprintf(stderr, "DirectAppendFile: open %s failed %s\n", filename.c_str(), strerror_tl(errno));
+    }
+    assert(fd_ >= 0);
+
+    for(int i = 0; i < kNumBuffers; ++i) {
+        void* buf = NULL;
+        if(::posix_memalign(&buf, kBlockSize, kBufferSize) != 0) {
+            abort();
+        }
+        buffers_[i] = static_cast<char*>(buf);
+        inflight_[i] = false;
+        offsets_[i] = 0;
+    }
+
+    if(direct_) {
+        ring_.reset(new IoUring(2 * kNumBuffers));
+        if(!ring_->valid()) {
+            ring_.reset();
+        }
+    }
+
+    struct stat st;
+    if(::fstat(fd_, &st) == 0 && st.st_size > 0) {
+        fileOffset_ = st.st_size & ~static_cast<off_t>(kBlockSize - 1);
+        used_ = static_cast<size_t>(st.st_size - fileOffset_);
+        if(used_ > 0) {
+            int rfd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+            if(rfd < 0 || ::pread(rfd, buffers_[0], used_, fileOffset_) != static_cast<ssize_t>(used_)) {
+                fprintf(stderr, "DirectAppendFile: read tail of %s failed\n", filename.c_str());
+            }
+            if(rfd >= 0) {
+                ::close(rfd);
+            }
+            flushedUsed_ = used_;   // 已经在文件里
+        }
+    }
+}
+
+DirectAppendFile::~DirectAppendFile() {
+    flush();
+    // 释放预分配但没有用到的空间
+    if(::ftruncate(fd_, fileOffset_ + static_cast<off_t>(used_)) < 0) {
+        fprintf(stderr, "DirectAppendFile: ftruncate failed %s\n", strerror_tl(errno));
+    }
+    ring_.reset();
+    ::close(fd_);
+    for(int i = 0; i < kNumBuffers; ++i) {
+        ::free(buffers_[i]);
+    }
+}
+
+void DirectAppendFile::append(const char* logline, size_t len) {
+    writtenBytes_ += len;
+    while(len > 0) {
+        size_t n = std::min(len, kBufferSize - used_);
+        memcpy(buffers_[current_] + used_, logline, n);
+        used_ += n;
+        logline += n;
+        len -= n;
+        if(used_ == kBufferSize) {
+            submitCurrent();
+        }
+    }
+}
+
+/**
+ * O_DIRECT要求长度和偏移都按块对齐 把尾部补零写成整块 数据仍留在当前缓冲区 写满后整块重写
+ * 这里不截断: 截断会丢掉文件末尾之后的预分配 每次flush都要重新fallocate
+ * 所以打开期间文件长度按块对齐 末尾可能有补齐的0 真实长度是fileOffset_ + used_
+ * 析构时(LogFile滚动时也会析构)才截断到真实长度
+ * 上次flush之后没有新数据时不重写尾块
+ */
+void DirectAppendFile::flush() {
+    waitAll();
+    if(used_ == flushedUsed_) {
+        return;
+    }
+    if(direct_) {
+        size_t aligned = (used_ + kBlockSize - 1) & ~(kBlockSize - 1);
+        memZero(buffers_[current_] + used_, aligned - used_);
+        writeSync(buffers_[current_], aligned, fileOffset_);
+    }
+    else {
+        writeSync(buffers_[current_] + flushedUsed_, used_ - flushedUsed_,
+                  fileOffset_ + static_cast<off_t>(flushedUsed_));
+    }
+    flushedUsed_ = used_;
+}
+
+void DirectAppendFile::submitCurrent() {
+    preallocate(fileOffset_ + static_cast<off_t>(kBufferSize));
+    if(ring_ && ring_->submitWrite(fd_, buffers_[current_], static_cast<unsigned>(kBufferSize),
+                                   fileOffset_, static_cast<uint64_t>(current_)))
+    {
+        inflight_[current_] = true;
+        offsets_[current_] = fileOffset_;
+    }
+    else {
+        writeSync(buffers_[current_], kBufferSize, fileOffset_);
+        if(!direct_) {
+            // 发起这一块的回写 等上一块写完并丢掉它的页缓存
+            ::sync_file_range(fd_, fileOffset_, kBufferSize, SYNC_FILE_RANGE_WRITE);
+            if(lastRangeLength_ > 0) {
+                ::sync_file_range(fd_, lastRangeOffset_, lastRangeLength_,
+                                  SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+                ::posix_fadvise(fd_, lastRangeOffset_, lastRangeLength_, POSIX_FADV_DONTNEED);
+            }
+            lastRangeOffset_ = fileOffset_;
+            lastRangeLength_ = kBufferSize;
+        }
+    }
+    fileOffset_ += kBufferSize;
+    current_ = (current_ + 1) % kNumBuffers;
+    used_ = 0;
+    flushedUsed_ = 0;
+    waitBuffer(current_);
+}
+
+// O_DIRECT短写之后从已写部分的块边界重写 否则剩下部分的地址 长度和偏移都不对齐
+void DirectAppendFile::writeSync(const char* buf, size_t len, off_t offset) {
+    while(len > 0) {
+        ssize_t n = ::pwrite(fd_, buf, len, offset);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "DirectAppendFile::append() failed %s\n", strerror_tl(errno));
+            return;
+        }
+        size_t written = static_cast<size_t>(n);
+        if(direct_ && written < len) {
+            written &= ~(kBlockSize - 1);
+        }
+        buf += written;
+        len -= written;
+        offset += static_cast<off_t>(written);
+    }
+}
+
+void DirectAppendFile::waitBuffer(int index) {
+    while(inflight_[index]) {
+        uint64_t userData = 0;
+        int result = 0;
+        ring_->waitCompletion(&userData, &result);
+        if(userData >= static_cast<uint64_t>(kNumBuffers)) {
+            continue;
+        }
+        int done = static_cast<int>(userData);
+        inflight_[done] = false;
+        if(result < 0) {
+            fprintf(stderr, "DirectAppendFile::append() failed %s\n", strerror_tl(-result));
+        }
+        else if(static_cast<size_t>(result) < kBufferSize) {
+            // 很少发生 例如磁盘满 剩下的部分从块边界开始同步重试 O_DIRECT要求对齐
+            size_t written = static_cast<size_t>(result) & ~(kBlockSize - 1);
+            writeSync(buffers_[done] + written, kBufferSize - written,
+                      offsets_[done] + static_cast<off_t>(written));
+        }
+    }
+}
+
+void DirectAppendFile::waitAll() {
+    for(int i = 0; i < kNumBuffers; ++i) {
+        waitBuffer(i);
+    }
+}
+
+void DirectAppendFile::preallocate(off_t end) {
+    if(!fallocateOk_ || end <= allocated_) {
+        return;
+    }
+    off_t start = std::max(allocated_, fileOffset_);
+    if(::fallocate(fd_, FALLOC_FL_KEEP_SIZE, start, kPreallocSize) == 0) {
+        allocated_ = start + kPreallocSize;
+    }
+    else {
+        fallocateOk_ = false;   // 文件系统不支持
+    }
+}
+
 }   // namespace FileUtil
 
 }   // namespace myserver
\ No newline at end of file
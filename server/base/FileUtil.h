@@ -9,6 +9,8 @@
 
 #include "server/base/noncopyable.h"
 #include "server/base/StringPiece.h"
+
+#include <memory>
 #include <sys/types.h> // for off_t
 
 
@@ -61,21 +63,84 @@ int readFile(StringArg filename,
     return file.readToString(maxSize, content, fileSize, modifyTime, createTime);
 }
 
+/**
+ * 只读映射整个文件 用于启动时加载几百MB的配置和查找表
+ * ReadSmallFile每次只能读64KB并且要复制到String里 大文件要先读一遍再解析一遍
+ * MappedFile直接把页缓存映射进来 没有复制 通过data()得到整个文件的视图
+ *
+ * flags可以组合:
+ *   kSequential  madvise(MADV_SEQUENTIAL) 顺序访问 内核加大预读 读过的页可以尽早回收
+ *   kRandom      madvise(MADV_RANDOM) 随机查找 关闭预读
+ *   kWillNeed    madvise(MADV_WILLNEED) 立即在后台开始读入整个文件 不等待
+ *   kPopulate    mmap时带MAP_POPULATE 构造函数返回前读入并建立所有页表项 之后访问不会缺页
+ *
+ * 文件大小取自fstat 所以/proc下的文件和设备文件不适用 仍然用readFile
+ * 映射之后文件被截断 访问超出部分会收到SIGBUS 只用于不会被原地修改的文件
+ */
+class MappedFile : noncopyable {
+public:
+    enum Flags {
+        kSequential = 1 << 0,
+        kRandom     = 1 << 1,
+        kWillNeed   = 1 << 2,
+        kPopulate   = 1 << 3,
+    };
+
+    explicit MappedFile(StringArg filename, int flags = kSequential | kWillNeed);
+    ~MappedFile();
+
+    // 返回错误码errno 0表示成功
+    int error() const { return err_; }
+    bool valid() const { return err_ == 0; }
+
+    const char* begin() const { return data_; }
+    size_t size() const { return size_; }
+    // 整个文件的视图 StringPiece的长度是int 超过2GB的文件用begin()和size()
+    StringPiece data() const;
+
+    // 已经处理完的部分不再需要 解除这部分的映射并让内核尽早回收页缓存
+    void dontNeed(size_t offset, size_t len);
+
+private:
+    int fd_;            // 保留到析构 dontNeed()要用
+    const char* data_;  // 映射的起始地址 空文件为NULL
+    size_t size_;       // 文件大小
+    int err_;           // 错误码
+};
+
+/**
+ * 日志文件的写入接口 LogFile通过它写文件 有stdio和直接IO两种实现
+ * 不是线程安全的，由调用它的函数保证线程安全
+ */
+class WritableFile : noncopyable {
+public:
+    WritableFile() : writtenBytes_(0) { }
+    virtual ~WritableFile() { }
+
+    // 将logline写到缓冲区
+    virtual void append(const char* logline, size_t len) = 0;
+    // 将缓冲区的信息flush到输出
+    virtual void flush() = 0;
+    // 已写入的字节数
+    off_t writtenBytes() const { return writtenBytes_; }
+
+protected:
+    off_t writtenBytes_;    // 已写入字节数
+};
+
 /**
  * AppendFile不是线程安全的，由调用它的函数保证线程安全
  */
-class AppendFile : noncopyable {
+class AppendFile : public WritableFile {
 public:
     explicit AppendFile(StringArg filename);
     
-    ~AppendFile();
+    ~AppendFile() override;
 
     // 将logline写到缓冲区
-    void append(const char* logline, size_t len);
+    void append(const char* logline, size_t len) override;
     // 将缓冲区的信息flush到输出
-    void flush();
-    // 已写入的字节数
-    off_t writtenBytes() const { return writtenBytes_;}
+    void flush() override;
 
 private:
     // 写
@@ -83,7 +148,66 @@ private:
 
     FILE* fp_;  // 打开的文件指针
     char buffer_[64*1024];  // 用户态缓冲区 大小为64KB 减少文件IO的次数
-    off_t writtenBytes_;    // 已写入字节数
+};
+
+class IoUring;
+
+/**
+ * 绕过页缓存的AppendFile stdio版本的写入先进页缓存 何时写盘由内核的回写决定
+ * 回写集中发生时 写日志的线程会被卡住几十毫秒
+ *
+ * DirectAppendFile用O_DIRECT打开文件 数据攒满一块1MB的对齐缓冲区后
+ * 通过io_uring异步写入 同时准备kNumBuffers块缓冲区轮流使用 append只在
+ * 所有缓冲区都在写盘时才等待
+ * 文件用fallocate(FALLOC_FL_KEEP_SIZE)按64MB预先分配 减少写入时的块分配
+ *
+ * 降级:
+ *   io_uring不可用时用pwrite同步写
+ *   文件系统不支持O_DIRECT(例如tmpfs)时用普通的写入 每写一块就用sync_file_range
+ *   发起这一块的回写 并等待上一块写完后丢掉它的页缓存 脏页始终只有一两块
+ *
+ * flush()把不足一块的尾部补零后写入 这一块数据留在缓冲区里 以后写满时再完整地写一次
+ * 为了保留预分配 打开期间不截断 文件长度按kBlockSize对齐 末尾可能有补齐的0
+ * 析构时(LogFile滚动时)截断到真实长度 进程崩溃时留下的文件末尾可能有不足一块的0
+ */
+class DirectAppendFile : public WritableFile {
+public:
+    explicit DirectAppendFile(StringArg filename);
+    ~DirectAppendFile() override;
+
+    void append(const char* logline, size_t len) override;
+    void flush() override;
+
+    // 是否真的用上了O_DIRECT和io_uring 用于测试和性能对比
+    bool directIO() const { return direct_; }
+    bool asyncIO() const { return ring_ != NULL; }
+
+    static const size_t kBlockSize = 4096;
+    static const size_t kBufferSize = 1024 * 1024;
+    static const int kNumBuffers = 4;
+    static const off_t kPreallocSize = 64 * 1024 * 1024;
+
+private:
+    void submitCurrent();                       // 写出写满的当前缓冲区 换到下一块
+    void writeSync(const char* buf, size_t len, off_t offset);
+    void waitBuffer(int index);                 // 等待这块缓冲区写完
+    void waitAll();
+    void preallocate(off_t end);
+
+    int fd_;
+    bool direct_;                       // 是否用O_DIRECT打开
+    std::unique_ptr<IoUring> ring_;     // 为NULL时同步写
+    char* buffers_[kNumBuffers];        // kBlockSize对齐
+    bool inflight_[kNumBuffers];        // 是否正在写盘
+    off_t offsets_[kNumBuffers];        // 正在写盘的缓冲区在文件中的位置 短写时补写剩下的部分
+    int current_;                       // 当前缓冲区
+    size_t used_;                       // 当前缓冲区已用的字节数
+    size_t flushedUsed_;                // 上次flush时当前缓冲区已用的字节数
+    off_t fileOffset_;                  // 当前缓冲区在文件中的位置 kBlockSize对齐
+    off_t allocated_;                   // 已经预分配到的位置
+    bool fallocateOk_;
+    off_t lastRangeOffset_;             // 非O_DIRECT时上一次发起回写的范围
+    off_t lastRangeLength_;
 };
 
 }   // namespace FileUtil
@@ -0,0 +1,568 @@
+/**
+* @description: FlightRecorder.cc
+* @author: YQ Huang
+* @brief: 常开的日志飞行记录仪 每个线程一个环形缓冲区 进程崩溃时写到文件
+* @date: 2026/10/18 20:31:16
+*/
+
+#include "server/base/FlightRecorder.h"
+#include "server/base/CurrentThread.h"
+#include "server/base/DeferredLogging.h"
+#include "server/base/Mutex.h"
+#include "server/base/Timestamp.h"
+
+#include <algorithm>
+#include <vector>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace myserver {
+
+namespace detail {
+
+bool g_flightRecorderEnabled = false;
+
+namespace {
+
+const uint32_t kRecordPad = 0;      // 填充到缓冲区末尾 读到它就绕回开头
+const size_t kAlign = 8;
+
+inline size_t alignUp(size_t n) {
+    return (n + kAlign - 1) & ~(kAlign - 1);
+}
+
+/**
+ * 一个线程的环形缓冲区 只有所属线程写 崩溃时由信号处理函数读
+ * head_和tail_是单调增加的位置 对size取模得到缓冲区中的偏移
+ * 每条记录 = BinaryLogHeader + 内容 按8字节对齐 不跨越缓冲区末尾
+ * 写入前先把tail_移过将被覆盖的旧记录 所以[tail_, head_)之间总是完整的记录
+ */
+class FlightRing : noncopyable {
+public:
+    explicit FlightRing(size_t size)
+        : buf_(new char[size]),
+          size_(size),
+          head_(0),
+          tail_(0),
+          pending_(0)
+    {
+    }
+
+    char* begin(size_t len) {
+        size_t need = alignUp(sizeof(BinaryLogHeader) + len);
+        if(need > size_ / 4) {
+            return NULL;
+        }
+        uint64_t pos = head_;
+        size_t offset = static_cast<size_t>(pos & (size_ - 1));
+        size_t toEnd = size_ - offset;
+        if(toEnd < need) {
+            reserve(pos, toEnd);
+            if(toEnd >= sizeof(BinaryLogHeader)) {
+                BinaryLogHeader pad;
+                memZero(&pad, sizeof pad);
+                pad.type = kRecordPad;
+                memcpy(buf_.get() + offset, &pad, sizeof pad);
+            }
+            pos += toEnd;
+            offset = 0;
+        }
+        reserve(pos, need);
+        pending_ = pos;
+        return buf_.get() + offset + sizeof(BinaryLogHeader);
+    }
+
+    void commit(uint32_t siteId, size_t len) {
+        BinaryLogHeader header;
+        header.type = siteId == 0 ? kBinaryText : kBinaryMessage;
+        header.length = static_cast<uint32_t>(len);
+        header.timestamp = Timestamp::nowFast().microSecondsSinceEpoch();
+        header.tid = CurrentThread::tid();
+        header.siteId = siteId;
+        memcpy(buf_.get() + (pending_ & (size_ - 1)), &header, sizeof header);
+        __atomic_store_n(&head_, pending_ + alignUp(sizeof header + len), __ATOMIC_RELEASE);
+    }
+
+    /**
+     * 按时间顺序依次输出每条记录 output返回false时停止
+     * 写入线程可能还在运行 所以每个头部都要检查 读到不合理的长度就停止
+     */
+    template<typename Output>
+    int64_t forEach(Output output) const {
+        uint64_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+        uint64_t pos = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+        int64_t count = 0;
+        while(pos < head) {
+            size_t offset = static_cast<size_t>(pos & (size_ - 1));
+            const char* p = buf_.get() + offset;
+            size_t span = recordSpan(pos);
+            if(span == 0 || pos + span > head) {
+                break;
+            }
+            BinaryLogHeader header;
+            memcpy(&header, p, sizeof header);
+            if(header.type == kBinaryText || header.type == kBinaryMessage) {
+                if(!output(header, p + sizeof header)) {
+                    break;
+                }
+                ++count;
+            }
+            pos += span;
+        }
+        return count;
+    }
+
+private:
+    // pos处的记录占用的字节数 包括对齐和末尾的填充 0表示头部已损坏
+    size_t recordSpan(uint64_t pos) const {
+        size_t offset = static_cast<size_t>(pos & (size_ - 1));
+        size_t toEnd = size_ - offset;
+        if(toEnd < sizeof(BinaryLogHeader)) {
+            return toEnd;
+        }
+        BinaryLogHeader header;
+        memcpy(&header, buf_.get() + offset, sizeof header);
+        if(header.type == kRecordPad) {
+            return toEnd;
+        }
+        size_t span = alignUp(sizeof header + header.length);
+        return span <= toEnd ? span : 0;
+    }
+
+    // 写[pos, pos + len)之前 丢掉会被覆盖的最旧的记录
+    void reserve(uint64_t pos, size_t len) {
+        uint64_t tail = tail_;
+        while(pos + len - tail > size_) {
+            size_t span = recordSpan(tail);
+            tail += span ? span : static_cast<uint64_t>(size_);
+        }
+        __atomic_store_n(&tail_, tail, __ATOMIC_RELEASE);
+    }
+
+    std::unique_ptr<char[]> buf_;
+    const size_t size_;     // 2的幂
+    uint64_t head_;         // 下一条记录的位置
+    uint64_t tail_;         // 最旧的记录的位置
+    uint64_t pending_;      // begin()预留的记录的位置
+};
+
+/**
+ * 所有线程的缓冲区 注册后不再释放 信号处理函数不加锁直接遍历
+ * 线程退出后缓冲区放回空闲列表 新线程复用时保留旧的记录
+ */
+const int kMaxRings = 4096;
+FlightRing* g_rings[kMaxRings];
+int g_numRings = 0;
+MutexLock g_ringsMutex;
+std::vector<FlightRing*>* g_freeRings = NULL;
+size_t g_ringSize = 64 * 1024;
+pthread_key_t g_ringKey;
+pthread_once_t g_ringKeyOnce = PTHREAD_ONCE_INIT;
+
+__thread FlightRing* t_flightRing = NULL;
+
+/**
+ * 备用信号栈 栈溢出引起的SIGSEGV发生时线程栈已经用完 信号处理函数只能在备用栈上运行
+ * 处理函数自己的缓冲区约9KB backtrace()展开调用栈还要用一些 所以比SIGSTKSZ大
+ */
+const size_t kAltStackSize = 64 * 1024;
+__thread char* t_altStack = NULL;
+
+// 调用线程已经有备用栈时(例如由应用自己设置)不替换
+void installAltStack() {
+    stack_t old;
+    if(t_altStack || ::sigaltstack(NULL, &old) != 0 || !(old.ss_flags & SS_DISABLE)) {
+        return;
+    }
+    stack_t ss;
+    ss.ss_sp = new char[kAltStackSize];
+    ss.ss_size = kAltStackSize;
+    ss.ss_flags = 0;
+    if(::sigaltstack(&ss, NULL) == 0) {
+        t_altStack = static_cast<char*>(ss.ss_sp);
+    }
+    else {
+        delete[] static_cast<char*>(ss.ss_sp);
+    }
+}
+
+// 线程退出时调用 之后这个线程不会再收到信号
+void releaseAltStack() {
+    if(t_altStack) {
+        stack_t ss;
+        memZero(&ss, sizeof ss);
+        ss.ss_flags = SS_DISABLE;
+        ::sigaltstack(&ss, NULL);
+        delete[] t_altStack;
+        t_altStack = NULL;
+    }
+}
+
+void releaseRing(void* ring) {
+    releaseAltStack();
+    MutexLockGuard lock(g_ringsMutex);
+    if(g_freeRings == NULL) {
+        g_freeRings = new std::vector<FlightRing*>;
+    }
+    g_freeRings->push_back(static_cast<FlightRing*>(ring));
+}
+
+void createRingKey() {
+    ::pthread_key_create(&g_ringKey, releaseRing);
+}
+
+// 慢路径 当前线程第一次记录时取得缓冲区
+FlightRing* ringOfThisThread() {
+    ::pthread_once(&g_ringKeyOnce, createRingKey);
+    FlightRing* ring = NULL;
+    {
+        MutexLockGuard lock(g_ringsMutex);
+        if(g_freeRings && !g_freeRings->empty()) {
+            ring = g_freeRings->back();
+            g_freeRings->pop_back();
+        }
+        else if(g_numRings < kMaxRings) {
+            ring = new FlightRing(g_ringSize);
+            __atomic_store_n(&g_rings[g_numRings], ring, __ATOMIC_RELEASE);
+            __atomic_store_n(&g_numRings, g_numRings + 1, __ATOMIC_RELEASE);
+        }
+    }
+    if(ring) {
+        ::pthread_setspecific(g_ringKey, ring);
+        installAltStack();
+    }
+    t_flightRing = ring;
+    return ring;
+}
+
+/**
+ * 信号处理函数中使用的输出 不分配内存 攒满缓冲区后write
+ */
+class SafeWriter {
+public:
+    explicit SafeWriter(int fd)
+        : fd_(fd),
+          len_(0)
+    {
+    }
+
+    ~SafeWriter() {
+        flush();
+    }
+
+    void append(const void* data, size_t len) {
+        const char* p = static_cast<const char*>(data);
+        while(len > 0) {
+            size_t n = std::min(len, sizeof buf_ - len_);
+            memcpy(buf_ + len_, p, n);
+            len_ += n;
+            p += n;
+            len -= n;
+            if(len_ == sizeof buf_) {
+                flush();
+            }
+        }
+    }
+
+    void append(const char* str) {
+        append(str, strlen(str));
+    }
+
+    void flush() {
+        const char* p = buf_;
+        while(len_ > 0) {
+            ssize_t n = ::write(fd_, p, len_);
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            if(n <= 0) {
+                break;
+            }
+            p += n;
+            len_ -= static_cast<size_t>(n);
+        }
+        len_ = 0;
+    }
+
+private:
+    int fd_;
+    size_t len_;
+    char buf_[4096];
+};
+
+// 同encodeLogSite() 但不分配内存
+void writeLogSite(SafeWriter* out, const DeferredLogSite& site, uint32_t id) {
+    const size_t fileLen = strlen(site.file) + 1;
+    const size_t funcLen = strlen(site.func) + 1;
+    const size_t formatLen = strlen(site.format) + 1;
+    BinaryLogHeader header;
+    header.type = kBinarySite;
+    header.length = static_cast<uint32_t>(2 * sizeof(int32_t) + fileLen + funcLen + formatLen);
+    header.timestamp = 0;
+    header.tid = 0;
+    header.siteId = id;
+    int32_t level = site.level;
+    int32_t line = site.line;
+    out->append(&header, sizeof header);
+    out->append(&level, sizeof level);
+    out->append(&line, sizeof line);
+    out->append(site.file, fileLen);
+    out->append(site.func, funcLen);
+    out->append(site.format, formatLen);
+}
+
+// 写一行文本记录 text以'\n'结尾
+void writeText(SafeWriter* out, const char* text, size_t len) {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    BinaryLogHeader header;
+    header.type = kBinaryText;
+    header.length = static_cast<uint32_t>(len);
+    header.timestamp = static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+    header.tid = CurrentThread::tid();
+    header.siteId = 0;
+    out->append(&header, sizeof header);
+    out->append(text, len);
+}
+
+/**
+ * 在固定的缓冲区中拼出一行文本 超长时截断
+ */
+class SafeLine {
+public:
+    SafeLine() : len_(0) { }
+
+    SafeLine& operator<<(const char* str) {
+        size_t n = std::min(strlen(str), sizeof buf_ - 1 - len_);
+        memcpy(buf_ + len_, str, n);
+        len_ += n;
+        return *this;
+    }
+
+    void appendUInt(uint64_t v, int base) {
+        char digits[24];
+        int i = sizeof digits;
+        do {
+            digits[--i] = "0123456789abcdef"[v % static_cast<uint64_t>(base)];
+            v /= static_cast<uint64_t>(base);
+        } while(v != 0);
+        size_t n = std::min(sizeof digits - i, sizeof buf_ - 1 - len_);
+        memcpy(buf_ + len_, digits + i, n);
+        len_ += n;
+    }
+
+    void writeTo(SafeWriter* out) {
+        buf_[len_++] = '\n';
+        writeText(out, buf_, len_);
+        len_ = 0;
+    }
+
+private:
+    char buf_[512];
+    size_t len_;
+};
+
+/**
+ * 调用栈 backtrace()和dladdr()不分配内存(backtrace第一次调用时加载libgcc 已在安装时预先调用)
+ * 符号名不做demangle 用c++filt还原
+ * dladdr()要加动态链接器的锁 不是异步信号安全的 崩溃发生在dlopen()等持有这把锁的
+ * 函数里时会死锁 这时文件里只有调用栈之前的内容 进程需要由外部结束
+ */
+void writeStackTrace(SafeWriter* out) {
+    const int kMaxFrames = 64;
+    void* frames[kMaxFrames];
+    int n = ::backtrace(frames, kMaxFrames);
+    for(int i = 0; i < n; ++i) {
+        SafeLine line;
+        line << "    #";
+        line.appendUInt(static_cast<uint64_t>(i), 10);
+        line << " 0x";
+        line.appendUInt(reinterpret_cast<uintptr_t>(frames[i]), 16);
+        Dl_info info;
+        if(::dladdr(frames[i], &info)) {
+            if(info.dli_sname) {
+                line << " " << info.dli_sname << "+0x";
+                line.appendUInt(reinterpret_cast<uintptr_t>(frames[i]) - reinterpret_cast<uintptr_t>(info.dli_saddr), 16);
+            }
+            if(info.dli_fname) {
+                line << " (" << info.dli_fname << ")";
+            }
+        }
+        line.writeTo(out);
+    }
+}
+
+int64_t dumpRings(SafeWriter* out) {
+    out->append(kBinaryLogMagic, sizeof kBinaryLogMagic);
+    uint32_t numSites = numLogSites();
+    for(uint32_t id = 1; id <= numSites; ++id) {
+        const DeferredLogSite* site = findLogSite(id);
+        if(site) {
+            writeLogSite(out, *site, id);
+        }
+    }
+    int64_t count = 0;
+    int numRings = __atomic_load_n(&g_numRings, __ATOMIC_ACQUIRE);
+    for(int i = 0; i < numRings; ++i) {
+        const FlightRing* ring = __atomic_load_n(&g_rings[i], __ATOMIC_ACQUIRE);
+        count += ring->forEach([out, numSites](const BinaryLogHeader& header, const char* body) {
+            // 还没来得及登记的调用点 解码时找不到 跳过
+            if(header.type == kBinaryMessage && (header.siteId == 0 || header.siteId > numSites)) {
+                return true;
+            }
+            out->append(&header, sizeof header);
+            out->append(body, header.length);
+            return true;
+        });
+    }
+    return count;
+}
+
+char g_crashBasename[256];
+const int kFatalSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+
+const char* signalName(int sig) {
+    switch(sig) {
+    case SIGSEGV: return "SIGSEGV";
+    case SIGBUS: return "SIGBUS";
+    case SIGFPE: return "SIGFPE";
+    case SIGILL: return "SIGILL";
+    case SIGABRT: return "SIGABRT";
+    default: return "signal";
+    }
+}
+
+/**
+ * 只使用异步信号安全的函数 写完后恢复默认处理再发一次信号 由内核结束进程
+ */
+void crashHandler(int sig, siginfo_t* info, void*) {
+    int savedErrno = errno;
+    char path[sizeof g_crashBasename + 32];
+    {
+        size_t len = strlen(g_crashBasename);
+        memcpy(path, g_crashBasename, len);
+        path[len++] = '.';
+        char digits[16];
+        int i = sizeof digits;
+        uint32_t pid = static_cast<uint32_t>(::getpid());
+        do {
+            digits[--i] = static_cast<char>('0' + pid % 10);
+            pid /= 10;
+        } while(pid != 0);
+        memcpy(path + len, digits + i, sizeof digits - i);
+        len += sizeof digits - i;
+        memcpy(path + len, ".crash", 7);
+    }
+
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd >= 0) {
+        SafeWriter out(fd);
+        dumpRings(&out);
+        SafeLine line;
+        line << "crash: " << signalName(sig) << " (";
+        line.appendUInt(static_cast<uint64_t>(sig), 10);
+        line << ") addr 0x";
+        line.appendUInt(reinterpret_cast<uintptr_t>(info ? info->si_addr : NULL), 16);
+        line << " in thread ";
+        line.appendUInt(static_cast<uint64_t>(CurrentThread::tid()), 10);
+        line << " " << CurrentThread::name();
+        line.writeTo(&out);
+        writeStackTrace(&out);
+        out.flush();
+        ::close(fd);
+    }
+
+    SafeWriter err(STDERR_FILENO);
+    err.append("caught ");
+    err.append(signalName(sig));
+    err.append(", flight recorder dumped to ");
+    err.append(path);
+    err.append("\n");
+    err.flush();
+
+    errno = savedErrno;
+    ::signal(sig, SIG_DFL);
+    ::raise(sig);
+}
+
+}   // namespace
+
+char* beginFlightRecord(size_t len) {
+    FlightRing* ring = t_flightRing;
+    if(__builtin_expect(ring == NULL, 0)) {
+        ring = ringOfThisThread();
+        if(ring == NULL) {
+            return NULL;
+        }
+    }
+    return ring->begin(len);
+}
+
+void commitFlightRecord(uint32_t siteId, size_t len) {
+    t_flightRing->commit(siteId, len);
+}
+
+void recordFlightText(const char* text, size_t len) {
+    char* buf = beginFlightRecord(len);
+    if(buf) {
+        memcpy(buf, text, len);
+        commitFlightRecord(0, len);
+    }
+}
+
+}   // namespace detail
+
+namespace FlightRecorder {
+
+void enable(size_t ringSize) {
+    size_t size = 4096;
+    while(size < ringSize) {
+        size <<= 1;
+    }
+    {
+        MutexLockGuard lock(detail::g_ringsMutex);
+        detail::g_ringSize = size;
+    }
+    __atomic_store_n(&detail::g_flightRecorderEnabled, true, __ATOMIC_RELEASE);
+}
+
+void disable() {
+    __atomic_store_n(&detail::g_flightRecorderEnabled, false, __ATOMIC_RELEASE);
+}
+
+void installCrashHandler(const string& basename) {
+    size_t len = std::min(basename.size(), sizeof detail::g_crashBasename - 1);
+    memcpy(detail::g_crashBasename, basename.data(), len);
+    detail::g_crashBasename[len] = '\0';
+
+    // backtrace()第一次调用时会加载libgcc_s并分配内存 不能留到信号处理函数里
+    void* frame[1];
+    ::backtrace(frame, 1);
+    // 其他线程在注册缓冲区时设置自己的备用栈
+    detail::installAltStack();
+
+    struct sigaction sa;
+    memZero(&sa, sizeof sa);
+    sa.sa_sigaction = detail::crashHandler;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&sa.sa_mask);
+    for(int sig : detail::kFatalSignals) {
+        ::sigaction(sig, &sa, NULL);
+    }
+}
+
+int64_t dump(int fd) {
+    detail::SafeWriter out(fd);
+    int64_t count = detail::dumpRings(&out);
+    out.flush();
+    return count;
+}
+
+}   // namespace FlightRecorder
+
+}   // namespace myserver
@@ -0,0 +1,71 @@
+/**
+* @description: FlightRecorder.h
+* @author: YQ Huang
+* @brief: 常开的日志飞行记录仪 每个线程一个环形缓冲区 进程崩溃时写到文件
+* @date: 2026/10/18 20:31:09
+*/
+
+#pragma once
+
+#include "server/base/Types.h"
+
+namespace myserver {
+
+/**
+ * LOG_FATAL调用abort()或者进程段错误时 还在AsyncLogging缓冲区里的日志就丢了
+ * 生产环境又开不起DEBUG级别 出了问题往往看不到崩溃前发生了什么
+ *
+ * 飞行记录仪给每个线程一个固定大小的环形缓冲区 写满后覆盖最旧的记录:
+ *   LOGF_XXX 不管级别是否打开 都把调用点编号和参数的原始字节拷贝进来 不做格式化
+ *            所以DEBUG/TRACE可以一直开着记录
+ *   LOG_XXX  已经输出的行 原样拷贝一份 没打开的LOG_TRACE/LOG_DEBUG格式化后只记录不输出
+ *            (比LOGF_XXX慢 热路径上用LOGF_XXX)
+ * 记录时没有IO 也没有锁
+ *
+ * 收到SIGSEGV SIGBUS SIGFPE SIGILL SIGABRT时 信号处理函数把所有线程的记录
+ * 连同崩溃线程的调用栈写到 basename.pid.crash 然后按默认动作结束进程(生成core)
+ * 文件是AsyncRingLogging的二进制日志格式 用logdecoder还原成文本
+ * LOG_FATAL在abort()之前还会记录CurrentThread::stackTrace()的结果
+ *
+ * 用法:
+ *   FlightRecorder::enable();
+ *   FlightRecorder::installCrashHandler("server");
+ */
+namespace FlightRecorder {
+
+// 打开记录 ringSize是每个线程的缓冲区大小 向上取整到2的幂 在启动时调用一次
+void enable(size_t ringSize = 64 * 1024);
+void disable();
+
+/**
+ * 安装致命信号的处理函数 崩溃记录写在当前工作目录下
+ * 处理函数运行在备用信号栈上 栈溢出时也能写出记录 调用线程和每个注册了缓冲区的线程
+ * 各分配一个64KB的备用栈(已经有备用栈的线程除外) 其他线程栈溢出时没有记录
+ * 调用栈的符号名来自dladdr() 崩溃发生在动态链接器内部(dlopen()等)时处理函数可能死锁
+ */
+void installCrashHandler(const string& basename);
+
+// 把所有线程的记录写到fd 异步信号安全 返回写出的记录数
+int64_t dump(int fd);
+
+}   // namespace FlightRecorder
+
+namespace detail {
+
+extern bool g_flightRecorderEnabled;
+
+inline bool flightRecorderEnabled() {
+    return __atomic_load_n(&g_flightRecorderEnabled, __ATOMIC_RELAXED);
+}
+
+// 在当前线程的环形缓冲区中预留len字节 记录太长时返回NULL
+char* beginFlightRecord(size_t len);
+// 发布beginFlightRecord()预留的记录 siteId为0表示这是一行文本
+void commitFlightRecord(uint32_t siteId, size_t len);
+
+// 拷贝一行已经格式化好的日志
+void recordFlightText(const char* text, size_t len);
+
+}   // namespace detail
+
+}   // namespace myserver
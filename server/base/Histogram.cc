@@ -0,0 +1,116 @@
+/**
+* @description: Histogram.cc
+* @author: YQ Huang
+* @brief: HDR风格的对数线性直方图 用于记录延迟分布
+* @date: 2026/10/18 22:05:44
+*/
+
+#include "server/base/Histogram.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+namespace myserver {
+
+Histogram::Histogram() {
+    reset();
+}
+
+void Histogram::reset() {
+    for(int i = 0; i < kNumBuckets; ++i) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * 先读count_再读各个桶 写线程同时在记录时 副本里桶的总数可能比count_多几个
+ * 计算分位数用的是桶的总数 所以副本的count_取两者中较大的
+ */
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot result;
+    uint64_t count = count_.load(std::memory_order_relaxed);
+    uint64_t total = 0;
+    for(int i = 0; i < kNumBuckets; ++i) {
+        result.counts_[i] = counts_[i].load(std::memory_order_relaxed);
+        total += result.counts_[i];
+    }
+    result.count_ = std::max(count, total);
+    result.sum_ = sum_.load(std::memory_order_relaxed);
+    result.max_ = max_.load(std::memory_order_relaxed);
+    return result;
+}
+
+uint64_t Histogram::bucketLowerBound(int index) {
+    if(index < kSubBuckets) {
+        return static_cast<uint64_t>(index);
+    }
+    int exponent = index / kSubBuckets + kSubBucketBits - 1;
+    uint64_t sub = static_cast<uint64_t>(index % kSubBuckets);
+    return (kSubBuckets + sub) << (exponent - kSubBucketBits);
+}
+
+uint64_t Histogram::bucketUpperBound(int index) {
+    if(index < kSubBuckets) {
+        return static_cast<uint64_t>(index);
+    }
+    int exponent = index / kSubBuckets + kSubBucketBits - 1;
+    return bucketLowerBound(index) + (static_cast<uint64_t>(1) << (exponent - kSubBucketBits)) - 1;
+}
+
+HistogramSnapshot::HistogramSnapshot()
+    : counts_(Histogram::kNumBuckets),
+      count_(0),
+      sum_(0),
+      max_(0)
+{
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    uint64_t total = 0;
+    for(uint64_t n : counts_) {
+        total += n;
+    }
+    if(total == 0) {
+        return 0;
+    }
+    q = std::min(std::max(q, 0.0), 100.0);
+    uint64_t rank = static_cast<uint64_t>(ceil(q / 100.0 * static_cast<double>(total)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for(int i = 0; i < Histogram::kNumBuckets; ++i) {
+        seen += counts_[i];
+        if(seen >= rank) {
+            return std::min(Histogram::bucketUpperBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& rhs) {
+    for(int i = 0; i < Histogram::kNumBuckets; ++i) {
+        counts_[i] += rhs.counts_[i];
+    }
+    count_ += rhs.count_;
+    sum_ += rhs.sum_;
+    max_ = std::max(max_, rhs.max_);
+}
+
+string HistogramSnapshot::toString() const {
+    char buf[256];
+    snprintf(buf, sizeof buf,
+             "count=%llu mean=%.1f p50=%llu p90=%llu p99=%llu p999=%llu max=%llu",
+             static_cast<unsigned long long>(count_),
+             mean(),
+             static_cast<unsigned long long>(percentile(50)),
+             static_cast<unsigned long long>(percentile(90)),
+             static_cast<unsigned long long>(percentile(99)),
+             static_cast<unsigned long long>(percentile(99.9)),
+             static_cast<unsigned long long>(max_));
+    return buf;
+}
+
+}   // namespace myserver
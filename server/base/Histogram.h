@@ -0,0 +1,107 @@
+/**
+* @description: Histogram.h
+* @author: YQ Huang
+* @brief: HDR风格的对数线性直方图 用于记录延迟分布
+* @date: 2026/10/18 22:05:37
+*/
+
+#pragma once
+
+#include "server/base/copyable.h"
+#include "server/base/noncopyable.h"
+#include "server/base/Types.h"
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+namespace myserver {
+
+class HistogramSnapshot;
+
+/**
+ * 对数线性直方图 每个2的幂区间[2^e, 2^(e+1))再等分成kSubBuckets个桶
+ * 桶宽与数值成正比 相对误差不超过1/kSubBuckets 0到kSubBuckets-1每个值一个桶
+ * 桶的个数固定 记录时不分配内存 不加锁
+ *
+ * 一个线程写 任意线程读: 写端用relaxed的load+store代替原子加 没有lock前缀
+ * 读端用snapshot()取得各个桶的副本 多个线程同时写同一个Histogram会丢失计数
+ */
+class Histogram : noncopyable {
+public:
+    static const int kSubBucketBits = 3;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    Histogram();
+
+    // 记录一个值 负数按0记录
+    void record(int64_t value) {
+        uint64_t v = value > 0 ? static_cast<uint64_t>(value) : 0;
+        increment(&counts_[bucketIndex(v)], 1);
+        increment(&count_, 1);
+        increment(&sum_, v);
+        if(v > max_.load(std::memory_order_relaxed)) {
+            max_.store(v, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    HistogramSnapshot snapshot() const;
+    // 只能由写线程调用
+    void reset();
+
+    // 值所在的桶
+    static int bucketIndex(uint64_t value) {
+        if(value < static_cast<uint64_t>(kSubBuckets)) {
+            return static_cast<int>(value);
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        int sub = static_cast<int>((value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+        return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+    }
+    // 桶内的最小值和最大值
+    static uint64_t bucketLowerBound(int index);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    static void increment(std::atomic<uint64_t>* counter, uint64_t n) {
+        counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> counts_[kNumBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+/**
+ * Histogram某一时刻的副本 可以合并多个线程的直方图后再计算分位数
+ */
+class HistogramSnapshot : public copyable {
+public:
+    HistogramSnapshot();
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+    // 分位数 q在[0, 100] 返回所在桶的上界(不超过max) 没有数据时返回0
+    uint64_t percentile(double q) const;
+    uint64_t bucketCount(int index) const { return counts_[index]; }
+
+    void merge(const HistogramSnapshot& rhs);
+
+    // "count=... mean=... p50=... p90=... p99=... p999=... max=..."
+    string toString() const;
+
+private:
+    friend class Histogram;
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+};
+
+}   // namespace myserver
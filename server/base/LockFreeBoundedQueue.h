@@ -0,0 +1,256 @@
+/**
+* @description: LockFreeBoundedQueue.h
+* @author: YQ Huang
+* @brief: 无锁有界多生产者多消费者队列
+* @date: 2026/10/18 09:41:52
+*/
+
+#pragma once
+
+#include "server/base/noncopyable.h"
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <assert.h>
+#include <sched.h>
+#include <stddef.h>
+#include <time.h>
+
+namespace myserver {
+
+namespace detail {
+
+/**
+ * 无锁队列满/空时的退避策略
+ * 先自旋几次(pause指令) 再sched_yield让出CPU 最后短暂睡眠
+ * 避免在核数少的机器上生产者和消费者互相空转
+ */
+class Backoff {
+public:
+    Backoff() : count_(0) { }
+
+    void pause() {
+        if(count_ < kSpinLimit) {
+            for(int i = 0; i < (1 << count_); ++i) {
+                cpuRelax();
+            }
+        }
+        else if(count_ < kYieldLimit) {
+            ::sched_yield();
+        }
+        else {
+            struct timespec ts = { 0, 50 * 1000 };
+            ::nanosleep(&ts, NULL);
+        }
+        if(count_ < kYieldLimit) {
+            ++count_;
+        }
+    }
+
+private:
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#else
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    static const int kSpinLimit = 6;
+    static const int kYieldLimit = 16;
+
+    int count_;
+};
+
+}   // namespace detail
+
+/**
+ * Dmitry Vyukov 的有界 MPMC 环形队列
+ * 每个槽位带一个序号sequence_ 生产者和消费者各自用CAS推进enqueuePos_/dequeuePos_
+ * 槽位的序号告诉线程这个槽位当前是可写、可读还是被别的线程占用
+ * 整个过程没有锁 每次操作只有一次CAS
+ *
+ * 接口与BoundedBlockingQueue一致 put()/take()在队列满/空时退避等待
+ * 容量向上取整为2的幂
+ *
+ * 元素直接构造在槽位的原始存储里 T只需要能移动构造 不需要默认构造
+ * tryTake(T*)通过移动赋值写入out 所以另外要求T能移动赋值 与两个阻塞队列相同
+ */
+template<typename T>
+class LockFreeBoundedQueue : noncopyable {
+public:
+    explicit LockFreeBoundedQueue(size_t maxSize)
+        : buffer_(NULL),
+          mask_(roundUpPowerOfTwo(maxSize) - 1)
+    {
+        assert(maxSize > 0);
+        buffer_ = new Cell[mask_ + 1];
+        for(size_t i = 0; i <= mask_; ++i) {
+            buffer_[i].sequence_.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    // 析构时没有其他线程访问 剩下的元素就地销毁
+    ~LockFreeBoundedQueue() {
+        size_t pos;
+        Cell* cell;
+        while((cell = claimForTake(&pos)) != NULL) {
+            cell->value()->~T();
+            releaseCell(cell, pos);
+        }
+        delete[] buffer_;
+    }
+
+    // 放入一个元素 队列满时退避等待
+    void put(const T& x) {
+        detail::Backoff backoff;
+        while(!tryPut(x)) {
+            backoff.pause();
+        }
+    }
+
+    void put(T&& x) {
+        detail::Backoff backoff;
+        while(!tryPut(std::move(x))) {
+            backoff.pause();
+        }
+    }
+
+    // 取出一个元素 队列空时退避等待
+    T take() {
+        size_t pos;
+        Cell* cell;
+        detail::Backoff backoff;
+        while((cell = claimForTake(&pos)) == NULL) {
+            backoff.pause();
+        }
+        T* p = cell->value();
+        T x(std::move(*p));
+        p->~T();
+        releaseCell(cell, pos);
+        return x;
+    }
+
+    bool tryPut(const T& x) {
+        T copy(x);
+        return tryPut(std::move(copy));
+    }
+
+    // 非阻塞的放入 队列满时返回false 此时x保持不变
+    bool tryPut(T&& x) {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for(;;) {
+            cell = &buffer_[pos & mask_];
+            size_t seq = cell->sequence_.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            // 槽位可写 尝试占有它
+            if(diff == 0) {
+                if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            // 槽位里的数据还没被消费 队列满了
+            else if(diff < 0) {
+                return false;
+            }
+            // 其他生产者抢先了 重新读取位置
+            else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->storage()) T(std::move(x));
+        // 发布数据 消费者看到sequence == pos+1 就知道可以读了
+        cell->sequence_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 非阻塞的取出 队列空时返回false
+    bool tryTake(T* out) {
+        size_t pos;
+        Cell* cell = claimForTake(&pos);
+        if(cell == NULL) {
+            return false;
+        }
+        T* p = cell->value();
+        *out = std::move(*p);
+        p->~T();
+        releaseCell(cell, pos);
+        return true;
+    }
+
+    // 下面几个函数在并发时只是近似值
+    size_t size() const {
+        size_t enq = enqueuePos_.load(std::memory_order_relaxed);
+        size_t deq = dequeuePos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= capacity(); }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    static const size_t kCacheLineSize = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence_;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type data_;
+
+        void* storage() { return &data_; }
+        T* value() { return static_cast<T*>(storage()); }
+    };
+
+    // 占有下一个可读的槽位 队列空时返回NULL 读完后必须调用releaseCell()
+    Cell* claimForTake(size_t* outPos) {
+        Cell* cell;
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for(;;) {
+            cell = &buffer_[pos & mask_];
+            size_t seq = cell->sequence_.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if(diff == 0) {
+                if(dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            // 槽位还没被写入 队列空
+            else if(diff < 0) {
+                return NULL;
+            }
+            else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        *outPos = pos;
+        return cell;
+    }
+
+    // 元素已经销毁 把槽位还给下一轮的生产者
+    void releaseCell(Cell* cell, size_t pos) {
+        cell->sequence_.store(pos + mask_ + 1, std::memory_order_release);
+    }
+
+    static size_t roundUpPowerOfTwo(size_t n) {
+        size_t size = 2;
+        while(size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    // 生产者和消费者的位置分别放在不同的cache line上 避免伪共享
+    char pad0_[kCacheLineSize];
+    Cell* buffer_;
+    const size_t mask_;
+    char pad1_[kCacheLineSize - sizeof(Cell*) - sizeof(size_t)];
+    std::atomic<size_t> enqueuePos_;
+    char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeuePos_;
+    char pad3_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+};
+
+}   // namespace myserver
@@ -0,0 +1,251 @@
+/**
+* @description: LogArchiver.cc
+* @author: YQ Huang
+* @brief: 在后台线程中关闭 压缩滚动下来的日志文件 并按总大小或个数删除旧文件
+* @date: 2026/10/18 17:58:44
+*/
+
+#include "server/base/LogArchiver.h"
+#include "server/base/CurrentThread.h"
+#include "server/base/FileUtil.h"
+#include "server/base/Logging.h"
+
+#include <algorithm>
+#include <vector>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef MYSERVER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace myserver {
+
+namespace {
+
+/**
+ * 把当前线程降到最低的CPU优先级和空闲IO优先级 尽量不影响业务线程和日志写入
+ * SCHED_IDLE的线程被唤醒时不会抢占普通线程 只在CPU空闲时运行
+ * 不支持时退而用nice 19 Linux上setpriority(PRIO_PROCESS, tid)只作用于这一个线程
+ */
+void lowerThreadPriority() {
+    struct sched_param param;
+    memZero(&param, sizeof param);
+    if(::pthread_setschedparam(::pthread_self(), SCHED_IDLE, &param) != 0 &&
+       ::setpriority(PRIO_PROCESS, static_cast<id_t>(CurrentThread::tid()), 19) < 0)
+    {
+        fprintf(stderr, "LogArchiver: setpriority failed %s\n", strerror_tl(errno));
+    }
+#ifdef SYS_ioprio_set
+    const int kIoprioWhoProcess = 1;
+    const int kIoprioClassIdle = 3;
+    const int kIoprioClassShift = 13;
+    ::syscall(SYS_ioprio_set, kIoprioWhoProcess, CurrentThread::tid(),
+              kIoprioClassIdle << kIoprioClassShift);
+#endif
+}
+
+bool endsWith(const string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+}   // namespace
+
+LogArchiver::LogArchiver(const string& basename,
+                         int maxFiles,
+                         off_t maxBytes,
+                         int compressionLevel)
+    : basename_(basename),
+      maxFiles_(maxFiles),
+      maxBytes_(maxBytes),
+      compressionLevel_(compressionLevel),
+      running_(false),
+      thread_(std::bind(&LogArchiver::threadFunc, this), "LogArchiver")
+{
+    assert(basename.find('/') == string::npos);
+}
+
+LogArchiver::~LogArchiver() {
+    if(running_) {
+        stop();
+    }
+}
+
+void LogArchiver::start() {
+    assert(!running_);
+    running_ = true;
+    thread_.start();
+}
+
+void LogArchiver::stop() {
+    assert(running_);
+    running_ = false;
+    queue_.put(Task());
+    thread_.join();
+}
+
+void LogArchiver::archive(std::unique_ptr<FileUtil::WritableFile> file, const string& filename) {
+    assert(!filename.empty());
+    Task task;
+    task.file = std::move(file);
+    task.filename = filename;
+    queue_.put(std::move(task));
+}
+
+void LogArchiver::threadFunc() {
+    lowerThreadPriority();
+    for(;;) {
+        Task task(queue_.take());
+        if(task.filename.empty()) {
+            break;
+        }
+        task.file.reset();  // fclose 写出缓冲区
+        if(compressionLevel_ > 0 && compress(task.filename)) {
+            compressedFiles_.increment();
+        }
+        enforceRetention(task.filename);
+    }
+}
+
+#ifdef MYSERVER_HAVE_ZLIB
+/**
+ * 流式压缩为gzip格式 先写到filename.gz.tmp 成功后rename为filename.gz 再删除原文件
+ * 任何一步失败都保留原文件
+ */
+bool LogArchiver::compress(const string& filename) {
+    const size_t kChunk = 64 * 1024;
+    string gzName = filename + ".gz";
+    string tmpName = gzName + ".tmp";
+
+    int in = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(in < 0) {
+        fprintf(stderr, "LogArchiver: open %s failed %s\n", filename.c_str(), strerror_tl(errno));
+        return false;
+    }
+    int out = ::open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(out < 0) {
+        fprintf(stderr, "LogArchiver: open %s failed %s\n", tmpName.c_str(), strerror_tl(errno));
+        ::close(in);
+        return false;
+    }
+    // 告诉内核只顺序读一遍 读完就可以丢掉页缓存
+    ::posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    z_stream zs;
+    memZero(&zs, sizeof zs);
+    // windowBits加16表示写gzip头和尾
+    bool ok = deflateInit2(&zs, compressionLevel_, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    std::unique_ptr<unsigned char[]> inBuf(new unsigned char[kChunk]);
+    std::unique_ptr<unsigned char[]> outBuf(new unsigned char[kChunk]);
+    int flush = Z_NO_FLUSH;
+    while(ok && flush != Z_FINISH) {
+        ssize_t n = ::read(in, inBuf.get(), kChunk);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            ok = false;
+            break;
+        }
+        flush = n == 0 ? Z_FINISH : Z_NO_FLUSH;
+        zs.next_in = inBuf.get();
+        zs.avail_in = static_cast<uInt>(n);
+        do {
+            zs.next_out = outBuf.get();
+            zs.avail_out = static_cast<uInt>(kChunk);
+            deflate(&zs, flush);
+            size_t have = kChunk - zs.avail_out;
+            if(have > 0 && ::write(out, outBuf.get(), have) != static_cast<ssize_t>(have)) {
+                ok = false;
+                break;
+            }
+        } while(zs.avail_out == 0);
+    }
+    deflateEnd(&zs);
+    ::close(in);
+    ok = ::close(out) == 0 && ok;
+
+    if(ok && ::rename(tmpName.c_str(), gzName.c_str()) == 0) {
+        ::unlink(filename.c_str());
+        return true;
+    }
+    fprintf(stderr, "LogArchiver: compress %s failed\n", filename.c_str());
+    ::unlink(tmpName.c_str());
+    return false;
+}
+#else
+bool LogArchiver::compress(const string& filename) {
+    return false;
+}
+#endif
+
+/**
+ * LogFile的文件名是 basename.时间.主机名.pid.log 同一个basename按文件名排序就是按时间排序
+ * 从最旧的开始删除 直到个数和总大小都满足限制
+ */
+void LogArchiver::enforceRetention(const string& newest) {
+    if(maxFiles_ <= 0 && maxBytes_ <= 0) {
+        return;
+    }
+    DIR* dir = ::opendir(".");
+    if(dir == NULL) {
+        fprintf(stderr, "LogArchiver: opendir failed %s\n", strerror_tl(errno));
+        return;
+    }
+    struct Entry {
+        string name;
+        off_t size;
+        bool operator<(const Entry& rhs) const { return name < rhs.name; }
+    };
+    std::vector<Entry> files;
+    const string prefix = basename_ + ".";
+    while(struct dirent* ent = ::readdir(dir)) {
+        string name(ent->d_name);
+        if(name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        bool plain = endsWith(name, ".log");
+        if(!plain && !endsWith(name, ".log.gz")) {
+            continue;
+        }
+        // 比刚归档的文件新的 是正在写的文件(或者别的进程的) 不动
+        if((plain ? name : name.substr(0, name.size() - 3)) > newest) {
+            continue;
+        }
+        struct stat st;
+        if(::stat(name.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            files.push_back(Entry{ name, st.st_size });
+        }
+    }
+    ::closedir(dir);
+
+    std::sort(files.begin(), files.end());
+    off_t total = 0;
+    for(const Entry& e : files) {
+        total += e.size;
+    }
+    size_t count = files.size();
+    for(const Entry& e : files) {
+        bool tooMany = maxFiles_ > 0 && count > static_cast<size_t>(maxFiles_);
+        bool tooBig = maxBytes_ > 0 && total > maxBytes_;
+        if(!tooMany && !tooBig) {
+            break;
+        }
+        if(::unlink(e.name.c_str()) == 0) {
+            removedFiles_.increment();
+        }
+        --count;
+        total -= e.size;
+    }
+}
+
+}   // namespace myserver
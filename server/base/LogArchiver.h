@@ -0,0 +1,79 @@
+/**
+* @description: LogArchiver.h
+* @author: YQ Huang
+* @brief: 在后台线程中关闭 压缩滚动下来的日志文件 并按总大小或个数删除旧文件
+* @date: 2026/10/18 17:58:44
+*/
+
+#pragma once
+
+#include "server/base/Atomic.h"
+#include "server/base/BlockingQueue.h"
+#include "server/base/Thread.h"
+
+#include <memory>
+
+namespace myserver {
+
+namespace FileUtil
+{
+class WritableFile;
+}
+
+/**
+ * LogFile滚动时 把旧文件(连同还没关闭的WritableFile)交给LogArchiver 自己立即返回
+ * 后端线程以最低的CPU和IO优先级依次完成:
+ *   1) 关闭旧文件 fclose时写出用户态缓冲区 不在append的路径上
+ *   2) 流式压缩成 filename.gz 每次读64KB 内存占用固定 写完后rename 再删除原文件
+ *   3) 按保留策略删除最旧的日志 只考虑basename.*.log和basename.*.log.gz
+ *      并且文件名不晚于刚归档的文件 所以正在写的文件不会被删除
+ *
+ * 没有zlib时只做关闭和保留策略 不压缩
+ *
+ * 用法:
+ *   LogArchiver archiver("server", 20, 10LL*1024*1024*1024);
+ *   archiver.start();
+ *   LogFile file("server", 500*1000*1000);
+ *   file.setArchiver(&archiver);
+ */
+class LogArchiver : noncopyable {
+public:
+    // maxFiles或maxBytes为0表示不限制 compressionLevel为zlib的压缩级别1~9 0表示不压缩
+    LogArchiver(const string& basename,
+                int maxFiles,
+                off_t maxBytes,
+                int compressionLevel = 6);
+    ~LogArchiver();
+
+    void start();
+    // 处理完已经提交的文件后返回
+    void stop();
+
+    // 由LogFile::rollFile()调用 不阻塞 file可以为NULL(已经关闭)
+    void archive(std::unique_ptr<FileUtil::WritableFile> file, const string& filename);
+
+    int64_t compressedFiles() { return compressedFiles_.get(); }
+    int64_t removedFiles() { return removedFiles_.get(); }
+
+private:
+    struct Task {
+        std::unique_ptr<FileUtil::WritableFile> file;
+        string filename;    // 空字符串表示退出
+    };
+
+    void threadFunc();
+    bool compress(const string& filename);
+    void enforceRetention(const string& newest);
+
+    const string basename_;
+    const int maxFiles_;
+    const off_t maxBytes_;
+    const int compressionLevel_;
+    bool running_;
+    Thread thread_;
+    BlockingQueue<Task> queue_;
+    AtomicInt64 compressedFiles_;
+    AtomicInt64 removedFiles_;
+};
+
+}   // namespace myserver
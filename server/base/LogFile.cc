@@ -7,6 +7,7 @@
 
 #include "server/base/LogFile.h"
 #include "server/base/FileUtil.h"
+#include "server/base/LogArchiver.h"
 #include "server/base/ProcessInfo.h"
 
 #include <assert.h>
@@ -20,16 +21,20 @@ LogFile::LogFile(const string& basename,
                  off_t rollSize,
                  bool threadSafe,
                  int flushInterval,
-                 int checkEveryN)
+                 int checkEveryN,
+                 bool directIO)
     : basename_(basename),
       rollSize_(rollSize),
       flushInterval_(flushInterval),
       checkEveryN_(checkEveryN),
+      directIO_(directIO),
       count_(0),
+      rollCount_(0),
       mutex_(threadSafe ? new MutexLock : NULL),
       startOfPeriod_(0),
       lastRoll_(0),
-      lastFlush_(0)
+      lastFlush_(0),
+      archiver_(NULL)
 {
     // 检查basename是否是最小路径单位
     assert(basename.find('/') == string::npos);
@@ -118,7 +123,20 @@ bool LogFile::rollFile() {
         lastFlush_ = now;
         startOfPeriod_ = start; //记录上一次rollfile的日期（天）
         // 换一个文件写日志，即为了保证两天的日志不写在同一个文件中，而上一天的日志可能并未写到rollSize_大小 
-        file_.reset(new FileUtil::AppendFile(filename));
+        std::unique_ptr<FileUtil::WritableFile> old(std::move(file_));
+        if(directIO_) {
+            file_.reset(new FileUtil::DirectAppendFile(filename));
+        }
+        else {
+            file_.reset(new FileUtil::AppendFile(filename));
+        }
+        // 旧文件的fclose和压缩都交给后台线程 append不用等待
+        if(old && archiver_) {
+            archiver_->archive(std::move(old), filename_);
+        }
+        old.reset();
+        filename_ = filename;
+        ++rollCount_;
         return true;
     }
     return false;
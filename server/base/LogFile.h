@@ -16,21 +16,28 @@ namespace myserver {
 
 namespace FileUtil
 {
-class AppendFile;
+class WritableFile;
 }
 
+class LogArchiver;
+
 class LogFile : noncopyable{
 public:
     LogFile(const string& basename, 
             off_t rollSize,         
             bool threadSafe = true,
             int flushInterval = 3,
-            int checkEveryN = 1024);
+            int checkEveryN = 1024,
+            bool directIO = false); // 用DirectAppendFile绕过页缓存写
     ~LogFile();
 
     void append(const char* logline, int len);  // 把日志消息写到缓冲区
     void flush();   // 将缓冲区内的日志消息flush到硬盘
     bool rollFile();    // 日志文件滚动
+    int rollCount() const { return rollCount_; }    // 已经打开过的文件数 用于发现文件换了
+
+    // 设置后 滚动下来的旧文件交给archiver在后台关闭 压缩 清理 archiver必须比LogFile活得久
+    void setArchiver(LogArchiver* archiver) { archiver_ = archiver; }
 
 private:
     void append_unlocked(const char* logline, int len); // 不加锁的append方式
@@ -41,14 +48,18 @@ private:
     const off_t rollSize_;      // 日志文件超过设定值进行roll
     const int flushInterval_;   // flush刷新时间间隔
     const int checkEveryN_;     // 每1024次日志操作，检查是否刷新，是否roll
+    const bool directIO_;       // 使用DirectAppendFile
 
     int count_; // 记录写入的次数
+    int rollCount_; // 滚动的次数
 
     std::unique_ptr<MutexLock> mutex_;              // 互斥锁
     time_t startOfPeriod_;                          // 开始记录日志时间（调整到零时时间）
     time_t lastRoll_;                               // 上一次滚动日志文件时间
     time_t lastFlush_;                              // 上一次日志写入文件时间
-    std::unique_ptr<FileUtil::AppendFile> file_;    // 文件智能指针
+    std::unique_ptr<FileUtil::WritableFile> file_;  // 文件智能指针
+    string filename_;                               // 当前文件的文件名
+    LogArchiver* archiver_;                         // 可以为NULL
 
     const static int kRollPerSeconds_ = 60 * 60 * 24;   // 一天的秒数
 };
@@ -8,8 +8,11 @@
 #include "server/base/LogStream.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <type_traits>
 #include <stdio.h>
+#include <string.h>
 
 #ifndef __STDC_FORMAT_MACROS
 #define __STDC_FORMAT_MACROS
@@ -24,58 +27,441 @@ namespace myserver {
 
 namespace detail {
 
-const char digits[] = "9876543210123456789";
-const char* zero = digits + 9;  // 指向了digits数组中的0
-static_assert(sizeof(digits) == 20, "wrong number of digits");
+// 00 01 02 ... 99 每次查表得到两位数字
+const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+static_assert(sizeof(digitPairs) == 201, "wrong number of digitPairs");
 
 const char digitsHex[] = "0123456789ABCDEF";
 static_assert(sizeof digitsHex == 17, "wrong number of digitsHex");
 
+// 十进制位数 每次比较4位 只在v很大时才做除法
+template<typename U>
+inline int countDigits(U v) {
+    int n = 1;
+    for(;;) {
+        if(v < 10) return n;
+        if(v < 100) return n + 1;
+        if(v < 1000) return n + 2;
+        if(v < 10000) return n + 3;
+        v /= 10000U;
+        n += 4;
+    }
+}
+
+/**
+ * 先算出位数 再从低位到高位每次写两位数字 不需要最后再翻转
+ * 32位以内的类型用32位除法 比64位除法快得多
+ */
+template<typename U>
+inline size_t convertUnsigned(char buf[], U v) {
+    const int len = countDigits(v);
+    char* p = buf + len;
+    while(v >= 100) {
+        const unsigned i = static_cast<unsigned>(v % 100) * 2;
+        v /= 100;
+        *--p = digitPairs[i + 1];
+        *--p = digitPairs[i];
+    }
+    if(v >= 10) {
+        const unsigned i = static_cast<unsigned>(v) * 2;
+        *--p = digitPairs[i + 1];
+        *--p = digitPairs[i];
+    }
+    else {
+        *--p = static_cast<char>('0' + v);
+    }
+    buf[len] = '\0';
+    return len;
+}
+
 /**
- * 将Value转化成字符串形式，by Matthew Wilson.
- * 将转换结果保存到buf，返回字符串的长度
+ * 将Value转化成字符串形式 将转换结果保存到buf 返回字符串的长度
+ * 负数先取绝对值(用无符号数 避免最小值取反溢出) 再写负号
  */
 template<typename T>
 size_t convert(char buf[], T value) {
-    T i = value;
-    char* p = buf;
+    typedef typename std::make_unsigned<T>::type U;
+    typedef typename std::conditional<sizeof(U) <= 4, uint32_t, uint64_t>::type Fast;
+    if(value < 0) {
+        *buf = '-';
+        return convertUnsigned(buf + 1, static_cast<Fast>(U(0) - static_cast<U>(value))) + 1;
+    }
+    return convertUnsigned(buf, static_cast<Fast>(value));
+}
 
-    // 循环 从低位到高位逐位读取数字 注意 读出来的是逆序的
+/**
+ * 将Value转换成16进制 由最高位的1算出位数 从低位往前写
+ * uintprt_t对于32位平台来说就是unsigned int
+ * 对于64位平台来说就是unsigned long
+ */
+size_t convertHex(char buf[], uintptr_t value) {
+    const int bits = static_cast<int>(sizeof(unsigned long long) * 8)
+                     - __builtin_clzll(static_cast<unsigned long long>(value) | 1);
+    const int len = (bits + 3) / 4;
+    char* p = buf + len;
     do {
-        int lsd = static_cast<int>(i % 10);
-        i /= 10;
-        *p++ = zero[lsd];
-    } while(i != 0);
+        *--p = digitsHex[value & 0xF];
+        value >>= 4;
+    } while(p != buf);
+    buf[len] = '\0';
+    return len;
+}
 
-    // 如果value为负数，要加负号
-    if(value < 0) {
-        *p++ = '-';
+/**
+ * 浮点数的最短表示 Ryu算法(Ulf Adams 2018)
+ * 在与相邻两个double的中点构成的区间内 找位数最少的十进制数 位数相同时取最接近原值的
+ * 所以用strtod读回来一定等于原值 而且总是最短的
+ *
+ * 需要两张5的幂的表 每项是125位左右的定点数 放在两个uint64_t里
+ *   pow5[i]    = floor(5^i / 2^(len(5^i) - 125))            i < 326
+ *   pow5Inv[i] = floor(2^(len(5^i) - 1 + 125) / 5^i) + 1    i < 342
+ * len(x)是x的二进制位数 两张表在第一次使用时用大整数精确计算
+ */
+class Pow5Tables {
+public:
+    static const int kPow5BitCount = 125;
+    static const int kPow5InvBitCount = 125;
+    static const int kPow5Size = 326;
+    static const int kPow5InvSize = 342;
+
+    Pow5Tables() {
+        // n = 5^i    inv = floor(2^kShift / 5^i)
+        // 每一步 floor(floor(x / 5^i) / 5) == floor(x / 5^(i+1)) 所以逐次除以5是精确的
+        BigInt n, inv;
+        memset(n, 0, sizeof n);
+        memset(inv, 0, sizeof inv);
+        n[0] = 1;
+        inv[kLimbs - 1] = 1U << 31;
+        const int kShift = kLimbs * 32 - 1;
+        for(int i = 0; i < kPow5InvSize; ++i) {
+            const int len = bitLength(n);
+            if(i < kPow5Size) {
+                extract128(n, len - kPow5BitCount, pow5_[i]);
+            }
+            extract128(inv, kShift - (len - 1 + kPow5InvBitCount), pow5Inv_[i]);
+            if(++pow5Inv_[i][0] == 0) {
+                ++pow5Inv_[i][1];
+            }
+            mulSmall(n, 5);
+            divSmall(inv, 5);
+        }
     }
 
-    *p = '\0';
-    std::reverse(buf, p);
+    const uint64_t* pow5(int i) const { return pow5_[i]; }
+    const uint64_t* pow5Inv(int i) const { return pow5Inv_[i]; }
+
+private:
+    // 小端的大整数 每个元素32位
+    static const int kLimbs = 34;
+    typedef uint32_t BigInt[kLimbs];
+
+    static int bitLength(const BigInt n) {
+        for(int i = kLimbs - 1; i >= 0; --i) {
+            if(n[i]) {
+                return i * 32 + 32 - __builtin_clz(n[i]);
+            }
+        }
+        return 0;
+    }
 
-    return p - buf;
+    static void mulSmall(BigInt n, uint32_t m) {
+        uint64_t carry = 0;
+        for(int i = 0; i < kLimbs; ++i) {
+            uint64_t v = static_cast<uint64_t>(n[i]) * m + carry;
+            n[i] = static_cast<uint32_t>(v);
+            carry = v >> 32;
+        }
+    }
+
+    static void divSmall(BigInt n, uint32_t d) {
+        uint64_t rem = 0;
+        for(int i = kLimbs - 1; i >= 0; --i) {
+            uint64_t v = (rem << 32) | n[i];
+            n[i] = static_cast<uint32_t>(v / d);
+            rem = v % d;
+        }
+    }
+
+    // out = floor(n / 2^shift)的低128位 shift可以为负(左移)
+    static void extract128(const BigInt n, int shift, uint64_t out[2]) {
+        out[0] = out[1] = 0;
+        for(int b = 0; b < 128; ++b) {
+            const int src = b + shift;
+            if(src >= 0 && src < kLimbs * 32 && ((n[src / 32] >> (src % 32)) & 1)) {
+                out[b / 64] |= 1ULL << (b % 64);
+            }
+        }
+    }
+
+    uint64_t pow5_[kPow5Size][2];
+    uint64_t pow5Inv_[kPow5InvSize][2];
+};
+
+// 函数内的静态变量 保证在其他编译单元的静态初始化中写日志也能用
+const Pow5Tables& pow5Tables() {
+    static const Pow5Tables tables;
+    return tables;
+}
+
+// ceil(log2(5^e)) e > 0 时成立
+inline int pow5Bits(int e) {
+    return static_cast<int>((static_cast<uint32_t>(e) * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e))
+inline int log10Pow2(int e) {
+    return static_cast<int>((static_cast<uint32_t>(e) * 78913) >> 18);
+}
+
+// floor(log10(5^e))
+inline int log10Pow5(int e) {
+    return static_cast<int>((static_cast<uint32_t>(e) * 732923) >> 20);
+}
+
+inline bool multipleOfPowerOf5(uint64_t v, int p) {
+    int count = 0;
+    while(v % 5 == 0) {
+        v /= 5;
+        ++count;
+    }
+    return count >= p;
+}
+
+inline bool multipleOfPowerOf2(uint64_t v, int p) {
+    return (v & ((1ULL << p) - 1)) == 0;
+}
+
+// (m * mul) >> j  mul是128位 j >= 64
+inline uint64_t mulShift64(uint64_t m, const uint64_t* mul, int j) {
+    typedef unsigned __int128 uint128;
+    const uint128 b0 = static_cast<uint128>(m) * mul[0];
+    const uint128 b2 = static_cast<uint128>(m) * mul[1];
+    return static_cast<uint64_t>(((b0 >> 64) + b2) >> (j - 64));
 }
 
 /**
- * 将Value转换成16进制
- * uintprt_t对于32位平台来说就是unsigned int
- * 对于64位平台来说就是unsigned long
+ * 正的有限浮点数 生成最短的数字串 value = *output * 10^*exponent
+ * 变量名与论文保持一致: mv是4倍的尾数 vr vp vm分别是原值和区间上下界乘以10^-e10
  */
-size_t convertHex(char buf[], uintptr_t value) {
-    uintptr_t i = value;
+void ryu(double value, uint64_t* output, int* exponent) {
+    const int kMantissaBits = 52;
+    const int kBias = 1023;
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof bits);
+    const uint64_t ieeeMantissa = bits & ((1ULL << kMantissaBits) - 1);
+    const int ieeeExponent = static_cast<int>(bits >> kMantissaBits) & 0x7FF;
+
+    int e2;
+    uint64_t m2;
+    if(ieeeExponent == 0) {
+        e2 = 1 - kBias - kMantissaBits - 2;
+        m2 = ieeeMantissa;
+    }
+    else {
+        e2 = ieeeExponent - kBias - kMantissaBits - 2;
+        m2 = (1ULL << kMantissaBits) | ieeeMantissa;
+    }
+    const bool acceptBounds = (m2 & 1) == 0;    // 尾数是偶数时 区间包含端点(round-half-even)
+
+    const uint64_t mv = 4 * m2;
+    const uint32_t mmShift = (ieeeMantissa != 0 || ieeeExponent <= 1) ? 1 : 0;
+
+    const Pow5Tables& tables = pow5Tables();
+    uint64_t vr, vp, vm;
+    int e10;
+    bool vmIsTrailingZeros = false;
+    bool vrIsTrailingZeros = false;
+    if(e2 >= 0) {
+        const int q = log10Pow2(e2) - (e2 > 3 ? 1 : 0);
+        e10 = q;
+        const int k = Pow5Tables::kPow5InvBitCount + pow5Bits(q) - 1;
+        const int i = -e2 + q + k;
+        const uint64_t* mul = tables.pow5Inv(q);
+        vr = mulShift64(4 * m2, mul, i);
+        vp = mulShift64(4 * m2 + 2, mul, i);
+        vm = mulShift64(4 * m2 - 1 - mmShift, mul, i);
+        if(q <= 21) {
+            if(mv % 5 == 0) {
+                vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+            }
+            else if(acceptBounds) {
+                vmIsTrailingZeros = multipleOfPowerOf5(mv - 1 - mmShift, q);
+            }
+            else {
+                vp -= multipleOfPowerOf5(mv + 2, q) ? 1 : 0;
+            }
+        }
+    }
+    else {
+        const int q = log10Pow5(-e2) - (-e2 > 1 ? 1 : 0);
+        e10 = q + e2;
+        const int i = -e2 - q;
+        const int k = pow5Bits(i) - Pow5Tables::kPow5BitCount;
+        const int j = q - k;
+        const uint64_t* mul = tables.pow5(i);
+        vr = mulShift64(4 * m2, mul, j);
+        vp = mulShift64(4 * m2 + 2, mul, j);
+        vm = mulShift64(4 * m2 - 1 - mmShift, mul, j);
+        if(q <= 1) {
+            vrIsTrailingZeros = true;
+            if(acceptBounds) {
+                vmIsTrailingZeros = mmShift == 1;
+            }
+            else {
+                --vp;
+            }
+        }
+        else if(q < 63) {
+            vrIsTrailingZeros = multipleOfPowerOf2(mv, q);
+        }
+    }
+
+    // 去掉vp和vm共同的高位之外的数字 剩下的就是最短的表示
+    int removed = 0;
+    uint64_t result;
+    if(vmIsTrailingZeros || vrIsTrailingZeros) {
+        // 少见的情况 需要精确处理舍入
+        int lastRemovedDigit = 0;
+        while(vp / 10 > vm / 10) {
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = static_cast<int>(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        if(vmIsTrailingZeros) {
+            while(vm % 10 == 0) {
+                vrIsTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = static_cast<int>(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
+            }
+        }
+        if(vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+            lastRemovedDigit = 4;   // 正好在中间 取偶数
+        }
+        result = vr + (((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5) ? 1 : 0);
+    }
+    else {
+        bool roundUp = false;
+        while(vp / 10 > vm / 10) {
+            roundUp = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        result = vr + ((vr == vm || roundUp) ? 1 : 0);
+    }
+    *output = result;
+    *exponent = e10 + removed;
+}
+
+/**
+ * 浮点数转换为最短的 能精确还原的十进制字符串
+ * 版式与%.17g相同: 十进制指数在[-4, 17)之间用定点表示 否则用科学计数法
+ * 只是数字取最短的 例如0.1输出0.1而不是0.10000000000000001
+ * 最长24个字符
+ */
+size_t formatDouble(char buf[], double value) {
     char* p = buf;
+    if(std::isnan(value)) {
+        memcpy(p, "nan", 4);
+        return 3;
+    }
+    if(std::signbit(value)) {
+        *p++ = '-';
+        value = -value;
+    }
+    if(std::isinf(value)) {
+        memcpy(p, "inf", 4);
+        return p + 3 - buf;
+    }
+    if(value == 0.0) {
+        *p++ = '0';
+        *p = '\0';
+        return p - buf;
+    }
 
-    do {
-        int lsd = static_cast<int>(i % 16);
-        i /= 16;
-        *p++ = digitsHex[lsd];
-    } while(i != 0);
+    // 常见的小整数直接按整数输出 2^53以内的整数都能精确表示
+    if(value < 9007199254740992.0) {
+        const uint64_t n = static_cast<uint64_t>(value);
+        if(static_cast<double>(n) == value) {
+            return p + convertUnsigned(p, n) - buf;
+        }
+    }
 
+    uint64_t output;
+    int K;
+    ryu(value, &output, &K);
+    char digits[24];
+    const int len = static_cast<int>(convertUnsigned(digits, output));
+    const int exp10 = len + K - 1;  // 第一位数字的十进制指数
+
+    if(exp10 < -4 || exp10 >= 17) {
+        // d.ddde+XX
+        *p++ = digits[0];
+        if(len > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        *p++ = 'e';
+        int e = exp10;
+        if(e < 0) {
+            *p++ = '-';
+            e = -e;
+        }
+        else {
+            *p++ = '+';
+        }
+        if(e < 10) {
+            *p++ = '0';
+        }
+        p += convertUnsigned(p, static_cast<uint32_t>(e));
+    }
+    else if(exp10 >= len - 1) {
+        // 整数 ddd000
+        memcpy(p, digits, len);
+        p += len;
+        for(int i = len - 1; i < exp10; ++i) {
+            *p++ = '0';
+        }
+    }
+    else if(exp10 >= 0) {
+        // ddd.ddd
+        memcpy(p, digits, exp10 + 1);
+        p += exp10 + 1;
+        *p++ = '.';
+        memcpy(p, digits + exp10 + 1, len - exp10 - 1);
+        p += len - exp10 - 1;
+    }
+    else {
+        // 0.000ddd
+        *p++ = '0';
+        *p++ = '.';
+        for(int i = -1; i > exp10; --i) {
+            *p++ = '0';
+        }
+        memcpy(p, digits, len);
+        p += len;
+    }
     *p = '\0';
-    std::reverse(buf, p);
-
     return p - buf;
 }
 
@@ -191,12 +577,11 @@ LogStream& LogStream::operator<<(const void* p) {
 }
 
 /**
- * 浮点类型数据转换为字符串；内部使用snprintf函数
- * 有时间可以看看Grisu3算法 by Florian Loitsch
+ * 浮点类型数据转换为字符串 输出能精确还原的最短表示 见detail::formatDouble
  */
 LogStream& LogStream::operator<<(double v) {
     if(buffer_.avail() >= kMaxNumericSize) {
-        int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v); // 以十进制输出小数点后12位
+        size_t len = detail::formatDouble(buffer_.current(), v);
         buffer_.add(len);
     }
     return *this;
@@ -20,6 +20,10 @@ namespace detail {
 const int kSmallBuffer = 4000;  // 4K
 const int kLargeBuffer = 4000 * 1000;   // 4M
 
+// 浮点数最短的精确表示 buf至少kMaxDoubleSize字节 返回长度 见LogStream.cc
+const int kMaxDoubleSize = 32;
+size_t formatDouble(char buf[], double value);
+
 /**
  * FixedBuffer 缓冲区 为一个非类型参数的模板类
  * SIZE表示缓冲区的大小
@@ -8,11 +8,15 @@
 #include "server/base/Logging.h"
 
 #include "server/base/CurrentThread.h"
+#include "server/base/FlightRecorder.h"
+#include "server/base/Mutex.h"
 #include "server/base/Timestamp.h"
 
+#include <map>
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 
 namespace myserver {
 
@@ -53,6 +57,112 @@ Logger::LogLevel initLogLevel() {
 
 Logger::LogLevel g_logLevel = initLogLevel();
 
+namespace detail {
+
+int g_logGeneration = 0;
+
+// 由名字得到日志级别 不区分大小写 不认识时返回NUM_LOG_LEVELS
+Logger::LogLevel parseLogLevel(const string& name) {
+    for(int i = 0; i < Logger::NUM_LOG_LEVELS; ++i) {
+        // LogLevelName后面补了空格
+        size_t len = strcspn(LogLevelName[i], " ");
+        if(name.size() == len && strncasecmp(name.c_str(), LogLevelName[i], len) == 0) {
+            return static_cast<Logger::LogLevel>(i);
+        }
+    }
+    return Logger::NUM_LOG_LEVELS;
+}
+
+/**
+ * 模块级别表 第一次使用时从环境变量SERVER_LOG_MODULES读取初始值
+ * 格式为逗号分隔的 模块=级别 例如 SERVER_LOG_MODULES=TcpConnection=DEBUG,EventLoop=TRACE
+ * 用函数内的静态变量 保证其他编译单元的静态初始化中写日志也是安全的
+ */
+class ModuleLogLevels {
+public:
+    ModuleLogLevels() {
+        const char* env = ::getenv("SERVER_LOG_MODULES");
+        if(env == NULL) {
+            return;
+        }
+        string spec(env);
+        size_t start = 0;
+        while(start < spec.size()) {
+            size_t end = spec.find(',', start);
+            if(end == string::npos) {
+                end = spec.size();
+            }
+            string item = spec.substr(start, end - start);
+            size_t eq = item.find('=');
+            Logger::LogLevel level = Logger::NUM_LOG_LEVELS;
+            if(eq != string::npos) {
+                level = parseLogLevel(item.substr(eq + 1));
+            }
+            if(level != Logger::NUM_LOG_LEVELS && eq > 0) {
+                levels_[item.substr(0, eq)] = level;
+            }
+            else {
+                fprintf(stderr, "SERVER_LOG_MODULES: ignore \"%s\"\n", item.c_str());
+            }
+            start = end + 1;
+        }
+    }
+
+    MutexLock mutex_;
+    std::map<string, Logger::LogLevel> levels_;
+};
+
+ModuleLogLevels& moduleLogLevels() {
+    static ModuleLogLevels levels;
+    return levels;
+}
+
+/**
+ * 调用点的慢路径 由文件名得到模块名 查表得到有效级别
+ * generation在查表之前读取 修改级别时先改表再加generation 所以查到的级别不会比generation旧
+ */
+void resolveLogSite(LogSite* site, int generation) {
+    const char* base = strrchr(site->file, '/');
+    base = base ? base + 1 : site->file;
+    const char* dot = strchr(base, '.');
+    string module(base, dot ? dot - base : strlen(base));
+
+    Logger::LogLevel level = g_logLevel;
+    ModuleLogLevels& modules = moduleLogLevels();
+    {
+        MutexLockGuard lock(modules.mutex_);
+        auto it = modules.levels_.find(module);
+        if(it != modules.levels_.end()) {
+            level = it->second;
+        }
+    }
+    int64_t state = static_cast<int64_t>(generation) << 8 | static_cast<int64_t>(level);
+    __atomic_store_n(&site->state, state, __ATOMIC_RELAXED);
+}
+
+void bumpLogGeneration() {
+    __atomic_add_fetch(&g_logGeneration, 1, __ATOMIC_RELEASE);
+}
+
+// 如果日志记录不在同一秒，则更新日志记录时间
+const char* formatLogSeconds(int64_t seconds) {
+    if(seconds != t_lastSecond) {
+        t_lastSecond = static_cast<time_t>(seconds);
+        time_t t = t_lastSecond;
+        struct tm tm_time;
+        localtime_r(&t, &tm_time);
+
+        int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
+            tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+            tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+        assert(len == 17);
+        (void)len;
+    }
+    return t_time;
+}
+
+}   // namespace detail
+
 // 帮助类 给定字符串长度 加快编译速度
 class T {
 public:
@@ -94,11 +204,12 @@ Logger::FlushFunc g_flush = defaultFlush;
 
 // Impl构造函数
 Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int line)
-    : time_(Timestamp::now()),
+    : time_(Timestamp::nowFast()),
       stream_(),
       level_(level),
       line_(line),
-      basename_(file)
+      basename_(file),
+      recordOnly_(false)
 {
     formatTime();
     CurrentThread::tid();
@@ -112,24 +223,13 @@ Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int l
 // 设置时间
 void Logger::Impl::formatTime() {
     int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();    // 获得微秒
-    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);   // 获得秒
+    int64_t seconds = microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond;  // 获得秒
     int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);    // 微妙
-    // 如果日志记录不在同一秒，则更新日志记录时间
-    if(seconds != t_lastSecond) {
-        t_lastSecond= seconds;
-        struct tm tm_time;
-        localtime_r(&seconds, &tm_time);
-
-        int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
-            tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
-            tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
-        assert(len == 17);
-        (void)len;
-    }
+    const char* secondsString = detail::formatLogSeconds(seconds);
     // 更新微秒
     Fmt us(".%6dZ ", microseconds);
     assert(us.length() == 9);
-    stream_ << T(t_time, 17) << T(us.data(), 9);
+    stream_ << T(secondsString, 17) << T(us.data(), 9);
 }
 
 // 结束
@@ -148,9 +248,10 @@ Logger::Logger(SourceFile file, int line, LogLevel level)
 {
 }
 
-Logger::Logger(SourceFile file, int line, LogLevel level, const char* func)
+Logger::Logger(SourceFile file, int line, LogLevel level, const char* func, bool recordOnly)
     : impl_(level, 0, file, line)
 {
+    impl_.recordOnly_ = recordOnly;
     impl_.stream_ << func << ' ';
 }
 
@@ -163,10 +264,22 @@ Logger::Logger(SourceFile file, int line, bool toAbort)
 Logger::~Logger() {
     impl_.finish();
     const LogStream::Buffer& buf(stream().buffer());
+    if(impl_.recordOnly_) {
+        detail::recordFlightText(buf.data(), buf.length());
+        return;
+    }
+    // 飞行记录仪保留一份 崩溃时不会随输出缓冲区一起丢失
+    if(detail::flightRecorderEnabled()) {
+        detail::recordFlightText(buf.data(), buf.length());
+    }
     // 调用g_output函数，将存于LogStream的buffer的日志内容输出
     g_output(buf.data(), buf.length());
     // 如果是FATAL错误，还要调用g_flush立即从缓冲区中输出，然后终止程序
     if(impl_.level_ == FATAL) {
+        if(detail::flightRecorderEnabled()) {
+            string stack = CurrentThread::stackTrace(true);
+            detail::recordFlightText(stack.data(), stack.size());
+        }
         g_flush();
         abort();
     }
@@ -175,6 +288,26 @@ Logger::~Logger() {
 //设置日志级别
 void Logger::setLogLevel(Logger::LogLevel level) {
     g_logLevel = level;
+    detail::bumpLogGeneration();
+}
+
+// 设置模块的日志级别 所有调用点下次执行时重新解析
+void Logger::setModuleLogLevel(const string& module, LogLevel level) {
+    detail::ModuleLogLevels& modules = detail::moduleLogLevels();
+    {
+        MutexLockGuard lock(modules.mutex_);
+        modules.levels_[module] = level;
+    }
+    detail::bumpLogGeneration();
+}
+
+void Logger::clearModuleLogLevels() {
+    detail::ModuleLogLevels& modules = detail::moduleLogLevels();
+    {
+        MutexLockGuard lock(modules.mutex_);
+        modules.levels_.clear();
+    }
+    detail::bumpLogGeneration();
 }
 
 // 设置输出函数
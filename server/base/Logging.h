@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "server/base/FlightRecorder.h"
 #include "server/base/LogStream.h"
 #include "server/base/Timestamp.h"
 
@@ -65,7 +66,8 @@ public:
     // 构造函数 调用内部类impl来实现 根据参数将信息加到输出缓冲区
     Logger(SourceFile file, int line);
     Logger(SourceFile file, int line,  LogLevel level);
-    Logger(SourceFile file, int line,  LogLevel level, const char* func);
+    // recordOnly为true时只写进飞行记录仪 不输出 用于级别没有打开的LOG_TRACE/LOG_DEBUG
+    Logger(SourceFile file, int line,  LogLevel level, const char* func, bool recordOnly = false);
     Logger(SourceFile file, int line, bool toAbort);
     // 析构函数 把LogStream缓冲区中的内容取出来，由g_output控制输出到特定文件
     ~Logger();
@@ -77,6 +79,10 @@ public:
     static LogLevel logLevel();
     static void setLogLevel(LogLevel level);
 
+    // 单独设置某个模块(源文件名去掉后缀)的日志级别 不影响其他模块
+    static void setModuleLogLevel(const string& module, LogLevel level);
+    static void clearModuleLogLevels();
+
     typedef void (*OutputFunc)(const char* msg, int len);   // 函数指针
     typedef void (*FlushFunc)();        // 函数指针
     static void setOutput(OutputFunc);  // 默认 fwrite 到 stdout
@@ -99,6 +105,7 @@ private:
         LogLevel level_;    // 当前日志级别
         int line_;          // 行号 由__line__得到
         SourceFile basename_;   // 文件名 由__file__与sourcefile类得到
+        bool recordOnly_;   // 只写飞行记录仪
     };
 
     Impl impl_; // 实现对象
@@ -112,19 +119,92 @@ inline Logger::LogLevel Logger::logLevel() {
     return g_logLevel;
 }
 
+namespace detail {
+
+/**
+ * 每个LOG_XXX调用点有一个静态的LogSite 缓存这个调用点所在模块的有效日志级别
+ * 模块名是源文件名去掉目录和后缀 例如TcpConnection.cc的模块名是TcpConnection
+ * 模块级别由Logger::setModuleLogLevel()或环境变量SERVER_LOG_MODULES设置
+ * 没有设置的模块使用全局的g_logLevel
+ *
+ * 每次修改全局级别或模块级别 g_logGeneration加一 调用点发现自己缓存的generation
+ * 过期后才重新查表 所以热路径上只有一次全局变量的读取和两次比较
+ *
+ * generation和level打包在一个64位整数里一起读写 几个线程同时解析同一个调用点时
+ * 不会出现新的generation配上旧的level 最后写入的即使是旧值 generation也是旧的
+ * 下次执行时会重新解析
+ */
+struct LogSite {
+    const char* file;
+    int64_t state;      // generation << 8 | level -1表示还没有解析
+};
+
+extern int g_logGeneration;
+
+void resolveLogSite(LogSite* site, int generation);
+
+inline bool logSiteEnabled(LogSite* site, Logger::LogLevel level) {
+    int generation = __atomic_load_n(&g_logGeneration, __ATOMIC_ACQUIRE);
+    int64_t state = __atomic_load_n(&site->state, __ATOMIC_RELAXED);
+    if(__builtin_expect((state >> 8) != generation, 0)) {
+        resolveLogSite(site, generation);
+        state = __atomic_load_n(&site->state, __ATOMIC_RELAXED);
+    }
+    return level >= static_cast<int>(state & 0xff);
+}
+
+/**
+ * 把秒数格式化成 "YYYYMMDD HH:MM:SS" 共17个字符 返回线程局部的缓存
+ * 同一线程同一秒内的日志只格式化一次 Logger和StructuredLogger共用
+ */
+const char* formatLogSeconds(int64_t seconds);
+
+}   // namespace detail
+
+}   // namespace myserver
+
+/**
+ * 编译期的最低日志级别 低于它的LOG_XXX整条语句在编译期就被去掉
+ * 例如 -DMYSERVER_LOG_MIN_LEVEL=2 去掉所有LOG_TRACE和LOG_DEBUG
+ * 取值与Logger::LogLevel相同 0:TRACE 1:DEBUG 2:INFO 3:WARN 4:ERROR
+ */
+#ifndef MYSERVER_LOG_MIN_LEVEL
+#define MYSERVER_LOG_MIN_LEVEL 0
+#endif
+
+// 调用点的LogSite放在lambda的静态变量里 这样宏可以用在表达式中
+#define MYSERVER_LOG_ENABLED(lvl) \
+    (lvl >= MYSERVER_LOG_MIN_LEVEL && \
+     myserver::detail::logSiteEnabled([]() -> myserver::detail::LogSite* { \
+         static myserver::detail::LogSite myserver_logSite = { __FILE__, -1 }; \
+         return &myserver_logSite; }(), lvl))
+
+/**
+ * LOG_TRACE/LOG_DEBUG级别没有打开时 如果飞行记录仪打开了 仍然格式化这一行
+ * 只写进飞行记录仪 myserver_logMode: 0不执行 1正常输出 2只记录
+ * 用for而不是if 宏后面跟else时不会和宏里的条件配对
+ */
+#define MYSERVER_LOG_VERBOSE(lvl) \
+    for(int myserver_logMode = lvl < MYSERVER_LOG_MIN_LEVEL ? 0 : \
+            MYSERVER_LOG_ENABLED(lvl) ? 1 : myserver::detail::flightRecorderEnabled() ? 2 : 0; \
+        myserver_logMode != 0; myserver_logMode = 0) \
+        myserver::Logger(__FILE__, __LINE__, lvl, __func__, myserver_logMode == 2).stream()
+
 // 设置一些方便使用的宏
-#define LOG_TRACE if(myserver::Logger::logLevel() <= myserver::Logger::TRACE) \
-    myserver::Logger(__FILE__, __LINE__, myserver::Logger::TRACE, __func__).stream()
-#define LOG_DEBUG if(myserver::Logger::logLevel() <= myserver::Logger::DEBUG) \
-    myserver::Logger(__FILE__, __LINE__, myserver::Logger::DEBUG, __func__).stream()
-#define LOG_INFO if(myserver::Logger::logLevel() <= myserver::Logger::INFO) \
+#define LOG_TRACE MYSERVER_LOG_VERBOSE(myserver::Logger::TRACE)
+#define LOG_DEBUG MYSERVER_LOG_VERBOSE(myserver::Logger::DEBUG)
+#define LOG_INFO if(!MYSERVER_LOG_ENABLED(myserver::Logger::INFO)) {} else \
     myserver::Logger(__FILE__, __LINE__).stream()
-#define LOG_WARN myserver::Logger(__FILE__, __LINE__, myserver::Logger::WARN).stream()
-#define LOG_ERROR myserver::Logger(__FILE__, __LINE__, myserver::Logger::ERROR).stream()
+#define LOG_WARN if(!MYSERVER_LOG_ENABLED(myserver::Logger::WARN)) {} else \
+    myserver::Logger(__FILE__, __LINE__, myserver::Logger::WARN).stream()
+#define LOG_ERROR if(!MYSERVER_LOG_ENABLED(myserver::Logger::ERROR)) {} else \
+    myserver::Logger(__FILE__, __LINE__, myserver::Logger::ERROR).stream()
 #define LOG_FATAL myserver::Logger(__FILE__, __LINE__, myserver::Logger::FATAL).stream()
 #define LOG_SYSERR myserver::Logger(__FILE__, __LINE__, false).stream()
 #define LOG_SYSFATAL myserver::Logger(__FILE__, __LINE__, true).stream()
 
+namespace myserver {
+
 // 根据错误码得到对应的错误描述
 const char* strerror_tl(int savedErrno);
 
@@ -0,0 +1,221 @@
+/**
+* @description: Metrics.cc
+* @author: YQ Huang
+* @brief: 进程内的指标注册表 计数器 仪表和直方图按线程分片 读取时合并
+* @date: 2026/10/18 22:41:33
+*/
+
+#include "server/base/Metrics.h"
+#include "server/base/Logging.h"
+
+#include <stdio.h>
+
+namespace myserver {
+
+namespace detail {
+
+__thread MetricsShard* t_metricsShard = NULL;
+
+MetricsShard::MetricsShard() {
+    for(int i = 0; i < kMaxSlots; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+    for(int i = 0; i < kMaxHistograms; ++i) {
+        histograms[i].store(NULL, std::memory_order_relaxed);
+    }
+}
+
+MetricsShard::~MetricsShard() {
+    for(int i = 0; i < kMaxHistograms; ++i) {
+        delete histograms[i].load(std::memory_order_relaxed);
+    }
+}
+
+MetricsShard* createMetricsShard() {
+    t_metricsShard = MetricsRegistry::instance().acquireShard();
+    return t_metricsShard;
+}
+
+}   // namespace detail
+
+int64_t Counter::value() const {
+    return MetricsRegistry::instance().sumSlot(slot_);
+}
+
+int64_t Gauge::value() const {
+    return MetricsRegistry::instance().sumSlot(slot_);
+}
+
+HistogramSnapshot HistogramMetric::snapshot() const {
+    return MetricsRegistry::instance().mergeHistogram(index_);
+}
+
+// 不析构 线程退出和全局对象析构时还可能在记录
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry* registry = new MetricsRegistry;
+    return *registry;
+}
+
+MetricsRegistry::MetricsRegistry()
+    : numSlots_(0)
+{
+    ::pthread_key_create(&shardKey_, &MetricsRegistry::releaseShard);
+}
+
+Counter* MetricsRegistry::counter(const string& name, const string& help) {
+    MutexLockGuard lock(mutex_);
+    for(const auto& c : counters_) {
+        if(c->name() == name) {
+            return c.get();
+        }
+    }
+    if(numSlots_ >= detail::MetricsShard::kMaxSlots) {
+        LOG_FATAL << "MetricsRegistry: too many counters and gauges, " << name;
+    }
+    counters_.emplace_back(new Counter(name, help, numSlots_++));
+    return counters_.back().get();
+}
+
+Gauge* MetricsRegistry::gauge(const string& name, const string& help) {
+    MutexLockGuard lock(mutex_);
+    for(const auto& g : gauges_) {
+        if(g->name() == name) {
+            return g.get();
+        }
+    }
+    if(numSlots_ >= detail::MetricsShard::kMaxSlots) {
+        LOG_FATAL << "MetricsRegistry: too many counters and gauges, " << name;
+    }
+    gauges_.emplace_back(new Gauge(name, help, numSlots_++));
+    return gauges_.back().get();
+}
+
+HistogramMetric* MetricsRegistry::histogram(const string& name, const string& help) {
+    MutexLockGuard lock(mutex_);
+    for(const auto& h : histograms_) {
+        if(h->name() == name) {
+            return h.get();
+        }
+    }
+    int index = static_cast<int>(histograms_.size());
+    if(index >= detail::MetricsShard::kMaxHistograms) {
+        LOG_FATAL << "MetricsRegistry: too many histograms, " << name;
+    }
+    histograms_.emplace_back(new HistogramMetric(name, help, index));
+    return histograms_.back().get();
+}
+
+int64_t MetricsRegistry::sumSlot(int slot) const {
+    MutexLockGuard lock(mutex_);
+    int64_t sum = 0;
+    for(const detail::MetricsShard* shard : shards_) {
+        sum += shard->slots[slot].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+HistogramSnapshot MetricsRegistry::mergeHistogram(int index) const {
+    MutexLockGuard lock(mutex_);
+    HistogramSnapshot result;
+    for(const detail::MetricsShard* shard : shards_) {
+        const Histogram* hist = shard->histograms[index].load(std::memory_order_acquire);
+        if(hist) {
+            result.merge(hist->snapshot());
+        }
+    }
+    return result;
+}
+
+/**
+ * 优先复用已退出线程的分片 分片从不释放 线程数的峰值决定了分片的个数
+ * 在加锁的情况下交接分片 新线程能看到旧线程写入的值
+ */
+detail::MetricsShard* MetricsRegistry::acquireShard() {
+    detail::MetricsShard* shard = NULL;
+    {
+        MutexLockGuard lock(mutex_);
+        if(!freeShards_.empty()) {
+            shard = freeShards_.back();
+            freeShards_.pop_back();
+        }
+        else {
+            shard = new detail::MetricsShard;
+            shards_.push_back(shard);
+        }
+    }
+    ::pthread_setspecific(shardKey_, shard);
+    return shard;
+}
+
+void MetricsRegistry::releaseShard(void* shard) {
+    MetricsRegistry& registry = instance();
+    detail::t_metricsShard = NULL;
+    MutexLockGuard lock(registry.mutex_);
+    registry.freeShards_.push_back(static_cast<detail::MetricsShard*>(shard));
+}
+
+void MetricsRegistry::appendSummary(string* out, const string& name, const string& help,
+                                    const string& labels, const HistogramSnapshot& snapshot,
+                                    bool withHeader)
+{
+    if(withHeader) {
+        *out += "# HELP " + name + " " + help + "\n";
+        *out += "# TYPE " + name + " summary\n";
+    }
+    const double kQuantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    char buf[128];
+    for(double q : kQuantiles) {
+        snprintf(buf, sizeof buf, "{%s%squantile=\"%g\"} %llu\n",
+                 labels.c_str(), labels.empty() ? "" : ",", q,
+                 static_cast<unsigned long long>(snapshot.percentile(q * 100)));
+        *out += name + buf;
+    }
+    string braced = labels.empty() ? "" : "{" + labels + "}";
+    snprintf(buf, sizeof buf, " %llu\n", static_cast<unsigned long long>(snapshot.sum()));
+    *out += name + "_sum" + braced + buf;
+    snprintf(buf, sizeof buf, " %llu\n", static_cast<unsigned long long>(snapshot.count()));
+    *out += name + "_count" + braced + buf;
+}
+
+/**
+ * 先在锁内复制指标列表 再逐个合并 合并时每个指标各加一次锁
+ * 各个指标的值不是同一时刻的 对于监控已经足够
+ */
+string MetricsRegistry::scrape() const {
+    std::vector<const Counter*> counters;
+    std::vector<const Gauge*> gauges;
+    std::vector<const HistogramMetric*> histograms;
+    {
+        MutexLockGuard lock(mutex_);
+        for(const auto& c : counters_) {
+            counters.push_back(c.get());
+        }
+        for(const auto& g : gauges_) {
+            gauges.push_back(g.get());
+        }
+        for(const auto& h : histograms_) {
+            histograms.push_back(h.get());
+        }
+    }
+
+    string out;
+    char buf[32];
+    for(const Counter* c : counters) {
+        snprintf(buf, sizeof buf, " %lld\n", static_cast<long long>(c->value()));
+        out += "# HELP " + c->name() + " " + c->help() + "\n";
+        out += "# TYPE " + c->name() + " counter\n";
+        out += c->name() + buf;
+    }
+    for(const Gauge* g : gauges) {
+        snprintf(buf, sizeof buf, " %lld\n", static_cast<long long>(g->value()));
+        out += "# HELP " + g->name() + " " + g->help() + "\n";
+        out += "# TYPE " + g->name() + " gauge\n";
+        out += g->name() + buf;
+    }
+    for(const HistogramMetric* h : histograms) {
+        appendSummary(&out, h->name(), h->help(), "", h->snapshot(), true);
+    }
+    return out;
+}
+
+}   // namespace myserver
@@ -0,0 +1,182 @@
+/**
+* @description: Metrics.h
+* @author: YQ Huang
+* @brief: 进程内的指标注册表 计数器 仪表和直方图按线程分片 读取时合并
+* @date: 2026/10/18 22:41:26
+*/
+
+#pragma once
+
+#include "server/base/Histogram.h"
+#include "server/base/Mutex.h"
+#include "server/base/noncopyable.h"
+#include "server/base/Types.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+namespace myserver {
+
+namespace detail {
+
+/**
+ * 每个线程一个分片 计数器和仪表各占一个槽 直方图第一次记录时才分配
+ * 只有拥有分片的线程写 所以用relaxed的load+store 不需要原子加
+ * 线程退出后分片连同里面的值留给下一个新线程继续累加 合并的结果不变
+ */
+struct MetricsShard {
+    static const int kMaxSlots = 512;
+    static const int kMaxHistograms = 64;
+
+    std::atomic<int64_t> slots[kMaxSlots];
+    std::atomic<Histogram*> histograms[kMaxHistograms];
+
+    MetricsShard();
+    ~MetricsShard();
+
+    void add(int slot, int64_t n) {
+        slots[slot].store(slots[slot].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    Histogram* histogram(int index) {
+        Histogram* hist = histograms[index].load(std::memory_order_relaxed);
+        if(__builtin_expect(hist == NULL, 0)) {
+            hist = new Histogram;
+            histograms[index].store(hist, std::memory_order_release);
+        }
+        return hist;
+    }
+};
+
+extern __thread MetricsShard* t_metricsShard;
+MetricsShard* createMetricsShard();
+
+inline MetricsShard* metricsShard() {
+    MetricsShard* shard = t_metricsShard;
+    if(__builtin_expect(shard == NULL, 0)) {
+        shard = createMetricsShard();
+    }
+    return shard;
+}
+
+}   // namespace detail
+
+class MetricsRegistry;
+
+// 单调递增的计数器
+class Counter : noncopyable {
+public:
+    void increment() { add(1); }
+    void add(int64_t n) { detail::metricsShard()->add(slot_, n); }
+    // 所有线程的合计
+    int64_t value() const;
+
+    const string& name() const { return name_; }
+    const string& help() const { return help_; }
+
+private:
+    friend class MetricsRegistry;
+    Counter(const string& name, const string& help, int slot)
+        : name_(name), help_(help), slot_(slot) { }
+
+    const string name_;
+    const string help_;
+    const int slot_;
+};
+
+/**
+ * 可增可减的仪表 例如连接数和队列长度
+ * 只支持增减 每个线程记录自己的变化量 合计就是当前值 增减可以发生在不同线程
+ */
+class Gauge : noncopyable {
+public:
+    void increment() { add(1); }
+    void decrement() { add(-1); }
+    void add(int64_t n) { detail::metricsShard()->add(slot_, n); }
+    int64_t value() const;
+
+    const string& name() const { return name_; }
+    const string& help() const { return help_; }
+
+private:
+    friend class MetricsRegistry;
+    Gauge(const string& name, const string& help, int slot)
+        : name_(name), help_(help), slot_(slot) { }
+
+    const string name_;
+    const string help_;
+    const int slot_;
+};
+
+// 数值分布 例如延迟和读写的字节数
+class HistogramMetric : noncopyable {
+public:
+    void record(int64_t value) { detail::metricsShard()->histogram(index_)->record(value); }
+    // 所有线程合并后的副本
+    HistogramSnapshot snapshot() const;
+
+    const string& name() const { return name_; }
+    const string& help() const { return help_; }
+
+private:
+    friend class MetricsRegistry;
+    HistogramMetric(const string& name, const string& help, int index)
+        : name_(name), help_(help), index_(index) { }
+
+    const string name_;
+    const string help_;
+    const int index_;
+};
+
+/**
+ * 指标注册表 进程内唯一
+ * 同名的指标只注册一次 重复注册返回同一个对象 指标对象和注册表都不会析构
+ * 所以可以保存在全局变量里 在任何线程退出时记录都是安全的
+ *
+ * 记录只访问调用线程自己的分片 读取时加锁遍历所有分片合并
+ * 输出Prometheus的文本格式 直方图输出成summary
+ */
+class MetricsRegistry : noncopyable {
+public:
+    static MetricsRegistry& instance();
+
+    Counter* counter(const string& name, const string& help);
+    Gauge* gauge(const string& name, const string& help);
+    HistogramMetric* histogram(const string& name, const string& help);
+
+    // 所有指标的文本格式
+    string scrape() const;
+
+    /**
+     * 把一个直方图按summary格式追加到out
+     * labels形如 loop="io1" 可以为空 withHeader为true时先输出HELP和TYPE行
+     */
+    static void appendSummary(string* out, const string& name, const string& help,
+                              const string& labels, const HistogramSnapshot& snapshot,
+                              bool withHeader);
+
+private:
+    friend class Counter;
+    friend class Gauge;
+    friend class HistogramMetric;
+    friend detail::MetricsShard* detail::createMetricsShard();
+
+    MetricsRegistry();
+
+    int64_t sumSlot(int slot) const;
+    HistogramSnapshot mergeHistogram(int index) const;
+    detail::MetricsShard* acquireShard();
+    static void releaseShard(void* shard);
+
+    mutable MutexLock mutex_;
+    int numSlots_;
+    std::vector<std::unique_ptr<Counter>> counters_;
+    std::vector<std::unique_ptr<Gauge>> gauges_;
+    std::vector<std::unique_ptr<HistogramMetric>> histograms_;
+    std::vector<detail::MetricsShard*> shards_;     // 所有分片 包括空闲的
+    std::vector<detail::MetricsShard*> freeShards_; // 线程退出后留下的分片
+    pthread_key_t shardKey_;                        // 线程退出时归还分片
+};
+
+}   // namespace myserver
@@ -0,0 +1,100 @@
+/**
+* @description: Slab.cc
+* @author: YQ Huang
+* @brief: 固定大小对象的内存池 以及配合std::allocate_shared使用的分配器
+* @date: 2026/10/19 00:08:38
+*/
+
+#include "server/base/Slab.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+namespace myserver {
+
+Slab::Slab(size_t objectsPerChunk)
+    : objectsPerChunk_(objectsPerChunk > 0 ? objectsPerChunk : 1),
+      objectSize_(0),
+      freeList_(NULL),
+      capacity_(0),
+      inUse_(0)
+{
+}
+
+Slab::~Slab() {
+    assert(inUse_ == 0);
+    for(void* chunk : chunks_) {
+        ::free(chunk);
+    }
+}
+
+// 对象按max_align_t对齐 以便放下任何类型
+void* Slab::allocate(size_t size) {
+    const size_t kAlign = alignof(max_align_t);
+    size_t rounded = (size + kAlign - 1) / kAlign * kAlign;
+    {
+        MutexLockGuard lock(mutex_);
+        if(objectSize_ == 0) {
+            objectSize_ = rounded;
+        }
+        if(rounded == objectSize_) {
+            if(freeList_ == NULL) {
+                addChunk();
+            }
+            FreeNode* node = freeList_;
+            freeList_ = node->next;
+            ++inUse_;
+            return node;
+        }
+    }
+    return ::operator new(size);
+}
+
+void Slab::deallocate(void* p, size_t size) {
+    const size_t kAlign = alignof(max_align_t);
+    size_t rounded = (size + kAlign - 1) / kAlign * kAlign;
+    {
+        MutexLockGuard lock(mutex_);
+        if(rounded == objectSize_) {
+            FreeNode* node = static_cast<FreeNode*>(p);
+            node->next = freeList_;
+            freeList_ = node;
+            --inUse_;
+            return;
+        }
+    }
+    ::operator delete(p);
+}
+
+void Slab::addChunk() {
+    mutex_.assertLocked();
+    char* chunk = static_cast<char*>(::malloc(objectSize_ * objectsPerChunk_));
+    if(chunk == NULL) {
+        throw std::bad_alloc();
+    }
+    chunks_.push_back(chunk);
+    // 倒序压入 让先分配的对象地址在前
+    for(size_t i = objectsPerChunk_; i > 0; --i) {
+        FreeNode* node = reinterpret_cast<FreeNode*>(chunk + (i - 1) * objectSize_);
+        node->next = freeList_;
+        freeList_ = node;
+    }
+    capacity_ += objectsPerChunk_;
+}
+
+size_t Slab::capacity() const {
+    MutexLockGuard lock(mutex_);
+    return capacity_;
+}
+
+size_t Slab::inUse() const {
+    MutexLockGuard lock(mutex_);
+    return inUse_;
+}
+
+size_t Slab::objectSize() const {
+    MutexLockGuard lock(mutex_);
+    return objectSize_;
+}
+
+}   // namespace myserver
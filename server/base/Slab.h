@@ -0,0 +1,94 @@
+/**
+* @description: Slab.h
+* @author: YQ Huang
+* @brief: 固定大小对象的内存池 以及配合std::allocate_shared使用的分配器
+* @date: 2026/10/19 00:08:31
+*/
+
+#pragma once
+
+#include "server/base/Mutex.h"
+#include "server/base/noncopyable.h"
+
+#include <memory>
+#include <new>
+#include <vector>
+#include <stddef.h>
+
+namespace myserver {
+
+/**
+ * 每次向系统申请一整块(chunk) 切成objectsPerChunk个同样大小的对象 用空闲链表管理
+ * 对象大小由第一次allocate()决定 之后大小不同的请求直接交给operator new
+ * 释放的对象回到空闲链表 不还给系统 chunk在Slab析构时一起释放
+ *
+ * 分配通常在IO线程 释放可能发生在任何持有最后一个引用的线程 所以空闲链表加锁
+ * 没有竞争时加锁的开销比malloc的小 更重要的是多个小对象合并成一次分配 地址也更集中
+ */
+class Slab : noncopyable {
+public:
+    explicit Slab(size_t objectsPerChunk = 64);
+    ~Slab();
+
+    void* allocate(size_t size);
+    void deallocate(void* p, size_t size);
+
+    // 切分好的对象个数 和其中正在使用的个数
+    size_t capacity() const;
+    size_t inUse() const;
+    size_t objectSize() const;
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    void addChunk();
+
+    const size_t objectsPerChunk_;
+    mutable MutexLock mutex_;
+    size_t objectSize_;
+    FreeNode* freeList_;
+    size_t capacity_;
+    size_t inUse_;
+    std::vector<void*> chunks_;
+};
+
+/**
+ * 从Slab分配的标准分配器 用于std::allocate_shared
+ * 对象和shared_ptr的控制块在同一次分配里 分配器本身持有Slab的引用
+ * 所以Slab会一直活到最后一个对象释放之后
+ */
+template<typename T>
+class SlabAllocator {
+public:
+    typedef T value_type;
+
+    explicit SlabAllocator(const std::shared_ptr<Slab>& slab) : slab_(slab) { }
+    template<typename U>
+    SlabAllocator(const SlabAllocator<U>& rhs) : slab_(rhs.slab()) { }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(slab_->allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) {
+        slab_->deallocate(p, n * sizeof(T));
+    }
+
+    const std::shared_ptr<Slab>& slab() const { return slab_; }
+
+private:
+    std::shared_ptr<Slab> slab_;
+};
+
+template<typename T, typename U>
+inline bool operator==(const SlabAllocator<T>& lhs, const SlabAllocator<U>& rhs) {
+    return lhs.slab() == rhs.slab();
+}
+
+template<typename T, typename U>
+inline bool operator!=(const SlabAllocator<T>& lhs, const SlabAllocator<U>& rhs) {
+    return !(lhs == rhs);
+}
+
+}   // namespace myserver
@@ -0,0 +1,209 @@
+/**
+* @description: SpscRingBuffer.h
+* @author: YQ Huang
+* @brief: 单生产者单消费者的无锁环形缓冲区
+* @date: 2026/10/18 13:20:05
+*/
+
+#pragma once
+
+#include "server/base/noncopyable.h"
+#include "server/base/Types.h"
+
+#include <atomic>
+#include <new>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace myserver {
+
+/**
+ * 单生产者单消费者(SPSC)的无锁环形缓冲区 存放变长的记录
+ * 每条记录 = Header(时间戳 + 长度) + 数据 按Header的大小(16字节)对齐
+ *
+ * 生产者只写head_ 消费者只写tail_ 两者都是单调递增的字节偏移 对容量取模得到位置
+ * 生产者用release语义发布head_ 消费者用acquire读取 反之亦然
+ * 所以整个过程不需要锁 也不需要CAS
+ *
+ * 一条记录不会跨越缓冲区末尾 如果末尾剩余空间不够 生产者写入一个填充记录 然后从头开始写
+ */
+class SpscRingBuffer : noncopyable {
+public:
+    struct Header {
+        int64_t timestamp;  // 记录的时间戳(微秒) 用于多个缓冲区之间的合并排序
+        uint32_t length;    // 数据长度 kPadding表示这是一个填充记录
+        uint32_t tag;       // 由使用者解释 例如区分文本日志和二进制日志
+    };
+
+    // 一条可读的记录 由peek()返回
+    struct Record {
+        int64_t timestamp;
+        const char* data;
+        uint32_t length;
+        uint32_t tag;
+    };
+
+    static const uint32_t kPadding = 0xFFFFFFFF;
+
+    // 容量向上取整为2的幂
+    explicit SpscRingBuffer(size_t capacity)
+        : mask_(roundUpPowerOfTwo(capacity) - 1),
+          buffer_(static_cast<char*>(::aligned_alloc(64, mask_ + 1))),
+          head_(0),
+          tail_(0),
+          cachedTail_(0),
+          writeOffset_(0),
+          writePadding_(0),
+          cachedHead_(0)
+    {
+        assert(buffer_ != NULL);
+        // 预先触发缺页 避免前端第一次写到某一页时陷入内核
+        memset(buffer_, 0, mask_ + 1);
+    }
+
+    ~SpscRingBuffer() {
+        ::free(buffer_);
+    }
+
+    // 成员按cache line对齐 C++11的new不保证这种对齐 所以自己分配
+    static void* operator new(size_t size) {
+        void* p = ::aligned_alloc(kCacheLineSize, (size + kCacheLineSize - 1) & ~(kCacheLineSize - 1));
+        if(p == NULL) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    static void operator delete(void* p) {
+        ::free(p);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    /**
+     * 生产者调用 写入一条记录 空间不够时返回false 不会阻塞
+     */
+    bool tryWrite(int64_t timestamp, const char* data, size_t len, uint32_t tag = 0) {
+        char* buf = beginWrite(len);
+        if(buf == NULL) {
+            return false;
+        }
+        memcpy(buf, data, len);
+        commitWrite(timestamp, tag, len);
+        return true;
+    }
+
+    /**
+     * 生产者调用 预留len字节 返回数据区的指针 空间不够时返回NULL
+     * 调用者直接在缓冲区里构造数据 然后调用commitWrite()发布 省去一次拷贝
+     */
+    char* beginWrite(size_t len) {
+        const size_t need = recordSize(len);
+        const size_t head = head_.load(std::memory_order_relaxed);
+        size_t offset = head & mask_;
+        size_t padding = 0;
+        // 末尾放不下这条记录 需要先填充到末尾
+        if(offset + need > capacity()) {
+            padding = capacity() - offset;
+        }
+        if(need + padding > capacity()) {
+            return NULL;
+        }
+        // 先用缓存的tail判断 不够时才去读消费者的tail_ 减少cache line的争用
+        if(head + padding + need - cachedTail_ > capacity()) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if(head + padding + need - cachedTail_ > capacity()) {
+                return NULL;
+            }
+        }
+        if(padding > 0) {
+            // 末尾至少还有一个Header的空间 因为记录都是Header对齐的
+            Header* pad = reinterpret_cast<Header*>(buffer_ + offset);
+            pad->length = kPadding;
+            offset = 0;
+        }
+        writeOffset_ = offset;
+        writePadding_ = padding;
+        return buffer_ + offset + sizeof(Header);
+    }
+
+    // 生产者调用 发布beginWrite()预留的记录 len不能超过预留的长度
+    void commitWrite(int64_t timestamp, uint32_t tag, size_t len) {
+        Header* header = reinterpret_cast<Header*>(buffer_ + writeOffset_);
+        header->timestamp = timestamp;
+        header->length = static_cast<uint32_t>(len);
+        header->tag = tag;
+        const size_t head = head_.load(std::memory_order_relaxed);
+        head_.store(head + writePadding_ + recordSize(len), std::memory_order_release);
+    }
+
+    /**
+     * 消费者调用 查看下一条记录但不取走 没有记录时返回false
+     */
+    bool peek(Record* record) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if(tail == cachedHead_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if(tail == cachedHead_) {
+                return false;
+            }
+        }
+        const Header* header = reinterpret_cast<const Header*>(buffer_ + (tail & mask_));
+        // 跳过填充记录
+        if(header->length == kPadding) {
+            tail += capacity() - (tail & mask_);
+            tail_.store(tail, std::memory_order_release);
+            if(tail == cachedHead_) {
+                return false;
+            }
+            header = reinterpret_cast<const Header*>(buffer_);
+        }
+        record->timestamp = header->timestamp;
+        record->length = header->length;
+        record->tag = header->tag;
+        record->data = reinterpret_cast<const char*>(header) + sizeof(Header);
+        return true;
+    }
+
+    /**
+     * 消费者调用 取走peek()返回的记录 之后record中的指针不再有效
+     */
+    void consume(const Record& record) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        tail_.store(tail + recordSize(record.length), std::memory_order_release);
+    }
+
+    // 近似值 只用于统计
+    size_t readableBytes() const {
+        return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static size_t recordSize(size_t len) {
+        return (sizeof(Header) + len + kAlign - 1) & ~(kAlign - 1);
+    }
+
+    static size_t roundUpPowerOfTwo(size_t n) {
+        size_t size = 64;
+        while(size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    static const size_t kAlign = sizeof(Header);
+    static const size_t kCacheLineSize = 64;
+
+    const size_t mask_;
+    char* const buffer_;
+    // 生产者和消费者各自使用的变量放在不同的cache line上
+    alignas(kCacheLineSize) std::atomic<size_t> head_;  // 生产者写 消费者读
+    alignas(kCacheLineSize) std::atomic<size_t> tail_;  // 消费者写 生产者读
+    alignas(kCacheLineSize) size_t cachedTail_;         // 生产者私有 tail_的缓存
+    size_t writeOffset_;                                // 生产者私有 beginWrite()预留的位置
+    size_t writePadding_;                               // 生产者私有 beginWrite()产生的填充
+    alignas(kCacheLineSize) size_t cachedHead_;         // 消费者私有 head_的缓存
+};
+
+}   // namespace myserver
@@ -0,0 +1,271 @@
+/**
+* @description: StructuredLogging.cc
+* @author: YQ Huang
+* @brief: 结构化日志 键值对直接编码成logfmt或JSON
+* @date: 2026/10/18 16:42:10
+*/
+
+#include "server/base/StructuredLogging.h"
+
+#include "server/base/CurrentThread.h"
+#include "server/base/Timestamp.h"
+
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace myserver {
+
+// 定义在Logging.cc中
+extern const char* LogLevelName[Logger::NUM_LOG_LEVELS];
+extern Logger::OutputFunc g_output;
+
+namespace detail {
+
+// 字符串内容写到缓冲区只剩这么多时停止 留给引号和结尾
+const int kStringReserve = StructuredLogger::kReserve / 2;
+
+const char* findSpecialChar(const char* begin, const char* end, unsigned char maxControl, char extra) {
+    const char* p = begin;
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i extraChar = _mm_set1_epi8(extra);
+    const __m128i control = _mm_set1_epi8(static_cast<char>(maxControl));
+    for(; end - p >= 16; p += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // 无符号比较 x <= maxControl 等价于 max(x, maxControl) == maxControl
+        __m128i special = _mm_cmpeq_epi8(_mm_max_epu8(x, control), control);
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(x, quote));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(x, backslash));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(x, extraChar));
+        const int mask = _mm_movemask_epi8(special);
+        if(mask != 0) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+#endif
+    for(; p < end; ++p) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if(c <= maxControl || c == '"' || c == '\\' || *p == extra) {
+            return p;
+        }
+    }
+    return end;
+}
+
+/**
+ * 转义'"' '\\'和控制字符 其余字节(包括UTF-8)原样输出
+ * 不需要转义的连续片段一次append
+ */
+void appendJsonEscaped(LogStream& s, StringPiece str) {
+    static const char kHex[] = "0123456789abcdef";
+    const char* p = str.data();
+    const char* end = p + str.size();
+    while(p < end) {
+        int room = s.buffer().avail() - kStringReserve;
+        if(room <= 0) {
+            return;
+        }
+        const char* special = findSpecialChar(p, end, 0x1F, '"');
+        int len = static_cast<int>(special - p);
+        if(len > room) {
+            len = room;
+            special = p + len;
+        }
+        s.append(p, len);
+        p = special;
+        if(p == end || len == room) {
+            continue;
+        }
+
+        char esc[6] = { '\\', 0, 0, 0, 0, 0 };
+        int escLen = 2;
+        switch(*p) {
+            case '"':  esc[1] = '"'; break;
+            case '\\': esc[1] = '\\'; break;
+            case '\n': esc[1] = 'n'; break;
+            case '\r': esc[1] = 'r'; break;
+            case '\t': esc[1] = 't'; break;
+            case '\b': esc[1] = 'b'; break;
+            case '\f': esc[1] = 'f'; break;
+            default:
+                esc[1] = 'u';
+                esc[2] = '0';
+                esc[3] = '0';
+                esc[4] = kHex[(*p >> 4) & 0xF];
+                esc[5] = kHex[*p & 0xF];
+                escLen = 6;
+                break;
+        }
+        s.append(esc, escLen);
+        ++p;
+    }
+}
+
+// 空值和含有空格 '=' '"' '\\'或控制字符的值需要加引号 引号内的转义规则与JSON相同
+void appendLogfmtValue(LogStream& s, StringPiece str) {
+    const char* end = str.data() + str.size();
+    if(str.size() > 0 && findSpecialChar(str.data(), end, ' ', '=') == end &&
+       str.size() < s.buffer().avail() - kStringReserve)
+    {
+        s.append(str.data(), str.size());
+    }
+    else {
+        s << '"';
+        appendJsonEscaped(s, str);
+        s << '"';
+    }
+}
+
+void appendLogfmtKey(LogStream& s, StringPiece key) {
+    const char* p = key.data();
+    const char* end = p + key.size();
+    if(p == end) {
+        s << '_';
+        return;
+    }
+    while(p < end) {
+        int room = s.buffer().avail() - kStringReserve;
+        if(room <= 0) {
+            return;
+        }
+        const char* special = findSpecialChar(p, end, ' ', '=');
+        int len = static_cast<int>(special - p);
+        if(len > room) {
+            len = room;
+            special = p + len;
+        }
+        s.append(p, len);
+        p = special;
+        if(p == end || len == room) {
+            continue;
+        }
+        s << '_';
+        ++p;
+    }
+}
+
+}   // namespace detail
+
+namespace {
+
+// LogLevelName后面补了空格 这里只要名字
+StringPiece levelName(Logger::LogLevel level) {
+    const char* name = LogLevelName[level];
+    return StringPiece(name, static_cast<int>(strcspn(name, " ")));
+}
+
+void appendSource(LogStream& s, const Logger::SourceFile& file, int line) {
+    s.append(file.data_, file.size_);
+    s << ':' << line;
+}
+
+LogfmtEncoder g_logfmtEncoder;
+const LogEncoder* g_encoder = &g_logfmtEncoder;
+
+}   // namespace
+
+void LogfmtEncoder::begin(LogStream& s, StringPiece time, int tid,
+                          Logger::LogLevel level, StringPiece msg) const
+{
+    s << "time=\"" << time << "\" level=" << levelName(level) << " tid=" << tid << " msg=";
+    detail::appendLogfmtValue(s, msg);
+}
+
+void LogfmtEncoder::field(LogStream& s, const KV& kv) const {
+    s << ' ';
+    detail::appendLogfmtKey(s, kv.key());
+    s << '=';
+    switch(kv.type()) {
+        case KV::kInt64:  s << static_cast<long long>(kv.asInt64()); break;
+        case KV::kUInt64: s << static_cast<unsigned long long>(kv.asUInt64()); break;
+        case KV::kDouble: s << kv.asDouble(); break;
+        case KV::kBool:   s << (kv.asBool() ? "true" : "false"); break;
+        case KV::kString: detail::appendLogfmtValue(s, kv.asString()); break;
+    }
+}
+
+void LogfmtEncoder::end(LogStream& s, const Logger::SourceFile& file, int line) const {
+    s << " src=";
+    appendSource(s, file, line);
+    s << '\n';
+}
+
+void JsonEncoder::begin(LogStream& s, StringPiece time, int tid,
+                        Logger::LogLevel level, StringPiece msg) const
+{
+    s << "{\"time\":\"" << time << "\",\"level\":\"" << levelName(level)
+      << "\",\"tid\":" << tid << ",\"msg\":\"";
+    detail::appendJsonEscaped(s, msg);
+    s << '"';
+}
+
+void JsonEncoder::field(LogStream& s, const KV& kv) const {
+    s << ",\"";
+    detail::appendJsonEscaped(s, kv.key());
+    s << "\":";
+    switch(kv.type()) {
+        case KV::kInt64:  s << static_cast<long long>(kv.asInt64()); break;
+        case KV::kUInt64: s << static_cast<unsigned long long>(kv.asUInt64()); break;
+        case KV::kDouble:
+            if(std::isfinite(kv.asDouble())) {
+                s << kv.asDouble();
+            }
+            else {
+                s << "null";
+            }
+            break;
+        case KV::kBool:   s << (kv.asBool() ? "true" : "false"); break;
+        case KV::kString:
+            s << '"';
+            detail::appendJsonEscaped(s, kv.asString());
+            s << '"';
+            break;
+    }
+}
+
+void JsonEncoder::end(LogStream& s, const Logger::SourceFile& file, int line) const {
+    s << ",\"src\":\"";
+    appendSource(s, file, line);
+    s << "\"}\n";
+}
+
+/**
+ * 时间的秒数部分用Logger的每秒缓存 微秒部分直接写6位数字 不调用snprintf
+ */
+StructuredLogger::StructuredLogger(Logger::SourceFile file, int line,
+                                   Logger::LogLevel level, StringPiece msg)
+    : encoder_(g_encoder),
+      file_(file),
+      line_(line)
+{
+    int64_t microSecondsSinceEpoch = Timestamp::now().microSecondsSinceEpoch();
+    int64_t seconds = microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond;
+    int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
+
+    char time[26];
+    memcpy(time, detail::formatLogSeconds(seconds), 17);
+    time[17] = '.';
+    for(int i = 23; i > 17; --i) {
+        time[i] = static_cast<char>('0' + microseconds % 10);
+        microseconds /= 10;
+    }
+    time[24] = 'Z';
+    time[25] = '\0';
+    encoder_->begin(stream_, StringPiece(time, 25), CurrentThread::tid(), level, msg);
+}
+
+StructuredLogger::~StructuredLogger() {
+    encoder_->end(stream_, file_, line_);
+    const LogStream::Buffer& buf(stream_.buffer());
+    g_output(buf.data(), buf.length());
+}
+
+void StructuredLogger::setEncoder(const LogEncoder* encoder) {
+    g_encoder = encoder ? encoder : &g_logfmtEncoder;
+}
+
+}   // namespace myserver
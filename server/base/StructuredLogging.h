@@ -0,0 +1,214 @@
+/**
+* @description: StructuredLogging.h
+* @author: YQ Huang
+* @brief: 结构化日志 键值对直接编码成logfmt或JSON
+* @date: 2026/10/18 16:42:10
+*/
+
+#pragma once
+
+#include "server/base/Logging.h"
+
+#include <type_traits>
+
+namespace myserver {
+
+/**
+ * 一个键值对 只保存键和值的指针或数值 不拷贝字符串 不分配内存
+ * operator<<时立即编码 所以字符串只需要在这条语句内有效
+ */
+class KV {
+public:
+    enum Type {
+        kInt64,
+        kUInt64,
+        kDouble,
+        kBool,
+        kString,
+    };
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                 std::is_signed<T>::value, int>::type = 0>
+    KV(StringPiece key, T v)
+        : key_(key), type_(kInt64)
+    {
+        value_.i = v;
+    }
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                 std::is_unsigned<T>::value, int>::type = 0>
+    KV(StringPiece key, T v)
+        : key_(key), type_(kUInt64)
+    {
+        value_.u = v;
+    }
+
+    KV(StringPiece key, bool v)
+        : key_(key), type_(kBool)
+    {
+        value_.b = v;
+    }
+
+    KV(StringPiece key, double v)
+        : key_(key), type_(kDouble)
+    {
+        value_.d = v;
+    }
+
+    KV(StringPiece key, float v)
+        : key_(key), type_(kDouble)
+    {
+        value_.d = v;
+    }
+
+    KV(StringPiece key, const char* v)
+        : key_(key), type_(kString)
+    {
+        setString(v ? StringPiece(v) : StringPiece("(null)", 6));
+    }
+
+    KV(StringPiece key, const string& v)
+        : key_(key), type_(kString)
+    {
+        setString(StringPiece(v));
+    }
+
+    KV(StringPiece key, StringPiece v)
+        : key_(key), type_(kString)
+    {
+        setString(v);
+    }
+
+    StringPiece key() const { return key_; }
+    Type type() const { return type_; }
+    int64_t asInt64() const { return value_.i; }
+    uint64_t asUInt64() const { return value_.u; }
+    double asDouble() const { return value_.d; }
+    bool asBool() const { return value_.b; }
+    StringPiece asString() const { return StringPiece(value_.s.data, value_.s.size); }
+
+private:
+    void setString(StringPiece v) {
+        value_.s.data = v.data();
+        value_.s.size = v.size();
+    }
+
+    StringPiece key_;
+    Type type_;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        bool b;
+        struct {
+            const char* data;
+            int size;
+        } s;
+    } value_;
+};
+
+/**
+ * 编码器 决定一条结构化日志的格式 可以自己实现
+ * 一条日志依次调用 begin() field()(每个键值对一次) end()
+ * 所有内容都写入StructuredLogger自己的LogStream 不分配内存
+ */
+class LogEncoder {
+public:
+    virtual ~LogEncoder() { }
+
+    // time是 "YYYYMMDD HH:MM:SS.uuuuuuZ" 格式的时间
+    virtual void begin(LogStream& s, StringPiece time, int tid,
+                       Logger::LogLevel level, StringPiece msg) const = 0;
+    virtual void field(LogStream& s, const KV& kv) const = 0;
+    virtual void end(LogStream& s, const Logger::SourceFile& file, int line) const = 0;
+};
+
+/**
+ * logfmt格式 一行是空格分隔的key=value
+ *   time="20261018 16:42:10.123456Z" level=INFO tid=1234 msg="request done" status=200 src=Foo.cc:42
+ * 值含有空格 '=' '"' '\\'或控制字符时加引号并转义
+ */
+class LogfmtEncoder : public LogEncoder {
+public:
+    void begin(LogStream& s, StringPiece time, int tid,
+               Logger::LogLevel level, StringPiece msg) const override;
+    void field(LogStream& s, const KV& kv) const override;
+    void end(LogStream& s, const Logger::SourceFile& file, int line) const override;
+};
+
+/**
+ * 一行一个JSON对象
+ *   {"time":"20261018 16:42:10.123456Z","level":"INFO","tid":1234,"msg":"request done","status":200,"src":"Foo.cc:42"}
+ * 非有限的浮点数(nan inf)输出为null
+ */
+class JsonEncoder : public LogEncoder {
+public:
+    void begin(LogStream& s, StringPiece time, int tid,
+               Logger::LogLevel level, StringPiece msg) const override;
+    void field(LogStream& s, const KV& kv) const override;
+    void end(LogStream& s, const Logger::SourceFile& file, int line) const override;
+};
+
+/**
+ * 结构化日志 与Logger共用日志级别 输出函数和每秒一次的时间缓存
+ * 用法:
+ *   SLOG_INFO("request done") << KV("method", "GET") << KV("status", 200) << KV("ms", 1.5);
+ *
+ * 整条日志在栈上的LogStream中编码 析构时交给Logger的输出函数
+ * 超出缓冲区的键值对被丢弃 保证每一行都是完整的logfmt或JSON
+ */
+class StructuredLogger : noncopyable {
+public:
+    StructuredLogger(Logger::SourceFile file, int line, Logger::LogLevel level, StringPiece msg);
+    ~StructuredLogger();
+
+    StructuredLogger& operator<<(const KV& kv) {
+        // 给结尾的src和换行留出空间
+        if(stream_.buffer().avail() > kReserve) {
+            encoder_->field(stream_, kv);
+        }
+        return *this;
+    }
+
+    // 默认是LogfmtEncoder encoder必须一直有效 在多线程写日志之前设置
+    static void setEncoder(const LogEncoder* encoder);
+
+    static const int kReserve = 256;
+
+private:
+    const LogEncoder* encoder_;
+    LogStream stream_;
+    Logger::SourceFile file_;
+    int line_;
+};
+
+namespace detail {
+
+/**
+ * 找到[begin, end)中第一个需要特殊处理的字节 没有则返回end
+ * 特殊字节是 '"' '\\' 以及所有 <= maxControl 的字节 再加上一个额外的字节extra
+ * 有SSE2时每次比较16个字节
+ */
+const char* findSpecialChar(const char* begin, const char* end, unsigned char maxControl, char extra);
+
+// 写入JSON字符串的内容(不含两边的引号) 转义'"' '\\'和控制字符
+void appendJsonEscaped(LogStream& s, StringPiece str);
+
+// 写入logfmt的值 需要时加引号并转义
+void appendLogfmtValue(LogStream& s, StringPiece str);
+
+// 写入logfmt的键 键不能加引号 空格 '=' '"' '\\'和控制字符替换成'_' 空键写成"_"
+void appendLogfmtKey(LogStream& s, StringPiece key);
+
+}   // namespace detail
+
+}   // namespace myserver
+
+#define SLOG_IMPL(lvl, msg) if(!MYSERVER_LOG_ENABLED(lvl)) {} else \
+    myserver::StructuredLogger(__FILE__, __LINE__, lvl, msg)
+
+#define SLOG_TRACE(msg) SLOG_IMPL(myserver::Logger::TRACE, msg)
+#define SLOG_DEBUG(msg) SLOG_IMPL(myserver::Logger::DEBUG, msg)
+#define SLOG_INFO(msg) SLOG_IMPL(myserver::Logger::INFO, msg)
+#define SLOG_WARN(msg) SLOG_IMPL(myserver::Logger::WARN, msg)
+#define SLOG_ERROR(msg) SLOG_IMPL(myserver::Logger::ERROR, msg)
@@ -60,20 +60,48 @@ struct ThreadData {
     string name_;           // 子线程的名字
     pid_t* tid_;            // 子线程的tid
     CountDownLatch* latch_; // 线程同步
+    CpuSet cpus_;           // CPU亲和性
+    int numaNode_;          // NUMA节点
+    bool strictNuma_;
 
     // 构造函数
     ThreadData(ThreadFunc func,
                const string& name,
                pid_t* tid,
-               CountDownLatch* latch)
+               CountDownLatch* latch,
+               const CpuSet& cpus,
+               int numaNode,
+               bool strictNuma)
         : func_(std::move(func)),
           name_(name),
           tid_(tid),
-          latch_(latch)
+          latch_(latch),
+          cpus_(cpus),
+          numaNode_(numaNode),
+          strictNuma_(strictNuma)
     { }
 
+    // 在start()返回之前完成 之后线程分配的内存都按新的策略
+    void applyPlacement() {
+        if(!cpus_.empty()) {
+            int err = cpus_.applyToCurrentThread();
+            if(err != 0) {
+                LOG_ERROR << "Thread " << name_ << " set cpu affinity " << cpus_.toString()
+                          << " failed: " << strerror_tl(err);
+            }
+        }
+        if(numaNode_ >= 0) {
+            int err = Numa::setMemoryNode(numaNode_, strictNuma_);
+            if(err != 0) {
+                LOG_ERROR << "Thread " << name_ << " set numa node " << numaNode_
+                          << " failed: " << strerror_tl(err);
+            }
+        }
+    }
+
     // 线程实际执行的函数
     void runInThread() {
+        applyPlacement();
         // 执行用户传入的回调函数
         *tid_ = CurrentThread::tid();
         tid_ = NULL;
@@ -148,7 +176,9 @@ Thread::Thread(ThreadFunc func, const string& n)
       tid_(0),
       func_(std::move(func)),
       name_(n),
-      latch_(1)
+      latch_(1),
+      numaNode_(-1),
+      strictNuma_(false)
 {   
     // 线程名字默认为空
     setDefalutName();
@@ -169,7 +199,8 @@ Thread::~Thread() {
  */ 
 void Thread::start() {
     started_ = true;
-    detail::ThreadData* data = new detail::ThreadData(func_, name_, &tid_, &latch_);
+    detail::ThreadData* data = new detail::ThreadData(func_, name_, &tid_, &latch_,
+                                                          cpus_, numaNode_, strictNuma_);
     if(pthread_create(&pthreadId_, NULL, &detail::startThread, data)) {
         started_ = false;
         delete data;
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "server/base/Affinity.h"
 #include "server/base/Atomic.h"
 #include "server/base/CountDownLatch.h"
 #include "server/base/Types.h"
@@ -33,6 +34,11 @@ public:
     // 析构函数
     ~Thread();
     
+    // 在start()之前调用 线程开始执行func之前固定在这些CPU上
+    void setCpuAffinity(const CpuSet& cpus) { cpus_ = cpus; }
+    // 在start()之前调用 线程的内存优先(strict时只)从这个NUMA节点分配
+    void setNumaNode(int node, bool strict = false) { numaNode_ = node; strictNuma_ = strict; }
+
     // 线程执行函数
     void start();   
     // 等待线程执行完成
@@ -57,6 +63,9 @@ private:
     ThreadFunc func_;       // 线程执行函数
     string name_;           // 线程名称
     CountDownLatch latch_;  // 线程同步
+    CpuSet cpus_;           // 为空表示不限制
+    int numaNode_;          // -1表示默认的内存策略
+    bool strictNuma_;       // MPOL_BIND还是MPOL_PREFERRED
 
     static AtomicInt32 numCreated_; // 原子操作 当前已经创建线程的数量
 
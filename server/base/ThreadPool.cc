@@ -6,12 +6,22 @@
 */
 
 #include "server/base/ThreadPool.h"
+#include "server/base/Metrics.h"
 
 #include <assert.h>
 #include <stdio.h>
 
 namespace myserver {
 
+namespace {
+
+Counter* const g_tasks = MetricsRegistry::instance().counter(
+    "myserver_threadpool_tasks_total", "Tasks submitted to all ThreadPools");
+Gauge* const g_queueDepth = MetricsRegistry::instance().gauge(
+    "myserver_threadpool_queue_depth", "Tasks waiting in all ThreadPool queues");
+
+}   // namespace
+
 // 构造函数 只初始化参数
 ThreadPool::ThreadPool(const string& nameArg)
     : mutex_(),
@@ -19,7 +29,12 @@ ThreadPool::ThreadPool(const string& nameArg)
       notFull_(mutex_),
       name_(nameArg),   // 初始化线程池名称
       maxQueueSize_(0), // 任务列表最大值初始化为0
-      running_(false)
+      highMark_(0),
+      lowMark_(0),
+      aboveHighMark_(false),
+      running_(false),
+      numaNode_(-1),
+      strictNuma_(false)
 {
 }
 
@@ -29,6 +44,8 @@ ThreadPool::~ThreadPool() {
     if(running_) {
         stop();
     }
+    // 停止后没有取走的任务随队列一起析构
+    g_queueDepth->add(-static_cast<int64_t>(queue_.size()));
     // 如果没有分配过线程，那就也没有需要释放的内存 什么都不做就可以了
 }
 
@@ -41,6 +58,10 @@ void ThreadPool::start(int numThreads) {
         snprintf(id, sizeof(id), "%d", i+1);
         // std::bind在绑定类内部成员时，第二个参数必须是类的实例
         threads_.emplace_back(new Thread(std::bind(&ThreadPool::runInThread, this), name_+id));
+        if(!cpus_.empty()) {
+            threads_[i]->setCpuAffinity(cpus_[i % cpus_.size()]);
+        }
+        threads_[i]->setNumaNode(numaNode_, strictNuma_);
         // 启动每个线程，但是由于线程运行函数是runInThread 所以会阻塞
         threads_[i]->start();
     }
@@ -72,6 +93,7 @@ size_t ThreadPool::queueSize() const {
 
 // 生产者函数 负责生成任务
 void ThreadPool::run(Task task) {
+    g_tasks->increment();
     // 如果线程池为空 即没有分配线程 直接有当前线程执行任务
     if(threads_.empty()) {
         task();
@@ -87,6 +109,13 @@ void ThreadPool::run(Task task) {
 
         // 当任务队列没满 则将任务加入队列中
         queue_.push_back(std::move(task));
+        g_queueDepth->increment();
+        if(highMark_ > 0 && !aboveHighMark_ && queue_.size() >= highMark_) {
+            aboveHighMark_ = true;
+            if(onHighMark_) {
+                onHighMark_();
+            }
+        }
         // 唤醒等待取任务的线程
         notEmpty_.notify();
     }
@@ -137,7 +166,15 @@ ThreadPool::Task ThreadPool::take() {
     // 再判断一下是否非空
     if(!queue_.empty()) {
         // 总是从队列队头取任务
-        task = queue_.front();
+        task = std::move(queue_.front());
+        queue_.pop_front();
+        g_queueDepth->decrement();
+        if(aboveHighMark_ && queue_.size() <= lowMark_) {
+            aboveHighMark_ = false;
+            if(onLowMark_) {
+                onLowMark_();
+            }
+        }
         if(maxQueueSize_ > 0) {
             // 已经取走一个任务，唤醒等待放任务的线程
             notFull_.notify();
@@ -35,11 +35,27 @@ public:
     // Must be called before start()
     // 设定任务列表的最大值
     void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
+    /**
+     * 队列长度增长到highMark时调用onHigh 之后降到lowMark时调用onLow 用于让生产者暂停
+     * 与setMaxQueueSize()阻塞调用者不同 适合不能阻塞的IO线程
+     * 回调在持有队列锁时调用 保证两者交替出现 回调里不能再调用ThreadPool的函数
+     */
+    void setQueueWaterMarks(size_t highMark, size_t lowMark, const Task& onHigh, const Task& onLow) {
+        highMark_ = highMark;
+        lowMark_ = lowMark;
+        onHighMark_ = onHigh;
+        onLowMark_ = onLow;
+    }
     // 设定线程初始化的回调函数
     void setThreadInitCallback(const Task& cb) {
         threadInitCallback_ = cb;
     }
 
+    // 第i个线程固定在cpus[i % cpus.size()]上
+    void setCpuAffinity(const std::vector<CpuSet>& cpus) { cpus_ = cpus; }
+    // 所有线程的内存优先(strict时只)从这个NUMA节点分配
+    void setNumaNode(int node, bool strict = false) { numaNode_ = node; strictNuma_ = strict; }
+
     // 创建线程池
     void start(int numThreads);
     // 关闭线程池
@@ -67,7 +83,15 @@ private:
     std::vector<std::unique_ptr<Thread> > threads_; // 存放线程指针
     std::deque<Task> queue_;    // 任务列表 线程安全的阻塞队列
     size_t maxQueueSize_;       // 任务列表最大数目
+    size_t highMark_;           // 0表示不检查水位
+    size_t lowMark_;
+    Task onHighMark_;
+    Task onLowMark_;
+    bool aboveHighMark_;        // 超过高水位后还没有降到低水位
     bool running_;              // 线程池运行标志
+    std::vector<CpuSet> cpus_;  // 每个线程的CPU亲和性
+    int numaNode_;              // -1表示默认的内存策略
+    bool strictNuma_;
 };
 
 }   // namespaace myserver
\ No newline at end of file
@@ -6,9 +6,11 @@
 */
 
 #include "server/base/Timestamp.h"
+#include "server/base/TscClock.h"
 
 #include <sys/time.h>
 #include <stdio.h>
+#include <time.h>
 #ifndef __STDC_FORMAT_MACROS
 #define __STDC_FORMAT_MACROS
 #endif
@@ -57,4 +59,15 @@ Timestamp Timestamp::now() {
     return Timestamp(seconds * kMicroSecondsPerSecond + tv.tv_usec);
 }
 
+Timestamp Timestamp::nowCoarse() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    int64_t seconds = ts.tv_sec;
+    return Timestamp(seconds * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
+
+Timestamp Timestamp::nowFast() {
+    return Timestamp(TscClock::nowMicros());
+}
+
 }
\ No newline at end of file
@@ -50,6 +50,10 @@ public:
 
     // 当前时间戳
     static Timestamp now();
+    // 精度只有一个时钟节拍(通常1-4ms) 只读内核更新的变量 适合只精确到秒的场合
+    static Timestamp nowCoarse();
+    // 用校准过的TSC计算 精度1微秒 比now()快 日志、Poller和定时器使用
+    static Timestamp nowFast();
     static Timestamp invalid() { return Timestamp(); }
 
     // 从time_t 微秒 偏移 得到时间戳
@@ -0,0 +1,65 @@
+/**
+* @description: TokenBucket.cc
+* @author: YQ Huang
+* @brief: 无锁的令牌桶 用于按字节数和消息数限速
+* @date: 2026/10/19 05:32:15
+*/
+
+#include "server/base/TokenBucket.h"
+
+#include <algorithm>
+
+namespace myserver {
+
+TokenBucket::TokenBucket(double rate, double burst)
+    : rate_(rate),
+      burst_(burst > 1 ? burst : 1),
+      nanosPerToken_(rate > 0 ? 1e9 / rate : 0),
+      burstNanos_(static_cast<int64_t>(burst_ * nanosPerToken_)),
+      tat_(0)
+{
+}
+
+int64_t TokenBucket::consume(int64_t n, Timestamp now) {
+    if(unlimited()) {
+        return 0;
+    }
+    int64_t nowNanos = toNanos(now);
+    int64_t cost = static_cast<int64_t>(static_cast<double>(n) * nanosPerToken_);
+    int64_t tat = tat_.load(std::memory_order_relaxed);
+    int64_t newTat;
+    do {
+        newTat = std::max(tat, nowNanos) + cost;
+    } while(!tat_.compare_exchange_weak(tat, newTat, std::memory_order_relaxed));
+    // 桶里还剩的令牌要能覆盖到newTat 超出的部分就是欠账
+    int64_t debt = newTat - nowNanos - burstNanos_;
+    return debt > 0 ? (debt + 999) / 1000 : 0;
+}
+
+bool TokenBucket::tryConsume(int64_t n, Timestamp now) {
+    if(unlimited()) {
+        return true;
+    }
+    int64_t nowNanos = toNanos(now);
+    int64_t cost = static_cast<int64_t>(static_cast<double>(n) * nanosPerToken_);
+    int64_t tat = tat_.load(std::memory_order_relaxed);
+    int64_t newTat;
+    do {
+        newTat = std::max(tat, nowNanos) + cost;
+        if(newTat - nowNanos > burstNanos_) {
+            return false;
+        }
+    } while(!tat_.compare_exchange_weak(tat, newTat, std::memory_order_relaxed));
+    return true;
+}
+
+double TokenBucket::available(Timestamp now) const {
+    if(unlimited()) {
+        return burst_;
+    }
+    int64_t nowNanos = toNanos(now);
+    int64_t tat = std::max(tat_.load(std::memory_order_relaxed), nowNanos);
+    return static_cast<double>(nowNanos + burstNanos_ - tat) / nanosPerToken_;
+}
+
+}   // namespace myserver
@@ -0,0 +1,54 @@
+/**
+* @description: TokenBucket.h
+* @author: YQ Huang
+* @brief: 无锁的令牌桶 用于按字节数和消息数限速
+* @date: 2026/10/19 05:32:08
+*/
+
+#pragma once
+
+#include "server/base/noncopyable.h"
+#include "server/base/Timestamp.h"
+
+#include <atomic>
+#include <stdint.h>
+
+namespace myserver {
+
+/**
+ * 令牌以每秒rate个的速度补充 最多攒burst个
+ * 实现上只保存一个时刻tat(GCRA算法): 按当前的取用速度 桶会在tat时被取空
+ * 取令牌就是把tat往后推 用一次CAS完成 多个线程共享一个桶时也不需要加锁
+ *
+ * consume()先取后算 不够时记为欠账 适合读完才知道字节数的情况
+ * 调用者据此暂停相应的时间 欠账还清之前再取 等待的时间会累加
+ */
+class TokenBucket : noncopyable {
+public:
+    // rate不大于0时不限速
+    TokenBucket(double rate, double burst);
+
+    // 取走n个令牌 返回还清欠账需要等待的微秒数 没有欠账时为0
+    int64_t consume(int64_t n, Timestamp now);
+
+    // 令牌足够时取走n个并返回true 否则不取
+    bool tryConsume(int64_t n, Timestamp now);
+
+    // 当前可用的令牌数 欠账时为负
+    double available(Timestamp now) const;
+
+    bool unlimited() const { return nanosPerToken_ <= 0; }
+    double rate() const { return rate_; }
+    double burst() const { return burst_; }
+
+private:
+    static int64_t toNanos(Timestamp t) { return t.microSecondsSinceEpoch() * 1000; }
+
+    const double rate_;
+    const double burst_;
+    const double nanosPerToken_;
+    const int64_t burstNanos_;      // 攒满burst个令牌需要的时间
+    std::atomic<int64_t> tat_;      // 单位纳秒 早于now时桶是满的
+};
+
+}   // namespace myserver
@@ -0,0 +1,137 @@
+/**
+* @description: TscClock.cc
+* @author: YQ Huang
+* @brief: 基于TSC的快速时钟 用于Timestamp::nowFast()
+* @date: 2026/10/19 01:40:20
+*/
+
+#include "server/base/TscClock.h"
+
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define MYSERVER_HAVE_TSC 1
+#endif
+
+namespace myserver {
+
+namespace {
+
+const int64_t kNanosPerMicrosecond = 1000;
+const int kMultShift = 32;
+const int64_t kMaxClampUs = 1000;
+
+int64_t clockMicros(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 + ts.tv_nsec / kNanosPerMicrosecond;
+}
+
+int64_t clockNanos(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+/**
+ * 微秒 = ticks * mult >> kMultShift
+ * ticks不超过resyncTicks(100ms的TSC计数 远小于2^32) 乘积不会溢出
+ */
+struct Calibration {
+    bool available;
+    double ticksPerMicrosecond;
+    uint64_t mult;
+    uint64_t resyncTicks;
+};
+
+#ifdef MYSERVER_HAVE_TSC
+// CPUID 0x80000007 EDX第8位: TSC频率不随P-state和C-state变化
+bool hasInvariantTsc() {
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (edx & (1u << 8)) != 0;
+}
+
+uint64_t readTsc() {
+    return __rdtsc();
+}
+#else
+uint64_t readTsc() {
+    return 0;
+}
+#endif
+
+Calibration calibrate() {
+    Calibration cal = { false, 0.0, 0, 0 };
+#ifdef MYSERVER_HAVE_TSC
+    if(!hasInvariantTsc()) {
+        return cal;
+    }
+    int64_t startNs = clockNanos(CLOCK_MONOTONIC);
+    uint64_t startTsc = readTsc();
+    int64_t endNs;
+    do {
+        endNs = clockNanos(CLOCK_MONOTONIC);
+    } while(endNs - startNs < TscClock::kCalibrationUs * kNanosPerMicrosecond);
+    uint64_t endTsc = readTsc();
+    double ticksPerUs = static_cast<double>(endTsc - startTsc) * kNanosPerMicrosecond
+                        / static_cast<double>(endNs - startNs);
+    if(ticksPerUs < 1.0) {
+        return cal;
+    }
+    cal.available = true;
+    cal.ticksPerMicrosecond = ticksPerUs;
+    cal.mult = static_cast<uint64_t>(static_cast<double>(1ULL << kMultShift) / ticksPerUs);
+    cal.resyncTicks = static_cast<uint64_t>(ticksPerUs * static_cast<double>(TscClock::kResyncIntervalUs));
+#endif
+    return cal;
+}
+
+const Calibration& calibration() {
+    static const Calibration cal = calibrate();
+    return cal;
+}
+
+// 每个线程的基准 tscBase为0表示还没有同步过
+__thread uint64_t t_tscBase = 0;
+__thread int64_t t_microsBase = 0;
+__thread int64_t t_lastMicros = 0;
+
+}   // namespace
+
+int64_t TscClock::nowMicros() {
+    const Calibration& cal = calibration();
+    if(!cal.available) {
+        return clockMicros(CLOCK_REALTIME);
+    }
+    uint64_t tsc = readTsc();
+    uint64_t delta = tsc - t_tscBase;
+    int64_t micros;
+    if(t_tscBase == 0 || delta >= cal.resyncTicks) {
+        micros = clockMicros(CLOCK_REALTIME);
+        t_tscBase = readTsc();
+        t_microsBase = micros;
+    }
+    else {
+        micros = t_microsBase + static_cast<int64_t>((delta * cal.mult) >> kMultShift);
+    }
+    // 重新同步时校准误差可能让时间退回一点 墙上时间被往回调整时则跟着退回
+    if(micros < t_lastMicros && t_lastMicros - micros < kMaxClampUs) {
+        micros = t_lastMicros;
+    }
+    t_lastMicros = micros;
+    return micros;
+}
+
+bool TscClock::available() {
+    return calibration().available;
+}
+
+double TscClock::ticksPerMicrosecond() {
+    return calibration().ticksPerMicrosecond;
+}
+
+}   // namespace myserver
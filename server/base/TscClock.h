@@ -0,0 +1,39 @@
+/**
+* @description: TscClock.h
+* @author: YQ Huang
+* @brief: 基于TSC的快速时钟 用于Timestamp::nowFast()
+* @date: 2026/10/19 01:40:12
+*/
+
+#pragma once
+
+#include "server/base/noncopyable.h"
+
+#include <stdint.h>
+
+namespace myserver {
+
+/**
+ * 用rdtsc读取时间 比gettimeofday少一次vDSO里的换算和seqlock重试
+ *
+ * 第一次使用时用CLOCK_MONOTONIC校准TSC的频率(约kCalibrationUs) 之后每个线程记住
+ * 一对(TSC, 墙上时间)作为基准 距离基准超过kResyncIntervalUs时重新读取一次CLOCK_REALTIME
+ * 所以不会累积频率误差 也能跟上NTP对墙上时间的调整
+ *
+ * CPU没有不变的TSC(constant/nonstop)或不是x86时退回clock_gettime(CLOCK_REALTIME)
+ * 同一线程内返回的时间不会因为校准误差倒退 墙上时间被往回调整时除外
+ */
+class TscClock : noncopyable {
+public:
+    static const int64_t kCalibrationUs = 5 * 1000;
+    static const int64_t kResyncIntervalUs = 100 * 1000;
+
+    // 自1970.1.1的微秒数
+    static int64_t nowMicros();
+
+    // 是否在使用TSC 以及校准得到的频率 不可用时为0
+    static bool available();
+    static double ticksPerMicrosecond();
+};
+
+}   // namespace myserver
@@ -0,0 +1,122 @@
+/**
+* @description: Affinity_test.cc
+* @author: YQ Huang
+* @brief: CpuSet和NUMA内存策略 测试函数
+* @date: 2026/10/18 21:41:26
+*/
+
+#include "server/base/Affinity.h"
+#include "server/base/CountDownLatch.h"
+#include "server/base/Thread.h"
+#include "server/base/ThreadPool.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <linux/mempolicy.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace myserver;
+
+void testParse() {
+    CpuSet set;
+    CHECK(CpuSet::parse("0-3,8,10-11\n", &set));
+    CHECK(set.count() == 7);
+    CHECK(set.contains(2) && set.contains(8) && !set.contains(9));
+    CHECK(set.first() == 0);
+    CHECK(set.toString() == "0-3,8,10-11");
+    CHECK(CpuSet::single(5).toString() == "5");
+    CHECK(CpuSet::parse("", &set) && set.empty());
+    CHECK(set.first() == -1);
+
+    const char* bad[] = { "a", "3-1", "1,,2", "1-", "-1", "99999" };
+    for(const char* spec : bad) {
+        CHECK(!CpuSet::parse(spec, &set));
+    }
+}
+
+// 返回调用线程的内存策略和节点掩码的第一个字
+int memoryPolicy(unsigned long* mask) {
+    int mode = -1;
+    *mask = 0;
+    unsigned long nodes[16] = { 0 };
+    CHECK(syscall(SYS_get_mempolicy, &mode, nodes, 16 * 8 * sizeof(unsigned long), NULL, 0) == 0);
+    *mask = nodes[0];
+    return mode;
+}
+
+/**
+ * 线程开始执行时已经固定在指定的CPU上 内存策略也已经设置好
+ */
+void testThreadPlacement() {
+    CpuSet allowed = CpuSet::ofCurrentThread();
+    CHECK(!allowed.empty());
+    int cpu = allowed.cpus().back();
+    int node = Numa::nodeOfCpu(cpu);
+    CHECK(Numa::numNodes() >= 1);
+    CHECK(node >= 0);
+    CHECK(CpuSet::ofNumaNode(node).contains(cpu));
+
+    CpuSet seen;
+    int pinned = -1;
+    int mode = -1;
+    unsigned long mask = 0;
+    Thread thread([&] {
+        seen = CpuSet::ofCurrentThread();
+        pinned = CpuSet::pinnedCpuOfCurrentThread();
+        mode = memoryPolicy(&mask);
+    }, "placed");
+    thread.setCpuAffinity(CpuSet::single(cpu));
+    thread.setNumaNode(node);
+    thread.start();
+    thread.join();
+    CHECK(seen == CpuSet::single(cpu));
+    CHECK(pinned == cpu);
+    CHECK(mode == MPOL_PREFERRED);
+    CHECK(mask == 1UL << node);
+
+    // 主线程不受影响 即使只允许一个CPU也不算显式固定
+    CHECK(CpuSet::ofCurrentThread() == allowed);
+    CHECK(CpuSet::pinnedCpuOfCurrentThread() == -1);
+    CHECK(memoryPolicy(&mask) == MPOL_DEFAULT);
+}
+
+void testThreadPool() {
+    std::vector<int> cpus = CpuSet::ofCurrentThread().cpus();
+    std::vector<CpuSet> sets;
+    for(int cpu : cpus) {
+        sets.push_back(CpuSet::single(cpu));
+    }
+    ThreadPool pool("pinned");
+    pool.setCpuAffinity(sets);
+    pool.setNumaNode(Numa::nodeOfCpu(cpus[0]), true);
+    pool.start(2);
+
+    const int kTasks = 16;
+    CountDownLatch latch(kTasks);
+    MutexLock mutex;
+    bool ok = true;
+    for(int i = 0; i < kTasks; ++i) {
+        pool.run([&] {
+            CpuSet current = CpuSet::ofCurrentThread();
+            unsigned long mask = 0;
+            bool good = current.count() == 1 && memoryPolicy(&mask) == MPOL_BIND;
+            {
+                MutexLockGuard lock(mutex);
+                ok = ok && good;
+            }
+            latch.countDown();
+        });
+    }
+    latch.wait();
+    pool.stop();
+    CHECK(ok);
+}
+
+int main() {
+    testParse();
+    testThreadPlacement();
+    testThreadPool();
+    printf("All tests passed\n");
+}
@@ -0,0 +1,108 @@
+/**
+* @description: AsyncLogging_test.cc
+* @author: YQ Huang
+* @brief: 异步日志积压时丢弃 测试函数
+* @date: 2026/10/19 07:15:42
+*/
+
+#include "server/base/AsyncLogging.h"
+#include "server/base/FileUtil.h"
+#include "server/base/LogStream.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <algorithm>
+#include <string>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace myserver;
+
+// 目录里唯一的文件名
+std::string onlyFile(const char* dir) {
+    std::string name;
+    DIR* d = opendir(dir);
+    CHECK(d != NULL);
+    struct dirent* entry;
+    while((entry = readdir(d)) != NULL) {
+        if(entry->d_name[0] != '.') {
+            CHECK(name.empty());
+            name = entry->d_name;
+        }
+    }
+    closedir(d);
+    CHECK(!name.empty());
+    return name;
+}
+
+/**
+ * 后端线程还没有启动 相当于后端完全卡住
+ * 前端写满currentBuffer_ nextBuffer_和新分配的一块后 积压达到maxBacklog 之后的消息全部丢弃
+ * 启动后端后 文件开头是丢弃的通知 接着是没被丢弃的全部消息
+ */
+void testDropWhenBacklogged() {
+    const int kLen = 1000;
+    const int kMaxBacklog = 2;
+    const int kMessages = 20000;
+    // 缓冲区剩余空间必须大于消息长度才写入
+    const int kPerBuffer = (detail::kLargeBuffer - 1) / kLen;
+    const int kKept = kPerBuffer * (kMaxBacklog + 1);
+    const int kDropped = kMessages - kKept;
+
+    std::string line(kLen - 1, 'x');
+    line += '\n';
+    AsyncLogging log("drop", 1000 * 1000 * 1000, 3, kMaxBacklog);
+    for(int i = 0; i < kMessages; ++i) {
+        log.append(line.data(), kLen);
+    }
+    CHECK(log.droppedMessages() == kDropped);
+    CHECK(log.droppedBytes() == static_cast<int64_t>(kDropped) * kLen);
+
+    log.start();
+    log.stop();
+
+    std::string content;
+    CHECK(FileUtil::readFile(onlyFile(".").c_str(), 64 * 1024 * 1024, &content) == 0);
+    char notice[64];
+    snprintf(notice, sizeof notice, "Dropped %d log messages at ", kDropped);
+    CHECK(content.compare(0, strlen(notice), notice) == 0);
+    snprintf(notice, sizeof notice, ", %d dropped in total\n", kDropped);
+    size_t noticeEnd = content.find('\n') + 1;
+    CHECK(content.compare(noticeEnd - strlen(notice), strlen(notice), notice) == 0);
+    CHECK(content.size() - noticeEnd == static_cast<size_t>(kKept) * kLen);
+    CHECK(std::count(content.begin() + static_cast<ptrdiff_t>(noticeEnd), content.end(), '\n') == kKept);
+    CHECK(unlink(onlyFile(".").c_str()) == 0);
+}
+
+// 没有积压时不丢弃 也没有通知
+void testNoDrop() {
+    AsyncLogging log("nodrop", 1000 * 1000 * 1000, 3, 2);
+    log.start();
+    const char kLine[] = "hello\n";
+    for(int i = 0; i < 1000; ++i) {
+        log.append(kLine, static_cast<int>(strlen(kLine)));
+    }
+    log.stop();
+    CHECK(log.droppedMessages() == 0);
+    CHECK(log.droppedBytes() == 0);
+    std::string content;
+    CHECK(FileUtil::readFile(onlyFile(".").c_str(), 1024 * 1024, &content) == 0);
+    CHECK(content.find("Dropped") == std::string::npos);
+    CHECK(content.size() == 1000 * strlen(kLine));
+    CHECK(unlink(onlyFile(".").c_str()) == 0);
+}
+
+int main() {
+    char dir[] = "/tmp/asynclogging_test.XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    CHECK(chdir(dir) == 0);
+
+    testDropWhenBacklogged();
+    testNoDrop();
+
+    CHECK(chdir("/") == 0);
+    CHECK(rmdir(dir) == 0);
+    printf("All tests passed\n");
+}
@@ -0,0 +1,90 @@
+/**
+* @description: BlockingQueue_bench.cc
+* @author: YQ Huang
+* @brief: 阻塞队列 吞吐量测试
+* @date: 2026/10/18 10:31:02
+*/
+
+#include "server/base/BlockingQueue.h"
+#include "server/base/BoundedBlockingQueue.h"
+#include "server/base/LockFreeBoundedQueue.h"
+#include "server/base/CountDownLatch.h"
+#include "server/base/Thread.h"
+#include "server/base/Timestamp.h"
+
+#include <memory>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace myserver;
+
+/**
+ * 吞吐量测试 nProducers个生产者共放入kItems个元素 nConsumers个消费者取出
+ * 输出每秒操作数(一次put和一次take算一次)
+ */
+template<typename Queue>
+void bench(const char* name, Queue& queue, int nProducers, int nConsumers, int kItems) {
+    std::vector<std::unique_ptr<Thread> > threads;
+    CountDownLatch startLatch(1);
+    const int perProducer = kItems / nProducers;
+    const int total = perProducer * nProducers;
+
+    for(int i = 0; i < nConsumers; ++i) {
+        // 消费者的数量可能不能整除总数 前面几个多取一个
+        int toTake = total / nConsumers + (i < total % nConsumers ? 1 : 0);
+        threads.emplace_back(new Thread([&queue, &startLatch, toTake]()
+        {
+            startLatch.wait();
+            for(int n = 0; n < toTake; ++n) {
+                queue.take();
+            }
+        }));
+    }
+    for(int i = 0; i < nProducers; ++i) {
+        threads.emplace_back(new Thread([&queue, &startLatch, perProducer]()
+        {
+            startLatch.wait();
+            for(int n = 0; n < perProducer; ++n) {
+                queue.put(n);
+            }
+        }));
+    }
+    for(auto& thr : threads) {
+        thr->start();
+    }
+
+    Timestamp start(Timestamp::now());
+    startLatch.countDown();
+    for(auto& thr : threads) {
+        thr->join();
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    char config[32];
+    snprintf(config, sizeof config, "%dP%dC", nProducers, nConsumers);
+    printf("%-24s %-8s %12.0f ops/s %8.1f ns/op\n",
+           name, config, total / seconds, seconds * 1e9 / total);
+}
+
+void benchAll(int nProducers, int nConsumers, int kItems) {
+    const size_t kCapacity = 1024;
+    {
+        BlockingQueue<int> queue;
+        bench("BlockingQueue", queue, nProducers, nConsumers, kItems);
+    }
+    {
+        BoundedBlockingQueue<int> queue(kCapacity);
+        bench("BoundedBlockingQueue", queue, nProducers, nConsumers, kItems);
+    }
+    {
+        LockFreeBoundedQueue<int> queue(kCapacity);
+        bench("LockFreeBoundedQueue", queue, nProducers, nConsumers, kItems);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int kItems = argc > 1 ? atoi(argv[1]) : 1000 * 1000;
+    benchAll(1, 1, kItems);
+    benchAll(4, 4, kItems);
+    benchAll(16, 16, kItems);
+}
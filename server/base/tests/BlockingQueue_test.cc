@@ -0,0 +1,178 @@
+/**
+* @description: BlockingQueue_test.cc
+* @author: YQ Huang
+* @brief: 阻塞队列 测试函数
+* @date: 2026/10/18 10:05:17
+*/
+
+#include "server/base/BlockingQueue.h"
+#include "server/base/BoundedBlockingQueue.h"
+#include "server/base/LockFreeBoundedQueue.h"
+#include "server/base/CountDownLatch.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace myserver;
+
+/**
+ * 多个生产者放入 [0, kItems) 多个消费者取出并求和
+ * 每个生产者最后放入一个-1作为结束标志
+ */
+template<typename Queue>
+void testProducerConsumer(Queue& queue, int producers, int consumers) {
+    const int kItems = 100000;
+    AtomicInt64 sum;
+    AtomicInt64 count;
+    std::vector<std::unique_ptr<Thread> > threads;
+
+    for(int i = 0; i < consumers; ++i) {
+        threads.emplace_back(new Thread([&queue, &sum, &count]()
+        {
+            for(;;) {
+                int x = queue.take();
+                if(x < 0) {
+                    break;
+                }
+                sum.add(x);
+                count.increment();
+            }
+        }));
+    }
+    for(int i = 0; i < producers; ++i) {
+        threads.emplace_back(new Thread([&queue, i, producers, kItems]()
+        {
+            for(int x = i; x < kItems; x += producers) {
+                queue.put(x);
+            }
+        }));
+    }
+    for(auto& thr : threads) {
+        thr->start();
+    }
+    // 先等生产者结束 再给每个消费者一个结束标志
+    for(int i = 0; i < producers; ++i) {
+        threads[consumers + i]->join();
+    }
+    for(int i = 0; i < consumers; ++i) {
+        queue.put(-1);
+    }
+    for(int i = 0; i < consumers; ++i) {
+        threads[i]->join();
+    }
+
+    CHECK(count.get() == kItems);
+    CHECK(sum.get() == static_cast<int64_t>(kItems) * (kItems - 1) / 2);
+}
+
+void testBlockingQueue() {
+    BlockingQueue<std::string> queue;
+    queue.put("hello");
+    queue.put(std::string("world"));
+    CHECK(queue.size() == 2);
+    CHECK(queue.take() == "hello");
+    std::string s;
+    CHECK(queue.tryTake(&s) && s == "world");
+    CHECK(!queue.tryTake(&s));
+
+    queue.put("a");
+    queue.put("b");
+    BlockingQueue<std::string>::queue_type all = queue.drain();
+    CHECK(all.size() == 2 && queue.size() == 0);
+
+    BlockingQueue<int> ints;
+    testProducerConsumer(ints, 4, 4);
+}
+
+void testBoundedBlockingQueue() {
+    BoundedBlockingQueue<int> queue(2);
+    CHECK(queue.empty());
+    CHECK(queue.tryPut(1));
+    CHECK(queue.tryPut(2));
+    CHECK(queue.full());
+    CHECK(!queue.tryPut(3));
+    CHECK(queue.take() == 1);
+    int x = 0;
+    CHECK(queue.tryTake(&x) && x == 2);
+    CHECK(!queue.tryTake(&x));
+
+    BoundedBlockingQueue<int> ints(16);
+    testProducerConsumer(ints, 4, 4);
+}
+
+void testLockFreeBoundedQueue() {
+    LockFreeBoundedQueue<std::string> queue(3);
+    CHECK(queue.capacity() == 4);
+    CHECK(queue.empty());
+    for(int i = 0; i < 4; ++i) {
+        CHECK(queue.tryPut(std::string(1, static_cast<char>('a' + i))));
+    }
+    CHECK(queue.full());
+    CHECK(!queue.tryPut(std::string("e")));
+    CHECK(queue.take() == "a");
+    CHECK(queue.tryPut(std::string("e")));
+    std::string s;
+    for(int i = 1; i < 5; ++i) {
+        CHECK(queue.tryTake(&s) && s == std::string(1, static_cast<char>('a' + i)));
+    }
+    CHECK(!queue.tryTake(&s));
+
+    // 析构时队列中还有元素 不能泄漏
+    LockFreeBoundedQueue<std::string> leftover(8);
+    leftover.put(std::string(100, 'x'));
+
+    LockFreeBoundedQueue<int> ints(16);
+    testProducerConsumer(ints, 1, 1);
+    testProducerConsumer(ints, 4, 4);
+    testProducerConsumer(ints, 3, 5);
+}
+
+// 没有默认构造函数 只能移动的元素
+class Token {
+public:
+    explicit Token(int value) : value_(new int(value)) { }
+    Token(Token&& rhs) = default;
+    Token& operator=(Token&& rhs) = default;
+    int value() const { return *value_; }
+
+private:
+    std::unique_ptr<int> value_;
+};
+
+// 三个队列对T的要求相同 同一份代码对三者都能编译
+template<typename Queue>
+void testMoveOnly(Queue& queue) {
+    CHECK(queue.empty());
+    queue.put(Token(1));
+    queue.put(Token(2));
+    queue.put(Token(3));
+    CHECK(queue.size() == 3);
+    CHECK(queue.take().value() == 1);
+    Token out(0);
+    CHECK(queue.tryTake(&out) && out.value() == 2);
+    // 剩下的一个在析构时销毁
+}
+
+void testNonDefaultConstructible() {
+    BlockingQueue<Token> unbounded;
+    testMoveOnly(unbounded);
+    BoundedBlockingQueue<Token> bounded(4);
+    testMoveOnly(bounded);
+    CHECK(bounded.tryPut(Token(4)));
+    LockFreeBoundedQueue<Token> lockFree(4);
+    testMoveOnly(lockFree);
+    CHECK(lockFree.tryPut(Token(4)));
+}
+
+int main() {
+    testBlockingQueue();
+    testBoundedBlockingQueue();
+    testLockFreeBoundedQueue();
+    testNonDefaultConstructible();
+    printf("All tests passed\n");
+}
@@ -0,0 +1,64 @@
+/**
+* @description: Clock_bench.cc
+* @author: YQ Huang
+* @brief: 各种读取当前时间的方式每次调用的耗时
+* @date: 2026/10/19 02:06:15
+*/
+
+#include "server/base/Timestamp.h"
+#include "server/base/TscClock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+
+using namespace myserver;
+
+int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+template<typename F>
+void bench(const char* name, int n, F f) {
+    int64_t sink = 0;
+    int64_t start = nowNanos();
+    for(int i = 0; i < n; ++i) {
+        sink += f();
+    }
+    int64_t elapsed = nowNanos() - start;
+    printf("%-34s %6.2f ns per call (%ld)\n", name, static_cast<double>(elapsed) / n, static_cast<long>(sink & 1));
+}
+
+int64_t clockMicros(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * clock_bench [calls]
+ */
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 10 * 1000 * 1000;
+    // 先校准 不计入
+    printf("tsc %s %.1f ticks/us\n", TscClock::available() ? "available" : "unavailable",
+           TscClock::ticksPerMicrosecond());
+    bench("gettimeofday", n, [] {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return static_cast<int64_t>(tv.tv_usec);
+    });
+    bench("clock_gettime(REALTIME)", n, [] { return clockMicros(CLOCK_REALTIME); });
+    bench("clock_gettime(MONOTONIC)", n, [] { return clockMicros(CLOCK_MONOTONIC); });
+    bench("clock_gettime(REALTIME_COARSE)", n, [] { return clockMicros(CLOCK_REALTIME_COARSE); });
+    bench("clock_gettime(MONOTONIC_COARSE)", n, [] { return clockMicros(CLOCK_MONOTONIC_COARSE); });
+    bench("Timestamp::now", n, [] { return Timestamp::now().microSecondsSinceEpoch(); });
+    bench("Timestamp::nowCoarse", n, [] { return Timestamp::nowCoarse().microSecondsSinceEpoch(); });
+    bench("Timestamp::nowFast", n, [] { return Timestamp::nowFast().microSecondsSinceEpoch(); });
+    // EventLoop::cachedNow()只是读一个成员 用volatile防止被提到循环外
+    volatile int64_t cached = Timestamp::now().microSecondsSinceEpoch();
+    bench("cached Timestamp", n, [&cached] { return Timestamp(cached).microSecondsSinceEpoch(); });
+}
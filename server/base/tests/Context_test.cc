@@ -0,0 +1,108 @@
+/**
+* @description: Context_test.cc
+* @author: YQ Huang
+* @brief: 带内联存储的类型化上下文 测试函数
+* @date: 2026/10/19 01:14:40
+*/
+
+#include "server/base/Context.h"
+#include "server/base/Types.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <map>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace myserver;
+
+int g_alive = 0;
+
+// 类似HTTP解析器的状态 放得进内部缓冲区
+struct ParserState {
+    ParserState() : state(0) { ++g_alive; }
+    explicit ParserState(int s) : state(s) { ++g_alive; }
+    ParserState(const ParserState& rhs) : state(rhs.state), path(rhs.path) { ++g_alive; }
+    ~ParserState() { --g_alive; }
+    int state;
+    string path;
+    std::map<string, string> headers;
+};
+
+struct Large {
+    Large() { ++g_alive; }
+    ~Large() { --g_alive; }
+    char data[Context::kInlineSize + 1];
+};
+
+struct Throwing {
+    Throwing() { throw std::runtime_error("ctor"); }
+};
+
+void testInline() {
+    static_assert(Context::isInline<ParserState>(), "ParserState should be stored inline");
+    static_assert(!Context::isInline<Large>(), "Large should be stored on heap");
+
+    Context context;
+    CHECK(context.empty());
+    CHECK(context.get<ParserState>() == NULL);
+
+    ParserState& state = context.emplace<ParserState>(3);
+    CHECK(g_alive == 1);
+    CHECK(!context.empty());
+    CHECK(context.is<ParserState>());
+    CHECK(context.get<ParserState>() == &state);
+    CHECK(static_cast<void*>(&state) >= static_cast<void*>(&context));
+    CHECK(static_cast<void*>(&state) < static_cast<void*>(&context + 1));
+    CHECK(context.get<int>() == NULL);
+    CHECK(context.get<Large>() == NULL);
+
+    state.path = "/index.html";
+    const Context& constContext = context;
+    CHECK(constContext.get<ParserState>()->state == 3);
+    CHECK(constContext.get<ParserState>()->path == "/index.html");
+
+    context.reset();
+    CHECK(context.empty());
+    CHECK(g_alive == 0);
+}
+
+void testHeap() {
+    {
+        Context context;
+        Large& large = context.emplace<Large>();
+        large.data[0] = 'x';
+        CHECK(g_alive == 1);
+        CHECK(context.get<Large>() == &large);
+        CHECK(static_cast<void*>(&large) != static_cast<void*>(&context));
+        // 换成另一种类型时先销毁原来的对象
+        context.emplace<ParserState>();
+        CHECK(g_alive == 1);
+        CHECK(context.get<Large>() == NULL);
+        CHECK(context.get<ParserState>() != NULL);
+    }
+    CHECK(g_alive == 0);
+}
+
+// 构造抛出异常后上下文为空
+void testException() {
+    Context context;
+    context.emplace<ParserState>(1);
+    bool thrown = false;
+    try {
+        context.emplace<Throwing>();
+    }
+    catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(context.empty());
+    CHECK(g_alive == 0);
+}
+
+int main() {
+    testInline();
+    testHeap();
+    testException();
+    printf("All tests passed\n");
+}
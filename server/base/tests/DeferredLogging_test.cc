@@ -0,0 +1,219 @@
+/**
+* @description: DeferredLogging_test.cc
+* @author: YQ Huang
+* @brief: 延迟格式化日志 测试函数
+* @date: 2026/10/18 15:48:03
+*/
+
+#include "server/base/AsyncRingLogging.h"
+#include "server/base/DeferredLogging.h"
+#include "server/base/FileUtil.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace myserver;
+
+std::string g_captured;
+
+void captureOutput(const char* msg, int len) {
+    g_captured.append(msg, len);
+}
+
+// 去掉时间和线程id 只留下 级别 正文 - 文件名:行号
+std::string stripPrefix(const std::string& line) {
+    // "20261018 15:48:03.123456Z  1234 INFO  ..."
+    CHECK(line.size() > 33);
+    CHECK(line[8] == ' ' && line[17] == '.' && line[24] == 'Z');
+    return line.substr(32);
+}
+
+std::string expectLine(const char* level, const char* body, int line) {
+    return std::string(level) + body + " - DeferredLogging_test.cc:" + std::to_string(line) + "\n";
+}
+
+// 没有设置AsyncRingLogging时 在调用线程上格式化 结果必须与snprintf相同
+#define CHECK_FORMAT(fmt, ...) \
+    do { \
+        char expect[1024]; \
+        snprintf(expect, sizeof expect, fmt, ##__VA_ARGS__); \
+        g_captured.clear(); \
+        LOGF_INFO(fmt, ##__VA_ARGS__); const int line = __LINE__; \
+        if(stripPrefix(g_captured) != expectLine("INFO  ", expect, line)) { \
+            fprintf(stderr, "got: %sexpect: %s\n", g_captured.c_str(), expect); \
+            abort(); \
+        } \
+    } while(0)
+
+void testFormat() {
+    Logger::setOutput(captureOutput);
+    int x = 42;
+    std::string str("string");
+    CHECK_FORMAT("no arguments");
+    CHECK_FORMAT("%d %i %u %x %X %o %%", -1, x, 7u, 255, 255, 8);
+    CHECK_FORMAT("%x %hx %hhx %lx", -1, -1, -1, -1L);
+    CHECK_FORMAT("%lld %llu %zu %ld", std::numeric_limits<long long>::min(),
+                 std::numeric_limits<unsigned long long>::max(), sizeof x, -123456789L);
+    CHECK_FORMAT("[%5d] [%-5d] [%05d] [%+d] [% d] [%*d] [%-*d]", 42, 42, 42, 42, 42, 6, x, 6, x);
+    CHECK_FORMAT("%g %.17g %e %.3f %10.2f %a", 0.1, 0.1, 12345.678, 3.14159, -2.5, 1.0);
+    CHECK_FORMAT("%s [%10s] [%-10s] [%.3s] [%.*s]", "abc", "right", "left", "truncate", 2, "xyz");
+    CHECK_FORMAT("%s %s", str.c_str(), "");
+    CHECK_FORMAT("%c%c%c %d", 'a', 'b', 99, 'A');
+    CHECK_FORMAT("%p %p", static_cast<void*>(&x), static_cast<const void*>(NULL));
+    CHECK_FORMAT("%d %d %d", static_cast<signed char>(-5), static_cast<short>(-300), true);
+
+    // TRACE和DEBUG与Logger一样带函数名
+    Logger::LogLevel old = Logger::logLevel();
+    Logger::setLogLevel(Logger::DEBUG);
+    g_captured.clear();
+    LOGF_DEBUG("debug %d", 1); const int line = __LINE__;
+    CHECK(stripPrefix(g_captured) == expectLine("DEBUG ", "testFormat debug 1", line));
+    Logger::setLogLevel(Logger::INFO);
+    g_captured.clear();
+    LOGF_DEBUG("filtered %d", 2);
+    CHECK(g_captured.empty());
+    Logger::setLogLevel(old);
+
+    // 过长的日志被截断 但仍以'\n'结尾
+    std::string big(10000, 'x');
+    g_captured.clear();
+    LOGF_WARN("%s", big.c_str());
+    CHECK(g_captured.size() == detail::kSmallBuffer);
+    CHECK(g_captured[g_captured.size() - 1] == '\n');
+}
+
+std::string readLogFiles(const char* pattern) {
+    glob_t result;
+    CHECK(::glob(pattern, 0, NULL, &result) == 0);
+    std::string all;
+    for(size_t i = 0; i < result.gl_pathc; ++i) {
+        std::string content;
+        CHECK(FileUtil::readFile(result.gl_pathv[i], 64 * 1024 * 1024, &content) == 0);
+        all += content;
+        ::unlink(result.gl_pathv[i]);
+    }
+    globfree(&result);
+    return all;
+}
+
+void collectLine(const char* line, int len, void* arg) {
+    static_cast<std::vector<std::string>*>(arg)->push_back(std::string(line, len));
+}
+
+std::vector<std::string> splitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    size_t start = 0;
+    size_t end;
+    while((end = text.find('\n', start)) != std::string::npos) {
+        lines.push_back(text.substr(start, end - start + 1));
+        start = end + 1;
+    }
+    return lines;
+}
+
+AsyncRingLogging* g_ringLog = NULL;
+
+void ringOutput(const char* msg, int len) {
+    g_ringLog->append(msg, len);
+}
+
+/**
+ * 经过AsyncRingLogging写文件 文本模式直接读文件 二进制模式用decodeBinaryLog()还原
+ * 两种方式得到的行必须相同
+ */
+std::vector<std::string> logThroughRing(bool binary, const char* basename) {
+    const int kThreads = 3;
+    const int kMessages = 2000;
+    AsyncRingLogging log(basename, 64 * 1024, 4 * 1024 * 1024, 1);
+    log.setBinary(binary);
+    log.start();
+    g_ringLog = &log;
+    setDeferredLogging(&log);
+    Logger::setOutput(ringOutput);
+
+    std::vector<std::unique_ptr<Thread> > threads;
+    for(int t = 0; t < kThreads; ++t) {
+        threads.emplace_back(new Thread([t]()
+        {
+            for(int i = 0; i < kMessages; ++i) {
+                LOGF_INFO("thread %d message %d %s %.2f", t, i, "payload", i / 4.0);
+                if(i % 100 == 0) {
+                    LOG_INFO << "text line " << t << ' ' << i;
+                }
+            }
+        }));
+        threads.back()->start();
+    }
+    for(auto& thr : threads) {
+        thr->join();
+    }
+    log.stop();
+    setDeferredLogging(NULL);
+    Logger::setOutput(captureOutput);
+    g_ringLog = NULL;
+    CHECK(log.droppedMessages() == 0);
+
+    std::string pattern(basename);
+    pattern += ".*.log";
+    std::string content = readLogFiles(pattern.c_str());
+    std::vector<std::string> lines;
+    if(binary) {
+        int64_t n = decodeBinaryLog(content.data(), content.size(), collectLine, &lines);
+        CHECK(n == static_cast<int64_t>(lines.size()));
+    }
+    else {
+        lines = splitLines(content);
+    }
+    CHECK(lines.size() == static_cast<size_t>(kThreads * (kMessages + kMessages / 100)));
+    return lines;
+}
+
+void testRing() {
+    std::vector<std::string> text = logThroughRing(false, "deferredlogging_test_text");
+    std::vector<std::string> binary = logThroughRing(true, "deferredlogging_test_binary");
+    CHECK(text.size() == binary.size());
+
+    // 每个线程的日志按顺序出现 内容正确
+    for(int pass = 0; pass < 2; ++pass) {
+        const std::vector<std::string>& lines = pass == 0 ? text : binary;
+        int next[3] = { 0, 0, 0 };
+        for(const auto& line : lines) {
+            int t = -1, i = -1;
+            if(sscanf(stripPrefix(line).c_str(), "INFO  thread %d message %d", &t, &i) == 2) {
+                CHECK(t >= 0 && t < 3 && i == next[t]);
+                char body[128];
+                snprintf(body, sizeof body, "thread %d message %d payload %.2f", t, i, i / 4.0);
+                CHECK(line.find(body) != std::string::npos);
+                ++next[t];
+            }
+            else {
+                CHECK(line.find("text line ") != std::string::npos);
+            }
+        }
+        CHECK(next[0] == 2000 && next[1] == 2000 && next[2] == 2000);
+    }
+}
+
+void testDecodeErrors() {
+    std::vector<std::string> lines;
+    CHECK(decodeBinaryLog("not a log", 9, collectLine, &lines) == -1);
+    std::string truncated(kBinaryLogMagic, sizeof kBinaryLogMagic);
+    truncated += "abc";
+    CHECK(decodeBinaryLog(truncated.data(), truncated.size(), collectLine, &lines) == -1);
+    CHECK(decodeBinaryLog(kBinaryLogMagic, sizeof kBinaryLogMagic, collectLine, &lines) == 0);
+    CHECK(lines.empty());
+}
+
+int main() {
+    testFormat();
+    testRing();
+    testDecodeErrors();
+    printf("All tests passed\n");
+}
@@ -0,0 +1,174 @@
+/**
+* @description: DirectAppendFile_test.cc
+* @author: YQ Huang
+* @brief: DirectAppendFile 测试函数
+* @date: 2026/10/18 19:26:40
+*/
+
+#include "server/base/FileUtil.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <string>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace myserver;
+
+std::string readAll(const char* name) {
+    std::string content;
+    FILE* fp = fopen(name, "rb");
+    CHECK(fp != NULL);
+    char buf[65536];
+    size_t n;
+    while((n = fread(buf, 1, sizeof buf, fp)) > 0) {
+        content.append(buf, n);
+    }
+    fclose(fp);
+    return content;
+}
+
+off_t fileSize(const char* name) {
+    struct stat st;
+    CHECK(stat(name, &st) == 0);
+    return st.st_size;
+}
+
+// 长度不规则的行 跨越多个缓冲区和块边界
+std::string makeLines(int seed, size_t size) {
+    std::string content;
+    char line[256];
+    for(int i = 0; content.size() < size; ++i) {
+        int n = snprintf(line, sizeof line, "20261018 19:26:40.%06d  %d INFO  line %d %.*s\n",
+                         i % 1000000, seed, i, (i * 7 + seed) % 97, "abcdefghijklmnopqrstuvwxyz"
+                         "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+        content.append(line, n);
+    }
+    return content;
+}
+
+/**
+ * flush之后文件以已写入的数据开头 后面最多是不足一块的补齐用的0
+ * 预分配的空间还在 说明没有截断
+ */
+void checkFlushed(const char* name, const std::string& expected) {
+    std::string content = readAll(name);
+    CHECK(content.size() >= expected.size());
+    CHECK(content.size() - expected.size() < FileUtil::DirectAppendFile::kBlockSize);
+    CHECK(content.compare(0, expected.size(), expected) == 0);
+    CHECK(content.find_first_not_of('\0', expected.size()) == std::string::npos);
+    struct stat st;
+    CHECK(stat(name, &st) == 0);
+    CHECK(st.st_blocks * 512 >= FileUtil::DirectAppendFile::kPreallocSize);
+}
+
+/**
+ * 写入超过kNumBuffers个缓冲区的数据 中途flush
+ * 析构后文件长度必须等于已写入的长度 不能带着补齐用的0
+ */
+void testAppendAndFlush() {
+    const char* name = "direct.log";
+    std::string expected;
+    {
+        FileUtil::DirectAppendFile file(name);
+        std::string a = makeLines(1, 5 * FileUtil::DirectAppendFile::kBufferSize + 123);
+        file.append(a.data(), a.size());
+        expected += a;
+        file.flush();
+        checkFlushed(name, expected);
+
+        // flush后继续写 补齐的0要被覆盖
+        for(int i = 0; i < 3; ++i) {
+            std::string b = makeLines(2 + i, 7777);
+            file.append(b.data(), b.size());
+            expected += b;
+            file.flush();
+            checkFlushed(name, expected);
+        }
+        // 没有新数据时flush什么也不做
+        file.flush();
+        checkFlushed(name, expected);
+        std::string c = makeLines(5, 3 * FileUtil::DirectAppendFile::kBufferSize);
+        file.append(c.data(), c.size());
+        expected += c;
+        CHECK(file.writtenBytes() == static_cast<off_t>(expected.size()));
+    }
+    CHECK(fileSize(name) == static_cast<off_t>(expected.size()));
+    CHECK(readAll(name) == expected);
+
+    // 重新打开 从原来的末尾接着写
+    {
+        FileUtil::DirectAppendFile file(name);
+        std::string d = makeLines(6, 100000);
+        file.append(d.data(), d.size());
+        expected += d;
+    }
+    CHECK(readAll(name) == expected);
+    unlink(name);
+}
+
+// 长度恰好是缓冲区整数倍时 析构后不能留下预分配的空间
+void testExactBuffer() {
+    const char* name = "exact.log";
+    const size_t kSize = 2 * FileUtil::DirectAppendFile::kBufferSize;
+    std::string content(kSize, 'x');
+    {
+        FileUtil::DirectAppendFile file(name);
+        file.append(content.data(), content.size());
+    }
+    struct stat st;
+    CHECK(stat(name, &st) == 0);
+    CHECK(st.st_size == static_cast<off_t>(kSize));
+    CHECK(st.st_blocks * 512 <= static_cast<off_t>(kSize) + 64 * 1024);
+    CHECK(readAll(name) == content);
+    unlink(name);
+}
+
+/**
+ * 用RLIMIT_FSIZE让第一块的异步写只写了一半 恢复限制后再写满kNumBuffers块
+ * 最后一次换缓冲区时等到第一块的完成事件 剩下的一半必须补写在第一块原来的位置
+ */
+void testShortWrite() {
+    const char* name = "short.log";
+    const size_t kBuffer = FileUtil::DirectAppendFile::kBufferSize;
+    const int kNumBuffers = FileUtil::DirectAppendFile::kNumBuffers;
+    std::string content = makeLines(7, kNumBuffers * kBuffer + 100);
+    {
+        FileUtil::DirectAppendFile file(name);
+        if(!file.asyncIO()) {
+            printf("io_uring not available, skip testShortWrite\n");
+            unlink(name);
+            return;
+        }
+        struct rlimit old;
+        CHECK(getrlimit(RLIMIT_FSIZE, &old) == 0);
+        struct rlimit limit = old;
+        limit.rlim_cur = kBuffer / 2;
+        signal(SIGXFSZ, SIG_IGN);
+        CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+        file.append(content.data(), kBuffer);
+        usleep(100 * 1000);     // 等内核执行这次写
+        CHECK(setrlimit(RLIMIT_FSIZE, &old) == 0);
+        file.append(content.data() + kBuffer, content.size() - kBuffer);
+    }
+    CHECK(fileSize(name) == static_cast<off_t>(content.size()));
+    CHECK(readAll(name) == content);
+    unlink(name);
+}
+
+int main() {
+    char dir[] = "/tmp/directappendfile_test.XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    CHECK(chdir(dir) == 0);
+
+    testAppendAndFlush();
+    testExactBuffer();
+    testShortWrite();
+
+    CHECK(chdir("/") == 0);
+    CHECK(rmdir(dir) == 0);
+    printf("All tests passed\n");
+}
@@ -0,0 +1,229 @@
+/**
+* @description: FlightRecorder_test.cc
+* @author: YQ Huang
+* @brief: 飞行记录仪 测试函数
+* @date: 2026/10/18 20:58:33
+*/
+
+#include "server/base/DeferredLogging.h"
+#include "server/base/FileUtil.h"
+#include "server/base/FlightRecorder.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace myserver;
+
+void discardOutput(const char*, int) {
+}
+
+void collectLine(const char* line, int len, void* arg) {
+    static_cast<std::vector<std::string>*>(arg)->push_back(std::string(line, len));
+}
+
+std::vector<std::string> decodeFile(const char* name) {
+    std::string content;
+    CHECK(FileUtil::readFile(name, 64 * 1024 * 1024, &content) == 0);
+    std::vector<std::string> lines;
+    CHECK(decodeBinaryLog(content.data(), content.size(), collectLine, &lines) >= 0);
+    return lines;
+}
+
+std::vector<std::string> dumpAndDecode() {
+    const char* name = "flight.dump";
+    int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CHECK(fd >= 0);
+    FlightRecorder::dump(fd);
+    close(fd);
+    std::vector<std::string> lines = decodeFile(name);
+    unlink(name);
+    return lines;
+}
+
+bool contains(const std::vector<std::string>& lines, const std::string& s) {
+    for(const auto& line : lines) {
+        if(line.find(s) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 级别是INFO 没打开的LOGF_DEBUG也要记下来 已经输出的LOG_INFO原样保留
+ * 缓冲区写满后只剩最近的记录 并且按写入的顺序
+ */
+void testRecordAndWrap() {
+    for(int i = 0; i < 2000; ++i) {
+        LOGF_DEBUG("debug %d %s", i, "flight");
+        if(i % 100 == 0) {
+            LOG_INFO << "info " << i;
+        }
+    }
+    std::vector<std::string> lines = dumpAndDecode();
+    CHECK(!lines.empty());
+    CHECK(lines.size() < 2000);
+    CHECK(lines.back().find("DEBUG testRecordAndWrap debug 1999 flight - FlightRecorder_test.cc:") != std::string::npos);
+    CHECK(contains(lines, "INFO  info 1900 - FlightRecorder_test.cc:"));
+    CHECK(!contains(lines, "debug 0 flight"));
+
+    int last = -1;
+    for(const auto& line : lines) {
+        size_t pos = line.find("debug ");
+        if(pos != std::string::npos) {
+            int n = atoi(line.c_str() + pos + 6);
+            CHECK(n == last + 1 || last == -1);
+            last = n;
+        }
+    }
+    CHECK(last == 1999);
+}
+
+std::string g_output;
+
+void captureOutput(const char* msg, int len) {
+    g_output.append(msg, len);
+}
+
+// 级别是INFO 普通的LOG_DEBUG/LOG_TRACE只进飞行记录仪 不输出
+void testPlainMacros() {
+    g_output.clear();
+    Logger::setOutput(captureOutput);
+    LOG_DEBUG << "plain debug " << 7;
+    LOG_TRACE << "plain trace " << 8;
+    LOG_INFO << "plain info";
+    Logger::setOutput(discardOutput);
+
+    CHECK(g_output.find("plain debug") == std::string::npos);
+    CHECK(g_output.find("plain trace") == std::string::npos);
+    CHECK(g_output.find("plain info") != std::string::npos);
+    std::vector<std::string> lines = dumpAndDecode();
+    CHECK(contains(lines, "DEBUG testPlainMacros plain debug 7 - FlightRecorder_test.cc:"));
+    CHECK(contains(lines, "TRACE testPlainMacros plain trace 8 - FlightRecorder_test.cc:"));
+
+    // 记录仪关掉以后 没打开的级别什么也不做
+    FlightRecorder::disable();
+    LOG_DEBUG << "after disable";
+    FlightRecorder::enable(16 * 1024);
+    CHECK(!contains(dumpAndDecode(), "after disable"));
+}
+
+// 已经退出的线程的记录也在
+void testExitedThread() {
+    Thread thread([] { LOGF_TRACE("from worker %d", 42); }, "worker");
+    thread.start();
+    thread.join();
+    CHECK(contains(dumpAndDecode(), "from worker 42"));
+}
+
+/**
+ * 子进程崩溃 检查崩溃记录文件 returnSignal是子进程被哪个信号结束的
+ */
+std::vector<std::string> runCrash(void (*crash)(), int* returnSignal) {
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if(pid == 0) {
+        // 不生成core
+        signal(SIGABRT, SIG_DFL);
+        FlightRecorder::installCrashHandler("flight_test");
+        LOGF_DEBUG("before crash %s", "in child");
+        crash();
+        _exit(0);
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFSIGNALED(status));
+    *returnSignal = WTERMSIG(status);
+
+    char name[64];
+    snprintf(name, sizeof name, "flight_test.%d.crash", pid);
+    std::vector<std::string> lines = decodeFile(name);
+    unlink(name);
+    return lines;
+}
+
+void segfault() {
+    *static_cast<volatile int*>(NULL) = 1;
+}
+
+void logFatal() {
+    LOG_FATAL << "fatal in child";
+}
+
+// 每层占1KB 调用之后还要用到buf 不会被优化成循环
+int recurse(int depth) {
+    volatile char buf[1024];
+    buf[0] = static_cast<char>(depth);
+    if(depth < 0) {
+        return 0;
+    }
+    return recurse(depth + 1) + buf[0];
+}
+
+void stackOverflow() {
+    recurse(0);
+}
+
+// 注册了缓冲区的线程也有备用信号栈
+void stackOverflowInThread() {
+    Thread thread([] {
+        LOGF_DEBUG("overflow in %s", "worker");
+        recurse(0);
+    }, "overflow");
+    thread.start();
+    thread.join();
+}
+
+void testCrash() {
+    int sig = 0;
+    std::vector<std::string> lines = runCrash(segfault, &sig);
+    CHECK(sig == SIGSEGV);
+    CHECK(contains(lines, "before crash in child"));
+    CHECK(contains(lines, "crash: SIGSEGV (11) addr 0x0"));
+    CHECK(contains(lines, "segfault"));
+
+    lines = runCrash(logFatal, &sig);
+    CHECK(sig == SIGABRT);
+    CHECK(contains(lines, "before crash in child"));
+    CHECK(contains(lines, "FATAL fatal in child"));
+    // LOG_FATAL记录的已经demangle的调用栈
+    CHECK(contains(lines, "logFatal()"));
+    CHECK(contains(lines, "crash: SIGABRT (6)"));
+
+    // 栈溢出时信号处理函数运行在备用栈上
+    lines = runCrash(stackOverflow, &sig);
+    CHECK(sig == SIGSEGV);
+    CHECK(contains(lines, "crash: SIGSEGV (11)"));
+
+    lines = runCrash(stackOverflowInThread, &sig);
+    CHECK(sig == SIGSEGV);
+    CHECK(contains(lines, "overflow in worker"));
+    CHECK(contains(lines, "crash: SIGSEGV (11)"));
+}
+
+int main() {
+    char dir[] = "/tmp/flightrecorder_test.XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    CHECK(chdir(dir) == 0);
+
+    Logger::setOutput(discardOutput);
+    Logger::setLogLevel(Logger::INFO);
+    FlightRecorder::enable(16 * 1024);
+
+    testRecordAndWrap();
+    testExitedThread();
+    testPlainMacros();
+    testCrash();
+
+    CHECK(chdir("/") == 0);
+    CHECK(rmdir(dir) == 0);
+    printf("All tests passed\n");
+}
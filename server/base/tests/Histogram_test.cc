@@ -0,0 +1,79 @@
+/**
+* @description: Histogram_test.cc
+* @author: YQ Huang
+* @brief: 对数线性直方图 测试函数
+* @date: 2026/10/18 22:18:09
+*/
+
+#include "server/base/Histogram.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace myserver;
+
+// 每个值都落在自己的桶里 相邻的桶首尾相接
+void testBuckets() {
+    for(uint64_t v = 0; v < 100000; ++v) {
+        int index = Histogram::bucketIndex(v);
+        CHECK(Histogram::bucketLowerBound(index) <= v);
+        CHECK(v <= Histogram::bucketUpperBound(index));
+    }
+    for(int i = 1; i < Histogram::kNumBuckets; ++i) {
+        CHECK(Histogram::bucketLowerBound(i) == Histogram::bucketUpperBound(i - 1) + 1);
+    }
+    CHECK(Histogram::bucketIndex(~static_cast<uint64_t>(0)) == Histogram::kNumBuckets - 1);
+    CHECK(Histogram::bucketUpperBound(Histogram::kNumBuckets - 1) == ~static_cast<uint64_t>(0));
+}
+
+// 相对误差不超过1/kSubBuckets
+void testPercentile() {
+    Histogram hist;
+    CHECK(hist.snapshot().percentile(50) == 0);
+    for(int64_t v = 1; v <= 10000; ++v) {
+        hist.record(v);
+    }
+    hist.record(-5);
+    HistogramSnapshot snap = hist.snapshot();
+    CHECK(snap.count() == 10001);
+    CHECK(snap.max() == 10000);
+    CHECK(snap.sum() == 10000 * 10001 / 2);
+    uint64_t p50 = snap.percentile(50);
+    CHECK(p50 >= 5000 && p50 <= 5000 + 5000 / Histogram::kSubBuckets);
+    uint64_t p99 = snap.percentile(99);
+    CHECK(p99 >= 9900 && p99 <= 10000);
+    CHECK(snap.percentile(100) == 10000);
+    CHECK(snap.percentile(0) == 0);
+
+    hist.reset();
+    CHECK(hist.count() == 0);
+    CHECK(hist.snapshot().max() == 0);
+}
+
+// 每个线程写自己的直方图 读端合并
+void testMerge() {
+    Histogram a;
+    Histogram b;
+    Thread t1([&a] { for(int i = 0; i < 100000; ++i) a.record(100); }, "a");
+    Thread t2([&b] { for(int i = 0; i < 100000; ++i) b.record(1000000); }, "b");
+    t1.start();
+    t2.start();
+    t1.join();
+    t2.join();
+    HistogramSnapshot snap = a.snapshot();
+    snap.merge(b.snapshot());
+    CHECK(snap.count() == 200000);
+    CHECK(snap.max() == 1000000);
+    CHECK(snap.percentile(50) >= 100 && snap.percentile(50) < 112);
+    CHECK(snap.percentile(51) >= 1000000);
+    printf("%s\n", snap.toString().c_str());
+}
+
+int main() {
+    testBuckets();
+    testPercentile();
+    testMerge();
+    printf("All tests passed\n");
+}
@@ -0,0 +1,177 @@
+/**
+* @description: LogArchiver_test.cc
+* @author: YQ Huang
+* @brief: 日志文件后台压缩和保留策略 测试函数
+* @date: 2026/10/18 18:31:07
+*/
+
+#include "server/base/CurrentThread.h"
+#include "server/base/FileUtil.h"
+#include "server/base/LogArchiver.h"
+#include "server/base/LogFile.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <zlib.h>
+
+using namespace myserver;
+
+std::vector<std::string> listFiles() {
+    std::vector<std::string> names;
+    DIR* dir = opendir(".");
+    CHECK(dir != NULL);
+    while(struct dirent* ent = readdir(dir)) {
+        if(ent->d_name[0] != '.') {
+            names.push_back(ent->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+void writeFile(const std::string& name, const std::string& content) {
+    FILE* fp = fopen(name.c_str(), "w");
+    CHECK(fp != NULL);
+    CHECK(fwrite(content.data(), 1, content.size(), fp) == content.size());
+    fclose(fp);
+}
+
+std::string gunzip(const std::string& name) {
+    gzFile gz = gzopen(name.c_str(), "rb");
+    CHECK(gz != NULL);
+    std::string content;
+    char buf[8192];
+    int n;
+    while((n = gzread(gz, buf, sizeof buf)) > 0) {
+        content.append(buf, n);
+    }
+    CHECK(n == 0);
+    gzclose(gz);
+    return content;
+}
+
+std::string makeContent(int seed, size_t size) {
+    std::string content;
+    char line[128];
+    for(int i = 0; content.size() < size; ++i) {
+        snprintf(line, sizeof line, "20261018 18:31:07.%06d  1234 INFO  message %d of file %d\n", i % 1000000, i, seed);
+        content += line;
+    }
+    return content;
+}
+
+// 直接提交文件 检查压缩结果和按个数保留
+void testCompressAndRetention() {
+    std::vector<std::string> contents;
+    {
+        LogArchiver archiver("arch", 3, 0);
+        archiver.start();
+        for(int i = 0; i < 5; ++i) {
+            char name[64];
+            snprintf(name, sizeof name, "arch.20261018-18310%d.host.1.log", i);
+            contents.push_back(makeContent(i, 200 * 1000 + i));
+            writeFile(name, contents.back());
+            archiver.archive(std::unique_ptr<FileUtil::WritableFile>(), name);
+        }
+        // 不属于这个basename的文件 和比最新归档文件更新的文件(正在写) 都不能删
+        writeFile("other.20261018-183100.host.1.log", "x");
+        writeFile("arch.20261018-183109.host.1.log", "current");
+        archiver.stop();
+        CHECK(archiver.compressedFiles() == 5);
+        CHECK(archiver.removedFiles() == 2);
+    }
+
+    std::vector<std::string> files = listFiles();
+    CHECK(files.size() == 5);
+    CHECK(files[0] == "arch.20261018-183102.host.1.log.gz");
+    CHECK(files[1] == "arch.20261018-183103.host.1.log.gz");
+    CHECK(files[2] == "arch.20261018-183104.host.1.log.gz");
+    CHECK(files[3] == "arch.20261018-183109.host.1.log");
+    CHECK(files[4] == "other.20261018-183100.host.1.log");
+    for(int i = 2; i < 5; ++i) {
+        CHECK(gunzip(files[i - 2]) == contents[i]);
+    }
+    for(const auto& f : files) {
+        unlink(f.c_str());
+    }
+}
+
+// 按总字节数保留 不压缩
+void testRetentionByBytes() {
+    {
+        LogArchiver archiver("bytes", 0, 250, 0);
+        archiver.start();
+        for(int i = 0; i < 4; ++i) {
+            char name[64];
+            snprintf(name, sizeof name, "bytes.20261018-18310%d.host.1.log", i);
+            writeFile(name, std::string(100, 'a'));
+            archiver.archive(std::unique_ptr<FileUtil::WritableFile>(), name);
+        }
+        archiver.stop();
+        CHECK(archiver.compressedFiles() == 0);
+        CHECK(archiver.removedFiles() == 2);
+    }
+    std::vector<std::string> files = listFiles();
+    CHECK(files.size() == 2);
+    CHECK(files[0] == "bytes.20261018-183102.host.1.log");
+    CHECK(files[1] == "bytes.20261018-183103.host.1.log");
+    for(const auto& f : files) {
+        unlink(f.c_str());
+    }
+}
+
+/**
+ * 通过LogFile滚动 旧文件没有关闭就交给了archiver
+ * 压缩后的内容必须包含滚动前写入的全部日志
+ */
+void testLogFileRoll() {
+    const off_t kRollSize = 64 * 1024;
+    LogArchiver archiver("roll", 0, 0);
+    archiver.start();
+    std::string written;
+    {
+        LogFile file("roll", kRollSize, false);
+        file.setArchiver(&archiver);
+        // LogFile每秒最多滚动一次
+        CurrentThread::sleepUsec(1100 * 1000);
+        std::string content = makeContent(7, kRollSize);
+        file.append(content.data(), static_cast<int>(content.size()));
+        written = content;
+        CHECK(file.rollCount() == 2);
+        file.append("after roll\n", 11);
+    }
+    archiver.stop();
+    CHECK(archiver.compressedFiles() == 1);
+
+    std::vector<std::string> files = listFiles();
+    CHECK(files.size() == 2);
+    CHECK(files[0].find(".log.gz") != std::string::npos);
+    CHECK(gunzip(files[0]) == written);
+    std::string current;
+    CHECK(FileUtil::readFile(files[1], 1024, &current) == 0);
+    CHECK(current == "after roll\n");
+    for(const auto& f : files) {
+        unlink(f.c_str());
+    }
+}
+
+int main() {
+    char dir[] = "/tmp/logarchiver_test.XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    CHECK(chdir(dir) == 0);
+
+    testCompressAndRetention();
+    testRetentionByBytes();
+    testLogFileRoll();
+
+    CHECK(chdir("/") == 0);
+    CHECK(rmdir(dir) == 0);
+    printf("All tests passed\n");
+}
@@ -0,0 +1,37 @@
+/**
+* @description: LogDecoder.cc
+* @author: YQ Huang
+* @brief: 把AsyncRingLogging写的二进制日志还原成文本
+* @date: 2026/10/18 16:20:37
+*/
+
+#include "server/base/DeferredLogging.h"
+#include "server/base/FileUtil.h"
+
+#include <stdio.h>
+
+using namespace myserver;
+
+void printLine(const char* line, int len, void*) {
+    fwrite(line, 1, len, stdout);
+}
+
+// 用法: logdecoder file...
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s binary_log_file...\n", argv[0]);
+        return 1;
+    }
+    for(int i = 1; i < argc; ++i) {
+        string content;
+        int err = FileUtil::readFile(argv[i], 1024 * 1024 * 1024, &content);
+        if(err != 0) {
+            fprintf(stderr, "%s: %s\n", argv[i], strerror_tl(err));
+            return 1;
+        }
+        if(decodeBinaryLog(content.data(), content.size(), printLine, NULL) < 0) {
+            fprintf(stderr, "%s: bad binary log\n", argv[i]);
+            return 1;
+        }
+    }
+}
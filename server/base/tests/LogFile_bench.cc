@@ -0,0 +1,91 @@
+/**
+* @description: LogFile_bench.cc
+* @author: YQ Huang
+* @brief: LogFile::append在滚动前后的延迟 对比滚动时同步关闭文件和交给LogArchiver
+* @date: 2026/10/18 18:55:12
+*/
+
+#include "server/base/LogArchiver.h"
+#include "server/base/LogFile.h"
+#include "server/base/Timestamp.h"
+
+#include <algorithm>
+#include <vector>
+#include <glob.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace myserver;
+
+int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * 连续写seconds秒 每秒滚动一次(LogFile每秒最多滚动一次 rollSize设得很小)
+ * 统计每次append的耗时 滚动那一次的append包含了关闭旧文件和打开新文件
+ */
+void bench(const char* name, LogArchiver* archiver, int seconds) {
+    const off_t kRollSize = 16 * 1024 * 1024;
+    char line[128];
+    int len = snprintf(line, sizeof line,
+                       "20261018 18:55:12.123456  1234 INFO  Hello 0123456789 abcdefghijklmnopqrstuvwxyz\n");
+
+    std::vector<int64_t> latencies;
+    latencies.reserve(8 * 1000 * 1000);
+    int64_t rollMax = 0;
+    int rolls = 0;
+    {
+        LogFile file("logfile_bench", kRollSize, false);
+        file.setArchiver(archiver);
+        int64_t deadline = nowNanos() + static_cast<int64_t>(seconds) * 1000000000;
+        int rollCount = file.rollCount();
+        int64_t start;
+        while((start = nowNanos()) < deadline) {
+            file.append(line, len);
+            int64_t elapsed = nowNanos() - start;
+            latencies.push_back(elapsed);
+            if(file.rollCount() != rollCount) {
+                rollCount = file.rollCount();
+                rollMax = std::max(rollMax, elapsed);
+                ++rolls;
+            }
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t n = latencies.size();
+    printf("%-12s appends %8zu rolls %d  p50 %5lld ns  p99 %6lld ns  p99.99 %8lld ns  max %9lld ns  roll max %9lld ns\n",
+           name, n, rolls,
+           static_cast<long long>(latencies[n / 2]),
+           static_cast<long long>(latencies[n * 99 / 100]),
+           static_cast<long long>(latencies[n * 9999 / 10000]),
+           static_cast<long long>(latencies[n - 1]),
+           static_cast<long long>(rollMax));
+}
+
+int main() {
+    // 只保留最近2个文件 避免把磁盘写满
+    bench("sync close", NULL, 3);
+    {
+        LogArchiver archiver("logfile_bench", 2, 0, 0);
+        archiver.start();
+        bench("archiver", &archiver, 3);
+    }
+    {
+        LogArchiver archiver("logfile_bench", 2, 0, 6);
+        archiver.start();
+        bench("archiver+gz", &archiver, 3);
+    }
+
+    glob_t files;
+    if(glob("logfile_bench.*", 0, NULL, &files) == 0) {
+        for(size_t i = 0; i < files.gl_pathc; ++i) {
+            unlink(files.gl_pathv[i]);
+        }
+        globfree(&files);
+    }
+}
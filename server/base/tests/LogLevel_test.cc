@@ -0,0 +1,158 @@
+/**
+* @description: LogLevel_test.cc
+* @author: YQ Huang
+* @brief: 编译期日志级别和模块日志级别 测试函数
+* @date: 2026/10/18 17:02:44
+*/
+
+// 这个文件中的LOG_TRACE在编译期就被去掉
+#undef MYSERVER_LOG_MIN_LEVEL
+#define MYSERVER_LOG_MIN_LEVEL 1
+
+#include "server/base/DeferredLogging.h"
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace myserver;
+
+std::string g_captured;
+
+void captureOutput(const char* msg, int len) {
+    g_captured.append(msg, len);
+}
+
+// 每个级别写一条日志 返回输出了哪些级别 第i位对应级别i
+// 同一组调用点反复执行 检查缓存的级别会随设置更新
+int logAllLevels() {
+    int mask = 0;
+    const char* names[] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR" };
+    g_captured.clear();
+    LOG_TRACE << "trace";
+    LOG_DEBUG << "debug";
+    LOG_INFO << "info";
+    LOG_WARN << "warn";
+    LOG_ERROR << "error";
+    for(int i = 0; i < 5; ++i) {
+        if(g_captured.find(names[i]) != std::string::npos) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+int logfAllLevels() {
+    int mask = 0;
+    const char* names[] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR" };
+    g_captured.clear();
+    LOGF_TRACE("trace %d", 0);
+    LOGF_DEBUG("debug %d", 1);
+    LOGF_INFO("info %d", 2);
+    LOGF_WARN("warn %d", 3);
+    LOGF_ERROR("error %d", 4);
+    for(int i = 0; i < 5; ++i) {
+        if(g_captured.find(names[i]) != std::string::npos) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+const int kTrace = 1, kDebug = 2, kInfo = 4, kWarn = 8, kError = 16;
+
+// 宏放在没有大括号的if里 后面的else必须属于外层的if
+bool warnOrElse(bool cond) {
+    bool elseTaken = false;
+    if(cond)
+        LOG_WARN << "warn";
+    else
+        elseTaken = true;
+    return elseTaken;
+}
+
+bool debugEnabled() {
+    return MYSERVER_LOG_ENABLED(Logger::DEBUG);
+}
+
+/**
+ * 几个线程反复执行同一个调用点 同时修改模块级别
+ * 停下来之后 调用点缓存的级别必须是最后一次设置的 不能是新的generation配旧的级别
+ */
+void testConcurrentResolve() {
+    const int kThreads = 4;
+    std::atomic<bool> stop(false);
+    std::vector<std::unique_ptr<Thread> > threads;
+    for(int i = 0; i < kThreads; ++i) {
+        threads.emplace_back(new Thread([&stop] {
+            while(!stop) {
+                debugEnabled();
+            }
+        }));
+        threads.back()->start();
+    }
+    for(int i = 0; i < 20000; ++i) {
+        Logger::setModuleLogLevel("LogLevel_test", i % 2 ? Logger::DEBUG : Logger::INFO);
+        CHECK(debugEnabled() == (i % 2 == 1));
+    }
+    stop = true;
+    for(auto& thread : threads) {
+        thread->join();
+    }
+    CHECK(debugEnabled());
+    Logger::clearModuleLogLevels();
+    CHECK(!debugEnabled());
+}
+
+int main() {
+    Logger::setOutput(captureOutput);
+    CHECK(Logger::logLevel() == Logger::INFO);
+
+    // ctest设置了SERVER_LOG_MODULES=LogLevel_test=WARN,bad_item
+    const char* env = getenv("SERVER_LOG_MODULES");
+    if(env && std::string(env).find("LogLevel_test=WARN") != std::string::npos) {
+        CHECK(logAllLevels() == (kWarn | kError));
+    }
+
+    Logger::clearModuleLogLevels();
+    CHECK(logAllLevels() == (kInfo | kWarn | kError));
+    CHECK(logfAllLevels() == (kInfo | kWarn | kError));
+
+    // 只打开这个模块的DEBUG TRACE在编译期已经去掉了
+    Logger::setModuleLogLevel("LogLevel_test", Logger::TRACE);
+    CHECK(logAllLevels() == (kDebug | kInfo | kWarn | kError));
+    CHECK(logfAllLevels() == (kDebug | kInfo | kWarn | kError));
+
+    // 别的模块不影响这个模块
+    Logger::clearModuleLogLevels();
+    Logger::setModuleLogLevel("TcpConnection", Logger::TRACE);
+    CHECK(logAllLevels() == (kInfo | kWarn | kError));
+
+    // 全局级别对WARN和ERROR也生效
+    Logger::setLogLevel(Logger::ERROR);
+    CHECK(logAllLevels() == kError);
+
+    // 模块级别优先于全局级别
+    Logger::setModuleLogLevel("LogLevel_test", Logger::INFO);
+    CHECK(logAllLevels() == (kInfo | kWarn | kError));
+
+    Logger::clearModuleLogLevels();
+    Logger::setLogLevel(Logger::INFO);
+    CHECK(logAllLevels() == (kInfo | kWarn | kError));
+
+    Logger::setLogLevel(Logger::ERROR);
+    CHECK(!warnOrElse(true));
+    CHECK(warnOrElse(false));
+    Logger::setLogLevel(Logger::INFO);
+    CHECK(!warnOrElse(true));
+    CHECK(warnOrElse(false));
+
+    testConcurrentResolve();
+    printf("All tests passed\n");
+}
@@ -5,9 +5,19 @@
 * @date: 2022/05/01 20:31:59
 */
 
+#include "server/base/AsyncLogging.h"
+#include "server/base/AsyncRingLogging.h"
+#include "server/base/DeferredLogging.h"
+#include "server/base/FlightRecorder.h"
+#include "server/base/LogFile.h"
+#include "server/base/Logging.h"
 #include "server/base/LogStream.h"
+#include "server/base/StructuredLogging.h"
+#include "server/base/Thread.h"
 #include "server/base/Timestamp.h"
 
+#include <memory>
+#include <vector>
 #include <stdio.h>
 #include <sstream>
 #define __STDC_FORMAT_MACROS
@@ -19,6 +29,10 @@ const size_t N = 1000000;
 
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 
+void report(const char* name, double seconds) {
+    printf("%-18s %f s %6.1f ns/op\n", name, seconds, seconds * 1e9 / N);
+}
+
 // printf
 template<typename T>
 void benchPrintf(const char* fmt) {
@@ -28,7 +42,7 @@ void benchPrintf(const char* fmt) {
         snprintf(buf, sizeof buf, fmt, (T)(i));
     }
     Timestamp end(Timestamp::now());
-    printf("benchPrintf %f\n", timeDifference(end, start));
+    report("benchPrintf", timeDifference(end, start));
 }
 
 // StringStream
@@ -41,7 +55,7 @@ void benchStringStream() {
         os.seekp(0, std::ios_base::beg);
     }
     Timestamp end(Timestamp::now());
-    printf("benchStringStream %f\n", timeDifference(end, start));
+    report("benchStringStream", timeDifference(end, start));
 }
 
 // LogStream
@@ -54,7 +68,190 @@ void benchLogStream() {
         os.resetBuffer();
     }
     Timestamp end(Timestamp::now());
-    printf("benchLogStream %f\n", timeDifference(end, start));
+    report("benchLogStream", timeDifference(end, start));
+}
+
+/**
+ * 上面的浮点数都是整数 这里用i/7.0这种需要17位有效数字的值
+ * 对比snprintf("%.17g")和LogStream的最短表示
+ */
+void benchDoubleDigits() {
+    char buf[32];
+    Timestamp start(Timestamp::now());
+    for(size_t i = 0; i < N; ++i) {
+        snprintf(buf, sizeof buf, "%.17g", static_cast<double>(i) / 7.0);
+    }
+    Timestamp end(Timestamp::now());
+    report("benchPrintf", timeDifference(end, start));
+
+    myserver::LogStream os;
+    start = Timestamp::now();
+    for(size_t i = 0; i < N; ++i) {
+        os << static_cast<double>(i) / 7.0;
+        os.resetBuffer();
+    }
+    end = Timestamp::now();
+    report("benchLogStream", timeDifference(end, start));
+}
+
+/**
+ * 多线程竞争下的日志吞吐量
+ * nThreads个线程同时调用LOG_INFO 分别输出到同步的LogFile 异步的AsyncLogging和AsyncRingLogging
+ */
+std::unique_ptr<LogFile> g_logFile;
+std::unique_ptr<AsyncLogging> g_asyncLog;
+std::unique_ptr<AsyncRingLogging> g_ringLog;
+
+void syncOutput(const char* msg, int len) {
+    g_logFile->append(msg, len);
+}
+
+void asyncOutput(const char* msg, int len) {
+    g_asyncLog->append(msg, len);
+}
+
+void ringOutput(const char* msg, int len) {
+    g_ringLog->append(msg, len);
+}
+
+double logInThreads(int nThreads, int kMessages) {
+    std::vector<std::unique_ptr<Thread> > threads;
+    const int perThread = kMessages / nThreads;
+    for(int i = 0; i < nThreads; ++i) {
+        threads.emplace_back(new Thread([perThread]()
+        {
+            for(int n = 0; n < perThread; ++n) {
+                LOG_INFO << "Hello 0123456789 abcdefghijklmnopqrstuvwxyz " << n;
+            }
+        }));
+    }
+    Timestamp start(Timestamp::now());
+    for(auto& thr : threads) {
+        thr->start();
+    }
+    for(auto& thr : threads) {
+        thr->join();
+    }
+    return timeDifference(Timestamp::now(), start);
+}
+
+void benchContention(int nThreads) {
+    const int kMessages = 1000 * 1000;
+    const off_t kRollSize = 500 * 1000 * 1000;
+
+    g_logFile.reset(new LogFile("logstream_bench_sync", kRollSize, true));
+    Logger::setOutput(syncOutput);
+    double seconds = logInThreads(nThreads, kMessages);
+    printf("LogFile      %2d threads %12.0f msg/s\n", nThreads, kMessages / seconds);
+    g_logFile.reset();
+
+    g_asyncLog.reset(new AsyncLogging("logstream_bench_async", kRollSize));
+    g_asyncLog->start();
+    Logger::setOutput(asyncOutput);
+    seconds = logInThreads(nThreads, kMessages);
+    printf("AsyncLogging %2d threads %12.0f msg/s, dropped %lld\n", nThreads, kMessages / seconds,
+           static_cast<long long>(g_asyncLog->droppedMessages()));
+    g_asyncLog->stop();
+    g_asyncLog.reset();
+
+    g_ringLog.reset(new AsyncRingLogging("logstream_bench_ring", kRollSize));
+    g_ringLog->start();
+    Logger::setOutput(ringOutput);
+    seconds = logInThreads(nThreads, kMessages);
+    printf("AsyncRing    %2d threads %12.0f msg/s, dropped %lld\n", nThreads, kMessages / seconds,
+           static_cast<long long>(g_ringLog->droppedMessages()));
+    g_ringLog->stop();
+    g_ringLog.reset();
+}
+
+/**
+ * 前端每条日志的耗时 LOG_INFO在调用线程上格式化 LOGF_INFO只拷贝参数
+ * 缓冲区足够大 整个测试过程中不会丢日志
+ */
+void benchDeferred() {
+    const int kMessages = 200 * 1000;
+    g_ringLog.reset(new AsyncRingLogging("logstream_bench_deferred", 500 * 1000 * 1000, 64 * 1024 * 1024));
+    g_ringLog->start();
+    Logger::setOutput(ringOutput);
+    setDeferredLogging(g_ringLog.get());
+
+    Timestamp start(Timestamp::now());
+    for(int n = 0; n < kMessages; ++n) {
+        LOG_INFO << "Hello 0123456789 abcdefghijklmnopqrstuvwxyz " << n << ' ' << 3.14;
+    }
+    double logSeconds = timeDifference(Timestamp::now(), start);
+    CurrentThread::sleepUsec(500 * 1000);
+
+    start = Timestamp::now();
+    for(int n = 0; n < kMessages; ++n) {
+        LOGF_INFO("Hello 0123456789 abcdefghijklmnopqrstuvwxyz %d %g", n, 3.14);
+    }
+    double logfSeconds = timeDifference(Timestamp::now(), start);
+
+    printf("LOG_INFO  %6.1f ns/msg\n", logSeconds * 1e9 / kMessages);
+    printf("LOGF_INFO %6.1f ns/msg, dropped %lld\n", logfSeconds * 1e9 / kMessages,
+           static_cast<long long>(g_ringLog->droppedMessages()));
+    setDeferredLogging(NULL);
+    g_ringLog->stop();
+    g_ringLog.reset();
+}
+
+void nullOutput(const char* msg, int len) {
+}
+
+/**
+ * 同样的内容 用LOG_INFO输出自由文本 和用SLOG_INFO输出logfmt JSON的开销
+ * 输出函数什么都不做 只比较前端编码的时间
+ */
+void benchStructured() {
+    const int kMessages = 1000 * 1000;
+    const string path("/api/v1/users/12345");
+    Logger::setOutput(nullOutput);
+
+    Timestamp start(Timestamp::now());
+    for(int n = 0; n < kMessages; ++n) {
+        LOG_INFO << "request done method=GET path=" << path << " status=" << 200 << " ms=" << n / 7.0;
+    }
+    double textSeconds = timeDifference(Timestamp::now(), start);
+
+    double seconds[2];
+    JsonEncoder json;
+    for(int pass = 0; pass < 2; ++pass) {
+        StructuredLogger::setEncoder(pass == 0 ? NULL : &json);
+        start = Timestamp::now();
+        for(int n = 0; n < kMessages; ++n) {
+            SLOG_INFO("request done") << KV("method", "GET") << KV("path", path)
+                                      << KV("status", 200) << KV("ms", n / 7.0);
+        }
+        seconds[pass] = timeDifference(Timestamp::now(), start);
+    }
+    StructuredLogger::setEncoder(NULL);
+
+    printf("LOG_INFO       %6.1f ns/msg\n", textSeconds * 1e9 / kMessages);
+    printf("SLOG_INFO fmt  %6.1f ns/msg\n", seconds[0] * 1e9 / kMessages);
+    printf("SLOG_INFO json %6.1f ns/msg\n", seconds[1] * 1e9 / kMessages);
+}
+
+/**
+ * 级别是INFO时LOGF_DEBUG的开销 飞行记录仪关闭时只判断级别 打开时拷贝参数到线程的环形缓冲区
+ */
+void benchFlightRecorder() {
+    const int kMessages = 10 * 1000 * 1000;
+    Logger::setLogLevel(Logger::INFO);
+    double seconds[2];
+    for(int pass = 0; pass < 2; ++pass) {
+        if(pass == 1) {
+            FlightRecorder::enable();
+        }
+        Timestamp start(Timestamp::now());
+        for(int n = 0; n < kMessages; ++n) {
+            LOGF_DEBUG("read %d bytes from %s", n, "10.0.0.1:8080");
+        }
+        seconds[pass] = timeDifference(Timestamp::now(), start);
+    }
+    FlightRecorder::disable();
+    printf("LOGF_DEBUG off        %6.1f ns/msg\n", seconds[0] * 1e9 / kMessages);
+    printf("LOGF_DEBUG recorded   %6.1f ns/msg\n", seconds[1] * 1e9 / kMessages);
 }
 
 int main() {
@@ -70,6 +267,9 @@ int main() {
     benchStringStream<double>();
     benchLogStream<double>();
 
+    puts("double i/7.0");
+    benchDoubleDigits();
+
     puts("int64_t");
     benchPrintf<int64_t>("%" PRId64);
     benchStringStream<int64_t>();
@@ -79,4 +279,18 @@ int main() {
     benchPrintf<void*>("%p");
     benchStringStream<void*>();
     benchLogStream<void*>();
+
+    puts("structured");
+    benchStructured();
+
+    puts("contention");
+    benchContention(1);
+    benchContention(4);
+    benchContention(16);
+
+    puts("deferred");
+    benchDeferred();
+
+    puts("flight recorder");
+    benchFlightRecorder();
 }
\ No newline at end of file
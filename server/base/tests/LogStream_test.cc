@@ -8,7 +8,11 @@
 #include "server/base/LogStream.h"
 
 #include <limits>
+#include <random>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 //#define BOOST_TEST_MODULE LogStreamTest
 #define BOOST_TEST_MAIN
@@ -157,8 +161,9 @@ BOOST_AUTO_TEST_CASE(testLogStreamFloats)
   BOOST_CHECK_EQUAL(buf.toString(), string("0.15"));
   os.resetBuffer();
 
+  // 输出能精确还原的最短表示 a+b与c不是同一个double 输出也不同
   os << a+b;
-  BOOST_CHECK_EQUAL(buf.toString(), string("0.15"));
+  BOOST_CHECK_EQUAL(buf.toString(), string("0.15000000000000002"));
   os.resetBuffer();
 
   BOOST_CHECK(a+b != c);
@@ -176,6 +181,125 @@ BOOST_AUTO_TEST_CASE(testLogStreamFloats)
   os.resetBuffer();
 }
 
+BOOST_AUTO_TEST_CASE(testLogStreamIntegerEdges)
+{
+  myserver::LogStream os;
+  const myserver::LogStream::Buffer& buf = os.buffer();
+  char expect[32];
+
+  // 10的幂及其前后 覆盖每一种位数
+  uint64_t p = 1;
+  for (int i = 0; i < 20; ++i)
+  {
+    const uint64_t values[] = { p - 1, p, p + 1 };
+    for (uint64_t v : values)
+    {
+      os << v;
+      snprintf(expect, sizeof expect, "%llu", static_cast<unsigned long long>(v));
+      BOOST_CHECK_EQUAL(buf.toString(), string(expect));
+      os.resetBuffer();
+
+      const int64_t n = -static_cast<int64_t>(v);
+      os << n;
+      snprintf(expect, sizeof expect, "%lld", static_cast<long long>(n));
+      BOOST_CHECK_EQUAL(buf.toString(), string(expect));
+      os.resetBuffer();
+    }
+    p *= 10;
+  }
+
+  os << std::numeric_limits<int64_t>::min();
+  BOOST_CHECK_EQUAL(buf.toString(), string("-9223372036854775808"));
+  os.resetBuffer();
+
+  os << std::numeric_limits<short>::min() << ' ' << std::numeric_limits<unsigned short>::max();
+  BOOST_CHECK_EQUAL(buf.toString(), string("-32768 65535"));
+  os.resetBuffer();
+
+  os << reinterpret_cast<void*>(~static_cast<uintptr_t>(0));
+  BOOST_CHECK_EQUAL(buf.toString(), string("0xFFFFFFFFFFFFFFFF").substr(0, 2 + 2 * sizeof(void*)));
+  os.resetBuffer();
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamFloatEdges)
+{
+  myserver::LogStream os;
+  const myserver::LogStream::Buffer& buf = os.buffer();
+
+  const struct { double value; const char* expect; } cases[] = {
+    { -0.0, "-0" },
+    { std::numeric_limits<double>::infinity(), "inf" },
+    { -std::numeric_limits<double>::infinity(), "-inf" },
+    { std::numeric_limits<double>::quiet_NaN(), "nan" },
+    { std::numeric_limits<double>::max(), "1.7976931348623157e+308" },
+    { std::numeric_limits<double>::min(), "2.2250738585072014e-308" },
+    { std::numeric_limits<double>::denorm_min(), "5e-324" },
+    { 1e16, "10000000000000000" },
+    { 1e17, "1e+17" },
+    { 123456789012345680.0, "1.2345678901234568e+17" },
+    { 0.0001, "0.0001" },
+    { 0.00001, "1e-05" },
+    { 1.5e-10, "1.5e-10" },
+    { 9007199254740993.0, "9007199254740992" },
+    { 5e22, "5e+22" },
+    { 100.0, "100" },
+  };
+  for (const auto& c : cases)
+  {
+    os << c.value;
+    BOOST_CHECK_EQUAL(buf.toString(), string(c.expect));
+    os.resetBuffer();
+  }
+}
+
+// 有效数字的个数 不计前导和末尾的0
+static int significantDigits(const char* s)
+{
+  string digits;
+  for (; *s && *s != 'e'; ++s)
+  {
+    if (*s >= '0' && *s <= '9')
+      digits += *s;
+  }
+  size_t first = digits.find_first_not_of('0');
+  size_t last = digits.find_last_not_of('0');
+  return first == string::npos ? 0 : static_cast<int>(last - first + 1);
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamFloatRoundTrip)
+{
+  myserver::LogStream os;
+  const myserver::LogStream::Buffer& buf = os.buffer();
+  std::mt19937_64 rng(20261018);
+
+  for (int i = 0; i < 100000; ++i)
+  {
+    // 随机的位模式 包括非规格化数 再加一些指数接近0的常见值
+    uint64_t bits = rng();
+    if (i % 2 == 0)
+      bits = (bits & 0x800FFFFFFFFFFFFFULL) | (static_cast<uint64_t>(1023 - 40 + rng() % 80) << 52);
+    double d;
+    memcpy(&d, &bits, sizeof d);
+    if (d != d || d - d != 0)
+      continue;
+
+    os << d;
+    string s = buf.toString();
+    os.resetBuffer();
+    BOOST_REQUIRE_EQUAL(strtod(s.c_str(), NULL), d);
+
+    // 不能比%.{n}g能还原的最少位数更长
+    char shortest[32];
+    for (int prec = 1; prec <= 17; ++prec)
+    {
+      snprintf(shortest, sizeof shortest, "%.*g", prec, d);
+      if (strtod(shortest, NULL) == d)
+        break;
+    }
+    BOOST_REQUIRE_EQUAL(significantDigits(s.c_str()), significantDigits(shortest));
+  }
+}
+
 BOOST_AUTO_TEST_CASE(testLogStreamVoid)
 {
   myserver::LogStream os;
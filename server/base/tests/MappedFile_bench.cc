@@ -0,0 +1,91 @@
+/**
+* @description: MappedFile_bench.cc
+* @author: YQ Huang
+* @brief: 加载大文件的启动时间 对比readFile和MappedFile
+* @date: 2026/10/18 20:14:52
+*/
+
+#include "server/base/FileUtil.h"
+
+#include <string>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace myserver;
+
+const char* kFileName = "mappedfile_bench.dat";
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+// 模拟解析 每个字节都要读一遍
+uint64_t checksum(const char* p, size_t len) {
+    uint64_t sum = 0;
+    for(size_t i = 0; i < len; ++i) {
+        sum = sum * 31 + static_cast<unsigned char>(p[i]);
+    }
+    return sum;
+}
+
+// 写回后丢掉页缓存 模拟进程冷启动时文件不在内存里
+void dropCache() {
+    int fd = open(kFileName, O_RDONLY | O_CLOEXEC);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+void benchReadFile(bool cold, size_t size) {
+    if(cold) {
+        dropCache();
+    }
+    double start = now();
+    std::string content;
+    int err = FileUtil::readFile(kFileName, static_cast<int>(size), &content);
+    uint64_t sum = checksum(content.data(), content.size());
+    printf("%-4s readFile              %8.1f ms  err %d  sum %016llx\n",
+           cold ? "cold" : "warm", (now() - start) * 1000, err, static_cast<unsigned long long>(sum));
+}
+
+void benchMapped(bool cold, const char* name, int flags) {
+    if(cold) {
+        dropCache();
+    }
+    double start = now();
+    FileUtil::MappedFile file(kFileName, flags);
+    uint64_t sum = checksum(file.begin(), file.size());
+    printf("%-4s %-21s %8.1f ms  err %d  sum %016llx\n",
+           cold ? "cold" : "warm", name, (now() - start) * 1000, file.error(), static_cast<unsigned long long>(sum));
+}
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 256;
+    size_t size = megabytes * 1024 * 1024;
+    {
+        FILE* fp = fopen(kFileName, "w");
+        std::string block(1024 * 1024, '\0');
+        for(size_t i = 0; i < block.size(); ++i) {
+            block[i] = static_cast<char>('a' + (i * 7) % 26);
+        }
+        for(size_t i = 0; i < megabytes; ++i) {
+            fwrite(block.data(), 1, block.size(), fp);
+        }
+        fclose(fp);
+    }
+
+    for(int pass = 0; pass < 2; ++pass) {
+        bool cold = pass == 0;
+        benchReadFile(cold, size);
+        benchMapped(cold, "mmap", 0);
+        benchMapped(cold, "mmap sequential", FileUtil::MappedFile::kSequential);
+        benchMapped(cold, "mmap seq+willneed", FileUtil::MappedFile::kSequential | FileUtil::MappedFile::kWillNeed);
+        benchMapped(cold, "mmap populate", FileUtil::MappedFile::kPopulate);
+    }
+    unlink(kFileName);
+}
@@ -0,0 +1,90 @@
+/**
+* @description: MappedFile_test.cc
+* @author: YQ Huang
+* @brief: MappedFile 测试函数
+* @date: 2026/10/18 20:05:17
+*/
+
+#include "server/base/FileUtil.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <string>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace myserver;
+
+void writeFile(const char* name, const std::string& content) {
+    FILE* fp = fopen(name, "w");
+    CHECK(fp != NULL);
+    CHECK(fwrite(content.data(), 1, content.size(), fp) == content.size());
+    fclose(fp);
+}
+
+// 内容必须和readFile读到的完全一样 包括超过64KB的部分
+void testContent() {
+    std::string content;
+    for(int i = 0; content.size() < 300 * 1000; ++i) {
+        content += std::to_string(i * 2654435761u);
+        content += (i % 10 == 0) ? '\n' : ',';
+    }
+    content += '\0';
+    content += "tail";
+    writeFile("mapped.dat", content);
+
+    const int flags[] = {
+        FileUtil::MappedFile::kSequential,
+        FileUtil::MappedFile::kSequential | FileUtil::MappedFile::kWillNeed,
+        FileUtil::MappedFile::kRandom | FileUtil::MappedFile::kPopulate,
+        0,
+    };
+    for(int f : flags) {
+        FileUtil::MappedFile file("mapped.dat", f);
+        CHECK(file.valid());
+        CHECK(file.size() == content.size());
+        CHECK(file.data() == StringPiece(content));
+        // 处理完的部分丢掉后 再访问会从文件重新读入
+        file.dontNeed(0, 100 * 1000);
+        file.dontNeed(file.size() - 10, 100);
+        CHECK(file.data() == StringPiece(content));
+    }
+
+    std::string viaReadFile;
+    CHECK(FileUtil::readFile("mapped.dat", static_cast<int>(content.size()), &viaReadFile) == 0);
+    CHECK(viaReadFile == content);
+    unlink("mapped.dat");
+}
+
+void testErrors() {
+    writeFile("empty.dat", "");
+    {
+        FileUtil::MappedFile file("empty.dat");
+        CHECK(file.valid());
+        CHECK(file.size() == 0);
+        CHECK(file.data().empty());
+    }
+    unlink("empty.dat");
+
+    FileUtil::MappedFile notExist("/notexist");
+    CHECK(notExist.error() == ENOENT);
+    CHECK(notExist.size() == 0);
+    FileUtil::MappedFile dir("/tmp");
+    CHECK(dir.error() == EISDIR);
+    FileUtil::MappedFile device("/dev/zero");
+    CHECK(device.error() == EINVAL);
+}
+
+int main() {
+    char dir[] = "/tmp/mappedfile_test.XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    CHECK(chdir(dir) == 0);
+
+    testContent();
+    testErrors();
+
+    CHECK(chdir("/") == 0);
+    CHECK(rmdir(dir) == 0);
+    printf("All tests passed\n");
+}
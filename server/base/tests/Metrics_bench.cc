@@ -0,0 +1,58 @@
+/**
+* @description: Metrics_bench.cc
+* @author: YQ Huang
+* @brief: 指标记录的开销 单线程和多线程同时记录同一个指标
+* @date: 2026/10/18 23:12:40
+*/
+
+#include "server/base/Metrics.h"
+#include "server/base/Thread.h"
+
+#include <memory>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace myserver;
+
+int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+template<typename F>
+void bench(const char* name, int numThreads, int iterations, F f) {
+    int64_t start = nowNanos();
+    std::vector<std::unique_ptr<Thread>> threads;
+    for(int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(new Thread([iterations, f] {
+            for(int j = 0; j < iterations; ++j) {
+                f(j);
+            }
+        }));
+        threads.back()->start();
+    }
+    for(auto& thr : threads) {
+        thr->join();
+    }
+    double elapsed = static_cast<double>(nowNanos() - start);
+    printf("%-24s threads %d  %6.2f ns/op\n", name, numThreads,
+           elapsed / static_cast<double>(iterations) / numThreads);
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 100 * 1000 * 1000;
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Counter* counter = registry.counter("bench_total", "");
+    Gauge* gauge = registry.gauge("bench_gauge", "");
+    HistogramMetric* hist = registry.histogram("bench_ns", "");
+
+    for(int threads = 1; threads <= 4; threads *= 2) {
+        bench("Counter::increment", threads, iterations, [counter](int) { counter->increment(); });
+        bench("Gauge::add", threads, iterations, [gauge](int i) { gauge->add(i & 1 ? 1 : -1); });
+        bench("HistogramMetric::record", threads, iterations / 4, [hist](int i) { hist->record(i & 4095); });
+    }
+    printf("counter %lld\n", static_cast<long long>(counter->value()));
+}
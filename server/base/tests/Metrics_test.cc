@@ -0,0 +1,114 @@
+/**
+* @description: Metrics_test.cc
+* @author: YQ Huang
+* @brief: 指标注册表 测试函数
+* @date: 2026/10/18 23:07:15
+*/
+
+#include "server/base/Metrics.h"
+#include "server/base/Thread.h"
+#include "server/base/ThreadPool.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace myserver;
+
+// 多个线程同时记录 已经退出的线程的值也要算上
+void testCounterAcrossThreads() {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Counter* counter = registry.counter("test_requests_total", "Requests");
+    CHECK(registry.counter("test_requests_total", "ignored") == counter);
+    CHECK(counter->value() == 0);
+
+    const int kThreads = 4;
+    const int kPerThread = 100000;
+    for(int round = 0; round < 2; ++round) {
+        std::vector<std::unique_ptr<Thread>> threads;
+        for(int i = 0; i < kThreads; ++i) {
+            threads.emplace_back(new Thread([counter] {
+                for(int j = 0; j < kPerThread; ++j) {
+                    counter->increment();
+                }
+            }));
+            threads.back()->start();
+        }
+        for(auto& thr : threads) {
+            thr->join();
+        }
+        CHECK(counter->value() == static_cast<int64_t>(round + 1) * kThreads * kPerThread);
+    }
+    counter->add(5);
+    CHECK(counter->value() == 2 * kThreads * kPerThread + 5);
+}
+
+// 增加和减少在不同的线程
+void testGauge() {
+    Gauge* gauge = MetricsRegistry::instance().gauge("test_inflight", "In flight");
+    Thread producer([gauge] { for(int i = 0; i < 1000; ++i) gauge->increment(); });
+    producer.start();
+    producer.join();
+    for(int i = 0; i < 400; ++i) {
+        gauge->decrement();
+    }
+    CHECK(gauge->value() == 600);
+}
+
+void testHistogram() {
+    HistogramMetric* hist = MetricsRegistry::instance().histogram("test_latency_ns", "Latency");
+    Thread worker([hist] { for(int i = 1; i <= 1000; ++i) hist->record(i); });
+    worker.start();
+    worker.join();
+    hist->record(1000000);
+    HistogramSnapshot snap = hist->snapshot();
+    CHECK(snap.count() == 1001);
+    CHECK(snap.max() == 1000000);
+    CHECK(snap.percentile(50) >= 500 && snap.percentile(50) < 600);
+}
+
+// 线程池的任务数和队列长度
+void testThreadPool() {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Counter* tasks = registry.counter("myserver_threadpool_tasks_total", "");
+    Gauge* depth = registry.gauge("myserver_threadpool_queue_depth", "");
+    int64_t before = tasks->value();
+    {
+        ThreadPool pool("metrics");
+        pool.start(2);
+        for(int i = 0; i < 100; ++i) {
+            pool.run([] { });
+        }
+        pool.stop();
+    }
+    CHECK(tasks->value() == before + 100);
+    CHECK(depth->value() == 0);
+}
+
+bool contains(const std::string& text, const std::string& s) {
+    return text.find(s) != std::string::npos;
+}
+
+void testScrape() {
+    std::string text = MetricsRegistry::instance().scrape();
+    printf("%s", text.c_str());
+    CHECK(contains(text, "# HELP test_requests_total Requests\n# TYPE test_requests_total counter\n"));
+    CHECK(contains(text, "\ntest_requests_total 800005\n"));
+    CHECK(contains(text, "# TYPE test_inflight gauge\ntest_inflight 600\n"));
+    CHECK(contains(text, "# TYPE test_latency_ns summary\n"));
+    CHECK(contains(text, "test_latency_ns{quantile=\"0.999\"} 1023\n"));
+    CHECK(contains(text, "test_latency_ns_count 1001\n"));
+    CHECK(contains(text, "test_latency_ns_sum 1500500\n"));
+}
+
+int main() {
+    testCounterAcrossThreads();
+    testGauge();
+    testHistogram();
+    testThreadPool();
+    testScrape();
+    printf("All tests passed\n");
+}
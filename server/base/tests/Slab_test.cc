@@ -0,0 +1,106 @@
+/**
+* @description: Slab_test.cc
+* @author: YQ Huang
+* @brief: 固定大小对象的内存池 测试函数
+* @date: 2026/10/19 00:31:26
+*/
+
+#include "server/base/Slab.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace myserver;
+
+struct Object {
+    explicit Object(int v) : value(v) { ++alive; }
+    ~Object() { --alive; }
+    int value;
+    char padding[100];
+    static int alive;
+};
+int Object::alive = 0;
+
+// 释放的对象被重用 不同大小的请求不进入空闲链表
+void testReuse() {
+    Slab slab(4);
+    std::set<void*> addresses;
+    void* objects[10];
+    for(int i = 0; i < 10; ++i) {
+        objects[i] = slab.allocate(40);
+        CHECK(reinterpret_cast<uintptr_t>(objects[i]) % alignof(max_align_t) == 0);
+        addresses.insert(objects[i]);
+    }
+    CHECK(addresses.size() == 10);
+    CHECK(slab.objectSize() == 48);
+    CHECK(slab.capacity() == 12);
+    CHECK(slab.inUse() == 10);
+
+    slab.deallocate(objects[3], 40);
+    void* p = slab.allocate(40);
+    CHECK(p == objects[3]);
+
+    void* other = slab.allocate(200);
+    CHECK(slab.inUse() == 10);
+    slab.deallocate(other, 200);
+
+    for(int i = 0; i < 10; ++i) {
+        slab.deallocate(objects[i], 40);
+    }
+    CHECK(slab.inUse() == 0);
+    CHECK(slab.capacity() == 12);
+}
+
+// allocate_shared把对象和控制块放在同一个节点里 Slab活到最后一个对象释放
+void testAllocateShared() {
+    std::weak_ptr<Slab> weakSlab;
+    std::shared_ptr<Object> survivor;
+    {
+        std::shared_ptr<Slab> slab = std::make_shared<Slab>();
+        weakSlab = slab;
+        std::vector<std::shared_ptr<Object>> objects;
+        for(int i = 0; i < 100; ++i) {
+            objects.push_back(std::allocate_shared<Object>(SlabAllocator<Object>(slab), i));
+        }
+        CHECK(Object::alive == 100);
+        CHECK(slab->inUse() == 100);
+        CHECK(slab->objectSize() > sizeof(Object));
+        CHECK(objects[42]->value == 42);
+        survivor = objects[7];
+        objects.clear();
+        CHECK(Object::alive == 1);
+        CHECK(slab->inUse() == 1);
+    }
+    CHECK(!weakSlab.expired());
+    CHECK(survivor->value == 7);
+    survivor.reset();
+    CHECK(Object::alive == 0);
+    CHECK(weakSlab.expired());
+}
+
+// 在一个线程分配 在另一个线程释放
+void testCrossThread() {
+    std::shared_ptr<Slab> slab = std::make_shared<Slab>(16);
+    std::vector<std::shared_ptr<Object>> objects;
+    for(int i = 0; i < 1000; ++i) {
+        objects.push_back(std::allocate_shared<Object>(SlabAllocator<Object>(slab), i));
+    }
+    Thread releaser([&objects] { objects.clear(); }, "releaser");
+    releaser.start();
+    for(int i = 0; i < 1000; ++i) {
+        std::allocate_shared<Object>(SlabAllocator<Object>(slab), i);
+    }
+    releaser.join();
+    CHECK(slab->inUse() == 0);
+    CHECK(Object::alive == 0);
+}
+
+int main() {
+    testReuse();
+    testAllocateShared();
+    testCrossThread();
+    printf("All tests passed\n");
+}
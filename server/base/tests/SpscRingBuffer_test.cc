@@ -0,0 +1,155 @@
+/**
+* @description: SpscRingBuffer_test.cc
+* @author: YQ Huang
+* @brief: SPSC环形缓冲区和AsyncRingLogging 测试函数
+* @date: 2026/10/18 14:20:46
+*/
+
+#include "server/base/AsyncRingLogging.h"
+#include "server/base/CurrentThread.h"
+#include "server/base/SpscRingBuffer.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <memory>
+#include <sched.h>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace myserver;
+
+// 单线程 反复写满再读空 覆盖末尾填充记录的情况
+void testWrapAround() {
+    SpscRingBuffer ring(256);
+    CHECK(ring.capacity() == 256);
+    char data[64];
+    int64_t written = 0;
+    int64_t read = 0;
+    for(int round = 0; round < 100; ++round) {
+        // 长度不断变化 让记录在不同的位置跨越末尾
+        size_t len = static_cast<size_t>(round % 40 + 1);
+        while(true) {
+            memset(data, static_cast<int>('a' + written % 26), len);
+            if(!ring.tryWrite(written, data, len)) {
+                break;
+            }
+            ++written;
+        }
+        SpscRingBuffer::Record record;
+        while(ring.peek(&record)) {
+            CHECK(record.timestamp == read);
+            CHECK(record.length == len);
+            CHECK(record.data[0] == static_cast<char>('a' + read % 26));
+            CHECK(record.data[len - 1] == record.data[0]);
+            ring.consume(record);
+            ++read;
+        }
+        CHECK(ring.readableBytes() == 0);
+    }
+    CHECK(written == read);
+    CHECK(written > 100);
+
+    // 超过容量的记录写不进去
+    std::string big(300, 'x');
+    CHECK(!ring.tryWrite(0, big.data(), big.size()));
+}
+
+// 一个生产者线程和一个消费者线程 检查顺序和内容
+void testProducerConsumer() {
+    const int64_t kRecords = 200000;
+    SpscRingBuffer ring(4096);
+    Thread producer([&ring, kRecords]()
+    {
+        char buf[32];
+        for(int64_t i = 0; i < kRecords; ) {
+            int len = snprintf(buf, sizeof buf, "%lld", static_cast<long long>(i));
+            if(ring.tryWrite(i, buf, static_cast<size_t>(len))) {
+                ++i;
+            }
+            else {
+                sched_yield();
+            }
+        }
+    });
+    producer.start();
+
+    char expect[32];
+    int64_t next = 0;
+    while(next < kRecords) {
+        SpscRingBuffer::Record record;
+        if(ring.peek(&record)) {
+            int len = snprintf(expect, sizeof expect, "%lld", static_cast<long long>(next));
+            CHECK(record.timestamp == next);
+            CHECK(record.length == static_cast<uint32_t>(len));
+            CHECK(memcmp(record.data, expect, record.length) == 0);
+            ring.consume(record);
+            ++next;
+        }
+        else {
+            sched_yield();
+        }
+    }
+    producer.join();
+    SpscRingBuffer::Record record;
+    CHECK(!ring.peek(&record));
+}
+
+// 每个写日志的线程注册一个缓冲区 缓冲区足够大时不丢日志
+void testAsyncRingLogging() {
+    const int kThreads = 4;
+    AsyncRingLogging log("spscringbuffer_test", 100 * 1000 * 1000, 4 * 1024 * 1024, 1);
+    log.start();
+    std::vector<std::unique_ptr<Thread> > threads;
+    for(int i = 0; i < kThreads; ++i) {
+        threads.emplace_back(new Thread([&log]()
+        {
+            const char msg[] = "hello AsyncRingLogging\n";
+            for(int n = 0; n < 10000; ++n) {
+                log.append(msg, static_cast<int>(sizeof msg - 1));
+            }
+        }));
+        threads.back()->start();
+    }
+    for(auto& thr : threads) {
+        thr->join();
+    }
+    log.stop();
+    CHECK(log.droppedMessages() == 0);
+    CHECK(log.numRings() >= 1 && log.numRings() <= static_cast<size_t>(kThreads));
+}
+
+/**
+ * 线程一个接一个地创建和退出 退出的线程的缓冲区读空后被新线程复用
+ * 缓冲区的个数不随线程数增长
+ */
+void testRingRecycle() {
+    const int kThreads = 200;
+    AsyncRingLogging log("spscringbuffer_test", 100 * 1000 * 1000, 64 * 1024, 1);
+    log.start();
+    for(int i = 0; i < kThreads; ++i) {
+        Thread thread([&log]()
+        {
+            const char msg[] = "hello recycled ring\n";
+            for(int n = 0; n < 100; ++n) {
+                log.append(msg, static_cast<int>(sizeof msg - 1));
+            }
+        });
+        thread.start();
+        thread.join();
+        CurrentThread::sleepUsec(5 * 1000);
+    }
+    log.stop();
+    CHECK(log.droppedMessages() == 0);
+    CHECK(log.numRings() < 10);
+}
+
+int main() {
+    testWrapAround();
+    testProducerConsumer();
+    testAsyncRingLogging();
+    testRingRecycle();
+    printf("All tests passed\n");
+}
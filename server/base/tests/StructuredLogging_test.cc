@@ -0,0 +1,218 @@
+/**
+* @description: StructuredLogging_test.cc
+* @author: YQ Huang
+* @brief: 结构化日志 测试函数
+* @date: 2026/10/18 17:20:36
+*/
+
+#include "server/base/StructuredLogging.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <limits>
+#include <new>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace myserver;
+
+// 统计operator new的调用次数 检查结构化日志不分配内存
+int g_allocations = 0;
+
+void* operator new(size_t size) {
+    ++g_allocations;
+    void* p = malloc(size ? size : 1);
+    if(p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+char g_captured[8192];
+int g_capturedLen = 0;
+
+void captureOutput(const char* msg, int len) {
+    CHECK(g_capturedLen + len <= static_cast<int>(sizeof g_captured));
+    memcpy(g_captured + g_capturedLen, msg, len);
+    g_capturedLen += len;
+}
+
+std::string takeCaptured() {
+    std::string line(g_captured, g_capturedLen);
+    g_capturedLen = 0;
+    return line;
+}
+
+// 逐字节的参考实现
+const char* findSpecialScalar(const char* p, const char* end, unsigned char maxControl, char extra) {
+    for(; p < end; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if(c <= maxControl || c == '"' || c == '\\' || *p == extra) {
+            return p;
+        }
+    }
+    return end;
+}
+
+void testFindSpecial() {
+    // 特殊字节出现在SIMD块的每个位置 以及结尾不足16字节的部分
+    const char specials[] = { '"', '\\', '\n', '\0', '\x1f', '=', ' ' };
+    for(int len = 0; len < 50; ++len) {
+        for(int pos = 0; pos <= len; ++pos) {
+            for(char sp : specials) {
+                std::string s(len, 'a');
+                s += "\xc3\xa9";    // UTF-8的高位字节不是特殊字节
+                if(pos < len) {
+                    s[pos] = sp;
+                }
+                const char* b = s.data();
+                const char* e = b + s.size();
+                CHECK(detail::findSpecialChar(b, e, 0x1F, '"') == findSpecialScalar(b, e, 0x1F, '"'));
+                CHECK(detail::findSpecialChar(b, e, ' ', '=') == findSpecialScalar(b, e, ' ', '='));
+            }
+        }
+    }
+}
+
+// 去掉开头的时间 线程id和结尾的src 只比较中间的部分
+std::string logfmtBody(const std::string& line) {
+    // time="20261018 17:20:36.123456Z" level=...
+    CHECK(line.compare(0, 6, "time=\"") == 0);
+    CHECK(line[14] == ' ' && line[23] == '.' && line[30] == 'Z' && line[31] == '"');
+    size_t src = line.rfind(" src=StructuredLogging_test.cc:");
+    CHECK(src != std::string::npos);
+    CHECK(line[line.size() - 1] == '\n');
+    std::string body = line.substr(33, src - 33);
+    size_t tid = body.find(" tid=");
+    size_t msg = body.find(" msg=");
+    CHECK(tid != std::string::npos && msg != std::string::npos);
+    return body.erase(tid, msg - tid);
+}
+
+std::string jsonBody(const std::string& line) {
+    // {"time":"20261018 17:20:36.123456Z","level":...
+    CHECK(line.compare(0, 9, "{\"time\":\"") == 0);
+    CHECK(line[34] == '"' && line[35] == ',');
+    size_t src = line.rfind(",\"src\":\"StructuredLogging_test.cc:");
+    CHECK(src != std::string::npos);
+    CHECK(line.compare(line.size() - 3, 3, "\"}\n") == 0);
+    std::string body = line.substr(36, src - 36);
+    size_t tid = body.find(",\"tid\":");
+    size_t msg = body.find(",\"msg\":");
+    CHECK(tid != std::string::npos && msg != std::string::npos);
+    return body.erase(tid, msg - tid);
+}
+
+void logFields() {
+    std::string path("/index.html");
+    SLOG_INFO("request done") << KV("method", "GET") << KV("path", path)
+                              << KV("status", 200) << KV("bytes", 123456789012ULL)
+                              << KV("delta", -7L) << KV("ms", 1.5) << KV("ok", true)
+                              << KV("note", StringPiece("a \"quoted\"\tvalue\\"))
+                              << KV("empty", "") << KV("eq", "a=b") << KV("nan", std::numeric_limits<double>::quiet_NaN());
+}
+
+void testEncoders() {
+    logFields();
+    CHECK(logfmtBody(takeCaptured()) ==
+          "level=INFO msg=\"request done\" method=GET path=/index.html status=200 bytes=123456789012"
+          " delta=-7 ms=1.5 ok=true note=\"a \\\"quoted\\\"\\tvalue\\\\\" empty=\"\" eq=\"a=b\" nan=nan");
+
+    JsonEncoder json;
+    StructuredLogger::setEncoder(&json);
+    logFields();
+    CHECK(jsonBody(takeCaptured()) ==
+          "\"level\":\"INFO\",\"msg\":\"request done\",\"method\":\"GET\",\"path\":\"/index.html\","
+          "\"status\":200,\"bytes\":123456789012,\"delta\":-7,\"ms\":1.5,\"ok\":true,"
+          "\"note\":\"a \\\"quoted\\\"\\tvalue\\\\\",\"empty\":\"\",\"eq\":\"a=b\",\"nan\":null");
+
+    SLOG_WARN("ctl\x01\n") << KV("k", std::string("\x7f\xc3\xa9", 3));
+    CHECK(jsonBody(takeCaptured()) == "\"level\":\"WARN\",\"msg\":\"ctl\\u0001\\n\",\"k\":\"\x7f\xc3\xa9\"");
+
+    // 低于日志级别的不输出 参数也不求值
+    int evaluated = 0;
+    SLOG_DEBUG("hidden") << KV("n", ++evaluated);
+    CHECK(g_capturedLen == 0 && evaluated == 0);
+
+    StructuredLogger::setEncoder(NULL);
+    SLOG_ERROR("back to logfmt");
+    CHECK(logfmtBody(takeCaptured()) == "level=ERROR msg=\"back to logfmt\"");
+
+    // logfmt的键不能加引号 特殊字节换成'_'
+    SLOG_INFO("keys") << KV("a key", 1) << KV("x=y", 2) << KV("q\"\\", 3) << KV("", 4) << KV("t\n", 5);
+    CHECK(logfmtBody(takeCaptured()) == "level=INFO msg=keys a_key=1 x_y=2 q__=3 _=4 t_=5");
+}
+
+// 超长的值被截断 多余的键值对被丢弃 但每一行仍然是完整的
+void testTruncation() {
+    std::string big(10000, 'x');
+    big[5000] = '"';
+    JsonEncoder json;
+    for(int pass = 0; pass < 2; ++pass) {
+        StructuredLogger::setEncoder(pass == 0 ? NULL : &json);
+        SLOG_INFO("big") << KV("a", big) << KV("b", big) << KV("c", 1);
+        std::string line = takeCaptured();
+        CHECK(line.size() < static_cast<size_t>(detail::kSmallBuffer));
+        if(pass == 0) {
+            std::string body = logfmtBody(line);
+            CHECK(body.find(" a=\"xxx") != std::string::npos);
+            CHECK(body[body.size() - 1] == '"');
+            CHECK(body.find(" b=") == std::string::npos);
+        }
+        else {
+            std::string body = jsonBody(line);
+            CHECK(body.find(",\"a\":\"xxx") != std::string::npos);
+            CHECK(body[body.size() - 1] == '"');
+            CHECK(body.find(",\"b\":") == std::string::npos);
+        }
+    }
+
+    // 超长的键也被截断 结尾的src和换行仍然放得下
+    for(size_t len = 3700; len < 4000; len += 13) {
+        std::string key(len, 'k');
+        key[len / 2] = ' ';
+        for(int pass = 0; pass < 2; ++pass) {
+            StructuredLogger::setEncoder(pass == 0 ? NULL : &json);
+            SLOG_INFO("long key") << KV(key, 1) << KV("c", 2);
+            std::string line = takeCaptured();
+            CHECK(line.size() < static_cast<size_t>(detail::kSmallBuffer));
+            std::string body = pass == 0 ? logfmtBody(line) : jsonBody(line);
+            CHECK(body.find(" kkk") != std::string::npos || body.find("\"kkk") != std::string::npos);
+        }
+    }
+    StructuredLogger::setEncoder(NULL);
+}
+
+void logNoAllocation(int i, const std::string& value) {
+    SLOG_INFO("no allocation") << KV("i", i) << KV("v", value) << KV("d", i / 3.0);
+    g_capturedLen = 0;
+}
+
+void testNoAllocation() {
+    JsonEncoder json;
+    std::string value("some value that does not fit in SSO buffer");
+    for(int pass = 0; pass < 2; ++pass) {
+        StructuredLogger::setEncoder(pass == 0 ? NULL : &json);
+        // 调用点第一次执行时解析模块级别 线程局部变量也在第一次使用时初始化
+        logNoAllocation(0, value);
+        g_allocations = 0;
+        for(int i = 0; i < 1000; ++i) {
+            logNoAllocation(i, value);
+        }
+        CHECK(g_allocations == 0);
+    }
+    StructuredLogger::setEncoder(NULL);
+}
+
+int main() {
+    Logger::setOutput(captureOutput);
+    testFindSpecial();
+    testEncoders();
+    testTruncation();
+    testNoAllocation();
+    printf("All tests passed\n");
+}
@@ -0,0 +1,15 @@
+/**
+* @description: TestUtil.h
+* @author: YQ Huang
+* @brief: 测试程序共用的检查宏
+* @date: 2026/10/19 09:40:18
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// 条件不成立时打印位置并abort() 与assert不同 定义了NDEBUG也照样检查
+#define CHECK(cond) \
+    do { if(!(cond)) { fprintf(stderr, "%s:%d CHECK failed: %s\n", __FILE__, __LINE__, #cond); abort(); } } while(0)
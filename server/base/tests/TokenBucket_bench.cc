@@ -0,0 +1,59 @@
+/**
+* @description: TokenBucket_bench.cc
+* @author: YQ Huang
+* @brief: 令牌桶每次取令牌的耗时 单线程和多个线程共享一个桶
+* @date: 2026/10/19 06:20:33
+*/
+
+#include "server/base/Thread.h"
+#include "server/base/TokenBucket.h"
+
+#include <memory>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace myserver;
+
+int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 每个线程调用n次consume() 时间戳取自调用方 与TcpConnection::handleRead()一样
+void bench(int numThreads, int n) {
+    TokenBucket bucket(1e12, 1e12);
+    Timestamp now(Timestamp::now());
+    std::vector<std::unique_ptr<Thread> > threads;
+    int64_t start = nowNanos();
+    for(int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(new Thread([&bucket, now, n]() {
+            int64_t sink = 0;
+            for(int j = 0; j < n; ++j) {
+                sink += bucket.consume(1500, now);
+            }
+            if(sink != 0) {
+                printf("unexpected wait %ld\n", static_cast<long>(sink));
+            }
+        }, "bench"));
+        threads.back()->start();
+    }
+    for(auto& thread : threads) {
+        thread->join();
+    }
+    int64_t elapsed = nowNanos() - start;
+    printf("%d thread(s) sharing one bucket: %6.2f ns per consume\n",
+           numThreads, static_cast<double>(elapsed) / n / numThreads);
+}
+
+/**
+ * tokenbucket_bench [calls]
+ */
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 10 * 1000 * 1000;
+    bench(1, n);
+    bench(2, n);
+    bench(4, n);
+}
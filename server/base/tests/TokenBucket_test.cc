@@ -0,0 +1,94 @@
+/**
+* @description: TokenBucket_test.cc
+* @author: YQ Huang
+* @brief: 令牌桶 测试函数
+* @date: 2026/10/19 05:55:40
+*/
+
+#include "server/base/Thread.h"
+#include "server/base/TokenBucket.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <memory>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace myserver;
+
+const Timestamp kStart(Timestamp::fromUnixTime(1800000000));
+
+Timestamp at(double seconds) {
+    return addTime(kStart, seconds);
+}
+
+// 一开始是满的 取空之后按速率补充 最多补到burst
+void testRefill() {
+    TokenBucket bucket(100, 10);
+    CHECK(!bucket.unlimited());
+    CHECK(fabs(bucket.available(at(0)) - 10) < 1e-6);
+    for(int i = 0; i < 10; ++i) {
+        CHECK(bucket.tryConsume(1, at(0)));
+    }
+    CHECK(!bucket.tryConsume(1, at(0)));
+    CHECK(fabs(bucket.available(at(0))) < 1e-6);
+    // 10ms补充一个
+    CHECK(!bucket.tryConsume(1, at(0.005)));
+    CHECK(bucket.tryConsume(1, at(0.010)));
+    CHECK(fabs(bucket.available(at(10)) - 10) < 1e-6);
+    CHECK(!bucket.tryConsume(11, at(10)));
+    CHECK(bucket.tryConsume(10, at(10)));
+}
+
+// consume()允许欠账 返回还清需要的时间 欠账期间再取会继续累加
+void testDebt() {
+    TokenBucket bucket(1000, 100);
+    CHECK(bucket.consume(100, at(0)) == 0);
+    CHECK(bucket.consume(500, at(0)) == 500 * 1000);
+    CHECK(fabs(bucket.available(at(0)) + 500) < 1e-6);
+    CHECK(bucket.consume(100, at(0.1)) == 500 * 1000);
+    // 还清之后重新攒令牌
+    CHECK(bucket.consume(0, at(0.6)) == 0);
+    CHECK(fabs(bucket.available(at(0.7)) - 100) < 1e-6);
+}
+
+void testUnlimited() {
+    TokenBucket bucket(0, 0);
+    CHECK(bucket.unlimited());
+    CHECK(bucket.consume(1 << 30, at(0)) == 0);
+    CHECK(bucket.tryConsume(1 << 30, at(0)));
+}
+
+// 多个线程同时取 成功取走的总数不超过burst
+void testConcurrent() {
+    const int kThreads = 4;
+    const int kTries = 100000;
+    TokenBucket bucket(1, 50000);
+    std::vector<int> taken(kThreads, 0);
+    std::vector<std::unique_ptr<Thread> > threads;
+    for(int i = 0; i < kThreads; ++i) {
+        threads.emplace_back(new Thread([&bucket, &taken, i]() {
+            for(int j = 0; j < kTries; ++j) {
+                if(bucket.tryConsume(1, at(0))) {
+                    ++taken[i];
+                }
+            }
+        }, "consumer"));
+        threads.back()->start();
+    }
+    int total = 0;
+    for(int i = 0; i < kThreads; ++i) {
+        threads[i]->join();
+        total += taken[i];
+    }
+    CHECK(total == 50000);
+}
+
+int main() {
+    testRefill();
+    testDebt();
+    testUnlimited();
+    testConcurrent();
+    printf("TokenBucket_test passed\n");
+}
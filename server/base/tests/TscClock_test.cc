@@ -0,0 +1,81 @@
+/**
+* @description: TscClock_test.cc
+* @author: YQ Huang
+* @brief: 基于TSC的快速时钟 测试函数
+* @date: 2026/10/19 01:58:33
+*/
+
+#include "server/base/Thread.h"
+#include "server/base/Timestamp.h"
+#include "server/base/TscClock.h"
+#include "server/base/tests/TestUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+using namespace myserver;
+
+int64_t gettimeofdayMicros() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return static_cast<int64_t>(tv.tv_sec) * 1000 * 1000 + tv.tv_usec;
+}
+
+/**
+ * 跨过几次重新同步 与gettimeofday的差不超过kMaxErrorUs 同一线程内不倒退
+ * 两次读时钟之间可能被调度出去 所以比较夹在前后两次gettimeofday之间
+ */
+void testAccuracy() {
+    const int64_t kMaxErrorUs = 200;
+    int64_t start = gettimeofdayMicros();
+    int64_t last = 0;
+    int64_t worst = 0;
+    int samples = 0;
+    while(gettimeofdayMicros() - start < 3 * TscClock::kResyncIntervalUs) {
+        int64_t before = gettimeofdayMicros();
+        int64_t fast = Timestamp::nowFast().microSecondsSinceEpoch();
+        int64_t after = gettimeofdayMicros();
+        CHECK(fast >= last);
+        last = fast;
+        int64_t error = 0;
+        if(fast < before) {
+            error = before - fast;
+        }
+        else if(fast > after) {
+            error = fast - after;
+        }
+        worst = std::max(worst, error);
+        ++samples;
+    }
+    printf("tsc %s %.1f ticks/us  %d samples  worst error %ld us\n",
+           TscClock::available() ? "available" : "unavailable",
+           TscClock::ticksPerMicrosecond(), samples, static_cast<long>(worst));
+    CHECK(worst <= kMaxErrorUs);
+}
+
+// 粗粒度时钟落后不超过几个时钟节拍
+void testCoarse() {
+    int64_t precise = Timestamp::now().microSecondsSinceEpoch();
+    int64_t coarse = Timestamp::nowCoarse().microSecondsSinceEpoch();
+    CHECK(coarse <= precise + 1000);
+    CHECK(precise - coarse < 50 * 1000);
+}
+
+// 每个线程有自己的基准
+void testThreads() {
+    int64_t mainNow = Timestamp::nowFast().microSecondsSinceEpoch();
+    int64_t threadNow = 0;
+    Thread thread([&threadNow] { threadNow = Timestamp::nowFast().microSecondsSinceEpoch(); }, "clock");
+    thread.start();
+    thread.join();
+    CHECK(threadNow >= mainNow - 1000);
+    CHECK(threadNow - mainNow < 1000 * 1000);
+}
+
+int main() {
+    testAccuracy();
+    testCoarse();
+    testThreads();
+    printf("All tests passed\n");
+}
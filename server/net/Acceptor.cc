@@ -8,6 +8,7 @@
 #include "server/net/Acceptor.h"
 
 #include "server/base/Logging.h"
+#include "server/base/Metrics.h"
 #include "server/net/EventLoop.h"
 #include "server/net/InetAddress.h"
 #include "server/net/SocketsOps.h"
@@ -21,6 +22,15 @@ namespace myserver {
 
 namespace net {
 
+namespace {
+
+Counter* const g_accepted = MetricsRegistry::instance().counter(
+    "myserver_tcp_accepted_total", "Connections accepted");
+Counter* const g_acceptErrors = MetricsRegistry::instance().counter(
+    "myserver_tcp_accept_errors_total", "Failed accept calls");
+
+}   // namespace
+
 /**
  * 构造函数
  */
@@ -34,11 +44,27 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
     assert(idleFd_ >= 0);
     acceptSocket_.setReuseAddr(true);
     acceptSocket_.setReusePort(reuseport);
+    // 每个IO线程一个监听套接字时 让内核把连接交给收包CPU上的那个线程
+    if(reuseport && loop->pinnedCpu() >= 0) {
+        acceptSocket_.setIncomingCpu(loop->pinnedCpu());
+    }
     acceptSocket_.bindAddress(listenAddr);
     acceptChannel_.setReadCallback(
         std::bind(&Acceptor::handleRead, this));
 }
 
+Acceptor::Acceptor(EventLoop* loop, int listenFd)
+    : loop_(loop),
+      acceptSocket_(listenFd),
+      acceptChannel_(loop, acceptSocket_.fd()),
+      listening_(false),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+{
+    assert(idleFd_ >= 0);
+    acceptChannel_.setReadCallback(
+        std::bind(&Acceptor::handleRead, this));
+}
+
 // 析构函数
 Acceptor::~Acceptor() {
     acceptChannel_.disableAll();
@@ -54,6 +80,14 @@ void Acceptor::listen() {
     acceptChannel_.enableReading();
 }
 
+void Acceptor::stop() {
+    loop_->assertInLoopThread();
+    if(listening_) {
+        listening_ = false;
+        acceptChannel_.disableAll();
+    }
+}
+
 // 调用accept(2)来接受新连接，并回调用户callback
 void Acceptor::handleRead() {
     loop_->assertInLoopThread();
@@ -61,6 +95,7 @@ void Acceptor::handleRead() {
 
     int connfd = acceptSocket_.accept(&peerAddr);
     if(connfd >= 0) {
+        g_accepted->increment();
         if(newConnectionCallback_) {
             newConnectionCallback_(connfd, peerAddr);
         }
@@ -72,6 +107,7 @@ void Acceptor::handleRead() {
     // 那么就会有一个空闲的文件描述符空出来，我们立即去接受新连接，然后立即关闭
     // 重新占用这个空闲的文件描述符。
     else {
+        g_acceptErrors->increment();
         LOG_SYSERR << "in Acceptor::handleRead";
         if(errno == EMFILE) {
             ::close(idleFd_);
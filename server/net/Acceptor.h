@@ -28,12 +28,17 @@ public:
     typedef std::function<void (int sockfd, const InetAddress&)> NewConnectionCallback;
 
     Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport);
+    // 接管一个已经绑定好地址的监听socket 例如重启时从旧进程收到的描述符
+    Acceptor(EventLoop* loop, int listenFd);
     ~Acceptor();
 
     void setNewConnectionCallback(const NewConnectionCallback& cb) { newConnectionCallback_ = cb; }
 
     void listen();
     bool listening() const { return listening_; }
+    // 不再accept新连接 监听socket保持打开 已经在accept队列里的连接留给共享它的其他进程
+    void stop();
+    int fd() const { return acceptSocket_.fd(); }
 
 private:
     void handleRead();  // 调用accept(2)来接受新连接，并回调用户callback
@@ -0,0 +1,106 @@
+/**
+* @description: AdmissionController.cc
+* @author: YQ Huang
+* @brief: 新连接的准入控制 过载时在accept之后立刻拒绝 不让已有的连接跟着变慢
+* @date: 2026/10/19 06:39:04
+*/
+
+#include "server/net/AdmissionController.h"
+
+#include "server/base/Metrics.h"
+
+#include <string.h>
+
+namespace myserver {
+
+namespace net {
+
+namespace {
+
+// 与Decision的顺序一致 kAdmit不计数
+Counter* const g_shed[AdmissionController::kNumDecisions] = {
+    NULL,
+    MetricsRegistry::instance().counter(
+        "myserver_tcp_shed_max_connections_total", "Connections rejected by the connection limit"),
+    MetricsRegistry::instance().counter(
+        "myserver_tcp_shed_queue_size_total", "Connections rejected because the loop queue was too long"),
+    MetricsRegistry::instance().counter(
+        "myserver_tcp_shed_loop_lag_total", "Connections rejected because the loop lag was too high"),
+    MetricsRegistry::instance().counter(
+        "myserver_tcp_shed_queue_delay_total", "Connections rejected by the CoDel queue delay check"),
+};
+
+}   // namespace
+
+AdmissionController::AdmissionController(const AdmissionPolicy& policy)
+    : policy_(policy),
+      dropping_(false)
+{
+    memset(counts_, 0, sizeof counts_);
+}
+
+/**
+ * 依次检查 命中第一项就拒绝
+ * CoDel的状态每次都要更新 所以放在最后 前面的检查拒绝时也不会漏掉延迟的变化
+ */
+AdmissionController::Decision AdmissionController::admit(size_t connections, size_t queueSize,
+                                                         double lag, Timestamp now)
+{
+    bool delayExceeded = policy_.queueDelayTarget > 0 && queueDelayExceeded(lag, now);
+    Decision decision = kAdmit;
+    if(policy_.maxConnections > 0 && connections >= policy_.maxConnections) {
+        decision = kMaxConnections;
+    }
+    else if(policy_.maxQueueSize > 0 && queueSize >= policy_.maxQueueSize) {
+        decision = kQueueSize;
+    }
+    else if(policy_.maxLoopLag > 0 && lag >= policy_.maxLoopLag) {
+        decision = kLoopLag;
+    }
+    else if(delayExceeded) {
+        decision = kQueueDelay;
+    }
+    ++counts_[decision];
+    if(decision != kAdmit) {
+        g_shed[decision]->increment();
+    }
+    return decision;
+}
+
+// 延迟一旦低于目标就退出拒绝状态 重新计时
+bool AdmissionController::queueDelayExceeded(double lag, Timestamp now) {
+    if(lag < policy_.queueDelayTarget) {
+        firstAboveTime_ = Timestamp::invalid();
+        dropping_ = false;
+    }
+    else if(!firstAboveTime_.valid()) {
+        firstAboveTime_ = addTime(now, policy_.queueDelayInterval);
+    }
+    else if(now >= firstAboveTime_) {
+        dropping_ = true;
+    }
+    return dropping_;
+}
+
+int64_t AdmissionController::shed() const {
+    int64_t total = 0;
+    for(int i = kAdmit + 1; i < kNumDecisions; ++i) {
+        total += counts_[i];
+    }
+    return total;
+}
+
+const char* AdmissionController::decisionName(Decision decision) {
+    switch(decision) {
+        case kAdmit: return "admit";
+        case kMaxConnections: return "max_connections";
+        case kQueueSize: return "queue_size";
+        case kLoopLag: return "loop_lag";
+        case kQueueDelay: return "queue_delay";
+        default: return "unknown";
+    }
+}
+
+}   // namespace net
+
+}   // namespace myserver
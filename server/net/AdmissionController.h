@@ -0,0 +1,85 @@
+/**
+* @description: AdmissionController.h
+* @author: YQ Huang
+* @brief: 新连接的准入控制 过载时在accept之后立刻拒绝 不让已有的连接跟着变慢
+* @date: 2026/10/19 06:38:52
+*/
+
+#pragma once
+
+#include "server/base/noncopyable.h"
+#include "server/base/Timestamp.h"
+#include "server/base/Types.h"
+
+#include <stdint.h>
+
+namespace myserver {
+
+namespace net {
+
+/**
+ * 各项为0表示不检查
+ * queueDelayTarget是CoDel的判断方式: 事件循环的延迟在一整个queueDelayInterval内
+ * 都高于queueDelayTarget 说明积压不是偶然的突发 开始拒绝 直到延迟回到目标以下
+ */
+struct AdmissionPolicy {
+    size_t maxConnections;      // 这个TcpServer的连接数上限
+    size_t maxQueueSize;        // EventLoop里等待执行的任务数上限
+    double maxLoopLag;          // EventLoop::lag()的上限 单位秒
+    double queueDelayTarget;    // 单位秒 常用0.005
+    double queueDelayInterval;  // 单位秒 默认0.1
+    string rejectMessage;       // 拒绝时尽量写给对端再关闭 为空时直接关闭
+
+    AdmissionPolicy()
+        : maxConnections(0),
+          maxQueueSize(0),
+          maxLoopLag(0),
+          queueDelayTarget(0),
+          queueDelayInterval(0.1)
+    { }
+};
+
+/**
+ * TcpServer在每次accept之后 创建TcpConnection之前调用admit()
+ * 被拒绝的连接只花一次close(可能还有一次write) 不分配连接对象
+ * 只在TcpServer的IO线程使用
+ */
+class AdmissionController : noncopyable {
+public:
+    enum Decision {
+        kAdmit,
+        kMaxConnections,
+        kQueueSize,
+        kLoopLag,
+        kQueueDelay,
+        kNumDecisions,
+    };
+
+    explicit AdmissionController(const AdmissionPolicy& policy);
+
+    const AdmissionPolicy& policy() const { return policy_; }
+
+    // connections是当前的连接数 queueSize和lag来自EventLoop now是当前时间
+    Decision admit(size_t connections, size_t queueSize, double lag, Timestamp now);
+
+    // 按结果统计的连接数
+    int64_t count(Decision decision) const { return counts_[decision]; }
+    int64_t admitted() const { return counts_[kAdmit]; }
+    int64_t shed() const;
+    // 是否处于CoDel的拒绝状态
+    bool dropping() const { return dropping_; }
+
+    static const char* decisionName(Decision decision);
+
+private:
+    bool queueDelayExceeded(double lag, Timestamp now);
+
+    const AdmissionPolicy policy_;
+    Timestamp firstAboveTime_;      // 延迟高于目标之后 到这个时刻还没降下来就开始拒绝
+    bool dropping_;
+    int64_t counts_[kNumDecisions];
+};
+
+}   // namespace net
+
+}   // namespace myserver
@@ -0,0 +1,166 @@
+/**
+* @description: Backpressure.cc
+* @author: YQ Huang
+* @brief: 下游处理不过来时暂停上游连接的读 把积压留在内核的接收缓冲区和TCP窗口里
+* @date: 2026/10/19 04:40:34
+*/
+
+#include "server/net/Backpressure.h"
+
+#include "server/base/Metrics.h"
+#include "server/base/ThreadPool.h"
+#include "server/net/EventLoop.h"
+#include "server/net/TcpConnection.h"
+
+#include <algorithm>
+#include <assert.h>
+
+namespace myserver {
+
+namespace net {
+
+namespace {
+
+Counter* const g_pauses = MetricsRegistry::instance().counter(
+    "myserver_backpressure_pauses_total", "Times a ReadGate paused reading on its sources");
+
+}   // namespace
+
+ReadGate::ReadGate()
+    : closed_(0),
+      pauses_(0)
+{
+}
+
+void ReadGate::add(const TcpConnectionPtr& source) {
+    bool closed;
+    {
+        MutexLockGuard lock(mutex_);
+        // 顺便清理已经释放的连接
+        sources_.erase(std::remove_if(sources_.begin(), sources_.end(),
+                                      [](const std::weak_ptr<TcpConnection>& s) { return s.expired(); }),
+                       sources_.end());
+        sources_.push_back(source);
+        closed = closed_ > 0;
+    }
+    if(closed) {
+        apply(source);
+    }
+}
+
+void ReadGate::close() {
+    bool changed;
+    {
+        MutexLockGuard lock(mutex_);
+        changed = closed_++ == 0;
+        if(changed) {
+            ++pauses_;
+        }
+    }
+    if(changed) {
+        g_pauses->increment();
+        update();
+    }
+}
+
+void ReadGate::open() {
+    bool changed;
+    {
+        MutexLockGuard lock(mutex_);
+        assert(closed_ > 0);
+        changed = closed_ > 0 && --closed_ == 0;
+    }
+    if(changed) {
+        update();
+    }
+}
+
+bool ReadGate::isOpen() const {
+    MutexLockGuard lock(mutex_);
+    return closed_ == 0;
+}
+
+int64_t ReadGate::pauses() const {
+    MutexLockGuard lock(mutex_);
+    return pauses_;
+}
+
+// 复制一份再逐个处理 不在持有mutex_时调用EventLoop
+void ReadGate::update() {
+    std::vector<std::weak_ptr<TcpConnection> > sources;
+    {
+        MutexLockGuard lock(mutex_);
+        sources = sources_;
+    }
+    for(const std::weak_ptr<TcpConnection>& source : sources) {
+        apply(source);
+    }
+}
+
+/**
+ * 调用者可能持有ThreadPool的锁 所以总是queueInLoop 不在当前线程直接修改
+ * 执行时才读取开关的状态 连续的close()和open()不会因为执行顺序留下错误的结果
+ */
+void ReadGate::apply(const std::weak_ptr<TcpConnection>& weakSource) {
+    TcpConnectionPtr source(weakSource.lock());
+    if(!source) {
+        return;
+    }
+    std::weak_ptr<ReadGate> weakGate(shared_from_this());
+    source->getLoop()->queueInLoop([weakGate, weakSource]() {
+        ReadGatePtr gate(weakGate.lock());
+        TcpConnectionPtr conn(weakSource.lock());
+        if(!gate || !conn || !conn->connected()) {
+            return;
+        }
+        if(gate->isOpen()) {
+            conn->startRead();
+        }
+        else {
+            conn->stopRead();
+        }
+    });
+}
+
+namespace backpressure {
+
+void link(const ReadGatePtr& gate, const TcpConnectionPtr& sink, size_t highMark, size_t lowMark) {
+    assert(lowMark < highMark);
+    sink->getLoop()->assertInLoopThread();
+    // 缓冲区没降到低水位又越过高水位时 高水位回调会再来一次 这里保证close()和open()成对
+    std::shared_ptr<bool> closed(std::make_shared<bool>(false));
+    sink->setHighWaterMarkCallback([gate, closed](const TcpConnectionPtr&, size_t) {
+        if(!*closed) {
+            *closed = true;
+            gate->close();
+        }
+    }, highMark);
+    sink->setLowWaterMarkCallback([gate, closed](const TcpConnectionPtr&, size_t) {
+        if(*closed) {
+            *closed = false;
+            gate->open();
+        }
+    }, lowMark);
+}
+
+ReadGatePtr link(const TcpConnectionPtr& source, const TcpConnectionPtr& sink,
+                 size_t highMark, size_t lowMark)
+{
+    ReadGatePtr gate(std::make_shared<ReadGate>());
+    gate->add(source);
+    link(gate, sink, highMark, lowMark);
+    return gate;
+}
+
+void link(const ReadGatePtr& gate, ThreadPool* pool, size_t highMark, size_t lowMark) {
+    assert(lowMark < highMark);
+    pool->setQueueWaterMarks(highMark, lowMark,
+                             [gate]() { gate->close(); },
+                             [gate]() { gate->open(); });
+}
+
+}   // namespace backpressure
+
+}   // namespace net
+
+}   // namespace myserver
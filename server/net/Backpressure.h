@@ -0,0 +1,86 @@
+/**
+* @description: Backpressure.h
+* @author: YQ Huang
+* @brief: 下游处理不过来时暂停上游连接的读 把积压留在内核的接收缓冲区和TCP窗口里
+* @date: 2026/10/19 04:40:27
+*/
+
+#pragma once
+
+#include "server/base/Mutex.h"
+#include "server/base/noncopyable.h"
+#include "server/net/Callbacks.h"
+
+#include <memory>
+#include <vector>
+
+namespace myserver {
+
+class ThreadPool;
+
+namespace net {
+
+/**
+ * 一组上游连接(source)共同的读开关 关闭时source都stopRead() 打开时startRead()
+ * 对端继续发送的数据留在内核里 TCP窗口填满后对端自然就发不出去了
+ *
+ * 关闭可以嵌套 多个下游各自close()一次 全部open()之后才恢复读
+ * 开关可以在任何线程操作 对连接的修改都经过queueInLoop在连接的IO线程执行
+ * 执行时按开关当时的状态处理 所以先后多次修改只留下最后的结果
+ *
+ * ReadGate只持有source的weak_ptr 连接关闭后自动忽略
+ * 加入开关的连接不要再自己调用startRead()/stopRead() 否则会被开关覆盖
+ */
+class ReadGate : noncopyable,
+                 public std::enable_shared_from_this<ReadGate>
+{
+public:
+    ReadGate();
+
+    // 开关已经关闭时source立刻暂停读
+    void add(const TcpConnectionPtr& source);
+
+    void close();
+    void open();
+    bool isOpen() const;
+    // 从打开变成关闭的次数
+    int64_t pauses() const;
+
+private:
+    void update();
+    void apply(const std::weak_ptr<TcpConnection>& weakSource);
+
+    mutable MutexLock mutex_;
+    int closed_;
+    int64_t pauses_;
+    std::vector<std::weak_ptr<TcpConnection> > sources_;
+};
+
+typedef std::shared_ptr<ReadGate> ReadGatePtr;
+
+namespace backpressure {
+
+/**
+ * sink的输出缓冲区达到highMark时关闭gate 发送到不超过lowMark时打开
+ * 会替换sink的高低水位回调 需要在sink的IO线程调用 例如在连接回调里
+ * sink在高水位之上断开时 TcpConnection补一次低水位回调 gate随之打开
+ * source恢复读 代理通常还应该同时关闭source
+ */
+void link(const ReadGatePtr& gate, const TcpConnectionPtr& sink, size_t highMark, size_t lowMark);
+
+// 创建只包含source的gate并连接到sink 例如代理的两个方向各调用一次
+ReadGatePtr link(const TcpConnectionPtr& source, const TcpConnectionPtr& sink,
+                 size_t highMark, size_t lowMark);
+
+/**
+ * 线程池的任务队列达到highMark时关闭gate 降到lowMark时打开
+ * 用ThreadPool::setQueueWaterMarks()实现 需要在pool->start()之前调用
+ * IO线程把请求交给线程池计算时 用这个代替setMaxQueueSize() IO线程不会阻塞
+ */
+void link(const ReadGatePtr& gate, ThreadPool* pool, size_t highMark, size_t lowMark);
+
+}   // namespace backpressure
+
+}   // namespace net
+
+}   // namespace myserver
@@ -24,7 +24,7 @@ const size_t Buffer::kInitialSize;
 ssize_t Buffer::readFd(int fd, int* savedErrno) {
     char extrabuf[65536];
     struct iovec vec[2];
-    const size_t writable = writerIndex_;
+    const size_t writable = writableBytes();
     vec[0].iov_base = begin() + writerIndex_;
     vec[0].iov_len = writable;
     vec[1].iov_base = extrabuf;
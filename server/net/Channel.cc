@@ -7,6 +7,7 @@
 
 #include "server/net/Channel.h"
 
+#include "server/base/CurrentThread.h"
 #include "server/base/Logging.h"
 #include "server/net/EventLoop.h"
 
@@ -77,6 +78,27 @@ string Channel::eventsToString() const {
     return eventsToString(fd_, events_);
 }
 
+// 与handleEventWithGuard()的判断顺序相同 std::bind生成的类型名里包含成员函数所属的类
+string Channel::callbackToString() const {
+    string result;
+    if((revents_ & POLLHUP) && !(revents_ & POLLIN) && closeCallback_) {
+        result += "close=" + CurrentThread::demangle(closeCallback_.target_type().name()) + " ";
+    }
+    if((revents_ & (POLLERR | POLLNVAL)) && errorCallback_) {
+        result += "error=" + CurrentThread::demangle(errorCallback_.target_type().name()) + " ";
+    }
+    if((revents_ & (POLLIN | POLLPRI | POLLRDHUP)) && readCallback_) {
+        result += "read=" + CurrentThread::demangle(readCallback_.target_type().name()) + " ";
+    }
+    if((revents_ & POLLOUT) && writeCallback_) {
+        result += "write=" + CurrentThread::demangle(writeCallback_.target_type().name()) + " ";
+    }
+    if(!result.empty()) {
+        result.resize(result.size() - 1);
+    }
+    return result;
+}
+
 // 关闭fd上注册的事件 并从Poll中移除
 void Channel::remove() {
     assert(isNoneEvent());
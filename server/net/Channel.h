@@ -76,6 +76,8 @@ public:
     // 事件转换为字符串，方便打印调试
     string reventsToString() const;
     string eventsToString() const;
+    // 本次revents_会调用的回调的类型名 用于定位慢回调
+    string callbackToString() const;
 
     void doNotLogHup() { logHup_ = false; }
 
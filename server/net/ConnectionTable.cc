@@ -0,0 +1,122 @@
+/**
+* @description: ConnectionTable.cc
+* @author: YQ Huang
+* @brief: 连接ID到TcpConnection的开放寻址哈希表
+* @date: 2026/10/18 23:31:12
+*/
+
+#include "server/net/ConnectionTable.h"
+#include "server/net/TcpConnection.h"
+
+#include <utility>
+#include <assert.h>
+
+namespace myserver {
+
+namespace net {
+
+ConnectionTable::ConnectionTable()
+    : slots_(kInitialCapacity),
+      mask_(kInitialCapacity - 1),
+      shift_(64 - 6),
+      size_(0)
+{
+    static_assert(kInitialCapacity == 1 << 6, "shift_ must match kInitialCapacity");
+}
+
+void ConnectionTable::insert(uint64_t id, const TcpConnectionPtr& conn) {
+    assert(id != 0);
+    if((size_ + 1) * 2 > slots_.size()) {
+        grow();
+    }
+    size_t i = slotOf(id);
+    while(slots_[i].id != 0) {
+        assert(slots_[i].id != id);
+        i = (i + 1) & mask_;
+    }
+    slots_[i].id = id;
+    slots_[i].conn = conn;
+    ++size_;
+}
+
+const TcpConnectionPtr* ConnectionTable::find(uint64_t id) const {
+    if(id == 0) {
+        return NULL;
+    }
+    for(size_t i = slotOf(id); slots_[i].id != 0; i = (i + 1) & mask_) {
+        if(slots_[i].id == id) {
+            return &slots_[i].conn;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 删除后留下的空槽会截断探测链 把后面的元素中理想位置不在(hole, j]之间的移到空槽
+ * 直到遇到空槽为止
+ */
+bool ConnectionTable::erase(uint64_t id) {
+    if(id == 0) {
+        return false;
+    }
+    size_t hole = slotOf(id);
+    while(slots_[hole].id != id) {
+        if(slots_[hole].id == 0) {
+            return false;
+        }
+        hole = (hole + 1) & mask_;
+    }
+    slots_[hole].conn.reset();
+    for(size_t j = (hole + 1) & mask_; slots_[j].id != 0; j = (j + 1) & mask_) {
+        size_t home = slotOf(slots_[j].id);
+        // home在循环区间(hole, j]内时元素不能移动
+        bool stay = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+        if(!stay) {
+            slots_[hole].id = slots_[j].id;
+            slots_[hole].conn.swap(slots_[j].conn);
+            hole = j;
+        }
+    }
+    slots_[hole].id = 0;
+    --size_;
+    return true;
+}
+
+void ConnectionTable::clear() {
+    for(Slot& slot : slots_) {
+        slot.id = 0;
+        slot.conn.reset();
+    }
+    size_ = 0;
+}
+
+void ConnectionTable::swap(ConnectionTable& rhs) {
+    slots_.swap(rhs.slots_);
+    std::swap(mask_, rhs.mask_);
+    std::swap(shift_, rhs.shift_);
+    std::swap(size_, rhs.size_);
+}
+
+void ConnectionTable::grow() {
+    std::vector<Slot> old;
+    old.swap(slots_);
+    slots_.resize(old.size() * 2);
+    mask_ = slots_.size() - 1;
+    --shift_;
+    size_ = 0;
+    for(Slot& slot : old) {
+        if(slot.id != 0) {
+            size_t i = slotOf(slot.id);
+            while(slots_[i].id != 0) {
+                i = (i + 1) & mask_;
+            }
+            slots_[i].id = slot.id;
+            slots_[i].conn.swap(slot.conn);
+            ++size_;
+        }
+    }
+}
+
+}   // namespace net
+
+}   // namespace myserver
@@ -0,0 +1,75 @@
+/**
+* @description: ConnectionTable.h
+* @author: YQ Huang
+* @brief: 连接ID到TcpConnection的开放寻址哈希表
+* @date: 2026/10/18 23:31:05
+*/
+
+#pragma once
+
+#include "server/base/noncopyable.h"
+#include "server/net/Callbacks.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace myserver {
+
+namespace net {
+
+/**
+ * 线性探测的开放寻址哈希表 键是TcpServer分配的64位连接ID 0表示空槽
+ * 所有槽位放在一个数组里 查找 插入和删除都不分配内存(扩容除外) 也没有字符串比较
+ * 删除时把后面同一探测链上的元素往前移 不使用墓碑 负载因子保持在1/2以下
+ * 不是线程安全的 只在TcpServer的IO线程里使用
+ */
+class ConnectionTable : noncopyable {
+public:
+    ConnectionTable();
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // id必须不为0且不在表中
+    void insert(uint64_t id, const TcpConnectionPtr& conn);
+    // 返回是否删除了
+    bool erase(uint64_t id);
+    // 找不到时返回NULL
+    const TcpConnectionPtr* find(uint64_t id) const;
+    void clear();
+    void swap(ConnectionTable& rhs);
+
+    // 遍历所有连接 遍历期间不能修改表
+    template<typename F>
+    void forEach(F f) const {
+        for(const Slot& slot : slots_) {
+            if(slot.id != 0) {
+                f(slot.id, slot.conn);
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        uint64_t id;
+        TcpConnectionPtr conn;
+        Slot() : id(0) { }
+    };
+
+    static const size_t kInitialCapacity = 64;
+
+    // Fibonacci哈希 连续的ID均匀地分散到各个槽
+    size_t slotOf(uint64_t id) const {
+        return static_cast<size_t>((id * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+    void grow();
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    int shift_;
+    size_t size_;
+};
+
+}   // namespace net
+
+}   // namespace myserver
@@ -7,16 +7,21 @@
 
 #include "server/net/EventLoop.h"
 
+#include "server/base/Affinity.h"
 #include "server/base/Logging.h"
 #include "server/base/Mutex.h"
+#include "server/base/Slab.h"
 #include "server/net/Channel.h"
 #include "server/net/Poller.h"
+#include "server/net/Socket.h"
 #include "server/net/SocketsOps.h"
 #include "server/net/TimerQueue.h"
 
 #include <algorithm>
 #include <signal.h>
+#include <stdio.h>
 #include <sys/eventfd.h>
+#include <time.h>
 #include <unistd.h>
 
 namespace myserver {
@@ -28,6 +33,13 @@ __thread EventLoop* t_loopInThisThread = 0;
 // 传递给epoll_wait timeout的参数 这是等待10秒
 const int kPollTimeMs = 10000;
 
+// 统计耗时用的单调时钟 单位纳秒
+int64_t monotonicNanos() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
 // 创建事件通知描述符
 int createEventfd() {
     int evtfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
@@ -65,11 +77,25 @@ EventLoop::EventLoop()
       eventHandling_(false),
       callingPendingFunctors_(false),
       iteration_(0),
+      lagUs_(0),
       threadId_(CurrentThread::tid()),
+      pinnedCpu_(-1),
+      numaNode_(-1),
+      spinBudgetUs_(0),
+      kernelBusyPollUs_(0),
+      socketBusyPollUs_(0),
+      spinWakeups_(0),
+      sleepWakeups_(0),
+      emptySpins_(0),
+      statsEnabled_(false),
+      slowCallbackNs_(100 * 1000 * 1000),
+      slowCallbacks_(0),
+      pollReturnTime_(Timestamp::nowFast()),
       poller_(Poller::newDefaultPoller(this)),
       timerQueue_(new TimerQueue(this)),
       wakeupFd_(createEventfd()),
       wakeupChannel_(new Channel(this, wakeupFd_)),
+      connectionSlab_(std::make_shared<Slab>()),
       currentActiveChannel_(NULL)
 {
     LOG_TRACE << "EventLoop created " << this << " in thread " << threadId_;
@@ -80,6 +106,13 @@ EventLoop::EventLoop()
     else {
         t_loopInThisThread = this;
     }
+    // EventLoopThread在创建EventLoop之前已经设置好CPU亲和性 只认显式的设置
+    pinnedCpu_ = CpuSet::pinnedCpuOfCurrentThread();
+    if(pinnedCpu_ >= 0) {
+        numaNode_ = Numa::nodeOfCpu(pinnedCpu_);
+        LOG_DEBUG << "EventLoop " << this << " pinned to cpu " << pinnedCpu_
+                  << " numa node " << numaNode_;
+    }
     // 设置唤醒channel的可读事件回调，并注册到Poller中
     wakeupChannel_->setReadCallback(
         std::bind(&EventLoop::handleRead, this));
@@ -118,28 +151,164 @@ void EventLoop::loop() {
     while(!quit_) {
         activeChannels_.clear();
         // 调用Poller::poll()获得当前活动事件的 超时10s
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
-        ++iteration_;
-        if(Logger::logLevel() <= Logger::TRACE) {
+        int64_t pollStart = statsEnabled_ ? monotonicNanos() : 0;
+        pollReturnTime_ = poll();
+        if(statsEnabled_) {
+            pollWaitHist_.record(monotonicNanos() - pollStart);
+        }
+        iteration_.store(iteration_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if(MYSERVER_LOG_ENABLED(Logger::TRACE)) {
             printActiveChannels();
         }
 
         // 然后依次调用每个Channel的handleEvent函数
-        eventHandling_ = true;
-        for(Channel* channel : activeChannels_) {
-            currentActiveChannel_ = channel;
-            currentActiveChannel_->handleEvent(pollReturnTime_);
-        }
-        currentActiveChannel_ = NULL;
-        eventHandling_ = false;
+        handleActiveChannels();
         // 处理计算任务
         doPendingFunctors();
+        lagUs_ = Timestamp::nowFast().microSecondsSinceEpoch() - pollReturnTime_.microSecondsSinceEpoch();
     }
 
     LOG_TRACE << "EventLoop " << this << " stop looping";
     looping_ = false;
 }
 
+/**
+ * 开启统计时 相邻两个回调共用一次时钟读数
+ * Channel至少活到这一轮的pending functor执行时 所以回调之后还可以访问
+ */
+void EventLoop::handleActiveChannels() {
+    eventHandling_ = true;
+    if(statsEnabled_) {
+        int64_t start = monotonicNanos();
+        for(Channel* channel : activeChannels_) {
+            currentActiveChannel_ = channel;
+            currentActiveChannel_->handleEvent(pollReturnTime_);
+            int64_t end = monotonicNanos();
+            int64_t elapsed = end - start;
+            if(channel->fd() == timerQueue_->fd()) {
+                timersHist_.record(elapsed);
+            }
+            else {
+                eventHandlingHist_.record(elapsed);
+            }
+            if(slowCallbackNs_ > 0 && elapsed > slowCallbackNs_) {
+                reportSlowCallback(elapsed, channel, NULL);
+            }
+            start = end;
+        }
+    }
+    else {
+        for(Channel* channel : activeChannels_) {
+            currentActiveChannel_ = channel;
+            currentActiveChannel_->handleEvent(pollReturnTime_);
+        }
+    }
+    currentActiveChannel_ = NULL;
+    eventHandling_ = false;
+}
+
+void EventLoop::reportSlowCallback(int64_t elapsedNs, const Channel* channel, const Functor* functor) {
+    slowCallbacks_.store(slowCallbacks_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if(channel) {
+        LOG_WARN << "EventLoop " << this << " slow callback " << elapsedNs / 1000 << "us fd="
+                 << channel->fd() << (channel->fd() == timerQueue_->fd() ? " timers" : "")
+                 << " revents=" << channel->reventsToString() << channel->callbackToString();
+    }
+    else {
+        LOG_WARN << "EventLoop " << this << " slow pending functor " << elapsedNs / 1000 << "us "
+                 << CurrentThread::demangle(functor->target_type().name());
+    }
+}
+
+void EventLoop::setSlowCallbackThreshold(double seconds) {
+    slowCallbackNs_ = static_cast<int64_t>(seconds * 1000 * 1000 * 1000);
+}
+
+EventLoopStats EventLoop::stats() const {
+    EventLoopStats result;
+    result.iterations = iteration_.load(std::memory_order_relaxed);
+    result.slowCallbacks = slowCallbacks_.load(std::memory_order_relaxed);
+    result.pollWait = pollWaitHist_.snapshot();
+    result.eventHandling = eventHandlingHist_.snapshot();
+    result.pendingFunctors = pendingFunctorsHist_.snapshot();
+    result.timers = timersHist_.snapshot();
+    return result;
+}
+
+void EventLoop::resetStats() {
+    assertInLoopThread();
+    slowCallbacks_.store(0, std::memory_order_relaxed);
+    pollWaitHist_.reset();
+    eventHandlingHist_.reset();
+    pendingFunctorsHist_.reset();
+    timersHist_.reset();
+}
+
+string EventLoopStats::toString() const {
+    char buf[64];
+    snprintf(buf, sizeof buf, "iterations=%lld slow_callbacks=%lld\n",
+             static_cast<long long>(iterations), static_cast<long long>(slowCallbacks));
+    string result(buf);
+    result += "poll_wait_ns " + pollWait.toString() + "\n";
+    result += "event_handling_ns " + eventHandling.toString() + "\n";
+    result += "pending_functors_ns " + pendingFunctors.toString() + "\n";
+    result += "timers_ns " + timers.toString() + "\n";
+    return result;
+}
+
+/**
+ * 混合模式下先自旋 spinBudgetUs_内一直没有事件才阻塞等待
+ * 其他线程的queueInLoop()和quit()都会写eventfd 定时器到期会让timerfd可读
+ * 所以自旋时只需要看有没有活跃的Channel
+ */
+Timestamp EventLoop::poll() {
+    if(spinBudgetUs_ > 0) {
+        Timestamp deadline;
+        for(;;) {
+            Timestamp now = poller_->poll(0, &activeChannels_);
+            if(!activeChannels_.empty()) {
+                ++spinWakeups_;
+                return now;
+            }
+            if(quit_) {
+                return now;
+            }
+            if(!deadline.valid()) {
+                deadline = Timestamp(now.microSecondsSinceEpoch() + spinBudgetUs_);
+            }
+            else if(!(now < deadline)) {
+                break;
+            }
+            ++emptySpins_;
+        }
+    }
+    Timestamp now = poller_->poll(kPollTimeMs, &activeChannels_);
+    ++sleepWakeups_;
+    return now;
+}
+
+void EventLoop::setKernelBusyPoll(int usec) {
+    kernelBusyPollUs_ = usec;
+    int err = poller_->setBusyPoll(usec);
+    if(err != 0) {
+        LOG_WARN << "EventLoop " << this << " epoll busy poll " << usec
+                 << "us not supported: " << strerror_tl(err);
+    }
+    // 没有权限时每个连接都会失败 只在这里报告一次
+    socketBusyPollUs_ = 0;
+    if(usec > 0) {
+        Socket probe(sockets::createNonblockingOrDie(AF_INET));
+        err = probe.setBusyPoll(usec);
+        if(err == 0) {
+            socketBusyPollUs_ = usec;
+        }
+        else {
+            LOG_WARN << "EventLoop " << this << " SO_BUSY_POLL " << usec
+                     << "us not supported: " << strerror_tl(err);
+        }
+    }
+}
+
 //
 void EventLoop::quit() {
     quit_ = true;
@@ -168,6 +337,7 @@ void EventLoop::runInLoop(Functor cb) {
  * 1) 如果调用queueInLoop()的线程不是IO线程，那么唤醒
  * 2) 如果在IO线程调用queueInLoop()，而此时正在调用pendingFunctor 否则这些新加入的
  *    cb就不能及时调用了
+ * 3) 在IO线程里还没有进入loop() 否则第一次poll要等到超时
  * 
  * 换句话说，只有在IO线程的事件回调中调用queueInLoop()才无须wakeup
  */
@@ -176,7 +346,7 @@ void EventLoop::queueInLoop(Functor cb) {
         MutexLockGuard lock(mutex_);
         pendingFunctors_.push_back(std::move(cb));
     }
-    if(!isInLoopThread() || callingPendingFunctors_) {
+    if(!isInLoopThread() || callingPendingFunctors_ || !looping_) {
         wakeup();
     }
 }
@@ -194,13 +364,13 @@ TimerId EventLoop::runAt(Timestamp time, TimerCallback cb) {
 
 // 在延迟delay之后执行
 TimerId EventLoop::runAfter(double delay, TimerCallback cb) {
-    Timestamp time(addTime(Timestamp::now(), delay));
+    Timestamp time(addTime(Timestamp::nowFast(), delay));
     return runAt(time, std::move(cb));
 }
 
 // 间隔interval重复执行
 TimerId EventLoop::runEvery(double interval, TimerCallback cb) {
-    Timestamp time(addTime(Timestamp::now(), interval));
+    Timestamp time(addTime(Timestamp::nowFast(), interval));
     return timerQueue_->addTimer(std::move(cb), time, interval);
 }
 
@@ -285,8 +455,23 @@ void EventLoop::doPendingFunctors() {
         functors.swap(pendingFunctors_);
     }
 
-    for(const Functor& functor : functors) {
-        functor();
+    if(statsEnabled_ && !functors.empty()) {
+        int64_t start = monotonicNanos();
+        int64_t last = start;
+        for(const Functor& functor : functors) {
+            functor();
+            int64_t now = monotonicNanos();
+            if(slowCallbackNs_ > 0 && now - last > slowCallbackNs_) {
+                reportSlowCallback(now - last, NULL, &functor);
+            }
+            last = now;
+        }
+        pendingFunctorsHist_.record(last - start);
+    }
+    else {
+        for(const Functor& functor : functors) {
+            functor();
+        }
     }
     callingPendingFunctors_ = false;
 }
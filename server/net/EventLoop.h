@@ -11,22 +11,40 @@
 #include <functional>
 #include <vector>
 
-#include <boost/any.hpp>
-
+#include "server/base/Context.h"
 #include "server/base/Mutex.h"
 #include "server/base/CurrentThread.h"
+#include "server/base/Histogram.h"
 #include "server/base/Timestamp.h"
 #include "server/net/Callbacks.h"
 #include "server/net/TimerId.h"
 
 namespace myserver {
 
+class Slab;
+
 namespace net {
 
 class Channel;
 class Poller;
 class TimerQueue;
 
+/**
+ * EventLoop各个阶段耗时的分布 单位纳秒
+ */
+struct EventLoopStats {
+    int64_t iterations;                 // 事件循环的次数
+    int64_t slowCallbacks;              // 超过阈值的回调个数
+    HistogramSnapshot pollWait;         // 每次epoll_wait阻塞和自旋的时间
+    HistogramSnapshot eventHandling;    // 每个IO事件回调的时间 不含定时器
+    HistogramSnapshot pendingFunctors;  // 每次doPendingFunctors()的时间
+    HistogramSnapshot timers;           // 每次处理到期定时器的时间
+
+    EventLoopStats() : iterations(0), slowCallbacks(0) { }
+    // 每个阶段一行
+    string toString() const;
+};
+
 /**
  * one loop per thread 每个线程最多只能有一个EventLoop对象
  * 创建了EventLoop对象的线程称为IO线程，其功能是运行事件循环
@@ -47,8 +65,64 @@ public:
 
     // 返回poll return的时刻
     Timestamp pollReturnTime() const { return pollReturnTime_; }
-    // 事件循环的次数
-    int64_t iteration() const { return iteration_; }
+    /**
+     * 每轮循环在poll返回时刷新一次的当前时间 读取它不需要读时钟
+     * 落后真实时间的部分是本轮已经处理事件的时间 可以容忍这个误差的回调(例如空闲超时)使用
+     * 只能在IO线程调用
+     */
+    Timestamp cachedNow() const { return pollReturnTime_; }
+    // 事件循环的次数 可以在任意线程调用
+    int64_t iteration() const { return iteration_.load(std::memory_order_relaxed); }
+    /**
+     * 上一轮循环从poll返回到处理完IO事件和任务所用的秒数
+     * 过载时新到的事件大约要等这么久才被处理 用于准入控制 只能在IO线程调用
+     */
+    double lag() const { return static_cast<double>(lagUs_) / Timestamp::kMicroSecondsPerSecond; }
+    // IO线程通过EventLoopThread或Thread显式固定在唯一的一个CPU上时返回它 否则返回-1
+    int pinnedCpu() const { return pinnedCpu_; }
+    // IO线程所在的NUMA节点 不确定时返回-1
+    int numaNode() const { return numaNode_; }
+
+    /**
+     * 混合轮询 在loop()之前或IO线程内调用
+     * usec > 0时 每次阻塞在epoll_wait之前先用timeout=0的epoll_wait自旋usec微秒
+     * 自旋期间有事件就立刻处理 省去线程睡眠和唤醒的开销 代价是空闲时多占用CPU
+     * usec = 0时关闭 始终阻塞等待(默认)
+     */
+    void setSpinBudget(int64_t usec) { spinBudgetUs_ = usec; }
+    int64_t spinBudget() const { return spinBudgetUs_; }
+    /**
+     * 内核busy poll 设置epoll实例的busy_poll_usecs 并对这个IO线程上新建的连接设置SO_BUSY_POLL
+     * 让内核在epoll_wait/recv时直接轮询网卡队列 需要网卡驱动支持NAPI 失败时只记录日志
+     * SO_BUSY_POLL先在一个临时socket上试一次 失败(例如没有CAP_NET_ADMIN)时新连接不再设置
+     * usec = 0时关闭 在IO线程启动之前或IO线程调用
+     */
+    void setKernelBusyPoll(int usec);
+    int kernelBusyPoll() const { return kernelBusyPollUs_; }
+    // 新连接的SO_BUSY_POLL微秒数 0表示不设置
+    int socketBusyPoll() const { return socketBusyPollUs_; }
+    // 自旋期间等到事件的次数
+    int64_t spinWakeups() const { return spinWakeups_; }
+    // 阻塞等待后返回的次数
+    int64_t sleepWakeups() const { return sleepWakeups_; }
+    // 自旋时没有事件的epoll_wait次数
+    int64_t emptySpins() const { return emptySpins_; }
+
+    /**
+     * 统计各个阶段的耗时 默认关闭 开启后每个回调前后各读一次时钟
+     * MetricsServer::addEventLoop()会打开它 在loop()之前或IO线程内调用
+     */
+    void setStatsEnabled(bool on) { statsEnabled_ = on; }
+    bool statsEnabled() const { return statsEnabled_; }
+    /**
+     * 单个IO事件回调 定时器或任务回调超过seconds秒时记录WARN日志
+     * 包括Channel的fd 事件和回调的类型名 0表示不检测 默认0.1秒 需要开启统计
+     */
+    void setSlowCallbackThreshold(double seconds);
+    // 各阶段耗时分布的副本 可以在任意线程调用
+    EventLoopStats stats() const;
+    // 清空统计 在IO线程内调用
+    void resetStats();
 
     // 在IO线程内运行某个用户任务回调
     void runInLoop(Functor cb);
@@ -83,13 +157,17 @@ public:
     // 判断EventLoop是否在分发事件
     bool eventHanding() const { return eventHandling_; }
 
-    void setContext(const boost::any& context) { context_ = context; }
-    
-    //
-    const boost::any& getContext() const { return context_; }
+    // 与TcpConnection的上下文相同 放在IO线程上的共享状态
+    template<typename T>
+    void setContext(T&& context)
+    { context_.emplace<typename std::decay<T>::type>(std::forward<T>(context)); }
 
-    //
-    boost::any* getMutableContext() { return &context_; }
+    const Context& getContext() const { return context_; }
+
+    Context* getMutableContext() { return &context_; }
+
+    // 在这个IO线程上的TcpConnection从这里分配
+    const std::shared_ptr<Slab>& connectionSlab() const { return connectionSlab_; }
 
     // 返回当前线程内的EventLoop对象
     static EventLoop* geteventLoopOfCurrentThread();
@@ -98,6 +176,9 @@ private:
     void abortNotInLoopThread();    // 不在IO线程里
     void handleRead();              // 将事件通知描述符里的内容读走，以便让其检测事件通知
     void doPendingFunctors();       // 执行转交给IO的任务
+    Timestamp poll();               // 按轮询模式等待IO事件 填充activeChannels_
+    void handleActiveChannels();    // 调用每个活跃Channel的handleEvent
+    void reportSlowCallback(int64_t elapsedNs, const Channel* channel, const Functor* functor);
 
     void printActiveChannels() const;   // DEBUG 将发生的事件写入日志
 
@@ -107,14 +188,31 @@ private:
     std::atomic<bool> quit_;            // 是否退出事件循环
     bool eventHandling_;                // EventLoop是否在分发事件
     bool callingPendingFunctors_;       // EventLoop是否在处理任务
-    int64_t iteration_;                 // 事件循环的次数
+    std::atomic<int64_t> iteration_;    // 事件循环的次数 只有IO线程写
+    int64_t lagUs_;                     // 上一轮处理事件和任务的微秒数
     const pid_t threadId_;              // 运行loop的线程ID
+    int pinnedCpu_;                     // 创建时IO线程显式固定到的唯一CPU
+    int numaNode_;                      // pinnedCpu_所在的节点
+    int64_t spinBudgetUs_;              // 阻塞之前自旋的微秒数 0表示不自旋
+    int kernelBusyPollUs_;              // 内核busy poll的微秒数 0表示不使用
+    int socketBusyPollUs_;              // 新连接的SO_BUSY_POLL 试过可以设置才不为0
+    int64_t spinWakeups_;               // 自旋期间等到事件的次数
+    int64_t sleepWakeups_;              // 阻塞等待后返回的次数
+    int64_t emptySpins_;                // 自旋时没有事件的epoll_wait次数
+    bool statsEnabled_;                 // 是否统计各阶段耗时
+    int64_t slowCallbackNs_;            // 慢回调的阈值 0表示不检测
+    std::atomic<int64_t> slowCallbacks_;    // 慢回调的个数
+    Histogram pollWaitHist_;            // epoll_wait的时间
+    Histogram eventHandlingHist_;       // IO事件回调的时间
+    Histogram pendingFunctorsHist_;     // doPendingFunctors()的时间
+    Histogram timersHist_;              // 定时器回调的时间
     Timestamp pollReturnTime_;          // poll阻塞的时间
     std::unique_ptr<Poller> poller_;    // IO复用
     std::unique_ptr<TimerQueue> timerQueue_; // 定时器列表
     int wakeupFd_;                           // eventfd描述符，用于唤醒阻塞的Poller
     std::unique_ptr<Channel> wakeupChannel_; // eventfd对应的Channel
-    boost::any context_;                     //
+    Context context_;                        // 用户数据
+    std::shared_ptr<Slab> connectionSlab_;   // TcpConnection的内存池 连接可能比EventLoop活得久 所以共享
 
     ChannelList activeChannels_;        // 活跃的事件列表
     Channel* currentActiveChannel_;     // 当前处理的事件
@@ -24,6 +24,16 @@ public:
     EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(),
                     const string& name = string());
     ~EventLoopThread();
+
+    /**
+     * 在startLoop()之前调用 把IO线程固定在cpus上 内存从node节点分配
+     * EventLoop在IO线程中创建 Poller 定时器 以及IO线程里分配的Buffer和连接对象
+     * 都在这个节点上 只包含一个CPU时 EventLoop::pinnedCpu()返回它
+     * Acceptor据此设置SO_INCOMING_CPU 与网卡中断和RPS的CPU对齐
+     */
+    void setCpuAffinity(const CpuSet& cpus) { thread_.setCpuAffinity(cpus); }
+    void setNumaNode(int node, bool strict = false) { thread_.setNumaNode(node, strict); }
+
     EventLoop* startLoop();
 
 private:
@@ -0,0 +1,210 @@
+/**
+* @description: Handoff.cc
+* @author: YQ Huang
+* @brief: 通过Unix域socket在进程间传递监听描述符 用于不中断服务的重启
+* @date: 2026/10/19 03:20:14
+*/
+
+#include "server/net/Handoff.h"
+
+#include "server/base/Logging.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace myserver {
+
+namespace net {
+
+namespace handoff {
+
+namespace {
+
+bool fillAddress(const string& path, struct sockaddr_un* addr) {
+    memZero(addr, sizeof *addr);
+    addr->sun_family = AF_UNIX;
+    if(path.size() >= sizeof addr->sun_path) {
+        LOG_ERROR << "handoff path too long " << path;
+        return false;
+    }
+    memcpy(addr->sun_path, path.data(), path.size());
+    return true;
+}
+
+}   // namespace
+
+int listen(const string& path) {
+    struct sockaddr_un addr;
+    if(!fillAddress(path, &addr)) {
+        return -1;
+    }
+    int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(sockfd < 0) {
+        LOG_SYSERR << "handoff::listen socket";
+        return -1;
+    }
+    ::unlink(path.c_str());
+    // 在listen()之前改权限 之前的连接会被拒绝 所以没有空档 不用改进程的umask
+    if(::bind(sockfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0
+       || ::chmod(path.c_str(), 0600) < 0
+       || ::listen(sockfd, 1) < 0) {
+        LOG_SYSERR << "handoff::listen " << path;
+        ::close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+int connect(const string& path) {
+    struct sockaddr_un addr;
+    if(!fillAddress(path, &addr)) {
+        return -1;
+    }
+    int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sockfd < 0) {
+        LOG_SYSERR << "handoff::connect socket";
+        return -1;
+    }
+    if(::connect(sockfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        LOG_SYSERR << "handoff::connect " << path;
+        ::close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+bool checkPeer(int sockfd) {
+    struct ucred cred;
+    socklen_t len = static_cast<socklen_t>(sizeof cred);
+    if(::getsockopt(sockfd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+        LOG_SYSERR << "handoff::checkPeer";
+        return false;
+    }
+    if(cred.uid != ::geteuid()) {
+        LOG_WARN << "handoff::checkPeer reject pid " << cred.pid << " uid " << cred.uid;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * 描述符放在控制消息里 普通数据是payload 至少要有一个字节的普通数据
+ */
+bool sendFds(int sockfd, const std::vector<int>& fds, StringPiece payload) {
+    if(fds.empty() || fds.size() > static_cast<size_t>(kMaxFds) || payload.size() > static_cast<int>(kMaxPayload)) {
+        return false;
+    }
+    char data[kMaxPayload + 1];
+    data[0] = static_cast<char>(fds.size());
+    memcpy(data + 1, payload.data(), static_cast<size_t>(payload.size()));
+    struct iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = static_cast<size_t>(payload.size()) + 1;
+
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * kMaxFds)];
+        struct cmsghdr align;
+    } control;
+    memZero(&control, sizeof control);
+    struct msghdr msg;
+    memZero(&msg, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    ssize_t n;
+    do {
+        n = ::sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+    } while(n < 0 && errno == EINTR);
+    if(n != static_cast<ssize_t>(iov.iov_len)) {
+        LOG_SYSERR << "handoff::sendFds";
+        return false;
+    }
+    return true;
+}
+
+bool recvFds(int sockfd, std::vector<int>* fds, string* payload) {
+    char data[kMaxPayload + 1];
+    struct iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = sizeof data;
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * kMaxFds)];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memZero(&msg, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+
+    ssize_t n;
+    do {
+        n = ::recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC);
+    } while(n < 0 && errno == EINTR);
+    if(n <= 0) {
+        LOG_SYSERR << "handoff::recvFds";
+        return false;
+    }
+    fds->clear();
+    for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const unsigned char* p = CMSG_DATA(cmsg);
+            for(size_t i = 0; i < count; ++i) {
+                int fd;
+                memcpy(&fd, p + i * sizeof(int), sizeof fd);
+                fds->push_back(fd);
+            }
+        }
+    }
+    bool ok = (msg.msg_flags & MSG_CTRUNC) == 0
+              && !fds->empty()
+              && static_cast<size_t>(static_cast<unsigned char>(data[0])) == fds->size();
+    if(!ok) {
+        LOG_ERROR << "handoff::recvFds got " << fds->size() << " descriptors";
+        for(int fd : *fds) {
+            ::close(fd);
+        }
+        fds->clear();
+        return false;
+    }
+    if(payload) {
+        payload->assign(data + 1, static_cast<size_t>(n) - 1);
+    }
+    return true;
+}
+
+int takeListenFd(const string& path, string* payload) {
+    int sockfd = connect(path);
+    if(sockfd < 0) {
+        return -1;
+    }
+    std::vector<int> fds;
+    bool ok = recvFds(sockfd, &fds, payload);
+    ::close(sockfd);
+    if(!ok) {
+        return -1;
+    }
+    for(size_t i = 1; i < fds.size(); ++i) {
+        ::close(fds[i]);
+    }
+    return fds[0];
+}
+
+}   // namespace handoff
+
+}   // namespace net
+
+}   // namespace myserver
@@ -0,0 +1,61 @@
+/**
+* @description: Handoff.h
+* @author: YQ Huang
+* @brief: 通过Unix域socket在进程间传递监听描述符 用于不中断服务的重启
+* @date: 2026/10/19 03:20:05
+*/
+
+#pragma once
+
+#include "server/base/StringPiece.h"
+#include "server/base/Types.h"
+
+#include <vector>
+
+namespace myserver {
+
+namespace net {
+
+/**
+ * 重启时旧进程把监听socket交给新进程 两个进程共享同一个socket
+ * 内核的accept队列不会丢失 客户端不会看到连接被拒绝
+ *
+ * 旧进程: TcpServer::enableHandoff(path) 在path上等待新进程
+ * 新进程: int fd = handoff::takeListenFd(path) 然后用TcpServer(loop, fd, name)接管
+ * 旧进程交出描述符后停止accept 已有的连接照常处理 直到全部关闭再退出
+ */
+namespace handoff {
+
+// 描述符和一段说明文字一起发送 payload不超过kMaxPayload
+const size_t kMaxPayload = 256;
+const int kMaxFds = 16;
+
+// 非阻塞的Unix域监听socket 权限0600 path已经存在时先删除 失败返回-1
+int listen(const string& path);
+
+/**
+ * 拿到监听描述符就能接管服务的端口 发送之前检查对端
+ * 用SO_PEERCRED取得对端连接时的身份 有效uid与本进程相同时返回true
+ */
+bool checkPeer(int sockfd);
+
+// 阻塞地连接到path 失败返回-1
+int connect(const string& path);
+
+// 用SCM_RIGHTS发送描述符 成功返回true
+bool sendFds(int sockfd, const std::vector<int>& fds, StringPiece payload);
+
+// 阻塞地接收一组描述符 收到的描述符带FD_CLOEXEC 失败返回false
+bool recvFds(int sockfd, std::vector<int>* fds, string* payload);
+
+/**
+ * 新进程启动时调用 连接旧进程并取得它的监听描述符
+ * payload是旧进程监听的地址 失败返回-1
+ */
+int takeListenFd(const string& path, string* payload = NULL);
+
+}   // namespace handoff
+
+}   // namespace net
+
+}   // namespace myserver
@@ -73,7 +73,7 @@ string InetAddress::toIp() const {
 // 将二进制值 IP+Port 转换成点分十进制字符串 结果保存到 buf
 string InetAddress::toIpPort() const {
     char buf[64] = "";
-    sockets::toIp(buf, sizeof buf, getSockAddr());
+    sockets::toIpPort(buf, sizeof buf, getSockAddr());
     return buf;
 }
 
@@ -56,6 +56,7 @@ public:
     uint16_t portNetEndian() const { return addr_.sin_port; }
 
     // 根据域名解析IP地址 解析成功返回true 地址保存在InetAddress指向的地址中
+    // 阻塞并且只有IPv4 IO线程里应使用Resolver
     static bool resolve(StringArg hostname, InetAddress* result);
     
     // 给IPv6的scopeid赋值
@@ -0,0 +1,130 @@
+/**
+* @description: MetricsServer.cc
+* @author: YQ Huang
+* @brief: 用HTTP输出指标的文本格式 供Prometheus等工具抓取
+* @date: 2026/10/18 22:58:09
+*/
+
+#include "server/net/MetricsServer.h"
+
+#include "server/base/Logging.h"
+#include "server/base/Metrics.h"
+#include "server/net/EventLoop.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+namespace myserver {
+
+namespace net {
+
+namespace {
+
+const size_t kMaxRequestSize = 8 * 1024;
+
+void sendResponse(const TcpConnectionPtr& conn, const char* status, const string& body) {
+    char header[256];
+    snprintf(header, sizeof header,
+             "HTTP/1.1 %s\r\n"
+             "Content-Type: text/plain; version=0.0.4\r\n"
+             "Content-Length: %zu\r\n"
+             "Connection: close\r\n"
+             "\r\n",
+             status, body.size());
+    conn->send(string(header) + body);
+    conn->shutdown();
+}
+
+}   // namespace
+
+MetricsServer::MetricsServer(EventLoop* loop,
+                             const InetAddress& listenAddr,
+                             const string& name)
+    : server_(loop, listenAddr, name)
+{
+    server_.setMessageCallback(
+        std::bind(&MetricsServer::onMessage, this, _1, _2, _3));
+}
+
+// 统计默认关闭 loop可能已经在别的线程运行 所以在它的IO线程里打开
+void MetricsServer::addEventLoop(EventLoop* loop, const string& name) {
+    loops_.push_back(std::make_pair(name, loop));
+    loop->runInLoop(std::bind(&EventLoop::setStatsEnabled, loop, true));
+}
+
+string MetricsServer::scrape() const {
+    string out = MetricsRegistry::instance().scrape();
+    if(loops_.empty()) {
+        return out;
+    }
+    std::vector<EventLoopStats> stats;
+    for(const auto& item : loops_) {
+        stats.push_back(item.second->stats());
+    }
+
+    char buf[128];
+    out += "# HELP myserver_eventloop_iterations_total Event loop iterations\n";
+    out += "# TYPE myserver_eventloop_iterations_total counter\n";
+    for(size_t i = 0; i < loops_.size(); ++i) {
+        snprintf(buf, sizeof buf, "{loop=\"%s\"} %lld\n",
+                 loops_[i].first.c_str(), static_cast<long long>(stats[i].iterations));
+        out += "myserver_eventloop_iterations_total";
+        out += buf;
+    }
+    out += "# HELP myserver_eventloop_slow_callbacks_total Callbacks over the slow callback threshold\n";
+    out += "# TYPE myserver_eventloop_slow_callbacks_total counter\n";
+    for(size_t i = 0; i < loops_.size(); ++i) {
+        snprintf(buf, sizeof buf, "{loop=\"%s\"} %lld\n",
+                 loops_[i].first.c_str(), static_cast<long long>(stats[i].slowCallbacks));
+        out += "myserver_eventloop_slow_callbacks_total";
+        out += buf;
+    }
+
+    struct Phase {
+        const char* name;
+        const char* help;
+        HistogramSnapshot EventLoopStats::*member;
+    };
+    const Phase kPhases[] = {
+        { "myserver_eventloop_poll_wait_ns", "Time spent in epoll_wait", &EventLoopStats::pollWait },
+        { "myserver_eventloop_event_handling_ns", "Time spent in each IO callback", &EventLoopStats::eventHandling },
+        { "myserver_eventloop_pending_functors_ns", "Time spent in each doPendingFunctors", &EventLoopStats::pendingFunctors },
+        { "myserver_eventloop_timers_ns", "Time spent in each timer dispatch", &EventLoopStats::timers },
+    };
+    for(const Phase& phase : kPhases) {
+        for(size_t i = 0; i < loops_.size(); ++i) {
+            MetricsRegistry::appendSummary(&out, phase.name, phase.help,
+                                           "loop=\"" + loops_[i].first + "\"",
+                                           stats[i].*phase.member, i == 0);
+        }
+    }
+    return out;
+}
+
+// 等收到完整的请求头后只看请求行
+void MetricsServer::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    const char kEnd[] = "\r\n\r\n";
+    const char* last = buf->peek() + buf->readableBytes();
+    if(std::search(buf->peek(), last, kEnd, kEnd + 4) == last) {
+        if(buf->readableBytes() > kMaxRequestSize) {
+            sendResponse(conn, "400 Bad Request", "request too large\n");
+            buf->retrieveAll();
+        }
+        return;
+    }
+    const char* crlf = buf->findCRLF();
+    string requestLine(buf->peek(), crlf);
+    buf->retrieveAll();
+    LOG_DEBUG << conn->name() << " " << requestLine;
+
+    if(requestLine.compare(0, 13, "GET /metrics ") == 0) {
+        sendResponse(conn, "200 OK", scrape());
+    }
+    else {
+        sendResponse(conn, "404 Not Found", "not found\n");
+    }
+}
+
+}   // namespace net
+
+}   // namespace myserver
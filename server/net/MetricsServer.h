@@ -0,0 +1,50 @@
+/**
+* @description: MetricsServer.h
+* @author: YQ Huang
+* @brief: 用HTTP输出指标的文本格式 供Prometheus等工具抓取
+* @date: 2026/10/18 22:58:02
+*/
+
+#pragma once
+
+#include "server/net/TcpServer.h"
+
+#include <utility>
+#include <vector>
+
+namespace myserver {
+
+namespace net {
+
+/**
+ * 最小的HTTP服务 GET /metrics 返回MetricsRegistry::scrape()的结果
+ * 以及通过addEventLoop()加入的EventLoop各阶段耗时 其他路径返回404
+ * 每个连接只处理一个请求 响应后关闭 运行在传入的EventLoop上
+ */
+class MetricsServer : noncopyable {
+public:
+    MetricsServer(EventLoop* loop,
+                  const InetAddress& listenAddr,
+                  const string& name = "MetricsServer");
+
+    /**
+     * 输出这个EventLoop的stats() 标签为loop="name" 并打开它的统计
+     * 在start()之前调用 loop的生命期要比MetricsServer长
+     */
+    void addEventLoop(EventLoop* loop, const string& name);
+
+    void start() { server_.start(); }
+
+    // 响应的正文 也可以直接调用
+    string scrape() const;
+
+private:
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp);
+
+    TcpServer server_;
+    std::vector<std::pair<string, EventLoop*>> loops_;
+};
+
+}   // namespace net
+
+}   // namespace myserver
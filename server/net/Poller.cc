@@ -13,9 +13,22 @@
 #include <assert.h>
 #include <errno.h>
 #include <poll.h>
+#include <stdint.h>
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
+// 旧的内核头文件里没有 定义与include/uapi/linux/eventpoll.h相同
+#ifndef EPIOCSPARAMS
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+
 namespace myserver {
 
 namespace net {
@@ -45,6 +58,21 @@ Poller::~Poller() {
     ::close(epollfd_);
 }
 
+int Poller::setBusyPoll(int usec) {
+    if(usec < 0) {
+        return EINVAL;
+    }
+    struct epoll_params params;
+    memZero(&params, sizeof params);
+    params.busy_poll_usecs = static_cast<uint32_t>(usec);
+    params.busy_poll_budget = 8;    // 每次轮询最多处理的包数 与net.core.busy_read的默认值相同
+    params.prefer_busy_poll = usec > 0;
+    if(::ioctl(epollfd_, EPIOCSPARAMS, &params) < 0) {
+        return errno;
+    }
+    return 0;
+}
+
 /**
  * 调用epoll获得当前活动的IO事件 然后填充调用方传入的activeChannels
  * 并返回epoll return的时刻
@@ -60,7 +88,7 @@ Timestamp Poller::poll(int timeoutMs, ChannelList* activeChannels) {
 
     int savedErrno = errno;
     // epoll_wait() 返回的时刻
-    Timestamp now(Timestamp::now());
+    Timestamp now(Timestamp::nowFast());
     if(numEvents > 0) {
         LOG_TRACE << numEvents << " events happened";
         // 将活动事件填充进activeChannels
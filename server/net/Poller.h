@@ -40,6 +40,12 @@ public:
     // 并返回poll return的时刻
     Timestamp poll(int timeoutMs, ChannelList* activeChannels);
 
+    /**
+     * 设置epoll实例的busy poll(EPIOCSPARAMS Linux 6.9) epoll_wait没有事件时
+     * 内核先轮询关联网卡队列usec微秒再睡眠 usec = 0时关闭 成功返回0 失败返回errno
+     */
+    int setBusyPoll(int usec);
+
     // 维护更新Channel
     void updateChannel(Channel* channel);
     // 移除Channel
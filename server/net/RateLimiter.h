@@ -0,0 +1,67 @@
+/**
+* @description: RateLimiter.h
+* @author: YQ Huang
+* @brief: 连接读取的限速 同时限制每秒字节数和每秒消息数
+* @date: 2026/10/19 05:41:26
+*/
+
+#pragma once
+
+#include "server/base/TokenBucket.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace myserver {
+
+namespace net {
+
+/**
+ * 各项为0表示不限制 burst为0时取一秒的量
+ * 消息指的是一次读取 即一次messageCallback 协议层的请求可能跨多次读取或者合并在一次里
+ */
+struct RateLimit {
+    double bytesPerSecond;
+    double bytesBurst;
+    double messagesPerSecond;
+    double messagesBurst;
+
+    RateLimit()
+        : bytesPerSecond(0), bytesBurst(0), messagesPerSecond(0), messagesBurst(0)
+    { }
+
+    bool enabled() const { return bytesPerSecond > 0 || messagesPerSecond > 0; }
+};
+
+/**
+ * TcpConnection::handleRead()每读到一次数据调用一次charge() 返回值大于0时暂停读
+ * 可以只属于一个连接 也可以由多个连接甚至多个IO线程共享 见TcpServer::setServerRateLimit()
+ */
+class RateLimiter : noncopyable {
+public:
+    explicit RateLimiter(const RateLimit& limit)
+        : bytes_(limit.bytesPerSecond, limit.bytesBurst > 0 ? limit.bytesBurst : limit.bytesPerSecond),
+          messages_(limit.messagesPerSecond,
+                    limit.messagesBurst > 0 ? limit.messagesBurst : limit.messagesPerSecond)
+    { }
+
+    // 记录一次读到的bytes字节 返回需要暂停读的秒数 0表示不用暂停
+    double charge(size_t bytes, Timestamp now) {
+        int64_t wait = std::max(bytes_.consume(static_cast<int64_t>(bytes), now),
+                                messages_.consume(1, now));
+        return static_cast<double>(wait) / Timestamp::kMicroSecondsPerSecond;
+    }
+
+    const TokenBucket& bytes() const { return bytes_; }
+    const TokenBucket& messages() const { return messages_; }
+
+private:
+    TokenBucket bytes_;
+    TokenBucket messages_;
+};
+
+typedef std::shared_ptr<RateLimiter> RateLimiterPtr;
+
+}   // namespace net
+
+}   // namespace myserver
@@ -0,0 +1,411 @@
+/**
+* @description: Resolver.cc
+* @author: YQ Huang
+* @brief: 在EventLoop上异步解析域名 通过UDP直接向DNS服务器查询A和AAAA记录
+* @date: 2026/10/19 02:30:26
+*/
+
+#include "server/net/Resolver.h"
+
+#include "server/base/FileUtil.h"
+#include "server/base/Logging.h"
+#include "server/net/EventLoop.h"
+#include "server/net/SocketsOps.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+namespace myserver {
+
+namespace net {
+
+namespace {
+
+const uint16_t kDnsPort = 53;
+const uint16_t kTypeA = 1;
+const uint16_t kTypeAAAA = 28;
+const uint16_t kClassIN = 1;
+const uint16_t kTypes[2] = { kTypeA, kTypeAAAA };
+const size_t kHeaderSize = 12;
+const size_t kMaxNameLength = 255;
+const size_t kMaxLabelLength = 63;
+const size_t kMaxPacketSize = 4096;
+
+uint16_t readUint16(const char* p) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint16_t>((u[0] << 8) | u[1]);
+}
+
+uint32_t readUint32(const char* p) {
+    return (static_cast<uint32_t>(readUint16(p)) << 16) | readUint16(p + 2);
+}
+
+void appendUint16(string* out, uint16_t v) {
+    out->push_back(static_cast<char>(v >> 8));
+    out->push_back(static_cast<char>(v & 0xff));
+}
+
+/**
+ * 查询报文: 头部(ID, RD=1, QDCOUNT=1) + QNAME + QTYPE + QCLASS
+ * 域名不合法时返回false
+ */
+bool buildQuery(uint16_t id, const string& hostname, uint16_t type, string* out) {
+    out->clear();
+    appendUint16(out, id);
+    appendUint16(out, 0x0100);      // 标准查询 期望递归
+    appendUint16(out, 1);
+    appendUint16(out, 0);
+    appendUint16(out, 0);
+    appendUint16(out, 0);
+    if(hostname.empty() || hostname.size() > kMaxNameLength - 2) {
+        return false;
+    }
+    size_t start = 0;
+    while(start <= hostname.size()) {
+        size_t dot = hostname.find('.', start);
+        if(dot == string::npos) {
+            dot = hostname.size();
+        }
+        size_t labelLength = dot - start;
+        if(labelLength == 0 || labelLength > kMaxLabelLength) {
+            return false;
+        }
+        out->push_back(static_cast<char>(labelLength));
+        out->append(hostname, start, labelLength);
+        start = dot + 1;
+    }
+    out->push_back('\0');
+    appendUint16(out, type);
+    appendUint16(out, kClassIN);
+    return true;
+}
+
+// 跳过一个可能压缩的域名 返回之后的位置 格式错误返回0
+size_t skipName(const char* data, size_t len, size_t pos) {
+    while(pos < len) {
+        unsigned char c = static_cast<unsigned char>(data[pos]);
+        if(c == 0) {
+            return pos + 1;
+        }
+        if((c & 0xc0) == 0xc0) {
+            return pos + 2 <= len ? pos + 2 : 0;
+        }
+        if((c & 0xc0) != 0) {
+            return 0;
+        }
+        pos += c + 1;
+    }
+    return 0;
+}
+
+// 小写并去掉末尾的点 作为缓存和合并查询的键
+string normalize(const string& hostname) {
+    string name(hostname);
+    while(!name.empty() && name[name.size() - 1] == '.') {
+        name.resize(name.size() - 1);
+    }
+    std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    });
+    return name;
+}
+
+// 域名本身是IP地址时直接转换
+bool parseLiteral(const string& hostname, InetAddress* out) {
+    struct sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    if(::inet_pton(AF_INET, hostname.c_str(), &addr.sin_addr) == 1) {
+        addr.sin_family = AF_INET;
+        *out = InetAddress(addr);
+        return true;
+    }
+    struct sockaddr_in6 addr6;
+    memZero(&addr6, sizeof addr6);
+    if(::inet_pton(AF_INET6, hostname.c_str(), &addr6.sin6_addr) == 1) {
+        addr6.sin6_family = AF_INET6;
+        *out = InetAddress(addr6);
+        return true;
+    }
+    return false;
+}
+
+int createUdpSocket(const InetAddress& nameserver) {
+    int sockfd = ::socket(nameserver.family(), SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if(sockfd < 0) {
+        LOG_SYSFATAL << "Resolver::createUdpSocket";
+    }
+    // connect之后只会收到nameserver发来的报文
+    if(sockets::connect(sockfd, nameserver.getSockAddr()) < 0) {
+        LOG_SYSERR << "Resolver connect to " << nameserver.toIpPort();
+    }
+    return sockfd;
+}
+
+}   // namespace
+
+InetAddress Resolver::defaultNameserver() {
+    string content;
+    if(FileUtil::readFile("/etc/resolv.conf", 64 * 1024, &content) == 0) {
+        size_t start = 0;
+        while(start < content.size()) {
+            size_t end = content.find('\n', start);
+            if(end == string::npos) {
+                end = content.size();
+            }
+            string line(content, start, end - start);
+            start = end + 1;
+            char ip[64];
+            if(::sscanf(line.c_str(), " nameserver %63s", ip) == 1) {
+                InetAddress addr;
+                if(parseLiteral(ip, &addr)) {
+                    return InetAddress(ip, kDnsPort);
+                }
+            }
+        }
+    }
+    return InetAddress("127.0.0.1", kDnsPort);
+}
+
+Resolver::Resolver(EventLoop* loop)
+    : Resolver(loop, defaultNameserver())
+{ }
+
+Resolver::Resolver(EventLoop* loop, const InetAddress& nameserver)
+    : loop_(CHECK_NOTNULL(loop)),
+      socket_(createUdpSocket(nameserver)),
+      channel_(loop, socket_.fd()),
+      timeout_(2.0),
+      retries_(2),
+      random_(std::random_device()()),
+      cacheHits_(0),
+      queriesSent_(0)
+{
+    channel_.setReadCallback([this](Timestamp) { handleRead(); });
+    channel_.enableReading();
+}
+
+Resolver::~Resolver() {
+    for(auto& item : queries_) {
+        loop_->cancel(item.second.timer);
+    }
+    channel_.disableAll();
+    channel_.remove();
+}
+
+void Resolver::resolve(StringArg hostname, const Callback& cb) {
+    loop_->runInLoop(std::bind(&Resolver::resolveInLoop, this, string(hostname.c_str()), cb));
+}
+
+/**
+ * 立即得到的结果也通过queueInLoop回调 回调不会在resolve()返回之前执行
+ */
+void Resolver::resolveInLoop(const string& hostname, const Callback& cb) {
+    loop_->assertInLoopThread();
+    InetAddress literal;
+    if(parseLiteral(hostname, &literal)) {
+        std::vector<InetAddress> addresses(1, literal);
+        loop_->queueInLoop(std::bind(cb, hostname, addresses));
+        return;
+    }
+
+    string name = normalize(hostname);
+    auto cached = cache_.find(name);
+    if(cached != cache_.end()) {
+        if(Timestamp::nowFast() < cached->second.expiration) {
+            ++cacheHits_;
+            loop_->queueInLoop(std::bind(cb, hostname, cached->second.addresses));
+            return;
+        }
+        cache_.erase(cached);
+    }
+
+    auto pending = queries_.find(name);
+    if(pending != queries_.end()) {
+        pending->second.callbacks.push_back(cb);
+        return;
+    }
+
+    string packet;
+    if(!buildQuery(0, name, kTypeA, &packet)) {
+        LOG_ERROR << "Resolver::resolve invalid hostname " << hostname;
+        loop_->queueInLoop(std::bind(cb, hostname, std::vector<InetAddress>()));
+        return;
+    }
+    Query& query = queries_[name];
+    query.hostname = hostname;
+    query.minTtl = UINT32_MAX;
+    query.retriesLeft = retries_;
+    query.callbacks.push_back(cb);
+    for(int i = 0; i < 2; ++i) {
+        query.ids[i] = nextId();
+        idToHostname_[query.ids[i]] = name;
+    }
+    sendQueries(&query);
+}
+
+// 随机的查询ID 让伪造应答更难
+uint16_t Resolver::nextId() {
+    uint16_t id;
+    do {
+        id = static_cast<uint16_t>(random_());
+    } while(id == 0 || idToHostname_.count(id) > 0);
+    return id;
+}
+
+// 发送还没有收到应答的查询 然后开始计时
+void Resolver::sendQueries(Query* query) {
+    string name = normalize(query->hostname);
+    string packet;
+    for(int i = 0; i < 2; ++i) {
+        if(query->ids[i] == 0) {
+            continue;
+        }
+        buildQuery(query->ids[i], name, kTypes[i], &packet);
+        ssize_t n = ::send(socket_.fd(), packet.data(), packet.size(), 0);
+        if(n < 0) {
+            // 超时后会重发
+            LOG_SYSERR << "Resolver::sendQueries " << name;
+        }
+        ++queriesSent_;
+    }
+    query->timer = loop_->runAfter(timeout_, std::bind(&Resolver::handleTimeout, this, name));
+}
+
+void Resolver::handleRead() {
+    char buf[kMaxPacketSize];
+    while(true) {
+        ssize_t n = ::recv(socket_.fd(), buf, sizeof buf, 0);
+        if(n < 0) {
+            // ECONNREFUSED表示nameserver没有监听 等待超时
+            if(errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_SYSERR << "Resolver::handleRead";
+            }
+            if(errno != EINTR) {
+                break;
+            }
+            continue;
+        }
+        handleResponse(buf, static_cast<size_t>(n));
+    }
+}
+
+/**
+ * 只接受ID和问题类型都对得上的应答 其余的丢弃
+ * 应答部分里的CNAME等记录跳过 只取与查询类型相同的A或AAAA记录
+ */
+void Resolver::handleResponse(const char* data, size_t len) {
+    if(len < kHeaderSize) {
+        return;
+    }
+    uint16_t id = readUint16(data);
+    uint16_t flags = readUint16(data + 2);
+    uint16_t qdcount = readUint16(data + 4);
+    uint16_t ancount = readUint16(data + 6);
+    auto idIt = idToHostname_.find(id);
+    if(idIt == idToHostname_.end() || (flags & 0x8000) == 0 || qdcount != 1) {
+        return;
+    }
+    string name = idIt->second;
+    Query& query = queries_[name];
+    int index = query.ids[0] == id ? 0 : 1;
+    uint16_t type = kTypes[index];
+
+    size_t pos = skipName(data, len, kHeaderSize);
+    if(pos == 0 || pos + 4 > len || readUint16(data + pos) != type) {
+        return;
+    }
+    pos += 4;
+
+    int rcode = flags & 0x0f;
+    if(rcode != 0) {
+        LOG_DEBUG << "Resolver " << name << " type " << type << " rcode " << rcode;
+    }
+    for(uint16_t i = 0; rcode == 0 && i < ancount; ++i) {
+        pos = skipName(data, len, pos);
+        if(pos == 0 || pos + 10 > len) {
+            break;
+        }
+        uint16_t rrType = readUint16(data + pos);
+        uint16_t rrClass = readUint16(data + pos + 2);
+        uint32_t ttl = readUint32(data + pos + 4);
+        uint16_t rdlength = readUint16(data + pos + 8);
+        pos += 10;
+        if(pos + rdlength > len) {
+            break;
+        }
+        if(rrClass == kClassIN && rrType == kTypeA && type == kTypeA && rdlength == 4) {
+            struct sockaddr_in addr;
+            memZero(&addr, sizeof addr);
+            addr.sin_family = AF_INET;
+            memcpy(&addr.sin_addr, data + pos, 4);
+            query.addresses[index].push_back(InetAddress(addr));
+            query.minTtl = std::min(query.minTtl, ttl);
+        }
+        else if(rrClass == kClassIN && rrType == kTypeAAAA && type == kTypeAAAA && rdlength == 16) {
+            struct sockaddr_in6 addr6;
+            memZero(&addr6, sizeof addr6);
+            addr6.sin6_family = AF_INET6;
+            memcpy(&addr6.sin6_addr, data + pos, 16);
+            query.addresses[index].push_back(InetAddress(addr6));
+            query.minTtl = std::min(query.minTtl, ttl);
+        }
+        pos += rdlength;
+    }
+
+    idToHostname_.erase(idIt);
+    query.ids[index] = 0;
+    if(query.ids[0] == 0 && query.ids[1] == 0) {
+        finish(name);
+    }
+}
+
+void Resolver::handleTimeout(const string& name) {
+    auto it = queries_.find(name);
+    if(it == queries_.end()) {
+        return;
+    }
+    Query& query = it->second;
+    if(query.retriesLeft > 0) {
+        --query.retriesLeft;
+        LOG_DEBUG << "Resolver::handleTimeout retry " << name;
+        sendQueries(&query);
+        return;
+    }
+    LOG_WARN << "Resolver::handleTimeout " << name << " gave up";
+    for(int i = 0; i < 2; ++i) {
+        if(query.ids[i] != 0) {
+            idToHostname_.erase(query.ids[i]);
+            query.ids[i] = 0;
+        }
+    }
+    finish(name);
+}
+
+// 合并两个查询的结果 缓存后依次回调
+void Resolver::finish(const string& name) {
+    auto it = queries_.find(name);
+    assert(it != queries_.end());
+    Query query(std::move(it->second));
+    queries_.erase(it);
+    loop_->cancel(query.timer);
+
+    std::vector<InetAddress> addresses(query.addresses[0]);
+    addresses.insert(addresses.end(), query.addresses[1].begin(), query.addresses[1].end());
+    if(!addresses.empty() && query.minTtl > 0) {
+        CacheEntry& entry = cache_[name];
+        entry.addresses = addresses;
+        entry.expiration = addTime(Timestamp::nowFast(), query.minTtl);
+    }
+    for(const Callback& cb : query.callbacks) {
+        cb(query.hostname, addresses);
+    }
+}
+
+}   // namespace net
+
+}   // namespace myserver
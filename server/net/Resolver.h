@@ -0,0 +1,107 @@
+/**
+* @description: Resolver.h
+* @author: YQ Huang
+* @brief: 在EventLoop上异步解析域名 通过UDP直接向DNS服务器查询A和AAAA记录
+* @date: 2026/10/19 02:30:18
+*/
+
+#pragma once
+
+#include "server/base/StringPiece.h"
+#include "server/base/Timestamp.h"
+#include "server/base/Types.h"
+#include "server/net/Channel.h"
+#include "server/net/InetAddress.h"
+#include "server/net/Socket.h"
+#include "server/net/TimerId.h"
+
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace myserver {
+
+namespace net {
+
+class EventLoop;
+
+/**
+ * InetAddress::resolve()调用阻塞的gethostbyname_r 在IO线程里会卡住整个事件循环
+ * Resolver把查询发给DNS服务器后就返回 应答在同一个EventLoop上通过Channel读取
+ *
+ * 同一个域名同时只有一对A和AAAA查询 等待中的回调合并到一起
+ * 结果按记录里最小的TTL缓存 失败的结果不缓存
+ * 超时后重发 重试用完时以已经收到的地址(可能为空)完成
+ * 域名本身是IP地址时直接返回 不查询
+ *
+ * resolve()可以在任何线程调用 回调总是在loop的IO线程里执行
+ * Resolver的生命期应长于loop.loop() 析构时丢弃还没有完成的查询 不调用它们的回调
+ */
+class Resolver : noncopyable {
+public:
+    // 地址的端口为0 IPv4在前IPv6在后 解析失败时为空
+    typedef std::function<void (const string& hostname,
+                                const std::vector<InetAddress>& addresses)> Callback;
+
+    // 使用/etc/resolv.conf里的第一个nameserver
+    explicit Resolver(EventLoop* loop);
+    Resolver(EventLoop* loop, const InetAddress& nameserver);
+    ~Resolver();
+
+    void resolve(StringArg hostname, const Callback& cb);
+
+    // 每次发送后等待应答的秒数和重发次数 默认2秒 2次
+    void setTimeout(double seconds) { timeout_ = seconds; }
+    void setRetries(int retries) { retries_ = retries; }
+
+    // 在IO线程调用
+    size_t cacheSize() const { return cache_.size(); }
+    void clearCache() { cache_.clear(); }
+    int64_t cacheHits() const { return cacheHits_; }
+    int64_t queriesSent() const { return queriesSent_; }
+
+    // /etc/resolv.conf里的第一个nameserver 读取失败时为127.0.0.1:53
+    static InetAddress defaultNameserver();
+
+private:
+    struct CacheEntry {
+        std::vector<InetAddress> addresses;
+        Timestamp expiration;
+    };
+
+    // 一个域名的A和AAAA两个查询
+    struct Query {
+        string hostname;
+        uint16_t ids[2];            // A和AAAA查询的ID 完成后置0
+        std::vector<InetAddress> addresses[2];
+        uint32_t minTtl;
+        int retriesLeft;
+        TimerId timer;
+        std::vector<Callback> callbacks;
+    };
+
+    void resolveInLoop(const string& hostname, const Callback& cb);
+    void sendQueries(Query* query);
+    void handleRead();
+    void handleResponse(const char* data, size_t len);
+    void handleTimeout(const string& hostname);
+    void finish(const string& hostname);
+    uint16_t nextId();
+
+    EventLoop* loop_;
+    Socket socket_;
+    Channel channel_;
+    double timeout_;
+    int retries_;
+    std::map<string, CacheEntry> cache_;
+    std::map<string, Query> queries_;               // 正在查询的域名
+    std::map<uint16_t, string> idToHostname_;       // 查询ID到域名
+    std::mt19937 random_;
+    int64_t cacheHits_;
+    int64_t queriesSent_;
+};
+
+}   // namespace net
+
+}   // namespace myserver
@@ -11,6 +11,7 @@
 #include "server/net/InetAddress.h"
 #include "server/net/SocketsOps.h"
 
+#include <errno.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <stdio.h>
@@ -118,6 +119,40 @@ void Socket::setKeepAlive(bool on) {
                  &optval, static_cast<socklen_t>(sizeof(optval)));
 }
 
+void Socket::setIncomingCpu(int cpu) {
+#ifdef SO_INCOMING_CPU
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU,
+                           &cpu, static_cast<socklen_t>(sizeof(cpu)));
+    if(ret < 0) {
+        LOG_SYSERR << "SO_INCOMING_CPU failed.";
+    }
+#else
+    LOG_ERROR << "SO_INCOMING_CPU is not supported.";
+#endif
+}
+
+int Socket::incomingCpu() const {
+#ifdef SO_INCOMING_CPU
+    int cpu = -1;
+    socklen_t len = static_cast<socklen_t>(sizeof(cpu));
+    if(::getsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0) {
+        return cpu;
+    }
+#endif
+    return -1;
+}
+
+int Socket::setBusyPoll(int usec) {
+#ifdef SO_BUSY_POLL
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL,
+                           &usec, static_cast<socklen_t>(sizeof(usec)));
+    return ret < 0 ? errno : 0;
+#else
+    (void)usec;
+    return ENOPROTOOPT;
+#endif
+}
+
 }   // namespace net
 
-}   // namespace myserver
\ No newline at end of file
+}   // namespace myserver
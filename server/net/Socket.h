@@ -59,6 +59,19 @@ public:
     // 是否开启TCP保活机制 默认开启
     void setKeepAlive(bool on);
 
+    /**
+     * SO_INCOMING_CPU 监听套接字设置后 SO_REUSEPORT组内优先把
+     * 在这个CPU上收到的连接交给它 用于和网卡中断/RPS的CPU对齐
+     */
+    void setIncomingCpu(int cpu);
+    // 最近一次收到数据包的CPU 不支持时返回-1
+    int incomingCpu() const;
+    /**
+     * SO_BUSY_POLL 接收队列为空时内核轮询网卡队列usec微秒 而不是立即返回或睡眠
+     * 超过net.core.busy_read的值需要CAP_NET_ADMIN 成功返回0 失败返回errno 不记录日志
+     */
+    int setBusyPoll(int usec);
+
 private:
     const int sockfd_;
 
@@ -8,18 +8,38 @@
 #include "server/net/TcpConnection.h"
 
 #include "server/base/Logging.h"
+#include "server/base/Metrics.h"
 #include "server/base/WeakCallback.h"
-#include "server/net/Channel.h"
 #include "server/net/EventLoop.h"
-#include "server/net/Socket.h"
 #include "server/net/SocketsOps.h"
 
+#include <algorithm>
 #include <errno.h>
+#include <stdio.h>
 
 namespace myserver {
 
 namespace net {
 
+namespace {
+
+Counter* const g_bytesReceived = MetricsRegistry::instance().counter(
+    "myserver_tcp_received_bytes_total", "Bytes read from TCP connections");
+Counter* const g_bytesSent = MetricsRegistry::instance().counter(
+    "myserver_tcp_sent_bytes_total", "Bytes written to TCP connections");
+Counter* const g_throttled = MetricsRegistry::instance().counter(
+    "myserver_tcp_throttled_total", "Times reading was paused by a rate limit");
+HistogramMetric* const g_readSize = MetricsRegistry::instance().histogram(
+    "myserver_tcp_read_size_bytes", "Bytes returned by each read on a TCP connection");
+
+// 没有指定回调的连接共用
+const ConnectionCallbacksPtr& defaultCallbacks() {
+    static ConnectionCallbacksPtr callbacks = std::make_shared<const ConnectionCallbacks>();
+    return callbacks;
+}
+
+}   // namespace
+
 void defaultConnectionCallback(const TcpConnectionPtr& conn) {
     LOG_TRACE << conn->localAddress().toIpPort() << " -> "
               << conn->peerAddress().toIpPort() << " is "
@@ -36,50 +56,91 @@ void defaultMessageCallback(const TcpConnectionPtr&,
 // TcpConnection 没有发起连接的功能，其构造函数的参数是
 // 已经建立好连接的socket fd 因此其初始状态是kConnecting
 TcpConnection::TcpConnection(EventLoop* loop,
-                             const string& nameArg,
+                             uint64_t id,
+                             const std::shared_ptr<const string>& namePrefix,
                              int sockfd,
                              const InetAddress& localAddr,
-                             const InetAddress& peerAddr)
+                             const InetAddress& peerAddr,
+                             const ConnectionCallbacksPtr& callbacks)
     : loop_(CHECK_NOTNULL(loop)),
-      name_(nameArg),
+      id_(id),
+      namePrefix_(namePrefix),
       state_(kConnecting),
       reading_(true),
-      socket_(new Socket(sockfd)),
-      channel_(new Channel(loop, sockfd)),
+      throttled_(false),
+      active_(true),
+      socket_(sockfd),
+      channel_(loop, sockfd),
       localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64*1024*1024)
+      callbacks_(callbacks ? callbacks : defaultCallbacks()),
+      highWaterMark_(64*1024*1024),
+      lowWaterMark_(0),
+      aboveHighWaterMark_(false)
 {
-    channel_->setReadCallback(
-        std::bind(&TcpConnection::handleRead, this, _1));
-    channel_->setWriteCallback(
-        std::bind(&TcpConnection::handleWrite, this));
-    channel_->setCloseCallback(
-        std::bind(&TcpConnection::handleClose, this));
-    channel_->setErrorCallback(
-        std::bind(&TcpConnection::handleError, this));
-    LOG_DEBUG << "TcpConnection::ctor[" << name_ << "] at " << this
+    // 只捕获this的lambda可以放进std::function内部的缓冲区 std::bind成员函数需要分配内存
+    channel_.setReadCallback([this](Timestamp receiveTime) { handleRead(receiveTime); });
+    channel_.setWriteCallback([this] { handleWrite(); });
+    channel_.setCloseCallback([this] { handleClose(); });
+    channel_.setErrorCallback([this] { handleError(); });
+    LOG_DEBUG << "TcpConnection::ctor[" << name() << "] at " << this
               << " fd=" << sockfd;
-    socket_->setKeepAlive(true);
+    socket_.setKeepAlive(true);
+    if(loop->socketBusyPoll() > 0) {
+        socket_.setBusyPoll(loop->socketBusyPoll());
+    }
 }
 
 // 析构函数中会 close(fd) (在 Socket的析构函数中发生)
 TcpConnection::~TcpConnection() {
-    LOG_DEBUG << "TcpConnection::dtor[" << name_ << "] at " << this
-              << " fd=" << channel_->fd()
+    LOG_DEBUG << "TcpConnection::dtor[" << name() << "] at " << this
+              << " fd=" << channel_.fd()
               << " state=" << stateToString();
     assert(state_ == kDisconnected);
 }
 
+string TcpConnection::name() const {
+    char buf[32];
+    snprintf(buf, sizeof buf, "#%llu", static_cast<unsigned long long>(id_));
+    return *namePrefix_ + buf;
+}
+
+/**
+ * 回调可能正在执行(例如在消息回调里切换协议) 旧的一份延后到这一轮的任务里再释放
+ */
+template<typename F>
+void TcpConnection::modifyCallbacks(F modify) {
+    std::shared_ptr<ConnectionCallbacks> copy = std::make_shared<ConnectionCallbacks>(*callbacks_);
+    modify(copy.get());
+    ConnectionCallbacksPtr old(std::move(callbacks_));
+    callbacks_ = std::move(copy);
+    loop_->queueInLoop([old] { });
+}
+
+void TcpConnection::setConnectionCallback(const ConnectionCallback& cb) {
+    modifyCallbacks([&cb](ConnectionCallbacks* callbacks) { callbacks->connectionCallback = cb; });
+}
+
+void TcpConnection::setMessageCallback(const MessageCallback& cb) {
+    modifyCallbacks([&cb](ConnectionCallbacks* callbacks) { callbacks->messageCallback = cb; });
+}
+
+void TcpConnection::setWriteCompleteCallback(const WriteCompleteCallback& cb) {
+    modifyCallbacks([&cb](ConnectionCallbacks* callbacks) { callbacks->writeCompleteCallback = cb; });
+}
+
+void TcpConnection::setCloseCallback(const CloseCallback& cb) {
+    modifyCallbacks([&cb](ConnectionCallbacks* callbacks) { callbacks->closeCallback = cb; });
+}
 
 bool TcpConnection::getTcpInfo(struct tcp_info* tcpi) const {
-    return socket_->getTcpInfo(tcpi);
+    return socket_.getTcpInfo(tcpi);
 }
 
 string TcpConnection::getTcpInfoString() const {
     char buf[1024];
     buf[0] = '\0';
-    socket_->getTcpInfoString(buf, sizeof buf);
+    socket_.getTcpInfoString(buf, sizeof buf);
     return buf;
 }
 
@@ -143,7 +204,7 @@ void TcpConnection::forceCloseWithDelay(double seconds) {
 }
 
 void TcpConnection::setTcpNoDelay(bool on) {
-    socket_->setTcpNoDelay(on);
+    socket_.setTcpNoDelay(on);
 }
 
 void TcpConnection::startRead() {
@@ -160,10 +221,10 @@ void TcpConnection::connectEstablished() {
     loop_->assertInLoopThread();
     assert(state_ == kConnecting);
     setState(kConnected);
-    channel_->tie(shared_from_this());
-    channel_->enableReading();
+    channel_.tie(shared_from_this());
+    channel_.enableReading();
 
-    connectionCallback_(shared_from_this());
+    callbacks_->connectionCallback(shared_from_this());
 }
 
 // 关闭连接 当TcpServer 从map中移除TcpConnection时调用
@@ -173,22 +234,29 @@ void TcpConnection::connectDestroyed() {
         // 和handleClose() 中重复 是为了处理不经由handleClose() 而是
         // 直接调用connectDestroyed()的情况
         setState(kDisconnected);
-        channel_->disableAll();
+        channel_.disableAll();
+        leaveHighWaterMark();
 
-        connectionCallback_(shared_from_this());
+        callbacks_->connectionCallback(shared_from_this());
     }
 
-    channel_->remove(); // 从Poller中移除channel
+    channel_.remove(); // 从Poller中移除channel
 }
 
 // 当有可读事件发生，执行handleRead()回调。尝试从socketfd中读取数据保存到Buffer中
 void TcpConnection::handleRead(Timestamp receiveTime) {
     loop_->assertInLoopThread();
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    ssize_t n = inputBuffer_.readFd(channel_.fd(), &savedErrno);
     // 若读取长度大于0，将接收的数据通过messageCallback_传递到上层应用(这里是TcpServer)
     if(n > 0) {
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        __atomic_store_n(&active_, true, __ATOMIC_RELAXED);
+        g_bytesReceived->add(n);
+        g_readSize->record(n);
+        callbacks_->messageCallback(shared_from_this(), &inputBuffer_, receiveTime);
+        if(rateLimiter_ || sharedRateLimiter_) {
+            throttle(n, receiveTime);
+        }
     }
     // 如果长度等于0，说明对端客户端关闭了连接，调用handleClose()进行关闭处理
     else if (n == 0) {
@@ -206,17 +274,27 @@ void TcpConnection::handleRead(Timestamp receiveTime) {
 // 采用LT水平触发，需要在发送数据的时候才关注可写事件，否则会造成busy loop
 void TcpConnection::handleWrite() {
     loop_->assertInLoopThread();
-    if(channel_->isWriting()) { // 当前sockfd可写
-        ssize_t n = sockets::write(channel_->fd(),
+    if(channel_.isWriting()) { // 当前sockfd可写
+        ssize_t n = sockets::write(channel_.fd(),
                                    outputBuffer_.peek(),
                                    outputBuffer_.readableBytes());
         if(n > 0) {
+            __atomic_store_n(&active_, true, __ATOMIC_RELAXED);
+            g_bytesSent->add(n);
             outputBuffer_.retrieve(n);
+            // 与高水位回调一样经过queueInLoop 两者的先后顺序不变
+            if(aboveHighWaterMark_ && outputBuffer_.readableBytes() <= lowWaterMark_) {
+                aboveHighWaterMark_ = false;
+                if(lowWaterMarkCallback_) {
+                    loop_->queueInLoop(std::bind(lowWaterMarkCallback_, shared_from_this(),
+                                                 outputBuffer_.readableBytes()));
+                }
+            }
             if(outputBuffer_.readableBytes() == 0) {    // 发送完毕
-                channel_->disableWriting(); // 不再关注fd的可写事件，避免busy loop
-                if(writeCompleteCallback_) {
+                channel_.disableWriting(); // 不再关注fd的可写事件，避免busy loop
+                if(callbacks_->writeCompleteCallback) {
                     // 通知用户，发送完毕
-                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                    loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
                 }
                 // 如果当前状态是正在关闭连接，主动发送关闭
                 if(state_ == kDisconnecting) {
@@ -229,7 +307,7 @@ void TcpConnection::handleWrite() {
         }
     }
     else {
-        LOG_TRACE << "Connection fd = " << channel_->fd()
+        LOG_TRACE << "Connection fd = " << channel_.fd()
                   << " is down, no more writing";
     }
 }
@@ -237,20 +315,35 @@ void TcpConnection::handleWrite() {
 // 关闭事件处理
 void TcpConnection::handleClose() {
     loop_->assertInLoopThread();
-    LOG_TRACE << "fd = " << channel_->fd() << " state = " << stateToString();
+    LOG_TRACE << "fd = " << channel_.fd() << " state = " << stateToString();
     assert(state_ == kConnected || state_ == kDisconnecting);
     setState(kDisconnected);
-    channel_->disableAll(); // channel不再关注任何事情
+    channel_.disableAll(); // channel不再关注任何事情
+    leaveHighWaterMark();
 
     TcpConnectionPtr guardThis(shared_from_this()); //必须使用智能指针
-    connectionCallback_(guardThis); // 回调用户的连接处理回调函数
+    callbacks_->connectionCallback(guardThis); // 回调用户的连接处理回调函数
     //必须最后调用，回调TcpServer的函数，TcpConnection的生命期由TcpServer控制
-    closeCallback_(guardThis);
+    callbacks_->closeCallback(guardThis);
+}
+
+/**
+ * 断开后输出缓冲区不会再发送 也就不会降到低水位
+ * 还在高水位之上时补一次低水位回调 让因此暂停的一方恢复 见backpressure::link()
+ */
+void TcpConnection::leaveHighWaterMark() {
+    if(aboveHighWaterMark_) {
+        aboveHighWaterMark_ = false;
+        if(lowWaterMarkCallback_) {
+            loop_->queueInLoop(std::bind(lowWaterMarkCallback_, shared_from_this(),
+                                         outputBuffer_.readableBytes()));
+        }
+    }
 }
 
 void TcpConnection::handleError() {
-    int err = sockets::getSocketError(channel_->fd());
-    LOG_ERROR << "TcpConnection::handleError [" << name_
+    int err = sockets::getSocketError(channel_.fd());
+    LOG_ERROR << "TcpConnection::handleError [" << name()
               << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
 
@@ -268,14 +361,16 @@ void TcpConnection::sendInLoop(const void* data, size_t len) {
         LOG_WARN << "disconnected, give up writing";
         return ;
     }
+    __atomic_store_n(&active_, true, __ATOMIC_RELAXED);
     // 如果当前channel没有写事件发生，并且发送buffer无待发送数据，那么直接发送
-    if(!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
-        nwrote = sockets::write(channel_->fd(), data, len);
+    if(!channel_.isWriting() && outputBuffer_.readableBytes() == 0) {
+        nwrote = sockets::write(channel_.fd(), data, len);
         if(nwrote >= 0) {
+            g_bytesSent->add(nwrote);
             remaining = len - nwrote;
             // 如果一次发送完毕，就调用发送完成回调函数
-            if(remaining == 0 && writeCompleteCallback_) {
-                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            if(remaining == 0 && callbacks_->writeCompleteCallback) {
+                loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
             }
         }
         else {  // 一旦发生错误，关闭连接
@@ -294,25 +389,25 @@ void TcpConnection::sendInLoop(const void* data, size_t len) {
     if(!faultError && remaining > 0) {
         size_t oldLen = outputBuffer_.readableBytes();
         // 如果输出缓冲区的数据已经超过超高水位标记，那么调用highWaterMarkCallback_
-        if(oldLen + remaining >= highWaterMark_
-           && oldLen < highWaterMark_
-           && highWaterMarkCallback_)
-        {
-            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+        if(oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_) {
+            aboveHighWaterMark_ = true;
+            if(highWaterMarkCallback_) {
+                loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+            }
         }
         // 把数据添加到输出缓冲区中
         outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
         // 监听channel的可写事件，因为还有数据未发完
-        if(!channel_->isWriting()) {
-            channel_->enableWriting();
+        if(!channel_.isWriting()) {
+            channel_.enableWriting();
         }
     }
 }
 
 void TcpConnection::shutdownInLoop() {
     loop_->assertInLoopThread();
-    if(!channel_->isWriting()) {
-        socket_->shutdownWrite();
+    if(!channel_.isWriting()) {
+        socket_.shutdownWrite();
     }
 }
 
@@ -340,20 +435,50 @@ const char* TcpConnection::stateToString() const {
 
 void TcpConnection::startReadInLoop() {
     loop_->assertInLoopThread();
-    if(!reading_ || !channel_->isReading()) {
-        channel_->enableReading();
+    if(!reading_ || !channel_.isReading()) {
         reading_ = true;
+        // 限速暂停期间只记下来 由unthrottle()恢复
+        if(!throttled_ && !channel_.isReading()) {
+            channel_.enableReading();
+        }
     }
 }
 
 void TcpConnection::stopReadInLoop() {
     loop_->assertInLoopThread();
-    if(reading_ || channel_->isReading()) {
-        channel_->disableReading();
+    if(reading_ || channel_.isReading()) {
+        channel_.disableReading();
         reading_ = false;
     }
 }
 
+// 已经读到的数据照常交给messageCallback 之后按欠账的时间暂停读
+void TcpConnection::throttle(size_t bytes, Timestamp receiveTime) {
+    double delay = 0;
+    if(rateLimiter_) {
+        delay = rateLimiter_->charge(bytes, receiveTime);
+    }
+    if(sharedRateLimiter_) {
+        delay = std::max(delay, sharedRateLimiter_->charge(bytes, receiveTime));
+    }
+    if(delay > 0 && state_ != kDisconnected && !throttled_) {
+        throttled_ = true;
+        g_throttled->increment();
+        if(channel_.isReading()) {
+            channel_.disableReading();
+        }
+        loop_->runAfter(delay, makeWeakCallback(shared_from_this(), &TcpConnection::unthrottle));
+    }
+}
+
+void TcpConnection::unthrottle() {
+    loop_->assertInLoopThread();
+    throttled_ = false;
+    if(reading_ && state_ != kDisconnected && !channel_.isReading()) {
+        channel_.enableReading();
+    }
+}
+
 
 }   // namespace net
     
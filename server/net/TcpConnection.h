@@ -7,40 +7,70 @@
 
 #pragma once
 
+#include "server/base/Context.h"
 #include "server/base/noncopyable.h"
 #include "server/base/StringPiece.h"
 #include "server/base/Types.h"
 #include "server/net/Callbacks.h"
 #include "server/net/Buffer.h"
+#include "server/net/Channel.h"
 #include "server/net/InetAddress.h"
+#include "server/net/RateLimiter.h"
+#include "server/net/Socket.h"
 
 #include <memory>
 
-#include <boost/any.hpp>
-
 struct tcp_info;
 
 namespace myserver {
 
 namespace net {
 
-class Channel;
 class EventLoop;
-class Socket;
 
+/**
+ * 同一个TcpServer的所有连接共享一份回调 不在每个连接里复制std::function
+ * 连接上调用set*Callback()时复制出自己的一份再修改
+ */
+struct ConnectionCallbacks {
+    ConnectionCallback connectionCallback;
+    MessageCallback messageCallback;
+    WriteCompleteCallback writeCompleteCallback;
+    CloseCallback closeCallback;
+
+    ConnectionCallbacks()
+        : connectionCallback(defaultConnectionCallback),
+          messageCallback(defaultMessageCallback)
+    { }
+};
+typedef std::shared_ptr<const ConnectionCallbacks> ConnectionCallbacksPtr;
+
+/**
+ * Socket和Channel直接作为成员 TcpServer用std::allocate_shared从IO线程的Slab分配
+ * 对象和引用计数在同一块内存里 一个连接只有输入输出缓冲区还需要单独分配
+ */
 class TcpConnection : noncopyable,
                       public std::enable_shared_from_this<TcpConnection>
 {
 public:
+    /**
+     * id是TcpServer分配的连接ID 在同一个TcpServer内唯一且不为0
+     * namePrefix由同一个TcpServer的所有连接共享 名字在name()里才拼接
+     * callbacks为空时使用默认的连接和消息回调
+     */
     TcpConnection(EventLoop* loop,
-                  const string& name,
+                  uint64_t id,
+                  const std::shared_ptr<const string>& namePrefix,
                   int sockfd,
                   const InetAddress& localAddr,
-                  const InetAddress& peerAddr);
+                  const InetAddress& peerAddr,
+                  const ConnectionCallbacksPtr& callbacks = ConnectionCallbacksPtr());
     ~TcpConnection();
 
     EventLoop* getLoop() const { return loop_; }
-    const string& name() const { return name_; }
+    uint64_t id() const { return id_; }
+    // 形如 "服务器名-ip:port#id" 每次调用都会格式化 热路径上用id()
+    string name() const;
     const InetAddress& localAddress() const { return localAddr_; }
     const InetAddress& peerAddress() const { return peerAddr_; }
     bool connected() const { return state_ == kConnected; }
@@ -62,26 +92,45 @@ public:
     void stopRead();
     bool isReading() const { return reading_; }
 
-    void setContext(const boost::any& context) { context_ = context; }
-    const boost::any& getContext() const { return context_; }
-    boost::any* getMutableContext() { return &context_; }
-
-    void setConnectionCallback(const ConnectionCallback& cb)
-    { connectionCallback_ = cb; }
-
-    void setMessageCallback(const MessageCallback& cb)
-    { messageCallback_ = cb; }
-
-    void setWriteCompleteCallback(const WriteCompleteCallback& cb)
-    { writeCompleteCallback_ = cb; }
+    /**
+     * 读取超过限速时暂停读 由定时器在还清欠账后恢复 不阻塞IO线程
+     * rateLimiter只属于这个连接 sharedRateLimiter由多个连接共享 可以为空 在IO线程调用
+     */
+    void setRateLimiter(const RateLimiterPtr& limiter) { rateLimiter_ = limiter; }
+    void setSharedRateLimiter(const RateLimiterPtr& limiter) { sharedRateLimiter_ = limiter; }
+    bool isThrottled() const { return throttled_; }
+
+    // 返回上次调用以来有没有收到或发出数据 并清除标志 TcpServer::drain()用来判断连接是否空闲
+    bool takeActive() { return __atomic_exchange_n(&active_, false, __ATOMIC_RELAXED); }
+
+    /**
+     * 协议的解析状态 小于Context::kInlineSize时就放在连接对象里
+     * 例如 conn->setContext(HttpContext()) 之后用 conn->getMutableContext()->get<HttpContext>()
+     */
+    template<typename T>
+    void setContext(T&& context)
+    { context_.emplace<typename std::decay<T>::type>(std::forward<T>(context)); }
+    const Context& getContext() const { return context_; }
+    Context* getMutableContext() { return &context_; }
+
+    void setConnectionCallback(const ConnectionCallback& cb);
+    void setMessageCallback(const MessageCallback& cb);
+    void setWriteCompleteCallback(const WriteCompleteCallback& cb);
 
     void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
     { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
 
+    /**
+     * 输出缓冲区超过高水位之后 发送到不超过lowWaterMark时调用 见backpressure::link()
+     * 还在高水位之上时连接断开 也调用一次
+     */
+    void setLowWaterMarkCallback(const LowWaterMarkCallback& cb, size_t lowWaterMark)
+    { lowWaterMarkCallback_ = cb; lowWaterMark_ = lowWaterMark; }
+
     Buffer* inputBuffer() { return &inputBuffer_; }
     Buffer* outputBuffer() { return &outputBuffer_; }
 
-    void setCloseCallback(const CloseCallback& cb) { closeCallback_ = cb; }
+    void setCloseCallback(const CloseCallback& cb);
 
     void connectEstablished();
     void connectDestroyed();
@@ -92,6 +141,7 @@ private:
     void handleWrite();
     void handleClose();
     void handleError();
+    void leaveHighWaterMark();
 
     void sendInLoop(const StringPiece& message);
     void sendInLoop(const void* message, size_t len);
@@ -102,24 +152,34 @@ private:
     const char* stateToString() const;
     void startReadInLoop();
     void stopReadInLoop();
+    void throttle(size_t bytes, Timestamp receiveTime);
+    void unthrottle();
+    // 复制一份共享的回调 由modify修改后替换
+    template<typename F>
+    void modifyCallbacks(F modify);
 
     EventLoop* loop_;
-    const string name_;
+    const uint64_t id_;
+    const std::shared_ptr<const string> namePrefix_;
     StateE state_;
     bool reading_;
-    std::unique_ptr<Socket> socket_;
-    std::unique_ptr<Channel> channel_;
+    bool throttled_;                // 因为限速暂停了读 与reading_分开 恢复时不改变用户的设置
+    bool active_;                   // 有读写 由takeActive()清除
+    Socket socket_;
+    Channel channel_;
     const InetAddress localAddr_;
     const InetAddress peerAddr_;
-    ConnectionCallback connectionCallback_;
-    MessageCallback messageCallback_;
-    WriteCompleteCallback writeCompleteCallback_;
+    ConnectionCallbacksPtr callbacks_;
     HighWaterMarkCallback highWaterMarkCallback_;
-    CloseCallback closeCallback_;
     size_t highWaterMark_;
+    LowWaterMarkCallback lowWaterMarkCallback_;
+    size_t lowWaterMark_;
+    bool aboveHighWaterMark_;       // 超过高水位后还没有降到低水位
+    RateLimiterPtr rateLimiter_;
+    RateLimiterPtr sharedRateLimiter_;
     Buffer inputBuffer_;
     Buffer outputBuffer_;
-    boost::any context_;
+    Context context_;
 
 };
 
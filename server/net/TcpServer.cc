@@ -8,15 +8,34 @@
 #include "server/net/TcpServer.h"
 
 #include "server/base/Logging.h"
+#include "server/base/Metrics.h"
+#include "server/base/Slab.h"
 #include "server/net/Acceptor.h"
 #include "server/net/EventLoop.h"
+#include "server/net/Handoff.h"
+#include "server/net/Socket.h"
 #include "server/net/SocketsOps.h"
 
+#include <unistd.h>
+
 
 namespace myserver {
 
 namespace net {
 
+namespace {
+
+Gauge* const g_connections = MetricsRegistry::instance().gauge(
+    "myserver_tcp_connections", "Open connections of all TcpServers");
+Counter* const g_drainShutdowns = MetricsRegistry::instance().counter(
+    "myserver_tcp_drain_shutdowns_total", "Idle connections shut down while draining");
+Counter* const g_drainForceClosed = MetricsRegistry::instance().counter(
+    "myserver_tcp_drain_force_closed_total", "Connections force closed at the drain deadline");
+
+}   // namespace
+
+const double TcpServer::kDrainInterval = 0.01;
+
 TcpServer::TcpServer(EventLoop* loop,
                      const InetAddress& listenAddr,
                      const string& nameArg,
@@ -24,11 +43,34 @@ TcpServer::TcpServer(EventLoop* loop,
     : loop_(CHECK_NOTNULL(loop)),
       ipPort_(listenAddr.toIpPort()),
       name_(nameArg),
+      namePrefix_(std::make_shared<const string>(name_ + "-" + ipPort_)),
       acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
-      connectionCallback_(defaultConnectionCallback),
-      messageCallback_(defaultMessageCallback),
-      nextConnId_(1)
+      nextConnId_(1),
+      handedOff_(false),
+      draining_(false)
+{
+    std::shared_ptr<ConnectionCallbacks> callbacks = std::make_shared<ConnectionCallbacks>();
+    callbacks->closeCallback = std::bind(&TcpServer::removeConnection, this, _1);
+    callbacks_ = callbacks;
+    acceptor_->setNewConnectionCallback(
+        std::bind(&TcpServer::newConnection, this, _1, _2));
+}
+
+TcpServer::TcpServer(EventLoop* loop,
+                     int listenFd,
+                     const string& nameArg)
+    : loop_(CHECK_NOTNULL(loop)),
+      ipPort_(InetAddress(sockets::getLocalAddr(listenFd)).toIpPort()),
+      name_(nameArg),
+      namePrefix_(std::make_shared<const string>(name_ + "-" + ipPort_)),
+      acceptor_(new Acceptor(loop, listenFd)),
+      nextConnId_(1),
+      handedOff_(false),
+      draining_(false)
 {
+    std::shared_ptr<ConnectionCallbacks> callbacks = std::make_shared<ConnectionCallbacks>();
+    callbacks->closeCallback = std::bind(&TcpServer::removeConnection, this, _1);
+    callbacks_ = callbacks;
     acceptor_->setNewConnectionCallback(
         std::bind(&TcpServer::newConnection, this, _1, _2));
 }
@@ -36,15 +78,51 @@ TcpServer::TcpServer(EventLoop* loop,
 TcpServer::~TcpServer() {
     loop_->assertInLoopThread();
     LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
+    closeHandoff();
+    if(draining_) {
+        loop_->cancel(drainTimer_);
+    }
 
-    for(auto& item : connections_) {
-        TcpConnectionPtr conn(item.second);
-        item.second.reset();
+    ConnectionTable connections;
+    connections.swap(connections_);
+    g_connections->add(-static_cast<int64_t>(connections.size()));
+    connections.forEach([](uint64_t, const TcpConnectionPtr& conn) {
         conn->getLoop()->runInLoop(
             std::bind(&TcpConnection::connectDestroyed, conn));
+    });
+}
+
+
+void TcpServer::setConnectionCallback(const ConnectionCallback& cb) {
+    std::shared_ptr<ConnectionCallbacks> callbacks = std::make_shared<ConnectionCallbacks>(*callbacks_);
+    callbacks->connectionCallback = cb;
+    callbacks_ = callbacks;
+}
+
+void TcpServer::setMessageCallback(const MessageCallback& cb) {
+    std::shared_ptr<ConnectionCallbacks> callbacks = std::make_shared<ConnectionCallbacks>(*callbacks_);
+    callbacks->messageCallback = cb;
+    callbacks_ = callbacks;
+}
+
+void TcpServer::setWriteCompleteCallback(const WriteCompleteCallback& cb) {
+    std::shared_ptr<ConnectionCallbacks> callbacks = std::make_shared<ConnectionCallbacks>(*callbacks_);
+    callbacks->writeCompleteCallback = cb;
+    callbacks_ = callbacks;
+}
+
+void TcpServer::setServerRateLimit(const RateLimit& limit) {
+    if(limit.enabled()) {
+        serverRateLimiter_ = std::make_shared<RateLimiter>(limit);
+    }
+    else {
+        serverRateLimiter_.reset();
     }
 }
 
+void TcpServer::setAdmissionPolicy(const AdmissionPolicy& policy) {
+    admission_.reset(new AdmissionController(policy));
+}
 
 void TcpServer::start() {
     if(started_.getAndSet(1) == 0) {
@@ -56,39 +134,231 @@ void TcpServer::start() {
 
 void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr) {
     loop_->assertInLoopThread();
-    char buf[64];
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
-    string connName = name_ + buf;
-
+    if(admission_ && !admit(sockfd)) {
+        return;
+    }
+    uint64_t id = nextConnId_++;
+    // 直接写入日志流 不拼接连接名
     LOG_INFO << "TcpServer::newConnection [" << name_
-             << "] - new connection [" << connName
+             << "] - new connection [" << *namePrefix_ << '#' << id
              << "] from " << peerAddr.toIpPort();
     
     InetAddress localAddr(sockets::getLocalAddr(sockfd));
 
-    TcpConnectionPtr conn(new TcpConnection(loop_, connName, sockfd, localAddr, peerAddr));
-    
-    connections_[connName] = conn;
-    conn->setConnectionCallback(connectionCallback_);
-    conn->setMessageCallback(messageCallback_);
-    conn->setWriteCompleteCallback(writeCompleteCallback_);
-    conn->setCloseCallback(
-        std::bind(&TcpServer::removeConnection, this, _1));
-    loop_->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    // 对象和引用计数一起从IO线程的Slab分配
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(
+        SlabAllocator<TcpConnection>(loop_->connectionSlab()),
+        loop_, id, namePrefix_, sockfd, localAddr, peerAddr, callbacks_);
+
+    if(connectionRateLimit_.enabled()) {
+        conn->setRateLimiter(std::make_shared<RateLimiter>(connectionRateLimit_));
+    }
+    if(serverRateLimiter_) {
+        conn->setSharedRateLimiter(serverRateLimiter_);
+    }
+
+    connections_.insert(id, conn);
+    g_connections->increment();
+    // newConnection总在IO线程里 直接建立连接 不必经过runInLoop复制一次std::function
+    conn->connectEstablished();
+}
+
+/**
+ * 过载时拒绝要尽量便宜 不格式化日志 不分配对象
+ * 新accept的socket发送缓冲区是空的 rejectMessage不长时一次非阻塞的write就能写完
+ */
+bool TcpServer::admit(int sockfd) {
+    const AdmissionPolicy& policy = admission_->policy();
+    size_t queueSize = policy.maxQueueSize > 0 ? loop_->queueSize() : 0;
+    AdmissionController::Decision decision =
+        admission_->admit(connections_.size(), queueSize, loop_->lag(), loop_->cachedNow());
+    if(decision == AdmissionController::kAdmit) {
+        return true;
+    }
+    LOG_DEBUG << "TcpServer::admit [" << name_ << "] - rejected by "
+              << AdmissionController::decisionName(decision);
+    if(!policy.rejectMessage.empty()) {
+        sockets::write(sockfd, policy.rejectMessage.data(), policy.rejectMessage.size());
+    }
+    sockets::close(sockfd);
+    return false;
+}
+
+TcpConnectionPtr TcpServer::findConnection(uint64_t id) const {
+    loop_->assertInLoopThread();
+    const TcpConnectionPtr* conn = connections_.find(id);
+    return conn ? *conn : TcpConnectionPtr();
+}
+
+void TcpServer::enableHandoff(const string& path, const HandoffCallback& cb) {
+    loop_->runInLoop(std::bind(&TcpServer::enableHandoffInLoop, this, path, cb));
+}
+
+void TcpServer::enableHandoffInLoop(const string& path, const HandoffCallback& cb) {
+    loop_->assertInLoopThread();
+    if(handoffSocket_ || handedOff_) {
+        LOG_ERROR << "TcpServer::enableHandoff [" << name_ << "] already enabled";
+        return;
+    }
+    int sockfd = handoff::listen(path);
+    if(sockfd < 0) {
+        return;
+    }
+    handoffPath_ = path;
+    handoffCallback_ = cb;
+    handoffSocket_.reset(new Socket(sockfd));
+    handoffChannel_.reset(new Channel(loop_, sockfd));
+    handoffChannel_->setReadCallback(std::bind(&TcpServer::handleHandoff, this));
+    handoffChannel_->enableReading();
+    LOG_INFO << "TcpServer::enableHandoff [" << name_ << "] waiting on " << path;
+}
+
+/**
+ * 先把描述符发出去再停止accept 中间到达的连接留在共享的accept队列里 由新进程接受
+ * 对端不是同一个用户或者发送失败时继续提供服务 等待下一次请求
+ */
+void TcpServer::handleHandoff() {
+    loop_->assertInLoopThread();
+    int peer = ::accept4(handoffSocket_->fd(), NULL, NULL, SOCK_CLOEXEC);
+    if(peer < 0) {
+        LOG_SYSERR << "TcpServer::handleHandoff accept";
+        return;
+    }
+    std::vector<int> fds(1, acceptor_->fd());
+    bool sent = handoff::checkPeer(peer) && handoff::sendFds(peer, fds, ipPort_);
+    ::close(peer);
+    if(!sent) {
+        return;
+    }
+    LOG_INFO << "TcpServer::handleHandoff [" << name_ << "] listening socket "
+             << ipPort_ << " handed off, " << connections_.size() << " connections left";
+    handedOff_ = true;
+    acceptor_->stop();
+    // 回调里可能析构TcpServer
+    HandoffCallback cb;
+    cb.swap(handoffCallback_);
+    closeHandoff();
+    if(cb) {
+        cb();
+    }
+}
+
+void TcpServer::closeHandoff() {
+    if(handoffChannel_) {
+        handoffChannel_->disableAll();
+        handoffChannel_->remove();
+        // Channel在自己的handleEvent里 推迟到这一轮结束再释放
+        std::shared_ptr<Channel> channel(std::move(handoffChannel_));
+        std::shared_ptr<Socket> socket(std::move(handoffSocket_));
+        loop_->queueInLoop([channel, socket] { });
+        ::unlink(handoffPath_.c_str());
+    }
+}
+
+void TcpServer::stopAccepting() {
+    loop_->runInLoop(std::bind(&TcpServer::stopAcceptingInLoop, this));
+}
+
+void TcpServer::stopAcceptingInLoop() {
+    loop_->assertInLoopThread();
+    if(acceptor_->listening()) {
+        LOG_INFO << "TcpServer::stopAccepting [" << name_ << "] " << ipPort_;
+        acceptor_->stop();
+    }
+}
+
+void TcpServer::drain(double timeout, const DrainCallback& cb) {
+    loop_->runInLoop(std::bind(&TcpServer::drainInLoop, this, timeout, cb));
+}
+
+void TcpServer::drainInLoop(double timeout, const DrainCallback& cb) {
+    loop_->assertInLoopThread();
+    if(draining_) {
+        LOG_WARN << "TcpServer::drain [" << name_ << "] already draining";
+        return;
+    }
+    stopAcceptingInLoop();
+    closeHandoff();
+    draining_ = true;
+    drainDeadline_ = addTime(Timestamp::nowFast(), timeout);
+    drainCallback_ = cb;
+    drainStats_ = DrainStats();
+    drainStats_.remaining = connections_.size();
+    LOG_INFO << "TcpServer::drain [" << name_ << "] " << connections_.size()
+             << " connections, timeout " << timeout << "s";
+    drainTimer_ = loop_->runEvery(kDrainInterval, std::bind(&TcpServer::drainTick, this));
+    drainTick();
+}
+
+/**
+ * 正在收请求或还有输出的连接先不动 半关闭之后对端还可以继续发送 但收不到回复了
+ * 缓冲区都为空时请求可能正在别的线程里处理 所以还要求上一次检查以来没有读写
+ */
+void TcpServer::drainTick() {
+    loop_->assertInLoopThread();
+    if(drainStats_.done) {
+        return;
+    }
+    size_t previous = drainStats_.remaining;
+    if(!connections_.empty()) {
+        if(!drainStats_.timedOut && Timestamp::nowFast() < drainDeadline_) {
+            connections_.forEach([this](uint64_t, const TcpConnectionPtr& conn) {
+                if(conn->connected()
+                   && !conn->takeActive()
+                   && conn->inputBuffer()->readableBytes() == 0
+                   && conn->outputBuffer()->readableBytes() == 0) {
+                    conn->shutdown();
+                    ++drainStats_.shutdowns;
+                    g_drainShutdowns->increment();
+                }
+            });
+        }
+        else if(!drainStats_.timedOut) {
+            drainStats_.timedOut = true;
+            LOG_WARN << "TcpServer::drain [" << name_ << "] deadline reached, force closing "
+                     << connections_.size() << " connections";
+            connections_.forEach([this](uint64_t, const TcpConnectionPtr& conn) {
+                conn->forceClose();
+                ++drainStats_.forceClosed;
+                g_drainForceClosed->increment();
+            });
+        }
+    }
+    drainStats_.remaining = connections_.size();
+    drainStats_.done = connections_.empty();
+    if(drainStats_.done) {
+        LOG_INFO << "TcpServer::drain [" << name_ << "] done, " << drainStats_.shutdowns
+                 << " shut down, " << drainStats_.forceClosed << " force closed";
+        loop_->cancel(drainTimer_);
+    }
+    if(drainCallback_ && (drainStats_.done || drainStats_.remaining != previous)) {
+        // 回调里可能析构TcpServer 先复制
+        DrainCallback cb(drainCallback_);
+        DrainStats stats(drainStats_);
+        if(stats.done) {
+            drainCallback_ = DrainCallback();
+        }
+        cb(stats);
+    }
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr& conn) {
-    loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    if(loop_->isInLoopThread()) {
+        removeConnectionInLoop(conn);
+    }
+    else {
+        loop_->queueInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    }
 }
 
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn) {
     loop_->assertInLoopThread();
     LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
-             << "] - connection " << conn->name();
-    size_t n = connections_.erase(conn->name());
-    (void) n;
-    assert(n == 1);
+             << "] - connection " << *namePrefix_ << '#' << conn->id();
+    bool erased = connections_.erase(conn->id());
+    (void) erased;
+    assert(erased);
+    g_connections->decrement();
     EventLoop* ioLoop = conn->getLoop();
     ioLoop->queueInLoop(
         std::bind(&TcpConnection::connectDestroyed, conn));
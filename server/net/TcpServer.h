@@ -9,20 +9,41 @@
 
 #include "server/base/Atomic.h"
 #include "server/base/Types.h"
+#include "server/net/AdmissionController.h"
+#include "server/net/ConnectionTable.h"
+#include "server/net/RateLimiter.h"
 #include "server/net/TcpConnection.h"
-
-#include <map>
+#include "server/net/TimerId.h"
 
 namespace myserver {
 
 namespace net {
 
 class Acceptor;
+class Channel;
 class EventLoop;
+class Socket;
+
+/**
+ * TcpServer::drain()的进度
+ */
+struct DrainStats {
+    size_t remaining;       // 还没有关闭的连接
+    size_t shutdowns;       // 已经半关闭的空闲连接
+    size_t forceClosed;     // 到期后强制关闭的连接
+    bool timedOut;          // 是否到了期限
+    bool done;              // 所有连接都已关闭
+
+    DrainStats()
+        : remaining(0), shutdowns(0), forceClosed(0), timedOut(false), done(false)
+    { }
+};
 
 class TcpServer : noncopyable {
 public:
     typedef std::function<void(EventLoop*)> ThreadInitCallback;
+    typedef std::function<void()> HandoffCallback;
+    typedef std::function<void(const DrainStats&)> DrainCallback;
     enum Option {
         kNoReusePort,
         kReusePort,
@@ -32,6 +53,10 @@ public:
               const InetAddress& listenAddr,
               const string& nameArg,
               Option option = kNoReusePort);
+    // 接管已经绑定好地址的监听描述符 见handoff::takeListenFd()
+    TcpServer(EventLoop* loop,
+              int listenFd,
+              const string& nameArg);
     ~TcpServer();
 
     const string& ipPort() const { return ipPort_; }
@@ -40,33 +65,92 @@ public:
 
     void start();
 
-    void setConnectionCallback(const ConnectionCallback& cb)
-    { connectionCallback_ = cb; }
-
-    void setMessageCallback(const MessageCallback& cb)
-    { messageCallback_ = cb; }
-
-    void setWriteCompleteCallback(const WriteCompleteCallback& cb)
-    { writeCompleteCallback_ = cb;}
+    // 当前的连接数和按ID查找连接 在IO线程调用
+    size_t numConnections() const { return connections_.size(); }
+    TcpConnectionPtr findConnection(uint64_t id) const;
+
+    /**
+     * 在Unix域socket path上等待新进程 新进程连上后把监听描述符交给它
+     * 然后停止accept并调用cb 已有的连接不受影响 在cb里调用drain() 完成后旧进程退出
+     * 只交接一次 可以在任何线程调用
+     */
+    void enableHandoff(const string& path, const HandoffCallback& cb);
+    bool handedOff() const { return handedOff_; }
+
+    // 不再accept新连接 监听socket保持打开直到TcpServer析构 可以在任何线程调用
+    void stopAccepting();
+
+    /**
+     * 优雅地关闭所有连接 析构之前调用 否则析构时直接断开所有连接 输出缓冲区里的数据会丢失
+     * 先停止accept 然后每kDrainInterval秒检查一次 输入输出缓冲区都为空
+     * 并且上一次检查以来没有读写的连接调用shutdown() 异步处理的请求要在kDrainInterval秒内回复
+     * 等对端读到EOF后关闭 还有输出的连接等数据发完 到达timeout秒时强制关闭剩下的连接
+     * 剩余连接数变化时和全部关闭时调用cb 最后一次done为true 可以在任何线程调用
+     */
+    void drain(double timeout, const DrainCallback& cb);
+    bool draining() const { return draining_; }
+    // 在IO线程调用
+    const DrainStats& drainStats() const { return drainStats_; }
+
+    static const double kDrainInterval;
+
+    /**
+     * 之后建立的每个连接各自按limit限速 超过时暂停读 见TcpConnection::setRateLimiter()
+     * 已有的连接不受影响 在start()之前或IO线程调用
+     */
+    void setConnectionRateLimit(const RateLimit& limit) { connectionRateLimit_ = limit; }
+    // 之后建立的所有连接合计按limit限速
+    void setServerRateLimit(const RateLimit& limit);
+    const RateLimiterPtr& serverRateLimiter() const { return serverRateLimiter_; }
+
+    /**
+     * accept之后先经过准入控制 被拒绝的连接不创建TcpConnection 写入policy.rejectMessage后关闭
+     * 在start()之前或IO线程调用 见AdmissionController
+     */
+    void setAdmissionPolicy(const AdmissionPolicy& policy);
+    // 没有设置准入策略时为NULL 在IO线程调用
+    const AdmissionController* admissionController() const { return get_pointer(admission_); }
+
+    // 之后建立的连接共享同一份回调 已有的连接不受影响
+    void setConnectionCallback(const ConnectionCallback& cb);
+    void setMessageCallback(const MessageCallback& cb);
+    void setWriteCompleteCallback(const WriteCompleteCallback& cb);
 
 private:
     void newConnection(int sockfd, const InetAddress& peerAddr);
+    bool admit(int sockfd);
     void removeConnection(const TcpConnectionPtr& conn);
     void removeConnectionInLoop(const TcpConnectionPtr& conn);
-
-    typedef std::map<string, TcpConnectionPtr> ConnectionMap;
+    void enableHandoffInLoop(const string& path, const HandoffCallback& cb);
+    void handleHandoff();
+    void closeHandoff();
+    void stopAcceptingInLoop();
+    void drainInLoop(double timeout, const DrainCallback& cb);
+    void drainTick();
 
     EventLoop* loop_;
     const string ipPort_;
     const string name_;
+    const std::shared_ptr<const string> namePrefix_;    // "name_-ipPort_" 所有连接共享
     std::unique_ptr<Acceptor> acceptor_;
-    ConnectionCallback connectionCallback_;
-    MessageCallback messageCallback_;
-    WriteCompleteCallback writeCompleteCallback_;
+    ConnectionCallbacksPtr callbacks_;  // 新连接共享 修改时复制一份 不影响已有的连接
     ThreadInitCallback threadInitCallback_;
     AtomicInt32 started_;
-    int nextConnId_;
-    ConnectionMap connections_;
+    uint64_t nextConnId_;
+    ConnectionTable connections_;
+    string handoffPath_;
+    std::unique_ptr<Socket> handoffSocket_;     // 等待新进程的Unix域socket
+    std::unique_ptr<Channel> handoffChannel_;
+    HandoffCallback handoffCallback_;
+    bool handedOff_;
+    bool draining_;
+    Timestamp drainDeadline_;
+    TimerId drainTimer_;
+    DrainCallback drainCallback_;
+    DrainStats drainStats_;
+    RateLimit connectionRateLimit_;
+    RateLimiterPtr serverRateLimiter_;
+    std::unique_ptr<AdmissionController> admission_;
 };
 
 }   // namespace net
@@ -44,7 +44,7 @@ int createTimerfd() {
  * };
  */
 struct timespec howMuchTimeFromNow(Timestamp when) {
-    int64_t microseconds = when.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+    int64_t microseconds = when.microSecondsSinceEpoch() - Timestamp::nowFast().microSecondsSinceEpoch();
 
     if(microseconds < 100) {
         microseconds = 100;
@@ -200,7 +200,7 @@ void TimerQueue::cancelInLoop(TimerId timerId) {
  */
 void TimerQueue::handleRead() {
     loop_->assertInLoopThread();
-    Timestamp now(Timestamp::now());
+    Timestamp now(Timestamp::nowFast());
     // 对timefd进行读操作，避免重复触发到期事件
     detail::readTimerfd(timerfd_, now);
 
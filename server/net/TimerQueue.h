@@ -42,6 +42,9 @@ public:
 
     void cancel(TimerId timerId);
 
+    // timerfd 用于区分定时器事件和其他IO事件
+    int fd() const { return timerfd_; }
+
 private:
     /**
      * TimerQueue需要高效地组织目前尚未到期的Timer，能快速地根据当前时间找到已经到期的Timer
@@ -0,0 +1,169 @@
+/**
+* @description: Admission_test.cc
+* @author: YQ Huang
+* @brief: 新连接准入控制 测试函数
+* @date: 2026/10/19 06:52:17
+*/
+
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+#include "server/net/AdmissionController.h"
+#include "server/net/EventLoop.h"
+#include "server/net/InetAddress.h"
+#include "server/net/SocketsOps.h"
+#include "server/net/TcpServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+const uint16_t kPort = 20490;
+const Timestamp kStart(Timestamp::fromUnixTime(1800000000));
+
+Timestamp at(double seconds) {
+    return addTime(kStart, seconds);
+}
+
+// 连接数 任务队列和延迟的上限 依次检查
+void testLimits() {
+    AdmissionPolicy policy;
+    policy.maxConnections = 10;
+    policy.maxQueueSize = 100;
+    policy.maxLoopLag = 0.05;
+    AdmissionController admission(policy);
+    CHECK(admission.admit(9, 99, 0.049, at(0)) == AdmissionController::kAdmit);
+    CHECK(admission.admit(10, 0, 0, at(0)) == AdmissionController::kMaxConnections);
+    CHECK(admission.admit(10, 100, 1, at(0)) == AdmissionController::kMaxConnections);
+    CHECK(admission.admit(0, 100, 0, at(0)) == AdmissionController::kQueueSize);
+    CHECK(admission.admit(0, 0, 0.05, at(0)) == AdmissionController::kLoopLag);
+    CHECK(admission.admitted() == 1);
+    CHECK(admission.shed() == 4);
+    CHECK(admission.count(AdmissionController::kMaxConnections) == 2);
+
+    // 没有设置任何一项时全部接受
+    AdmissionController open((AdmissionPolicy()));
+    CHECK(open.admit(1000000, 1000000, 10, at(0)) == AdmissionController::kAdmit);
+}
+
+/**
+ * 延迟短暂超过目标不拒绝 持续一个interval才开始拒绝
+ * 降到目标以下立刻恢复 之后重新计时
+ */
+void testQueueDelay() {
+    AdmissionPolicy policy;
+    policy.queueDelayTarget = 0.005;
+    policy.queueDelayInterval = 0.1;
+    AdmissionController admission(policy);
+    CHECK(admission.admit(0, 0, 0.001, at(0)) == AdmissionController::kAdmit);
+    CHECK(admission.admit(0, 0, 0.010, at(0.01)) == AdmissionController::kAdmit);
+    CHECK(admission.admit(0, 0, 0.010, at(0.05)) == AdmissionController::kAdmit);
+    CHECK(admission.admit(0, 0, 0.002, at(0.08)) == AdmissionController::kAdmit);
+    CHECK(admission.admit(0, 0, 0.010, at(0.10)) == AdmissionController::kAdmit);
+    CHECK(!admission.dropping());
+    CHECK(admission.admit(0, 0, 0.010, at(0.19)) == AdmissionController::kAdmit);
+    CHECK(admission.admit(0, 0, 0.010, at(0.20)) == AdmissionController::kQueueDelay);
+    CHECK(admission.dropping());
+    CHECK(admission.admit(0, 0, 0.006, at(0.50)) == AdmissionController::kQueueDelay);
+    CHECK(admission.admit(0, 0, 0.004, at(0.51)) == AdmissionController::kAdmit);
+    CHECK(!admission.dropping());
+    CHECK(admission.admit(0, 0, 0.010, at(0.52)) == AdmissionController::kAdmit);
+    CHECK(admission.count(AdmissionController::kQueueDelay) == 2);
+}
+
+int connectTo(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    CHECK(fd >= 0);
+    struct sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(::connect(fd, sockets::sockaddr_cast(&addr), static_cast<socklen_t>(sizeof addr)) == 0);
+    return fd;
+}
+
+// 读到EOF为止
+string readUntilEof(int fd) {
+    string result;
+    char buf[256];
+    ssize_t n;
+    while((n = ::read(fd, buf, sizeof buf)) > 0) {
+        result.append(buf, static_cast<size_t>(n));
+    }
+    CHECK(n == 0);
+    return result;
+}
+
+string readLine(int fd) {
+    string result;
+    char c;
+    while(::read(fd, &c, 1) == 1 && c != '\n') {
+        result += c;
+    }
+    return result;
+}
+
+/**
+ * 最多两个连接 第三个连接收到拒绝的回复后被关闭
+ * 关掉一个连接之后又可以接受新的连接
+ */
+void testServer() {
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "Admission");
+    AdmissionPolicy policy;
+    policy.maxConnections = 2;
+    policy.rejectMessage = "busy\n";
+    server.setAdmissionPolicy(policy);
+    server.setConnectionCallback([](const TcpConnectionPtr& conn) {
+        if(conn->connected()) {
+            conn->send("hello\n");
+        }
+    });
+    server.start();
+
+    Thread client([&loop]() {
+        int fd1 = connectTo(kPort);
+        CHECK(readLine(fd1) == "hello");
+        int fd2 = connectTo(kPort);
+        CHECK(readLine(fd2) == "hello");
+        int fd3 = connectTo(kPort);
+        CHECK(readUntilEof(fd3) == "busy\n");
+        ::close(fd3);
+
+        ::close(fd1);
+        CurrentThread::sleepUsec(100 * 1000);
+        int fd4 = connectTo(kPort);
+        CHECK(readLine(fd4) == "hello");
+        ::close(fd2);
+        ::close(fd4);
+        loop.runAfter(0.1, [&loop]() { loop.quit(); });
+    }, "client");
+    client.start();
+    loop.runAfter(10.0, []() {
+        fprintf(stderr, "testServer timed out\n");
+        abort();
+    });
+    loop.loop();
+    client.join();
+
+    const AdmissionController* admission = server.admissionController();
+    CHECK(admission != NULL);
+    CHECK(admission->admitted() == 3);
+    CHECK(admission->count(AdmissionController::kMaxConnections) == 1);
+    CHECK(server.numConnections() == 0);
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    testLimits();
+    testQueueDelay();
+    testServer();
+    printf("Admission_test passed\n");
+}
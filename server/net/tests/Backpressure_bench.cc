@@ -0,0 +1,145 @@
+/**
+* @description: Backpressure_bench.cc
+* @author: YQ Huang
+* @brief: 慢速下游的代理 比较有无背压时输出缓冲区和内存的峰值
+* @date: 2026/10/19 05:10:44
+*/
+
+#include "server/base/Logging.h"
+#include "server/base/ProcessInfo.h"
+#include "server/base/Thread.h"
+#include "server/net/Backpressure.h"
+#include "server/net/EventLoop.h"
+#include "server/net/InetAddress.h"
+#include "server/net/TcpConnection.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+/**
+ * 生产者尽快写入source的对端 消费者每读16KB休眠1ms 大约16MB/s
+ * 没有背压时代理把读到的数据全部堆在sink的输出缓冲区里
+ * 用法: backpressure_bench [total_mb]  两种模式各在一个子进程里运行 互不影响内存峰值
+ */
+
+TcpConnectionPtr makeConnection(EventLoop* loop, uint64_t id, int* peer) {
+    int fds[2];
+    if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        perror("socketpair");
+        exit(1);
+    }
+    // 连接这一端和TcpServer接受的连接一样是非阻塞的 对端由测试线程阻塞读写
+    ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    *peer = fds[1];
+    static std::shared_ptr<const string> prefix = std::make_shared<const string>("proxy");
+    TcpConnectionPtr conn(std::make_shared<TcpConnection>(loop, id, prefix, fds[0], InetAddress(), InetAddress()));
+    conn->setConnectionCallback([](const TcpConnectionPtr&) { });
+    conn->setCloseCallback([](const TcpConnectionPtr& c) {
+        c->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+    });
+    return conn;
+}
+
+// /proc/self/status里的VmHWM 单位KB
+long peakRssKb() {
+    string status = ProcessInfo::procStatus();
+    size_t pos = status.find("VmHWM:");
+    return pos == string::npos ? -1 : atol(status.c_str() + pos + 6);
+}
+
+void runProxy(bool backpressure, size_t total) {
+    EventLoop loop;
+    int sourcePeer, sinkPeer;
+    TcpConnectionPtr source(makeConnection(&loop, 1, &sourcePeer));
+    TcpConnectionPtr sink(makeConnection(&loop, 2, &sinkPeer));
+    size_t peak = 0;
+    source->setMessageCallback([&sink, &peak](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+        sink->send(buf);
+        peak = std::max(peak, sink->outputBuffer()->readableBytes());
+    });
+    source->connectEstablished();
+    sink->connectEstablished();
+    ReadGatePtr gate;
+    if(backpressure) {
+        gate = backpressure::link(source, sink, 256 * 1024, 64 * 1024);
+    }
+    long rssBefore = peakRssKb();
+
+    Thread producer([sourcePeer, total]() {
+        char buf[64 * 1024];
+        memset(buf, 'x', sizeof buf);
+        size_t sent = 0;
+        while(sent < total) {
+            ssize_t n = ::write(sourcePeer, buf, std::min(sizeof buf, total - sent));
+            if(n <= 0) {
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        ::shutdown(sourcePeer, SHUT_WR);
+    }, "producer");
+
+    std::atomic<bool> done(false);
+    Thread consumer([sinkPeer, total, &done]() {
+        char buf[16 * 1024];
+        size_t received = 0;
+        while(received < total) {
+            ssize_t n = ::read(sinkPeer, buf, sizeof buf);
+            if(n <= 0) {
+                break;
+            }
+            received += static_cast<size_t>(n);
+            CurrentThread::sleepUsec(1000);
+        }
+        done = true;
+    }, "consumer");
+
+    Timestamp start(Timestamp::now());
+    producer.start();
+    consumer.start();
+    loop.runEvery(0.01, [&loop, &done]() {
+        if(done) {
+            loop.quit();
+        }
+    });
+    loop.loop();
+    producer.join();
+    consumer.join();
+    double seconds = timeDifference(Timestamp::now(), start);
+
+    printf("%-14s peak output buffer %9zu bytes  peak RSS +%6ld KB  pauses %4lld  %.2f MB/s\n",
+           backpressure ? "backpressure" : "none", peak, peakRssKb() - rssBefore,
+           gate ? static_cast<long long>(gate->pauses()) : 0LL,
+           static_cast<double>(total) / seconds / 1024 / 1024);
+
+    if(source->connected()) {
+        source->connectDestroyed();
+    }
+    sink->connectDestroyed();
+    ::close(sourcePeer);
+    ::close(sinkPeer);
+}
+
+int main(int argc, char* argv[]) {
+    Logger::setLogLevel(Logger::WARN);
+    size_t totalMb = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 64;
+    for(bool backpressure : { true, false }) {
+        pid_t pid = ::fork();
+        if(pid == 0) {
+            runProxy(backpressure, totalMb * 1024 * 1024);
+            fflush(stdout);
+            _exit(0);
+        }
+        ::waitpid(pid, NULL, 0);
+    }
+}
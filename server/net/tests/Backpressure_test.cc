@@ -0,0 +1,259 @@
+/**
+* @description: Backpressure_test.cc
+* @author: YQ Huang
+* @brief: ReadGate和backpressure::link() 测试函数
+* @date: 2026/10/19 04:58:12
+*/
+
+#include "server/base/CountDownLatch.h"
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/base/ThreadPool.h"
+#include "server/base/tests/TestUtil.h"
+#include "server/net/Backpressure.h"
+#include "server/net/EventLoop.h"
+#include "server/net/InetAddress.h"
+#include "server/net/TcpConnection.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+const size_t kTotal = 8 * 1024 * 1024;
+const size_t kHighMark = 256 * 1024;
+const size_t kLowMark = 64 * 1024;
+
+// 用socketpair的一端建立连接 另一端存入peer
+TcpConnectionPtr makeConnection(EventLoop* loop, uint64_t id, int* peer) {
+    int fds[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+    // 连接这一端和TcpServer接受的连接一样是非阻塞的 对端由测试线程阻塞读写
+    ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    *peer = fds[1];
+    static std::shared_ptr<const string> prefix = std::make_shared<const string>("backpressure");
+    TcpConnectionPtr conn(std::make_shared<TcpConnection>(loop, id, prefix, fds[0], InetAddress(), InetAddress()));
+    conn->setConnectionCallback([](const TcpConnectionPtr&) { });
+    conn->setCloseCallback([](const TcpConnectionPtr& c) {
+        c->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+    });
+    return conn;
+}
+
+// 让loop处理完已经排队的函数
+void runFor(EventLoop* loop, double seconds) {
+    loop->runAfter(seconds, [loop]() { loop->quit(); });
+    loop->loop();
+}
+
+// 多次close()需要同样次数的open()才恢复读 新加入的连接跟随开关的状态
+void testNesting() {
+    EventLoop loop;
+    int peer1, peer2;
+    TcpConnectionPtr conn1(makeConnection(&loop, 1, &peer1));
+    TcpConnectionPtr conn2(makeConnection(&loop, 2, &peer2));
+    conn1->connectEstablished();
+    conn2->connectEstablished();
+
+    ReadGatePtr gate(std::make_shared<ReadGate>());
+    gate->add(conn1);
+    CHECK(gate->isOpen());
+    gate->close();
+    gate->close();
+    gate->open();
+    CHECK(!gate->isOpen());
+    CHECK(gate->pauses() == 1);
+    gate->add(conn2);
+    runFor(&loop, 0.02);
+    CHECK(!conn1->isReading());
+    CHECK(!conn2->isReading());
+
+    gate->open();
+    CHECK(gate->isOpen());
+    runFor(&loop, 0.02);
+    CHECK(conn1->isReading());
+    CHECK(conn2->isReading());
+
+    // 连接关闭后开关忽略它
+    conn1->connectDestroyed();
+    conn1.reset();
+    gate->close();
+    runFor(&loop, 0.02);
+    CHECK(!conn2->isReading());
+    conn2->connectDestroyed();
+    ::close(peer1);
+    ::close(peer2);
+}
+
+/**
+ * source收到的数据全部转发给sink sink的对端先不读
+ * sink的输出缓冲区应该停在高水位附近 而不是积累全部8MB
+ * 对端开始读之后source恢复 数据完整且有序
+ */
+void testProxy() {
+    EventLoop loop;
+    int sourcePeer, sinkPeer;
+    TcpConnectionPtr source(makeConnection(&loop, 1, &sourcePeer));
+    TcpConnectionPtr sink(makeConnection(&loop, 2, &sinkPeer));
+    size_t peak = 0;
+    source->setMessageCallback([&sink, &peak](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+        sink->send(buf);
+        peak = std::max(peak, sink->outputBuffer()->readableBytes());
+    });
+    source->connectEstablished();
+    sink->connectEstablished();
+    ReadGatePtr gate(backpressure::link(source, sink, kHighMark, kLowMark));
+
+    Thread producer([sourcePeer]() {
+        char buf[64 * 1024];
+        size_t sent = 0;
+        while(sent < kTotal) {
+            for(size_t i = 0; i < sizeof buf; ++i) {
+                buf[i] = static_cast<char>((sent + i) % 251);
+            }
+            ssize_t n = ::write(sourcePeer, buf, sizeof buf);
+            CHECK(n > 0);
+            sent += static_cast<size_t>(n);
+            CHECK(static_cast<size_t>(n) == sizeof buf);
+        }
+        ::shutdown(sourcePeer, SHUT_WR);
+    }, "producer");
+
+    std::atomic<bool> done(false);
+    std::atomic<bool> pausedBeforeRead(false);
+    Thread consumer([sinkPeer, &gate, &done, &pausedBeforeRead]() {
+        // 先不读 等source被暂停
+        CurrentThread::sleepUsec(300 * 1000);
+        pausedBeforeRead = !gate->isOpen();
+        char buf[64 * 1024];
+        size_t received = 0;
+        while(received < kTotal) {
+            ssize_t n = ::read(sinkPeer, buf, sizeof buf);
+            CHECK(n > 0);
+            for(ssize_t i = 0; i < n; ++i) {
+                CHECK(buf[i] == static_cast<char>((received + static_cast<size_t>(i)) % 251));
+            }
+            received += static_cast<size_t>(n);
+        }
+        done = true;
+    }, "consumer");
+
+    producer.start();
+    consumer.start();
+    loop.runEvery(0.01, [&loop, &done]() {
+        if(done) {
+            loop.quit();
+        }
+    });
+    loop.runAfter(20.0, []() {
+        fprintf(stderr, "testProxy timed out\n");
+        abort();
+    });
+    loop.loop();
+    producer.join();
+    consumer.join();
+
+    CHECK(pausedBeforeRead);
+    CHECK(gate->pauses() >= 1);
+    CHECK(gate->isOpen());
+    // 最后一次读入的数据可能越过高水位 但不会超出太多
+    CHECK(peak < kHighMark + 256 * 1024);
+    printf("proxy: peak output buffer %zu bytes, %lld pauses\n",
+           peak, static_cast<long long>(gate->pauses()));
+
+    // 对端的EOF要在恢复读之后才能看到
+    runFor(&loop, 0.05);
+    CHECK(source->disconnected());
+    sink->connectDestroyed();
+    ::close(sourcePeer);
+    ::close(sinkPeer);
+}
+
+/**
+ * sink在高水位之上时断开 输出缓冲区不会再降到低水位
+ * 共用开关的两个source都必须恢复读 不能一直暂停
+ */
+void testSinkClosed() {
+    EventLoop loop;
+    int peer1, peer2, sinkPeer;
+    TcpConnectionPtr source1(makeConnection(&loop, 1, &peer1));
+    TcpConnectionPtr source2(makeConnection(&loop, 2, &peer2));
+    TcpConnectionPtr sink(makeConnection(&loop, 3, &sinkPeer));
+    source1->connectEstablished();
+    source2->connectEstablished();
+    sink->connectEstablished();
+    ReadGatePtr gate(std::make_shared<ReadGate>());
+    gate->add(source1);
+    gate->add(source2);
+    backpressure::link(gate, sink, kHighMark, kLowMark);
+
+    // 对端不读 数据积在sink的输出缓冲区里
+    sink->send(string(4 * kHighMark, 'x'));
+    runFor(&loop, 0.02);
+    CHECK(!gate->isOpen());
+    CHECK(!source1->isReading());
+    CHECK(!source2->isReading());
+
+    sink->forceClose();
+    runFor(&loop, 0.02);
+    CHECK(sink->disconnected());
+    CHECK(gate->isOpen());
+    CHECK(source1->isReading());
+    CHECK(source2->isReading());
+
+    source1->connectDestroyed();
+    source2->connectDestroyed();
+    ::close(peer1);
+    ::close(peer2);
+    ::close(sinkPeer);
+}
+
+// 线程池任务积压时关闭开关 消化到低水位时打开
+void testThreadPool() {
+    ReadGatePtr gate(std::make_shared<ReadGate>());
+    ThreadPool pool("BackpressurePool");
+    backpressure::link(gate, &pool, 8, 2);
+    pool.start(1);
+
+    CountDownLatch started(1);
+    CountDownLatch release(1);
+    pool.run([&started, &release]() {
+        started.countDown();
+        release.wait();
+    });
+    started.wait();
+    for(int i = 0; i < 7; ++i) {
+        pool.run([]() { });
+    }
+    CHECK(gate->isOpen());
+    pool.run([]() { });
+    CHECK(!gate->isOpen());
+    CHECK(gate->pauses() == 1);
+    for(int i = 0; i < 4; ++i) {
+        pool.run([]() { });
+    }
+
+    release.countDown();
+    CountDownLatch finished(1);
+    pool.run([&finished]() { finished.countDown(); });
+    finished.wait();
+    CHECK(gate->isOpen());
+    CHECK(gate->pauses() == 1);
+    pool.stop();
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    testNesting();
+    testProxy();
+    testSinkClosed();
+    testThreadPool();
+    printf("Backpressure_test passed\n");
+}
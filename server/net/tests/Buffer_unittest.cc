@@ -7,6 +7,8 @@
 
 #include "server/net/Buffer.h"
 
+#include <unistd.h>
+
 #define BOOST_TEST_MAIN
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
@@ -158,6 +160,27 @@ BOOST_AUTO_TEST_CASE(testBufferFindEOL)
   BOOST_CHECK_EQUAL(buf.findEOL(buf.peek()+90000), null);
 }
 
+// 可写空间比writerIndex_小时 readFd只能往缓冲区里读writableBytes()字节 其余的放进extrabuf
+BOOST_AUTO_TEST_CASE(testBufferReadFd)
+{
+  Buffer buf;
+  buf.append(string(1000, 'x'));
+  BOOST_CHECK_LT(buf.writableBytes(), 100);
+
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::pipe(fds), 0);
+  const string input(100, 'y');
+  BOOST_REQUIRE_EQUAL(::write(fds[1], input.data(), input.size()), 100);
+  int savedErrno = 0;
+  BOOST_CHECK_EQUAL(buf.readFd(fds[0], &savedErrno), 100);
+  ::close(fds[0]);
+  ::close(fds[1]);
+
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 1100);
+  BOOST_CHECK_LE(buf.writableBytes(), Buffer::kInitialSize);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string(1000, 'x') + input);
+}
+
 void output(Buffer&& buf, const void* inner)
 {
   Buffer newbuf(std::move(buf));
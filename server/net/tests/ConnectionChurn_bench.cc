@@ -0,0 +1,123 @@
+/**
+* @description: ConnectionChurn_bench.cc
+* @author: YQ Huang
+* @brief: 连接频繁建立和关闭时TcpServer每秒能处理的连接数
+* @date: 2026/10/18 23:52:37
+*/
+
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/net/ConnectionTable.h"
+#include "server/net/EventLoop.h"
+#include "server/net/InetAddress.h"
+#include "server/net/SocketsOps.h"
+#include "server/net/TcpServer.h"
+
+#include <map>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+const uint16_t kPort = 20410;
+
+int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * 每次连接发送一个字节 服务端回复后主动关闭 客户端读到EOF再开始下一个
+ * 这样同时存在的连接最多只有几个 测的是建立和销毁连接的路径
+ * 服务端先关闭 TIME_WAIT留在服务端 不会耗尽客户端的本地端口
+ */
+void runClient(int connections, EventLoop* loop) {
+    struct sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int64_t start = nowNanos();
+    int done = 0;
+    for(int i = 0; i < connections; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        if(::connect(fd, sockets::sockaddr_cast(&addr), static_cast<socklen_t>(sizeof addr)) < 0) {
+            ::close(fd);
+            ::usleep(1000);
+            continue;
+        }
+        char c = 'x';
+        if(::write(fd, &c, 1) == 1 && ::read(fd, &c, 1) == 1 && ::read(fd, &c, 1) == 0) {
+            ++done;
+        }
+        ::close(fd);
+    }
+    double seconds = static_cast<double>(nowNanos() - start) / 1e9;
+    printf("TcpServer churn  %d connections in %.3f s  %.0f connects/sec\n",
+           done, seconds, done / seconds);
+    loop->quit();
+}
+
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    conn->send(buf);
+    conn->shutdown();
+}
+
+// 只比较连接表本身 旧的实现是按名字的std::map
+void benchTable(int n) {
+    const int kLive = 1000;
+    int64_t start = nowNanos();
+    {
+        std::map<string, TcpConnectionPtr> map;
+        for(int i = 1; i <= n; ++i) {
+            char buf[64];
+            snprintf(buf, sizeof buf, "-%s#%d", "127.0.0.1:20410", i);
+            map[string("ChurnServer") + buf] = TcpConnectionPtr();
+            if(i > kLive) {
+                snprintf(buf, sizeof buf, "-%s#%d", "127.0.0.1:20410", i - kLive);
+                map.erase(string("ChurnServer") + buf);
+            }
+        }
+    }
+    int64_t mapNs = nowNanos() - start;
+
+    start = nowNanos();
+    {
+        ConnectionTable table;
+        for(int i = 1; i <= n; ++i) {
+            table.insert(i, TcpConnectionPtr());
+            if(i > kLive) {
+                table.erase(i - kLive);
+            }
+        }
+    }
+    int64_t tableNs = nowNanos() - start;
+    printf("map<string>      %.1f ns per insert+erase\n", static_cast<double>(mapNs) / n);
+    printf("ConnectionTable  %.1f ns per insert+erase\n", static_cast<double>(tableNs) / n);
+}
+
+/**
+ * connectionchurn_bench [connections]
+ */
+int main(int argc, char* argv[]) {
+    Logger::setLogLevel(Logger::WARN);
+    int connections = argc > 1 ? atoi(argv[1]) : 20000;
+    benchTable(1000000);
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "ChurnServer");
+    server.setMessageCallback(onMessage);
+    server.start();
+    Thread client(std::bind(runClient, connections, &loop), "client");
+    client.start();
+    loop.loop();
+    client.join();
+}
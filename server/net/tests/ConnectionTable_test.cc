@@ -0,0 +1,85 @@
+/**
+* @description: ConnectionTable_test.cc
+* @author: YQ Huang
+* @brief: 连接ID哈希表 测试函数
+* @date: 2026/10/18 23:44:20
+*/
+
+#include "server/net/ConnectionTable.h"
+#include "server/base/tests/TestUtil.h"
+#include "server/net/EventLoop.h"
+#include "server/net/TcpConnection.h"
+
+#include <map>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+// 表里只放id 值用空指针代替 与std::map对照随机插入删除
+void testAgainstMap() {
+    ConnectionTable table;
+    std::map<uint64_t, bool> expected;
+    std::mt19937_64 rng(42);
+    uint64_t nextId = 1;
+    for(int round = 0; round < 200000; ++round) {
+        if(expected.empty() || rng() % 3 != 0) {
+            uint64_t id = nextId++;
+            table.insert(id, TcpConnectionPtr());
+            expected[id] = true;
+        }
+        else {
+            auto it = expected.begin();
+            std::advance(it, rng() % std::min<size_t>(expected.size(), 16));
+            CHECK(table.erase(it->first));
+            expected.erase(it);
+        }
+        if(round % 1000 == 0) {
+            CHECK(table.size() == expected.size());
+            for(const auto& item : expected) {
+                CHECK(table.find(item.first) != NULL);
+            }
+            size_t n = 0;
+            table.forEach([&n](uint64_t, const TcpConnectionPtr&) { ++n; });
+            CHECK(n == expected.size());
+        }
+    }
+    CHECK(!table.erase(nextId));
+    CHECK(table.find(nextId) == NULL);
+    CHECK(table.find(0) == NULL);
+    table.clear();
+    CHECK(table.empty());
+}
+
+// 删除后连接随之释放
+void testOwnership() {
+    EventLoop loop;
+    int fds[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+    std::shared_ptr<const string> prefix = std::make_shared<const string>("test-127.0.0.1:0");
+    TcpConnectionPtr conn(new TcpConnection(&loop, 7, prefix, fds[0], InetAddress(), InetAddress()));
+    CHECK(conn->name() == "test-127.0.0.1:0#7");
+    std::weak_ptr<TcpConnection> weak(conn);
+
+    ConnectionTable table;
+    table.insert(conn->id(), conn);
+    conn->setConnectionCallback([](const TcpConnectionPtr&) { });
+    conn->connectEstablished();
+    conn->connectDestroyed();
+    conn.reset();
+    CHECK(!weak.expired());
+    CHECK(table.find(7)->get() == weak.lock().get());
+    CHECK(table.erase(7));
+    CHECK(weak.expired());
+    ::close(fds[1]);
+}
+
+int main() {
+    testAgainstMap();
+    testOwnership();
+    printf("All tests passed\n");
+}
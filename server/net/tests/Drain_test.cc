@@ -0,0 +1,185 @@
+/**
+* @description: Drain_test.cc
+* @author: YQ Huang
+* @brief: TcpServer优雅关闭 测试函数
+* @date: 2026/10/19 04:12:36
+*/
+
+#include "server/base/CountDownLatch.h"
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+#include "server/net/EventLoop.h"
+#include "server/net/InetAddress.h"
+#include "server/net/SocketsOps.h"
+#include "server/net/TcpServer.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+const uint16_t kPort = 20470;
+const size_t kBigResponse = 16 * 1024 * 1024;
+
+int connectTo(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    CHECK(fd >= 0);
+    struct sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(::connect(fd, sockets::sockaddr_cast(&addr), static_cast<socklen_t>(sizeof addr)) == 0);
+    return fd;
+}
+
+// 读到EOF为止 返回读到的字节数
+size_t readUntilEof(int fd) {
+    char buf[64 * 1024];
+    size_t total = 0;
+    ssize_t n;
+    while((n = ::read(fd, buf, sizeof buf)) > 0) {
+        total += static_cast<size_t>(n);
+    }
+    CHECK(n == 0);
+    return total;
+}
+
+// "big"回复16MB 其他内容原样返回
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    std::string message = buf->retrieveAllAsString();
+    if(message == "big") {
+        conn->send(std::string(kBigResponse, 'x'));
+    }
+    else {
+        conn->send(message);
+    }
+}
+
+EventLoop* g_loop = NULL;
+TcpServer* g_server = NULL;
+CountDownLatch g_started(1);
+CountDownLatch g_drained(1);
+std::vector<DrainStats> g_progress;     // 只在IO线程里修改
+
+void runServer() {
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "drain");
+    server.setMessageCallback(onMessage);
+    server.start();
+    g_loop = &loop;
+    g_server = &server;
+    g_started.countDown();
+    loop.loop();
+}
+
+void testDrain() {
+    Thread thread(runServer, "server");
+    thread.start();
+    g_started.wait();
+
+    // idle: 空闲 收到EOF后关闭
+    // slow: 有16MB输出还没读 发完之后才半关闭
+    // stubborn: 收到EOF也不关闭 到期被强制关闭
+    int idle = connectTo(kPort);
+    int slow = connectTo(kPort);
+    int stubborn = connectTo(kPort);
+    char buf[16];
+    CHECK(::write(idle, "a", 1) == 1 && ::read(idle, buf, sizeof buf) == 1);
+    CHECK(::write(stubborn, "b", 1) == 1 && ::read(stubborn, buf, sizeof buf) == 1);
+    CHECK(::write(slow, "big", 3) == 3);
+    ::usleep(100 * 1000);
+
+    g_server->drain(0.5, [](const DrainStats& stats) {
+        g_progress.push_back(stats);
+        if(stats.done) {
+            g_drained.countDown();
+        }
+    });
+
+    CHECK(readUntilEof(idle) == 0);
+    ::close(idle);
+    CHECK(readUntilEof(slow) == kBigResponse);
+    ::close(slow);
+    CHECK(readUntilEof(stubborn) == 0);
+
+    g_drained.wait();
+    ::close(stubborn);
+    g_loop->runInLoop([] {
+        const DrainStats& stats = g_server->drainStats();
+        CHECK(stats.done);
+        CHECK(stats.timedOut);
+        CHECK(stats.remaining == 0);
+        CHECK(stats.shutdowns == 3);
+        CHECK(stats.forceClosed == 1);
+        CHECK(g_server->numConnections() == 0);
+        CHECK(!g_progress.empty());
+        CHECK(g_progress.back().done);
+        for(size_t i = 1; i < g_progress.size(); ++i) {
+            CHECK(g_progress[i].remaining < g_progress[i - 1].remaining || g_progress[i].done);
+        }
+        g_loop->quit();
+    });
+    thread.join();
+}
+
+/**
+ * 收到请求时开始drain 回复在另一个定时器里发出 这时两个缓冲区都是空的
+ * 连接刚有过读 不能算空闲 回复要在半关闭之前发出去
+ */
+void testAsyncReply() {
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort + 2, true), "async");
+    server.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        buf->retrieveAll();
+        server.drain(0.2, [&](const DrainStats& stats) {
+            if(stats.done) {
+                loop.quit();
+            }
+        });
+        loop.runAfter(0.002, [conn] { conn->send("reply"); });
+    });
+    server.start();
+    int fd = connectTo(kPort + 2);
+    CHECK(::write(fd, "request", 7) == 7);
+    loop.loop();
+
+    char buf[16];
+    CHECK(::read(fd, buf, sizeof buf) == 5);
+    CHECK(memcmp(buf, "reply", 5) == 0);
+    CHECK(readUntilEof(fd) == 0);
+    ::close(fd);
+    CHECK(server.drainStats().shutdowns == 1);
+}
+
+// 没有连接时立即完成
+void testEmpty() {
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort + 1, true), "empty");
+    server.start();
+    bool done = false;
+    server.drain(1.0, [&](const DrainStats& stats) {
+        CHECK(stats.done && !stats.timedOut && stats.remaining == 0);
+        done = true;
+        loop.quit();
+    });
+    CHECK(done);
+    CHECK(server.draining());
+}
+
+int main() {
+    Logger::setLogLevel(Logger::ERROR);
+    testDrain();
+    testAsyncReply();
+    testEmpty();
+    printf("All tests passed\n");
+}
@@ -0,0 +1,161 @@
+/**
+* @description: EventLoopStats_test.cc
+* @author: YQ Huang
+* @brief: EventLoop各阶段耗时统计和慢回调检测 测试函数
+* @date: 2026/10/18 22:24:51
+*/
+
+#include "server/base/Logging.h"
+#include "server/base/tests/TestUtil.h"
+#include "server/net/Channel.h"
+#include "server/net/EventLoop.h"
+#include "server/net/Socket.h"
+#include "server/net/SocketsOps.h"
+
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+std::string g_output;
+
+void captureOutput(const char* msg, int len) {
+    g_output.append(msg, len);
+}
+
+class SlowReader {
+public:
+    explicit SlowReader(EventLoop* loop)
+        : fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+          channel_(loop, fd_)
+    {
+        channel_.setReadCallback(std::bind(&SlowReader::onRead, this));
+        channel_.enableReading();
+    }
+
+    ~SlowReader() {
+        channel_.disableAll();
+        channel_.remove();
+        ::close(fd_);
+    }
+
+    void notify() {
+        uint64_t one = 1;
+        CHECK(::write(fd_, &one, sizeof one) == sizeof one);
+    }
+
+    int fd() const { return fd_; }
+
+private:
+    void onRead() {
+        uint64_t n = 0;
+        CHECK(::read(fd_, &n, sizeof n) == sizeof n);
+        ::usleep(30 * 1000);
+    }
+
+    int fd_;
+    Channel channel_;
+};
+
+/**
+ * IO线程在进入loop()之前queueInLoop() 第一次poll应该立即返回 而不是等到超时
+ */
+void testQueueBeforeLoop() {
+    EventLoop loop;
+    bool called = false;
+    loop.queueInLoop([&] {
+        called = true;
+        loop.quit();
+    });
+    Timestamp start(Timestamp::now());
+    loop.loop();
+    CHECK(called);
+    CHECK(timeDifference(Timestamp::now(), start) < 1.0);
+}
+
+/**
+ * 普通用户不能把SO_BUSY_POLL设置成超过net.core.busy_read的值 setKernelBusyPoll()
+ * 只报告一次 新连接不再设置 有的沙箱不检查权限 这时应该照常设置
+ * 需要root权限才能切换到普通用户 否则跳过
+ */
+void testSocketBusyPollDenied() {
+    if(::geteuid() != 0) {
+        return;
+    }
+    pid_t pid = ::fork();
+    CHECK(pid >= 0);
+    if(pid == 0) {
+        CHECK(::setgid(65534) == 0 && ::setuid(65534) == 0);
+        Socket socket(sockets::createNonblockingOrDie(AF_INET));
+        bool allowed = socket.setBusyPoll(50) == 0;
+        g_output.clear();
+        EventLoop loop;
+        loop.setKernelBusyPoll(50);
+        CHECK(loop.kernelBusyPoll() == 50);
+        CHECK(loop.socketBusyPoll() == (allowed ? 50 : 0));
+        CHECK((g_output.find("SO_BUSY_POLL 50us not supported") == std::string::npos) == allowed);
+        loop.setKernelBusyPoll(0);
+        CHECK(loop.socketBusyPoll() == 0);
+        ::_exit(0);
+    }
+    int status = 0;
+    CHECK(::waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main() {
+    Logger::setOutput(captureOutput);
+    testQueueBeforeLoop();
+    testSocketBusyPollDenied();
+    EventLoop loop;
+    CHECK(!loop.statsEnabled());
+    loop.setStatsEnabled(true);
+    loop.setSlowCallbackThreshold(0.02);
+    SlowReader reader(&loop);
+
+    reader.notify();
+    loop.runAfter(0.05, [] { ::usleep(30 * 1000); });
+    loop.runAfter(0.1, [&loop] {
+        loop.queueInLoop([] { ::usleep(30 * 1000); });
+        loop.queueInLoop([] { });
+    });
+    loop.runAfter(0.2, [&loop] { loop.quit(); });
+    loop.loop();
+
+    EventLoopStats stats = loop.stats();
+    printf("%s", stats.toString().c_str());
+    CHECK(stats.iterations > 0);
+    // 读回调 定时器 任务各一个
+    CHECK(stats.slowCallbacks == 3);
+    CHECK(stats.eventHandling.count() >= 1);
+    CHECK(stats.eventHandling.max() >= 30 * 1000 * 1000);
+    CHECK(stats.timers.count() >= 3);
+    CHECK(stats.timers.max() >= 30 * 1000 * 1000);
+    CHECK(stats.pendingFunctors.count() >= 1);
+    CHECK(stats.pendingFunctors.max() >= 30 * 1000 * 1000);
+    CHECK(stats.pollWait.count() == static_cast<uint64_t>(stats.iterations));
+
+    CHECK(g_output.find("slow callback") != std::string::npos);
+    char fdField[32];
+    snprintf(fdField, sizeof fdField, "fd=%d ", reader.fd());
+    CHECK(g_output.find(fdField) != std::string::npos);
+    CHECK(g_output.find("read=std::_Bind<void (SlowReader::*") != std::string::npos);
+    CHECK(g_output.find(" timers revents=") != std::string::npos);
+    CHECK(g_output.find("slow pending functor") != std::string::npos);
+
+    loop.resetStats();
+    CHECK(loop.stats().slowCallbacks == 0);
+    CHECK(loop.stats().timers.count() == 0);
+
+    // 关闭统计后不再记录
+    loop.setStatsEnabled(false);
+    loop.runAfter(0.01, [&loop] { loop.quit(); });
+    loop.loop();
+    CHECK(loop.stats().pollWait.count() == 0);
+    printf("All tests passed\n");
+}
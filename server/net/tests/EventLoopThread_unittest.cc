@@ -46,4 +46,17 @@ int main() {
         loop->runInLoop(std::bind(quit, loop));
         CurrentThread::sleepUsec(500 * 1000);
     }
+
+    {
+        // 固定在最后一个可用的CPU上
+        int cpu = CpuSet::ofCurrentThread().cpus().back();
+        EventLoopThread thr4;
+        thr4.setCpuAffinity(CpuSet::single(cpu));
+        thr4.setNumaNode(Numa::nodeOfCpu(cpu));
+        EventLoop* loop = thr4.startLoop();
+        printf("pinned: cpu = %d, loop cpu = %d, numa node = %d\n",
+               cpu, loop->pinnedCpu(), loop->numaNode());
+        loop->runInLoop(std::bind(print, loop));
+        CurrentThread::sleepUsec(500 * 1000);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+/**
+* @description: Handoff_test.cc
+* @author: YQ Huang
+* @brief: 监听socket交接 测试函数 两个EventLoop线程分别扮演新旧进程
+* @date: 2026/10/19 03:44:51
+*/
+
+#include "server/base/CountDownLatch.h"
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+#include "server/net/EventLoop.h"
+#include "server/net/Handoff.h"
+#include "server/net/InetAddress.h"
+#include "server/net/SocketsOps.h"
+#include "server/net/TcpServer.h"
+
+#include <atomic>
+#include <string>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+const uint16_t kPort = 20460;
+
+int connectTo(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    CHECK(fd >= 0);
+    struct sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(::connect(fd, sockets::sockaddr_cast(&addr), static_cast<socklen_t>(sizeof addr)) == 0);
+    return fd;
+}
+
+// 发送一行 读回复
+std::string roundTrip(int fd, const std::string& message) {
+    CHECK(::write(fd, message.data(), message.size()) == static_cast<ssize_t>(message.size()));
+    char buf[256];
+    ssize_t n = ::read(fd, buf, sizeof buf);
+    CHECK(n > 0);
+    return std::string(buf, static_cast<size_t>(n));
+}
+
+// 回复时带上服务器的名字 以区分新旧进程
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    std::string reply = conn->name().substr(0, 3) + ":" + buf->retrieveAllAsString();
+    conn->send(reply);
+}
+
+std::string g_path;
+CountDownLatch g_oldStarted(1);
+std::atomic<bool> g_handedOff(false);
+std::atomic<int> g_connectionsAtHandoff(-1);
+
+// 旧进程 交出监听socket后等已有的连接全部关闭再退出
+void runOld() {
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "old");
+    server.setMessageCallback(onMessage);
+    server.enableHandoff(g_path, [&] {
+        g_connectionsAtHandoff = static_cast<int>(server.numConnections());
+        g_handedOff = true;
+        loop.runEvery(0.01, [&] {
+            if(server.numConnections() == 0) {
+                loop.quit();
+            }
+        });
+    });
+    server.start();
+    loop.runInLoop([] { g_oldStarted.countDown(); });
+    loop.loop();
+    CHECK(server.handedOff());
+}
+
+EventLoop* g_newLoop = NULL;
+CountDownLatch g_newStarted(1);
+
+void runNew(int listenFd) {
+    EventLoop loop;
+    TcpServer server(&loop, listenFd, "new");
+    CHECK(server.ipPort() == "127.0.0.1:20460");
+    server.setMessageCallback(onMessage);
+    server.start();
+    g_newLoop = &loop;
+    g_newStarted.countDown();
+    loop.loop();
+}
+
+/**
+ * 只有root能切换用户 放开路径的权限后用nobody连接
+ * 旧进程检查SO_PEERCRED后直接关闭连接 不交出描述符
+ */
+void testRejectOtherUser() {
+    if(::geteuid() != 0) {
+        return;
+    }
+    CHECK(::chmod(g_path.c_str(), 0666) == 0);
+    pid_t pid = ::fork();
+    CHECK(pid >= 0);
+    if(pid == 0) {
+        if(::setgid(65534) != 0 || ::setuid(65534) != 0) {
+            _exit(2);
+        }
+        int sockfd = handoff::connect(g_path);
+        char buf[16];
+        _exit(sockfd >= 0 && ::read(sockfd, buf, sizeof buf) == 0 ? 0 : 1);
+    }
+    int status = 0;
+    CHECK(::waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(!g_handedOff);
+    CHECK(::chmod(g_path.c_str(), 0600) == 0);
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/handoff_test.%d.sock", static_cast<int>(::getpid()));
+    g_path = path;
+
+    Thread oldServer(runOld, "old");
+    oldServer.start();
+    g_oldStarted.wait();
+
+    int before = connectTo(kPort);
+    CHECK(roundTrip(before, "a") == "old:a");
+
+    struct stat st;
+    CHECK(::stat(g_path.c_str(), &st) == 0);
+    CHECK((st.st_mode & 0777) == 0600);
+    testRejectOtherUser();
+
+    std::string payload;
+    int listenFd = handoff::takeListenFd(g_path, &payload);
+    CHECK(listenFd >= 0);
+    CHECK(payload == "127.0.0.1:20460");
+    while(!g_handedOff) {
+        ::usleep(1000);
+    }
+    CHECK(g_connectionsAtHandoff == 1);
+    CHECK(::access(g_path.c_str(), F_OK) != 0);
+
+    Thread newServer(std::bind(runNew, listenFd), "new");
+    newServer.start();
+    g_newStarted.wait();
+
+    // 新连接由新进程处理 旧连接仍由旧进程处理
+    int after = connectTo(kPort);
+    CHECK(roundTrip(after, "b") == "new:b");
+    CHECK(roundTrip(before, "c") == "old:c");
+
+    // 旧连接关闭后旧进程退出 端口一直可用
+    ::close(before);
+    oldServer.join();
+    int last = connectTo(kPort);
+    CHECK(roundTrip(last, "d") == "new:d");
+    CHECK(roundTrip(after, "e") == "new:e");
+    ::close(last);
+    ::close(after);
+
+    g_newLoop->quit();
+    newServer.join();
+
+    // 没有旧进程时取不到描述符
+    CHECK(handoff::takeListenFd(g_path) < 0);
+    printf("All tests passed\n");
+}
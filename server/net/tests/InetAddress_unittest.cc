@@ -0,0 +1,51 @@
+/**
+* @description: InetAddress_unittest.cc
+* @author: YQ Huang
+* @brief: InetAddress 单元测试
+* @date: 2026/10/19 09:12:40
+*/
+
+#include "server/net/InetAddress.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using myserver::string;
+using myserver::net::InetAddress;
+
+BOOST_AUTO_TEST_CASE(testInetAddress)
+{
+  InetAddress addr0(1234);
+  BOOST_CHECK_EQUAL(addr0.toIp(), string("0.0.0.0"));
+  BOOST_CHECK_EQUAL(addr0.toIpPort(), string("0.0.0.0:1234"));
+  BOOST_CHECK_EQUAL(addr0.port(), 1234);
+
+  InetAddress addr1(4321, true);
+  BOOST_CHECK_EQUAL(addr1.toIp(), string("127.0.0.1"));
+  BOOST_CHECK_EQUAL(addr1.toIpPort(), string("127.0.0.1:4321"));
+  BOOST_CHECK_EQUAL(addr1.port(), 4321);
+
+  InetAddress addr2("1.2.3.4", 8888);
+  BOOST_CHECK_EQUAL(addr2.toIp(), string("1.2.3.4"));
+  BOOST_CHECK_EQUAL(addr2.toIpPort(), string("1.2.3.4:8888"));
+  BOOST_CHECK_EQUAL(addr2.port(), 8888);
+
+  InetAddress addr3("255.254.253.252", 65535);
+  BOOST_CHECK_EQUAL(addr3.toIp(), string("255.254.253.252"));
+  BOOST_CHECK_EQUAL(addr3.toIpPort(), string("255.254.253.252:65535"));
+  BOOST_CHECK_EQUAL(addr3.port(), 65535);
+}
+
+BOOST_AUTO_TEST_CASE(testInet6Address)
+{
+  InetAddress addr0(1234, false, true);
+  BOOST_CHECK_EQUAL(addr0.toIp(), string("::"));
+  BOOST_CHECK_EQUAL(addr0.toIpPort(), string("[::]:1234"));
+  BOOST_CHECK_EQUAL(addr0.port(), 1234);
+
+  InetAddress addr1(1234, true, true);
+  BOOST_CHECK_EQUAL(addr1.toIp(), string("::1"));
+  BOOST_CHECK_EQUAL(addr1.toIpPort(), string("[::1]:1234"));
+  BOOST_CHECK_EQUAL(addr1.port(), 1234);
+}
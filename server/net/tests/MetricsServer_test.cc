@@ -0,0 +1,123 @@
+/**
+* @description: MetricsServer_test.cc
+* @author: YQ Huang
+* @brief: 指标HTTP接口 测试函数
+* @date: 2026/10/18 23:16:52
+*/
+
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+#include "server/net/EventLoop.h"
+#include "server/net/InetAddress.h"
+#include "server/net/MetricsServer.h"
+#include "server/net/SocketsOps.h"
+#include "server/net/TcpServer.h"
+
+#include <string>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+const uint16_t kEchoPort = 20400;
+const uint16_t kMetricsPort = 20401;
+
+int connectTo(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    CHECK(fd >= 0);
+    struct sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(::connect(fd, sockets::sockaddr_cast(&addr), static_cast<socklen_t>(sizeof addr)) == 0);
+    return fd;
+}
+
+// 发送请求后一直读到对端关闭
+std::string request(uint16_t port, const std::string& req) {
+    int fd = connectTo(port);
+    CHECK(::write(fd, req.data(), req.size()) == static_cast<ssize_t>(req.size()));
+    std::string response;
+    char buf[4096];
+    ssize_t n = 0;
+    while((n = ::read(fd, buf, sizeof buf)) > 0) {
+        response.append(buf, n);
+    }
+    ::close(fd);
+    return response;
+}
+
+bool contains(const std::string& text, const std::string& s) {
+    return text.find(s) != std::string::npos;
+}
+
+void runClient(EventLoop* loop) {
+    // 一次回显 统计收发的字节和接受的连接
+    int fd = connectTo(kEchoPort);
+    CHECK(::write(fd, "hello", 5) == 5);
+    char buf[5];
+    CHECK(::read(fd, buf, sizeof buf) == 5);
+    ::close(fd);
+
+    // 分两次发送请求头
+    int mfd = connectTo(kMetricsPort);
+    CHECK(::write(mfd, "GET /metrics HTTP/1.1\r\n", 23) == 23);
+    ::usleep(10 * 1000);
+    CHECK(::write(mfd, "Host: localhost\r\n\r\n", 19) == 19);
+    std::string response;
+    char rbuf[4096];
+    ssize_t n = 0;
+    while((n = ::read(mfd, rbuf, sizeof rbuf)) > 0) {
+        response.append(rbuf, n);
+    }
+    ::close(mfd);
+
+    printf("%s\n", response.c_str());
+    CHECK(response.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    size_t bodyStart = response.find("\r\n\r\n") + 4;
+    char length[64];
+    snprintf(length, sizeof length, "Content-Length: %zu\r\n", response.size() - bodyStart);
+    CHECK(contains(response, length));
+    CHECK(contains(response, "# TYPE myserver_tcp_received_bytes_total counter\nmyserver_tcp_received_bytes_total "));
+    CHECK(!contains(response, "\nmyserver_tcp_received_bytes_total 0\n"));
+    CHECK(!contains(response, "\nmyserver_tcp_accepted_total 0\n"));
+    CHECK(contains(response, "\nmyserver_tcp_accept_errors_total 0\n"));
+    CHECK(contains(response, "# TYPE myserver_tcp_connections gauge\n"));
+    CHECK(contains(response, "myserver_tcp_read_size_bytes_count "));
+    CHECK(contains(response, "myserver_eventloop_iterations_total{loop=\"main\"} "));
+    CHECK(contains(response, "myserver_eventloop_poll_wait_ns{loop=\"main\",quantile=\"0.5\"} "));
+
+    std::string notFound = request(kMetricsPort, "GET / HTTP/1.0\r\n\r\n");
+    CHECK(notFound.compare(0, 22, "HTTP/1.1 404 Not Found") == 0);
+
+    loop->quit();
+}
+
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    conn->send(buf);
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    TcpServer echo(&loop, InetAddress(kEchoPort, true), "Echo");
+    echo.setMessageCallback(onMessage);
+    echo.start();
+    MetricsServer metrics(&loop, InetAddress(kMetricsPort, true));
+    metrics.addEventLoop(&loop, "main");
+    CHECK(loop.statsEnabled());
+    metrics.start();
+
+    Thread client(std::bind(runClient, &loop), "client");
+    client.start();
+    loop.loop();
+    client.join();
+    printf("All tests passed\n");
+}
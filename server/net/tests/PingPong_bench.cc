@@ -0,0 +1,140 @@
+/**
+* @description: PingPong_bench.cc
+* @author: YQ Huang
+* @brief: 阻塞等待和混合自旋两种轮询模式下的ping-pong往返延迟
+* @date: 2026/10/18 21:48:12
+*/
+
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/net/EventLoop.h"
+#include "server/net/InetAddress.h"
+#include "server/net/SocketsOps.h"
+#include "server/net/TcpServer.h"
+
+#include <algorithm>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+const size_t kMessageSize = 64;
+const int kWarmup = 1000;
+
+int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+bool writeAll(int fd, const char* buf, size_t len) {
+    while(len > 0) {
+        ssize_t n = ::write(fd, buf, len);
+        if(n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readAll(int fd, char* buf, size_t len) {
+    while(len > 0) {
+        ssize_t n = ::read(fd, buf, len);
+        if(n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 阻塞套接字的客户端 每次发送kMessageSize字节 等回显完整返回后再发下一个
+void runClient(uint16_t port, int iterations, std::vector<int64_t>* rtts, EventLoop* loop) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    struct sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    while(::connect(fd, sockets::sockaddr_cast(&addr), static_cast<socklen_t>(sizeof addr)) < 0) {
+        ::usleep(1000);
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, static_cast<socklen_t>(sizeof one));
+
+    char buf[kMessageSize] = { 'p' };
+    for(int i = 0; i < kWarmup + iterations; ++i) {
+        int64_t start = nowNanos();
+        if(!writeAll(fd, buf, sizeof buf) || !readAll(fd, buf, sizeof buf)) {
+            LOG_ERROR << "ping-pong broken at " << i;
+            break;
+        }
+        if(i >= kWarmup) {
+            rtts->push_back(nowNanos() - start);
+        }
+    }
+    ::close(fd);
+    loop->quit();
+}
+
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    conn->send(buf);
+}
+
+void bench(const char* mode, uint16_t port, int iterations, int64_t spinUs, int kernelBusyPollUs) {
+    EventLoop loop;
+    loop.setSpinBudget(spinUs);
+    if(kernelBusyPollUs > 0) {
+        loop.setKernelBusyPoll(kernelBusyPollUs);
+    }
+    TcpServer server(&loop, InetAddress(port, true), "PingPong");
+    server.setMessageCallback(onMessage);
+    server.start();
+
+    std::vector<int64_t> rtts;
+    rtts.reserve(iterations);
+    Thread client(std::bind(runClient, port, iterations, &rtts, &loop), "client");
+    client.start();
+    loop.loop();
+    client.join();
+
+    if(rtts.empty()) {
+        printf("%-8s no samples\n", mode);
+        return;
+    }
+    std::sort(rtts.begin(), rtts.end());
+    size_t n = rtts.size();
+    printf("%-8s p50 %7.2f us  p99 %7.2f us  p99.9 %7.2f us  spin wakeups %lld sleep wakeups %lld empty spins %lld\n",
+           mode,
+           static_cast<double>(rtts[n / 2]) / 1000.0,
+           static_cast<double>(rtts[n * 99 / 100]) / 1000.0,
+           static_cast<double>(rtts[n * 999 / 1000]) / 1000.0,
+           static_cast<long long>(loop.spinWakeups()),
+           static_cast<long long>(loop.sleepWakeups()),
+           static_cast<long long>(loop.emptySpins()));
+}
+
+/**
+ * pingpong_bench [iterations] [spin_us] [kernel_busy_poll_us]
+ * 单核机器上服务端自旋会和客户端抢CPU 混合模式的结果只在至少两个核时有意义
+ */
+int main(int argc, char* argv[]) {
+    Logger::setLogLevel(Logger::WARN);
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    int64_t spinUs = argc > 2 ? atoll(argv[2]) : 50;
+    int kernelBusyPollUs = argc > 3 ? atoi(argv[3]) : 0;
+
+    bench("blocking", 20380, iterations, 0, 0);
+    bench("hybrid", 20381, iterations, spinUs, kernelBusyPollUs);
+}
@@ -0,0 +1,197 @@
+/**
+* @description: RateLimit_test.cc
+* @author: YQ Huang
+* @brief: 连接读取限速 测试函数
+* @date: 2026/10/19 06:04:51
+*/
+
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+#include "server/net/EventLoop.h"
+#include "server/net/InetAddress.h"
+#include "server/net/RateLimiter.h"
+#include "server/net/SocketsOps.h"
+#include "server/net/TcpServer.h"
+
+#include <atomic>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+const uint16_t kPort = 20480;
+const size_t kKB = 1024;
+
+// 阻塞地写完len字节 然后关闭
+void writeAll(int fd, size_t len) {
+    char buf[16 * 1024];
+    memZero(buf, sizeof buf);
+    size_t sent = 0;
+    while(sent < len) {
+        ssize_t n = ::write(fd, buf, std::min(sizeof buf, len - sent));
+        CHECK(n > 0);
+        sent += static_cast<size_t>(n);
+    }
+    ::close(fd);
+}
+
+// 字节数和消息数任意一个超出都要暂停 暂停的时间取两者中较长的
+void testCharge() {
+    Timestamp now(Timestamp::fromUnixTime(1800000000));
+    RateLimit limit;
+    limit.bytesPerSecond = 1000;
+    limit.bytesBurst = 1000;
+    limit.messagesPerSecond = 10;
+    limit.messagesBurst = 2;
+    RateLimiter limiter(limit);
+    CHECK(limiter.charge(500, now) == 0);
+    CHECK(limiter.charge(500, now) == 0);
+    // 第三条消息超出 消息的欠账0.1秒 字节的欠账0.5秒
+    double delay = limiter.charge(500, now);
+    CHECK(delay > 0.49 && delay < 0.51);
+
+    RateLimiter unlimited((RateLimit()));
+    CHECK(!RateLimit().enabled());
+    CHECK(unlimited.charge(1 << 30, now) == 0);
+}
+
+/**
+ * 每个连接限速512KB/s 可以先读64KB 客户端写入512KB
+ * 最后一次读取不用等待 一次最多读128KB左右 所以读完至少需要(512-64-128)/512秒
+ */
+void testConnectionLimit() {
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "RateLimit");
+    RateLimit limit;
+    limit.bytesPerSecond = 512 * kKB;
+    limit.bytesBurst = 64 * kKB;
+    server.setConnectionRateLimit(limit);
+
+    size_t received = 0;
+    bool throttled = false;
+    Timestamp first;
+    Timestamp last;
+    server.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, Timestamp t) {
+        if(!first.valid()) {
+            first = t;
+        }
+        received += buf->readableBytes();
+        buf->retrieveAll();
+        // 限速在messageCallback返回之后才计算 等这一轮事件处理完再看
+        loop.queueInLoop([&throttled, conn]() { throttled = throttled || conn->isThrottled(); });
+        last = t;
+    });
+    server.setConnectionCallback([&loop](const TcpConnectionPtr& conn) {
+        if(conn->disconnected()) {
+            loop.quit();
+        }
+    });
+    server.start();
+
+    Thread client([]() {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        CHECK(fd >= 0);
+        struct sockaddr_in addr;
+        memZero(&addr, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(kPort);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CHECK(::connect(fd, sockets::sockaddr_cast(&addr), static_cast<socklen_t>(sizeof addr)) == 0);
+        writeAll(fd, 512 * kKB);
+    }, "client");
+    client.start();
+    loop.runAfter(10.0, []() {
+        fprintf(stderr, "testConnectionLimit timed out\n");
+        abort();
+    });
+    loop.loop();
+    client.join();
+
+    double seconds = timeDifference(last, first);
+    printf("connection limit: %zu bytes in %.3f s\n", received, seconds);
+    CHECK(received == 512 * kKB);
+    CHECK(throttled);
+    CHECK(seconds > 0.5);
+    CHECK(seconds < 3.0);
+}
+
+/**
+ * 两个连接共享512KB/s 每个连接写入256KB 合计同样受限
+ * 用socketpair建立连接 对端由各自的线程写入
+ */
+void testSharedLimit() {
+    EventLoop loop;
+    RateLimit limit;
+    limit.bytesPerSecond = 512 * kKB;
+    limit.bytesBurst = 64 * kKB;
+    RateLimiterPtr shared(std::make_shared<RateLimiter>(limit));
+
+    std::shared_ptr<const string> prefix = std::make_shared<const string>("shared");
+    size_t received = 0;
+    int closed = 0;
+    Timestamp first;
+    Timestamp last;
+    std::vector<TcpConnectionPtr> conns;
+    std::vector<int> peers;
+    for(uint64_t id = 1; id <= 2; ++id) {
+        int fds[2];
+        CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+        ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        peers.push_back(fds[1]);
+        TcpConnectionPtr conn(std::make_shared<TcpConnection>(&loop, id, prefix, fds[0],
+                                                              InetAddress(), InetAddress()));
+        conn->setSharedRateLimiter(shared);
+        conn->setMessageCallback([&](const TcpConnectionPtr&, Buffer* buf, Timestamp t) {
+            if(!first.valid()) {
+                first = t;
+            }
+            received += buf->readableBytes();
+            buf->retrieveAll();
+            last = t;
+        });
+        conn->setConnectionCallback([&](const TcpConnectionPtr& c) {
+            if(c->disconnected() && ++closed == 2) {
+                loop.quit();
+            }
+        });
+        conn->setCloseCallback([](const TcpConnectionPtr& c) {
+            c->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+        });
+        conn->connectEstablished();
+        conns.push_back(conn);
+    }
+
+    Thread writer1([&peers]() { writeAll(peers[0], 256 * kKB); }, "writer1");
+    Thread writer2([&peers]() { writeAll(peers[1], 256 * kKB); }, "writer2");
+    writer1.start();
+    writer2.start();
+    loop.runAfter(10.0, []() {
+        fprintf(stderr, "testSharedLimit timed out\n");
+        abort();
+    });
+    loop.loop();
+    writer1.join();
+    writer2.join();
+
+    double seconds = timeDifference(last, first);
+    printf("shared limit: %zu bytes in %.3f s\n", received, seconds);
+    CHECK(received == 512 * kKB);
+    // 两个连接各自的最后一次读取都不用等待 至少需要(512-64-2*128)/512秒
+    CHECK(seconds > 0.3);
+    CHECK(seconds < 3.0);
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    testCharge();
+    testConnectionLimit();
+    testSharedLimit();
+    printf("RateLimit_test passed\n");
+}
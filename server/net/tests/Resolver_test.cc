@@ -0,0 +1,232 @@
+/**
+* @description: Resolver_test.cc
+* @author: YQ Huang
+* @brief: 异步DNS解析 用环回地址上的DNS桩服务器测试
+* @date: 2026/10/19 02:58:40
+*/
+
+#include "server/base/Logging.h"
+#include "server/base/Thread.h"
+#include "server/base/tests/TestUtil.h"
+#include "server/net/EventLoop.h"
+#include "server/net/Resolver.h"
+#include "server/net/SocketsOps.h"
+
+#include <atomic>
+#include <map>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+const uint16_t kPort = 20453;
+
+/**
+ * DNS桩服务器 在自己的线程里阻塞收发
+ *   www.example.test      CNAME + 两个A(TTL 60) 和一个AAAA(TTL 30)
+ *   short.example.test    一个A(TTL 1) 没有AAAA
+ *   missing.example.test  NXDOMAIN
+ *   slow.example.test     不应答
+ */
+class StubDnsServer {
+public:
+    StubDnsServer()
+        : sockfd_(::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP)),
+          running_(true),
+          thread_(std::bind(&StubDnsServer::run, this), "stubdns")
+    {
+        struct sockaddr_in addr;
+        memZero(&addr, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(kPort);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CHECK(::bind(sockfd_, sockets::sockaddr_cast(&addr), sizeof addr) == 0);
+        struct timeval tv = { 0, 50 * 1000 };
+        ::setsockopt(sockfd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+        thread_.start();
+    }
+
+    ~StubDnsServer() {
+        running_ = false;
+        thread_.join();
+        ::close(sockfd_);
+    }
+
+    int queries(const string& name) {
+        MutexLockGuard lock(mutex_);
+        return queries_[name];
+    }
+
+private:
+    void run() {
+        char buf[512];
+        while(running_) {
+            struct sockaddr_in peer;
+            socklen_t peerLen = sizeof peer;
+            ssize_t n = ::recvfrom(sockfd_, buf, sizeof buf, 0, sockets::sockaddr_cast(reinterpret_cast<struct sockaddr_in6*>(&peer)), &peerLen);
+            if(n < 12) {
+                continue;
+            }
+            string name;
+            size_t pos = 12;
+            while(pos < static_cast<size_t>(n) && buf[pos] != 0) {
+                if(!name.empty()) {
+                    name += '.';
+                }
+                name.append(buf + pos + 1, static_cast<size_t>(buf[pos]));
+                pos += static_cast<size_t>(buf[pos]) + 1;
+            }
+            size_t questionEnd = pos + 5;
+            uint16_t type = static_cast<uint16_t>((static_cast<unsigned char>(buf[pos + 1]) << 8)
+                                                  | static_cast<unsigned char>(buf[pos + 2]));
+            {
+                MutexLockGuard lock(mutex_);
+                ++queries_[name];
+            }
+            if(name == "slow.example.test") {
+                continue;
+            }
+
+            string reply(buf, questionEnd);
+            reply[2] = static_cast<char>(0x81);     // QR RD
+            reply[3] = static_cast<char>(0x80);     // RA
+            uint16_t ancount = 0;
+            if(name == "missing.example.test") {
+                reply[3] = static_cast<char>(0x83); // NXDOMAIN
+            }
+            else if(name == "www.example.test") {
+                // 先放一条指向问题里域名的CNAME 解析时应跳过
+                appendRecord(&reply, 5, 60, string("\x03web\xc0\x0c", 6));
+                ++ancount;
+                if(type == 1) {
+                    appendRecord(&reply, 1, 60, string("\x0a\x00\x00\x01", 4));
+                    appendRecord(&reply, 1, 60, string("\x0a\x00\x00\x02", 4));
+                    ancount = static_cast<uint16_t>(ancount + 2);
+                }
+                else {
+                    struct in6_addr addr6;
+                    ::inet_pton(AF_INET6, "2001:db8::1", &addr6);
+                    appendRecord(&reply, 28, 30, string(reinterpret_cast<const char*>(&addr6), 16));
+                    ++ancount;
+                }
+            }
+            else if(name == "short.example.test" && type == 1) {
+                appendRecord(&reply, 1, 1, string("\x0a\x00\x00\x03", 4));
+                ++ancount;
+            }
+            reply[6] = static_cast<char>(ancount >> 8);
+            reply[7] = static_cast<char>(ancount & 0xff);
+            ::sendto(sockfd_, reply.data(), reply.size(), 0, sockets::sockaddr_cast(reinterpret_cast<struct sockaddr_in6*>(&peer)), peerLen);
+        }
+    }
+
+    // 名字用指向问题的压缩指针
+    static void appendRecord(string* out, uint16_t type, uint32_t ttl, const string& rdata) {
+        const char header[] = {
+            static_cast<char>(0xc0), 0x0c,
+            static_cast<char>(type >> 8), static_cast<char>(type & 0xff),
+            0x00, 0x01,
+            static_cast<char>(ttl >> 24), static_cast<char>((ttl >> 16) & 0xff),
+            static_cast<char>((ttl >> 8) & 0xff), static_cast<char>(ttl & 0xff),
+            static_cast<char>(rdata.size() >> 8), static_cast<char>(rdata.size() & 0xff),
+        };
+        out->append(header, sizeof header);
+        out->append(rdata);
+    }
+
+    int sockfd_;
+    std::atomic<bool> running_;
+    Thread thread_;
+    MutexLock mutex_;
+    std::map<string, int> queries_;
+};
+
+// 运行事件循环直到回调返回
+std::vector<InetAddress> resolveSync(EventLoop* loop, Resolver* resolver, const string& hostname) {
+    std::vector<InetAddress> result;
+    bool done = false;
+    resolver->resolve(hostname, [&](const string& name, const std::vector<InetAddress>& addresses) {
+        CHECK(name == hostname);
+        result = addresses;
+        done = true;
+        loop->quit();
+    });
+    loop->loop();
+    CHECK(done);
+    return result;
+}
+
+void sleepInLoop(EventLoop* loop, double seconds) {
+    loop->runAfter(seconds, [loop] { loop->quit(); });
+    loop->loop();
+}
+
+int main() {
+    Logger::setLogLevel(Logger::ERROR);
+    StubDnsServer server;
+    EventLoop loop;
+    Resolver resolver(&loop, InetAddress("127.0.0.1", kPort));
+
+    // A和AAAA都返回 IPv4在前
+    std::vector<InetAddress> www = resolveSync(&loop, &resolver, "www.example.test");
+    CHECK(www.size() == 3);
+    CHECK(www[0].toIp() == "10.0.0.1");
+    CHECK(www[1].toIp() == "10.0.0.2");
+    CHECK(www[2].family() == AF_INET6);
+    CHECK(www[2].toIp() == "2001:db8::1");
+    CHECK(server.queries("www.example.test") == 2);
+
+    // 命中缓存 大小写和末尾的点不影响
+    www = resolveSync(&loop, &resolver, "WWW.Example.test.");
+    CHECK(www.size() == 3);
+    CHECK(resolver.cacheHits() == 1);
+    CHECK(server.queries("www.example.test") == 2);
+
+    // 同时解析同一个域名只查询一次
+    int callbacks = 0;
+    for(int i = 0; i < 3; ++i) {
+        resolver.resolve("short.example.test", [&](const string&, const std::vector<InetAddress>& addresses) {
+            CHECK(addresses.size() == 1);
+            CHECK(addresses[0].toIp() == "10.0.0.3");
+            if(++callbacks == 3) {
+                loop.quit();
+            }
+        });
+    }
+    loop.loop();
+    CHECK(server.queries("short.example.test") == 2);
+
+    // TTL过期后重新查询
+    sleepInLoop(&loop, 1.1);
+    CHECK(resolveSync(&loop, &resolver, "short.example.test").size() == 1);
+    CHECK(server.queries("short.example.test") == 4);
+
+    // 失败的结果不缓存
+    CHECK(resolveSync(&loop, &resolver, "missing.example.test").empty());
+    CHECK(resolveSync(&loop, &resolver, "missing.example.test").empty());
+    CHECK(server.queries("missing.example.test") == 4);
+
+    // 超时重发一次后放弃
+    resolver.setTimeout(0.1);
+    resolver.setRetries(1);
+    CHECK(resolveSync(&loop, &resolver, "slow.example.test").empty());
+    CHECK(server.queries("slow.example.test") == 4);
+
+    // IP地址不查询
+    std::vector<InetAddress> literal = resolveSync(&loop, &resolver, "127.0.0.1");
+    CHECK(literal.size() == 1 && literal[0].toIp() == "127.0.0.1");
+    literal = resolveSync(&loop, &resolver, "::1");
+    CHECK(literal.size() == 1 && literal[0].family() == AF_INET6);
+
+    // 不合法的域名
+    CHECK(resolveSync(&loop, &resolver, "bad..name").empty());
+
+    printf("cache size %zu  queries sent %ld\n", resolver.cacheSize(), static_cast<long>(resolver.queriesSent()));
+    printf("All tests passed\n");
+}
@@ -0,0 +1,122 @@
+/**
+* @description: TcpConnection_bench.cc
+* @author: YQ Huang
+* @brief: 创建和销毁一个TcpConnection的内存分配次数和耗时
+* @date: 2026/10/19 00:36:52
+*/
+
+#include "server/base/Logging.h"
+#include "server/base/Slab.h"
+#include "server/net/EventLoop.h"
+#include "server/net/TcpConnection.h"
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace myserver;
+using namespace myserver::net;
+
+// 统计全局operator new的次数和字节数 替换后new和delete都对应malloc和free
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+std::atomic<int64_t> g_allocations(0);
+std::atomic<int64_t> g_allocatedBytes(0);
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+    void* p = ::malloc(size);
+    if(p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    ::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    ::free(p);
+}
+
+int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void onConnection(const TcpConnectionPtr&) { }
+void onMessage(const TcpConnectionPtr&, Buffer*, Timestamp) { }
+void onClose(const TcpConnectionPtr&) { }
+
+/**
+ * 与TcpServer::newConnection()和removeConnectionInLoop()相同的步骤
+ * shared为false时按以前的方式 用new创建 每个连接复制一遍回调
+ */
+void bench(EventLoop* loop, int fd, int n, bool shared) {
+    std::shared_ptr<const string> prefix = std::make_shared<const string>("bench-127.0.0.1:0");
+    std::shared_ptr<ConnectionCallbacks> callbacks = std::make_shared<ConnectionCallbacks>();
+    callbacks->connectionCallback = onConnection;
+    callbacks->messageCallback = onMessage;
+    callbacks->closeCallback = onClose;
+    InetAddress addr(0, true);
+
+    int64_t allocations = g_allocations.load();
+    int64_t bytes = g_allocatedBytes.load();
+    int64_t start = nowNanos();
+    for(int i = 0; i < n; ++i) {
+        // Socket析构时会关闭描述符 每次复制一个
+        int sockfd = ::dup(fd);
+        TcpConnectionPtr conn;
+        if(shared) {
+            conn = std::allocate_shared<TcpConnection>(
+                SlabAllocator<TcpConnection>(loop->connectionSlab()),
+                loop, i + 1, prefix, sockfd, addr, addr, callbacks);
+        }
+        else {
+            conn.reset(new TcpConnection(loop, i + 1, prefix, sockfd, addr, addr));
+            conn->setConnectionCallback(onConnection);
+            conn->setMessageCallback(onMessage);
+            conn->setCloseCallback(onClose);
+        }
+        conn->connectEstablished();
+        conn->connectDestroyed();
+    }
+    int64_t elapsed = nowNanos() - start;
+    printf("%-28s %6.1f allocations %7.1f bytes %7.1f ns per connection\n",
+           shared ? "allocate_shared + shared cb" : "new + per-connection cb",
+           static_cast<double>(g_allocations.load() - allocations) / n,
+           static_cast<double>(g_allocatedBytes.load() - bytes) / n,
+           static_cast<double>(elapsed) / n);
+}
+
+/**
+ * tcpconnection_bench [connections]
+ * 计数包括连接建立时分配的输入输出缓冲区
+ */
+int main(int argc, char* argv[]) {
+    Logger::setLogLevel(Logger::WARN);
+    int n = argc > 1 ? atoi(argv[1]) : 200000;
+    EventLoop loop;
+    int fds[2];
+    if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+    printf("sizeof(TcpConnection) = %zu\n", sizeof(TcpConnection));
+    // 先各跑一遍预热 Slab的第一块内存也在这时分配
+    bench(&loop, fds[0], 1000, false);
+    bench(&loop, fds[0], 1000, true);
+    bench(&loop, fds[0], n, false);
+    bench(&loop, fds[0], n, true);
+    // Slab的内存不经过operator new 单独列出
+    printf("slab node (object + control block) = %zu bytes\n", loop.connectionSlab()->objectSize());
+    ::close(fds[0]);
+    ::close(fds[1]);
+}